@@ -154,6 +154,9 @@ FGAIBase::FGAIBase(object_type ot, bool enableHot) :
     _collision_reported = false;
     _expiry_reported = false;
 
+    _interestTier = 0;
+    _interestDt = 0.0;
+
     _subID = 0;
 
     _x_offset = 0;
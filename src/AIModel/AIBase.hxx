@@ -321,6 +321,11 @@ public:
     static bool _isNight();
 
     std::string & getCallSign();
+
+    // Distance tier assigned by FGAIManager, and the simulation time not
+    // yet passed to update() while the object is updated at a reduced rate
+    int _interestTier;
+    double _interestDt;
 };
 
 typedef SGSharedPtr<FGAIBase> FGAIBasePtr;
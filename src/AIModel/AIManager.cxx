@@ -27,6 +27,7 @@
 #include <simgear/structure/exception.hxx>
 #include <simgear/structure/commands.hxx>
 #include <simgear/structure/SGBinding.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include <boost/mem_fn.hpp>
 #include <boost/foreach.hpp>
@@ -136,6 +137,30 @@ FGAIManager::init() {
     globals->get_commands()->addCommand("load-scenario", this, &FGAIManager::loadScenarioCommand);
     globals->get_commands()->addCommand("unload-scenario", this, &FGAIManager::unloadScenarioCommand);
     _environmentVisiblity = fgGetNode("/environment/visibility-m");
+
+    SGPropertyNode* interest = fgGetNode("/sim/ai/interest", true);
+    _interestEnabled = interest->getNode("enabled", true);
+    if (!_interestEnabled->hasValue())
+        _interestEnabled->setBoolValue(true);
+    _interestNearRange = interest->getNode("near-range-nm", true);
+    if (!_interestNearRange->hasValue())
+        _interestNearRange->setDoubleValue(20.0);
+    _interestDormantRange = interest->getNode("dormant-range-nm", true);
+    if (!_interestDormantRange->hasValue())
+        _interestDormantRange->setDoubleValue(60.0);
+    _interestFarRate = interest->getNode("far-rate-hz", true);
+    if (!_interestFarRate->hasValue())
+        _interestFarRate->setDoubleValue(10.0);
+    _interestDormantRate = interest->getNode("dormant-rate-hz", true);
+    if (!_interestDormantRate->hasValue())
+        _interestDormantRate->setDoubleValue(1.0);
+
+    const char* tierNames[INTEREST_TIERS] = { "near", "far", "dormant" };
+    for (int i = 0; i < INTEREST_TIERS; ++i) {
+        SGPropertyNode* tier = interest->getNode(tierNames[i], true);
+        _interestCount[i] = tier->getNode("count", true);
+        _interestUpdateTime[i] = tier->getNode("update-usec", true);
+    }
 }
 
 void
@@ -189,6 +214,7 @@ FGAIManager::shutdown()
     }
     
     ai_list.clear();
+    _grid.clear();
     _environmentVisiblity.clear();
     
     globals->get_commands()->removeCommand("load-scenario");
@@ -244,23 +270,71 @@ FGAIManager::update(double dt) {
   
     ai_list.erase(ai_list.begin(), firstAlive);
   
-    // every remaining item is alive. update them in turn, but guard for
-    // exceptions, so a single misbehaving AI object doesn't bring down the
-    // entire subsystem.
+    // the update interval of each distance tier; near objects are updated
+    // every frame
+    const SGVec3d userCart = globals->get_aircraft_position_cart();
+    const bool interest = _interestEnabled->getBoolValue();
+    const double nearM = _interestNearRange->getDoubleValue() * SG_NM_TO_METER;
+    double dormantM = _interestDormantRange->getDoubleValue() * SG_NM_TO_METER;
+    if (_environmentVisiblity)
+        dormantM = std::max(dormantM, _environmentVisiblity->getDoubleValue());
+    double interval[INTEREST_TIERS] = { 0.0, 0.0, 0.0 };
+    if (_interestFarRate->getDoubleValue() > 0.0)
+        interval[INTEREST_FAR] = 1.0 / _interestFarRate->getDoubleValue();
+    if (_interestDormantRate->getDoubleValue() > 0.0)
+        interval[INTEREST_DORMANT] = 1.0 / _interestDormantRate->getDoubleValue();
+
+    int count[INTEREST_TIERS] = { 0, 0, 0 };
+    double updateTime[INTEREST_TIERS] = { 0.0, 0.0, 0.0 };
+
+    _grid.clear();
+
+    // every remaining item is alive. update them in turn, at the rate of
+    // their distance tier, but guard for exceptions, so a single
+    // misbehaving AI object doesn't bring down the entire subsystem.
     BOOST_FOREACH(FGAIBase* base, ai_list) {
+        const SGVec3d cart = base->getCartPos();
+        _grid.insert(base, cart);
+
+        int tier = INTEREST_NEAR;
+        if (interest && hasInterestTiers(base)) {
+            double distM = dist(userCart, cart);
+            if (distM > dormantM)
+                tier = INTEREST_DORMANT;
+            else if (distM > nearM)
+                tier = INTEREST_FAR;
+        }
+        base->_interestTier = tier;
+        ++count[tier];
+
+        // skipped frames are made up for by a longer time step
+        base->_interestDt += dt;
+        if (base->_interestDt < interval[tier])
+            continue;
+        double baseDt = base->_interestDt;
+        base->_interestDt = 0.0;
+
+        SGTimeStamp start;
+        start.stamp();
         try {
             if (base->isa(FGAIBase::otThermal)) {
-                processThermal(dt, (FGAIThermal*)base);
+                processThermal(baseDt, (FGAIThermal*)base);
             } else {
-                base->update(dt);
+                base->update(baseDt);
             }
         } catch (sg_exception& e) {
             SG_LOG(SG_AI, SG_WARN, "caught exception updating AI model:" << base->_getName()<< ", which will be killed."
                    "\n\tError:" << e.getFormattedMessage());
             base->setDie(true);
         }
+        updateTime[tier] += (SGTimeStamp::now() - start).toUSecs();
     } // of live AI objects iteration
 
+    for (int i = 0; i < INTEREST_TIERS; ++i) {
+        _interestCount[i]->setIntValue(count[i]);
+        _interestUpdateTime[i]->setDoubleValue(updateTime[i]);
+    }
+
     thermal_lift_node->setDoubleValue( strength );  // for thermals
 }
 
@@ -622,4 +696,27 @@ FGAIManager::calcRangeFt(const SGVec3d& aCartPos, const FGAIBase* aObject) const
     return distM * SG_METER_TO_FEET;
 }
 
+void
+FGAIManager::findObjectsWithin(const SGVec3d& aCartPos, double rangeM,
+                               std::vector<FGAIBase*>& result) const
+{
+    _grid.query(aCartPos, rangeM, result);
+}
+
+// Traffic only matters to the user within range; objects which can hit,
+// carry or lift the user always run at full rate.
+bool
+FGAIManager::hasInterestTiers(FGAIBase* base)
+{
+    switch (base->getType()) {
+    case FGAIBase::otAircraft:
+    case FGAIBase::otShip:
+    case FGAIBase::otGroundVehicle:
+    case FGAIBase::otMultiplayer:
+        return true;
+    default:
+        return false;
+    }
+}
+
 //end AIManager.cxx
@@ -25,10 +25,13 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
 #include <simgear/structure/subsystem_mgr.hxx>
 #include <simgear/structure/SGSharedPtr.hxx>
 
+#include "AISpatialGrid.hxx"
+
 class FGAIBase;
 class FGAIThermal;
 
@@ -84,6 +87,13 @@ public:
 
     double calcRangeFt(const SGVec3d& aCartPos, const FGAIBase* aObject) const;
 
+    /**
+     * @brief append the AI and multiplayer objects within rangeM of aCartPos
+     * to result, using their positions as of the last update.
+     */
+    void findObjectsWithin(const SGVec3d& aCartPos, double rangeM,
+                           std::vector<FGAIBase*>& result) const;
+
     static const char* subsystemName() { return "ai-model"; }
 private:
     // FGSubmodelMgr is a friend for access to the AI_list
@@ -132,6 +142,26 @@ private:
     double strength;
     void processThermal( double dt, FGAIThermal* thermal );
 
+    // Interest management: objects are updated at full rate near the user,
+    // at a reduced rate further away, and rarely beyond visual and TCAS
+    // range.
+    enum InterestTier {
+        INTEREST_NEAR = 0,
+        INTEREST_FAR,
+        INTEREST_DORMANT,
+        INTEREST_TIERS
+    };
+    static bool hasInterestTiers(FGAIBase* base);
+
+    FGAISpatialGrid _grid;
+    SGPropertyNode_ptr _interestEnabled;
+    SGPropertyNode_ptr _interestNearRange;
+    SGPropertyNode_ptr _interestDormantRange;
+    SGPropertyNode_ptr _interestFarRate;
+    SGPropertyNode_ptr _interestDormantRate;
+    SGPropertyNode_ptr _interestCount[INTEREST_TIERS];
+    SGPropertyNode_ptr _interestUpdateTime[INTEREST_TIERS];
+
     SGPropertyChangeCallback<FGAIManager> cb_ai_bare;
     SGPropertyChangeCallback<FGAIManager> cb_ai_detailed;
     
@@ -25,6 +25,7 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
 #include <string>
 #include <stdio.h>
 
@@ -46,6 +47,9 @@ FGAIMultiplayer::FGAIMultiplayer() :
    mAllowExtrapolation = true;
    mLagAdjustSystemSpeed = 10;
    mLastTimestamp = 0;
+   mMotionFirst = 0;
+   mMotionCount = 0;
+   mDeltaCapable = false;
    lastUpdateTime = 0;
    playerLag = 0.03;
    compensateLag = 1;
@@ -122,7 +126,7 @@ void FGAIMultiplayer::update(double dt)
   FGAIBase::update(dt);
 
   // Check if we already got data
-  if (mMotionInfo.empty())
+  if (mMotionCount == 0)
     return;
 
   // The current simulation time we need to update for,
@@ -131,8 +135,8 @@ void FGAIMultiplayer::update(double dt)
   double curtime = globals->get_sim_time_sec();
 
   // Get the last available time
-  MotionInfo::reverse_iterator it = mMotionInfo.rbegin();
-  double curentPkgTime = it->second.time;
+  FGExternalMotionData& latest = motionInfoAt(mMotionCount - 1);
+  double curentPkgTime = latest.time;
 
   // Dynamically optimize the time offset between the feeder and the client
   // Well, 'dynamically' means that the dynamic of that update must be very
@@ -143,7 +147,7 @@ void FGAIMultiplayer::update(double dt)
   // component will provide this. We just take the error of the currently
   // requested time to the most recent available packet. This is the
   // target we want to reach in average.
-  double lag = it->second.lag;
+  double lag = latest.lag;
   if (!mTimeOffsetSet) {
     mTimeOffsetSet = true;
     mTimeOffset = curentPkgTime - curtime - lag;
@@ -206,7 +210,7 @@ void FGAIMultiplayer::update(double dt)
       SG_LOG(SG_AI, SG_DEBUG, "Offset adjust system: time offset = "
              << mTimeOffset << ", expected longitudinal position error due to "
              " current adjustment of the offset: "
-             << fabs(norm(it->second.linearVel)*systemIncrement));
+             << fabs(norm(latest.linearVel)*systemIncrement));
     }
   }
 
@@ -224,20 +228,20 @@ void FGAIMultiplayer::update(double dt)
     // that is good ...
 
     // Find the first packet before the target time
-    MotionInfo::iterator nextIt = mMotionInfo.upper_bound(tInterp);
-    if (nextIt == mMotionInfo.begin()) {
+    size_t next = motionInfoUpperBound(tInterp);
+    if (next == 0) {
       SG_LOG(SG_AI, SG_DEBUG, "Taking oldest packet!");
       // We have no packet before the target time, just use the first one
-      MotionInfo::iterator firstIt = mMotionInfo.begin();
-      ecPos = firstIt->second.position;
-      ecOrient = firstIt->second.orientation;
-      ecLinearVel = firstIt->second.linearVel;
+      FGExternalMotionData& first = motionInfoAt(0);
+      ecPos = first.position;
+      ecOrient = first.orientation;
+      ecLinearVel = first.linearVel;
       speed = norm(ecLinearVel) * SG_METER_TO_NM * 3600.0;
 
       std::vector<FGPropertyData*>::const_iterator firstPropIt;
       std::vector<FGPropertyData*>::const_iterator firstPropItEnd;
-      firstPropIt = firstIt->second.properties.begin();
-      firstPropItEnd = firstIt->second.properties.end();
+      firstPropIt = first.properties.begin();
+      firstPropItEnd = first.properties.end();
       while (firstPropIt != firstPropItEnd) {
         //cout << " Setting property..." << (*firstPropIt)->id;
         PropertyMap::iterator pIt = mPropertyMap.find((*firstPropIt)->id);
@@ -278,17 +282,19 @@ void FGAIMultiplayer::update(double dt)
     } else {
       // Ok, we have really found something where our target time is in between
       // do interpolation here
-      MotionInfo::iterator prevIt = nextIt;
-      --prevIt;
+      size_t prev = next - 1;
 
       /*
       * RJH: 2017-02-16 another exception thrown here when running under debug (and hence huge frame delays)
       * the value of nextIt was already end(); which I think means that we cannot run the entire next section of code.
       */
-      if (nextIt != prevIt && nextIt != mMotionInfo.end()) {
+      if (next < mMotionCount) {
+          FGExternalMotionData& prevInfo = motionInfoAt(prev);
+          FGExternalMotionData& nextInfo = motionInfoAt(next);
+
           // Interpolation coefficient is between 0 and 1
-          double intervalStart = prevIt->second.time;
-          double intervalEnd = nextIt->second.time;
+          double intervalStart = prevInfo.time;
+          double intervalEnd = nextInfo.time;
 
           double intervalLen = intervalEnd - intervalStart;
           double tau = 0.0;
@@ -299,22 +305,22 @@ void FGAIMultiplayer::update(double dt)
               << intervalLen << ", interpolation parameter = " << tau);
 
           // Here we do just linear interpolation on the position
-          ecPos = interpolate(tau, prevIt->second.position, nextIt->second.position);
-          ecOrient = interpolate((float)tau, prevIt->second.orientation,
-              nextIt->second.orientation);
-          ecLinearVel = interpolate((float)tau, prevIt->second.linearVel, nextIt->second.linearVel);
+          ecPos = interpolate(tau, prevInfo.position, nextInfo.position);
+          ecOrient = interpolate((float)tau, prevInfo.orientation,
+              nextInfo.orientation);
+          ecLinearVel = interpolate((float)tau, prevInfo.linearVel, nextInfo.linearVel);
           speed = norm(ecLinearVel) * SG_METER_TO_NM * 3600.0;
 
-          if (prevIt->second.properties.size()
-              == nextIt->second.properties.size()) {
+          if (prevInfo.properties.size()
+              == nextInfo.properties.size()) {
               std::vector<FGPropertyData*>::const_iterator prevPropIt;
               std::vector<FGPropertyData*>::const_iterator prevPropItEnd;
               std::vector<FGPropertyData*>::const_iterator nextPropIt;
               std::vector<FGPropertyData*>::const_iterator nextPropItEnd;
-              prevPropIt = prevIt->second.properties.begin();
-              prevPropItEnd = prevIt->second.properties.end();
-              nextPropIt = nextIt->second.properties.begin();
-              nextPropItEnd = nextIt->second.properties.end();
+              prevPropIt = prevInfo.properties.begin();
+              prevPropItEnd = prevInfo.properties.end();
+              nextPropIt = nextInfo.properties.begin();
+              nextPropItEnd = nextInfo.properties.end();
               while (prevPropIt != prevPropItEnd) {
                   PropertyMap::iterator pIt = mPropertyMap.find((*prevPropIt)->id);
                   //cout << " Setting property..." << (*prevPropIt)->id;
@@ -384,17 +390,16 @@ void FGAIMultiplayer::update(double dt)
           }
 
           // Now throw away too old data
-          if (prevIt != mMotionInfo.begin())
+          if (prev > 1)
           {
-              --prevIt;
-              mMotionInfo.erase(mMotionInfo.begin(), prevIt);
+              dropMotionInfo(prev - 1);
           }
       }
     }
   } else {
     // Ok, we need to predict the future, so, take the best data we can have
     // and do some eom computation to guess that for now.
-    FGExternalMotionData& motionInfo = it->second;
+    FGExternalMotionData& motionInfo = latest;
 
     // The time to predict, limit to 3 seconds
     double t = tInterp - motionInfo.time;
@@ -430,8 +435,8 @@ void FGAIMultiplayer::update(double dt)
 	std::vector<FGPropertyData*>::const_iterator firstPropIt;
     std::vector<FGPropertyData*>::const_iterator firstPropItEnd;
     speed = norm(ecLinearVel) * SG_METER_TO_NM * 3600.0;
-    firstPropIt = it->second.properties.begin();
-    firstPropItEnd = it->second.properties.end();
+    firstPropIt = latest.properties.begin();
+    firstPropItEnd = latest.properties.end();
     while (firstPropIt != firstPropItEnd) {
       PropertyMap::iterator pIt = mPropertyMap.find((*firstPropIt)->id);
       //cout << " Setting property..." << (*firstPropIt)->id;
@@ -539,27 +544,100 @@ void FGAIMultiplayer::update(double dt)
   Transform();
 }
 
+// Copy the motion data and take over the properties of 'from', leaving its
+// property list empty. 'to' must not hold any properties.
+static void
+moveMotionInfo(FGExternalMotionData& to, FGExternalMotionData& from)
+{
+  std::vector<FGPropertyData*> properties;
+  properties.swap(from.properties);
+  to = from;
+  to.properties.swap(properties);
+  // hand the (empty) list back, so both sides keep some capacity
+  from.properties.swap(properties);
+}
+
+size_t
+FGAIMultiplayer::motionInfoUpperBound(double time)
+{
+  size_t first = 0;
+  size_t count = mMotionCount;
+  while (count > 0) {
+    size_t step = count / 2;
+    if (motionInfoAt(first + step).time <= time) {
+      first += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+  return first;
+}
+
+void
+FGAIMultiplayer::dropMotionInfo(size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+    motionInfoAt(i).clearProperties();
+  mMotionFirst = (mMotionFirst + count) % mMotionInfo.size();
+  mMotionCount -= count;
+}
+
 void
 FGAIMultiplayer::addMotionInfo(FGExternalMotionData& motionInfo,
                                long stamp)
 {
   mLastTimestamp = stamp;
 
-  if (!mMotionInfo.empty()) {
-    double diff = motionInfo.time - mMotionInfo.rbegin()->first;
+  if (mMotionCount > 0) {
+    FGExternalMotionData& latest = motionInfoAt(mMotionCount - 1);
+    double diff = motionInfo.time - latest.time;
 
     // packet is very old -- MP has probably reset (incl. his timebase)
     if (diff < -10.0)
-      mMotionInfo.clear();
+      dropMotionInfo(mMotionCount);
 
     // drop packets arriving out of order
     else if (diff < 0.0)
       return;
+
+    // same timestamp, the new packet replaces the old one
+    else if (diff == 0.0) {
+      latest.clearProperties();
+      moveMotionInfo(latest, motionInfo);
+      return;
+    }
+  }
+
+  if (mMotionCount == mMotionInfo.size()) {
+    // Grow the ring. The entries are moved over by hand, as copying them
+    // would share their properties.
+    MotionInfo grown(std::max<size_t>(2*mMotionInfo.size(), 16));
+    for (size_t i = 0; i < mMotionCount; ++i)
+      moveMotionInfo(grown[i], motionInfoAt(i));
+    mMotionInfo.swap(grown);
+    mMotionFirst = 0;
   }
-  mMotionInfo[motionInfo.time] = motionInfo;
-  // We just copied the property (pointer) list - they are ours now. Clear the
-  // properties list in given/returned object, so former owner won't deallocate them.
-  motionInfo.properties.clear();
+
+  // The properties are ours now; the given object is left with an empty
+  // list, so the former owner won't deallocate them.
+  moveMotionInfo(motionInfoAt(mMotionCount), motionInfo);
+  ++mMotionCount;
+}
+
+void
+FGAIMultiplayer::addDeltaMotionInfo(FGExternalMotionData& motionInfo,
+                                    long stamp, uint32_t keyframe,
+                                    bool isKeyframe)
+{
+  if (isKeyframe)
+    mDeltaDecoder.setKeyframe(motionInfo.properties, keyframe);
+  else
+    // if we missed the keyframe, go with the changed properties until the
+    // next one arrives
+    mDeltaDecoder.complete(motionInfo.properties, keyframe);
+
+  addMotionInfo(motionInfo, stamp);
 }
 
 void
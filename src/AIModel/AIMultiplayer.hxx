@@ -23,8 +23,10 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <MultiPlayer/mpmessages.hxx>
+#include <MultiPlayer/mpdelta.hxx>
 #include "AIBase.hxx"
 
 class FGAIMultiplayer : public FGAIBase {
@@ -37,11 +39,21 @@ public:
   virtual void update(double dt);
 
   void addMotionInfo(FGExternalMotionData& motionInfo, long stamp);
+  // Add the data of a MP_DELTA_DATA_ID message, completing its properties
+  // from the keyframe they refer to, or of a keyframe for those.
+  void addDeltaMotionInfo(FGExternalMotionData& motionInfo, long stamp,
+                          uint32_t keyframe, bool isKeyframe);
   void setDoubleProperty(const std::string& prop, double val);
 
   long getLastTimestamp(void) const
   { return mLastTimestamp; }
 
+  // whether the sender can decode delta position messages
+  void setDeltaCapable(bool deltaCapable)
+  { mDeltaCapable = deltaCapable; }
+  bool getDeltaCapable(void) const
+  { return mDeltaCapable; }
+
   void setAllowExtrapolation(bool allowExtrapolation)
   { mAllowExtrapolation = allowExtrapolation; }
   bool getAllowExtrapolation(void) const
@@ -77,9 +89,22 @@ public:
 
 private:
 
-  // Automatic sorting of motion data according to its timestamp
-  typedef std::map<double,FGExternalMotionData> MotionInfo;
+  // Motion data sorted by timestamp, kept in a ring buffer so that adding
+  // and dropping packets doesn't allocate once the buffer has grown.
+  // Entries outside of the live range have their properties cleared.
+  typedef std::vector<FGExternalMotionData> MotionInfo;
   MotionInfo mMotionInfo;
+  size_t mMotionFirst;
+  size_t mMotionCount;
+
+  FGExternalMotionData& motionInfoAt(size_t i)
+  { return mMotionInfo[(mMotionFirst + i) % mMotionInfo.size()]; }
+  size_t motionInfoUpperBound(double time);
+  void dropMotionInfo(size_t count);
+
+  // the keyframe delta messages are completed from
+  FGMPDeltaDecoder mDeltaDecoder;
+  bool mDeltaCapable;
 
   // Map between the property id's from the multiplayers network packets
   // and the property nodes
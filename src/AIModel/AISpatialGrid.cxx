@@ -0,0 +1,104 @@
+// FGAISpatialGrid - uniform grid over the AI and multiplayer objects
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "AISpatialGrid.hxx"
+
+#include <cmath>
+
+FGAISpatialGrid::FGAISpatialGrid(double cellSizeM) :
+    _cellSize(cellSizeM),
+    _size(0)
+{
+}
+
+void FGAISpatialGrid::clear()
+{
+    // keep the storage of the cells, but don't let cells which stay empty
+    // pile up as objects move around
+    if (_cells.size() > 4 * _size + 64) {
+        _cells.clear();
+    } else {
+        for (CellMap::iterator it = _cells.begin(); it != _cells.end(); ++it)
+            it->second.clear();
+    }
+    _size = 0;
+}
+
+void FGAISpatialGrid::insert(FGAIBase* object, const SGVec3d& cart)
+{
+    Entry e = { object, cart };
+    _cells[cellKey(cellIndex(cart.x()), cellIndex(cart.y()),
+                   cellIndex(cart.z()))].push_back(e);
+    ++_size;
+}
+
+void FGAISpatialGrid::query(const SGVec3d& cart, double rangeM,
+                            ObjectVec& result) const
+{
+    if (_size == 0)
+        return;
+
+    const double range2 = rangeM * rangeM;
+    int x0 = cellIndex(cart.x() - rangeM), x1 = cellIndex(cart.x() + rangeM);
+    int y0 = cellIndex(cart.y() - rangeM), y1 = cellIndex(cart.y() + rangeM);
+    int z0 = cellIndex(cart.z() - rangeM), z1 = cellIndex(cart.z() + rangeM);
+
+    // for large ranges, looking at every cell is cheaper than the lookups
+    bool scanAll = double(x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1)
+        > _cells.size();
+
+    if (scanAll) {
+        for (CellMap::const_iterator it = _cells.begin(); it != _cells.end(); ++it) {
+            for (Cell::const_iterator e = it->second.begin(); e != it->second.end(); ++e) {
+                if (distSqr(cart, e->cart) <= range2)
+                    result.push_back(e->object);
+            }
+        }
+        return;
+    }
+
+    for (int x = x0; x <= x1; ++x) {
+        for (int y = y0; y <= y1; ++y) {
+            for (int z = z0; z <= z1; ++z) {
+                CellMap::const_iterator it = _cells.find(cellKey(x, y, z));
+                if (it == _cells.end())
+                    continue;
+                for (Cell::const_iterator e = it->second.begin(); e != it->second.end(); ++e) {
+                    if (distSqr(cart, e->cart) <= range2)
+                        result.push_back(e->object);
+                }
+            }
+        }
+    }
+}
+
+int FGAISpatialGrid::cellIndex(double coord) const
+{
+    return static_cast<int>(std::floor(coord / _cellSize));
+}
+
+uint64_t FGAISpatialGrid::cellKey(int x, int y, int z)
+{
+    // 21 bits per axis is plenty for earth centered coordinates in
+    // cells of a few km
+    const uint64_t mask = (1 << 21) - 1;
+    return ((uint64_t(x) & mask) << 42) | ((uint64_t(y) & mask) << 21)
+        | (uint64_t(z) & mask);
+}
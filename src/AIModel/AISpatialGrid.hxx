@@ -0,0 +1,70 @@
+// FGAISpatialGrid - uniform grid over the AI and multiplayer objects
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _FG_AISPATIALGRID_HXX
+#define _FG_AISPATIALGRID_HXX
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <simgear/math/SGMath.hxx>
+
+class FGAIBase;
+
+/**
+ * Objects bucketed by cells of a uniform grid in earth centered
+ * coordinates, so that finding the objects within some range doesn't
+ * need to look at all of them. FGAIManager rebuilds it every frame;
+ * the cells keep their storage across rebuilds.
+ */
+class FGAISpatialGrid
+{
+public:
+    typedef std::vector<FGAIBase*> ObjectVec;
+
+    explicit FGAISpatialGrid(double cellSizeM = 40000.0);
+
+    void clear();
+    void insert(FGAIBase* object, const SGVec3d& cart);
+
+    /**
+     * Append the objects within rangeM of cart to result, in no
+     * particular order.
+     */
+    void query(const SGVec3d& cart, double rangeM, ObjectVec& result) const;
+
+    size_t size() const
+    { return _size; }
+
+private:
+    struct Entry
+    {
+        FGAIBase* object;
+        SGVec3d cart;
+    };
+    typedef std::vector<Entry> Cell;
+    typedef std::unordered_map<uint64_t, Cell> CellMap;
+
+    int cellIndex(double coord) const;
+    static uint64_t cellKey(int x, int y, int z);
+
+    double _cellSize;
+    CellMap _cells;
+    size_t _size;
+};
+
+#endif // _FG_AISPATIALGRID_HXX
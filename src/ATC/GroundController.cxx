@@ -64,6 +64,34 @@
 
 using std::string;
 
+// Size of the cells of the proximity grid. Larger than the range at which
+// taxiing aircraft react to each other, so a query only looks at a few cells.
+static const double TrafficCellSize = 250.0;
+
+static int trafficCellIndex(double coord)
+{
+    return static_cast<int>(std::floor(coord / TrafficCellSize));
+}
+
+static uint64_t trafficCellKey(int x, int y, int z)
+{
+    const uint64_t mask = (1 << 21) - 1;
+    return ((uint64_t(x) & mask) << 42) | ((uint64_t(y) & mask) << 21)
+        | (uint64_t(z) & mask);
+}
+
+static uint64_t trafficCell(const SGVec3d& cart)
+{
+    return trafficCellKey(trafficCellIndex(cart.x()), trafficCellIndex(cart.y()),
+                          trafficCellIndex(cart.z()));
+}
+
+// Position on the ellipsoid, so the straight distance between two aircraft
+// never exceeds the geodesic distance the conflict checks use.
+static SGVec3d trafficCart(double lat, double lon)
+{
+    return SGVec3d::fromGeod(SGGeod::fromDeg(lon, lat));
+}
 
 /***************************************************************************
  * FGGroundController()
@@ -75,7 +103,8 @@ bool compare_trafficrecords(FGTrafficRecord a, FGTrafficRecord b)
 }
 
 FGGroundController::FGGroundController() :
-    parent(NULL)
+    parent(NULL),
+    maxTrafficRadius(0)
 {
     hasNetwork = false;
     count = 0;
@@ -113,20 +142,9 @@ void FGGroundController::announcePosition(int id,
         return;
     }
 
-    TrafficVectorIterator i = activeTraffic.begin();
-    // Search search if the current id alread has an entry
-    // This might be faster using a map instead of a vector, but let's start by taking a safe route
-    if (!activeTraffic.empty()) {
-        //while ((i->getId() != id) && i != activeTraffic.end()) {
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
-            }
-            i++;
-        }
-    }
+    TrafficVectorIterator i = findTraffic(id);
     // Add a new TrafficRecord if no one exsists for this aircraft.
-    if (i == activeTraffic.end() || (activeTraffic.empty())) {
+    if (i == activeTraffic.end()) {
         FGTrafficRecord rec;
         rec.setId(id);
         rec.setLeg(leg);
@@ -136,36 +154,146 @@ void FGGroundController::announcePosition(int id,
         rec.setAircraft(aircraft);
         if (leg == 2) {
             activeTraffic.push_front(rec);
+            i = activeTraffic.begin();
         } else {
             activeTraffic.push_back(rec);   
+            i = --activeTraffic.end();
         }
-        
+        indexTraffic(i);
     } else {
         i->setPositionAndIntentions(currentPosition, intendedRoute);
         i->setPositionAndHeading(lat, lon, heading, speed, alt);
+        updateTrafficCell(id);
     }
 }
 
 
 void FGGroundController::signOff(int id)
+{
+    TrafficVectorIterator i = findTraffic(id);
+    if (i == activeTraffic.end()) {
+        SG_LOG(SG_GENERAL, SG_ALERT,
+               "AI error: Aircraft without traffic record is signing off at " << SG_ORIGIN);
+    } else {
+        unindexTraffic(id);
+        activeTraffic.erase(i);
+    }
+}
+
+/**
+ * The records of activeTraffic are indexed by aircraft id, and filed in the
+ * cells of a grid by position, so neither finding an aircraft nor finding
+ * the traffic near it needs to look at all records.
+ */
+TrafficVectorIterator FGGroundController::findTraffic(int id)
+{
+    TrafficIndex::iterator it = trafficIndex.find(id);
+    if (it == trafficIndex.end())
+        return activeTraffic.end();
+    return it->second.record;
+}
+
+void FGGroundController::indexTraffic(TrafficVectorIterator rec)
+{
+    TrafficIndexEntry entry;
+    entry.record = rec;
+    entry.cart = trafficCart(rec->getLatitude(), rec->getLongitude());
+    entry.cell = trafficCell(entry.cart);
+    trafficCells[entry.cell].push_back(rec->getId());
+    trafficIndex[rec->getId()] = entry;
+    maxTrafficRadius = std::max(maxTrafficRadius, rec->getRadius());
+}
+
+// Call whenever the position of a record changes.
+void FGGroundController::updateTrafficCell(int id)
+{
+    TrafficIndex::iterator it = trafficIndex.find(id);
+    if (it == trafficIndex.end())
+        return;
+    TrafficIndexEntry& entry = it->second;
+    entry.cart = trafficCart(entry.record->getLatitude(), entry.record->getLongitude());
+    uint64_t cell = trafficCell(entry.cart);
+    if (cell != entry.cell) {
+        removeFromCell(entry.cell, id);
+        trafficCells[cell].push_back(id);
+        entry.cell = cell;
+    }
+}
+
+void FGGroundController::removeFromCell(uint64_t cell, int id)
+{
+    TrafficCellMap::iterator it = trafficCells.find(cell);
+    if (it == trafficCells.end())
+        return;
+    intVec& ids = it->second;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+    if (ids.empty())
+        trafficCells.erase(it);
+}
+
+void FGGroundController::unindexTraffic(int id)
+{
+    TrafficIndex::iterator it = trafficIndex.find(id);
+    if (it == trafficIndex.end())
+        return;
+    removeFromCell(it->second.cell, id);
+    trafficIndex.erase(it);
+    if (trafficIndex.empty())
+        maxTrafficRadius = 0;
+}
+
+void FGGroundController::eraseDeadGroundTraffic()
 {
     TrafficVectorIterator i = activeTraffic.begin();
-    // Search search if the current id alread has an entry
-    // This might be faster using a map instead of a vector, but let's start by taking a safe route
-    if (activeTraffic.size()) {
-        //while ((i->getId() != id) && i != activeTraffic.end()) {
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
+    while (i != activeTraffic.end()) {
+        if (!i->getAircraft() || i->getAircraft()->getDie()) {
+            unindexTraffic(i->getId());
+            i = activeTraffic.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Append the ids of the aircraft within range (meters) of cart.
+void FGGroundController::findTrafficNear(const SGVec3d& cart, double range,
+                                         intVec& ids) const
+{
+    const double range2 = range * range;
+    int x0 = trafficCellIndex(cart.x() - range), x1 = trafficCellIndex(cart.x() + range);
+    int y0 = trafficCellIndex(cart.y() - range), y1 = trafficCellIndex(cart.y() + range);
+    int z0 = trafficCellIndex(cart.z() - range), z1 = trafficCellIndex(cart.z() + range);
+    for (int x = x0; x <= x1; ++x) {
+        for (int y = y0; y <= y1; ++y) {
+            for (int z = z0; z <= z1; ++z) {
+                TrafficCellMap::const_iterator it = trafficCells.find(trafficCellKey(x, y, z));
+                if (it == trafficCells.end())
+                    continue;
+                for (intVec::const_iterator j = it->second.begin(); j != it->second.end(); ++j) {
+                    TrafficIndex::const_iterator e = trafficIndex.find(*j);
+                    if (distSqr(cart, e->second.cart) <= range2)
+                        ids.push_back(*j);
+                }
             }
-            i++;
         }
     }
-    if (i == activeTraffic.end() || (activeTraffic.size() == 0)) {
-        SG_LOG(SG_GENERAL, SG_ALERT,
-               "AI error: Aircraft without traffic record is signing off at " << SG_ORIGIN);
-    } else {
-        i = activeTraffic.erase(i);
+}
+
+/**
+ * For every segment, the aircraft that currently taxi on its opposite.
+ * An aircraft may not push back onto a route that traffic is coming down.
+ */
+void FGGroundController::updateOncomingTraffic(FGGroundNetwork* network)
+{
+    oncomingTraffic.clear();
+    for (TrafficVectorIterator j = activeTraffic.begin(); j != activeTraffic.end(); j++) {
+        int pos = j->getCurrentPosition();
+        if (pos > 0) {
+            FGTaxiSegment *seg = network->findOppositeSegment(pos-1);
+            if (seg) {
+                oncomingTraffic[seg->getIndex()].push_back(j->getId());
+            }
+        }
     }
 }
 /**
@@ -222,27 +350,15 @@ void FGGroundController::updateAircraftInformation(int id, double lat, double lo
     // Probably use a status mechanism similar to the Engine start procedure in the startup controller.
 
 
-    TrafficVectorIterator i = activeTraffic.begin();
-    // Search search if the current id has an entry
-    // This might be faster using a map instead of a vector, but let's start by taking a safe route
-    TrafficVectorIterator current, closest;
-    if (activeTraffic.size()) {
-        //while ((i->getId() != id) && i != activeTraffic.end()) {
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
-            }
-            i++;
-        }
-    }
+    TrafficVectorIterator current = findTraffic(id);
     // update position of the current aircraft
-    if (i == activeTraffic.end() || (activeTraffic.size() == 0)) {
+    if (current == activeTraffic.end()) {
         SG_LOG(SG_GENERAL, SG_ALERT,
                "AI error: updating aircraft without traffic record at " << SG_ORIGIN);
-    } else {
-        i->setPositionAndHeading(lat, lon, heading, speed, alt);
-        current = i;
+        return;
     }
+    current->setPositionAndHeading(lat, lon, heading, speed, alt);
+    updateTrafficCell(id);
 
     setDt(getDt() + dt);
 
@@ -308,25 +424,14 @@ void FGGroundController::checkSpeedAdjustment(int id, double lat,
 {
 
     TrafficVectorIterator current, closest, closestOnNetwork;
-    TrafficVectorIterator i = activeTraffic.begin();
     bool otherReasonToSlowDown = false;
 //    bool previousInstruction;
-    if (activeTraffic.size()) {
-        //while ((i->getId() != id) && (i != activeTraffic.end()))
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
-            }
-            i++;
-        }
-    } else {
-        return;
-    }
-    if (i == activeTraffic.end() || (activeTraffic.size() == 0)) {
+    current = findTraffic(id);
+    if (current == activeTraffic.end()) {
         SG_LOG(SG_GENERAL, SG_ALERT,
                "AI error: Trying to access non-existing aircraft in FGGroundNetwork::checkSpeedAdjustment at " << SG_ORIGIN);
+        return;
     }
-    current = i;
     //closest = current;
 
 //    previousInstruction = current->getSpeedAdjustment();
@@ -337,8 +442,40 @@ void FGGroundController::checkSpeedAdjustment(int id, double lat,
         //TrafficVector iterator closest;
         closest = current;
         closestOnNetwork = current;
-        for (TrafficVectorIterator i = activeTraffic.begin();
-                i != activeTraffic.end(); i++) {
+
+        // Find the closest aircraft at the tower controller first; it is only
+        // taken when it is closer than all ground traffic.
+        double towerMindist = HUGE_VAL;
+        double maxRadius = maxTrafficRadius;
+        TrafficVectorIterator towerClosest;
+        if (towerController->hasActiveTraffic()) {
+            for (TrafficVectorIterator i =
+                        towerController->getActiveTraffic().begin();
+                    i != towerController->getActiveTraffic().end(); i++) {
+                //cerr << "Comparing " << current->getId() << " and " << i->getId() << endl;
+                maxRadius = std::max(maxRadius, i->getRadius());
+                SGGeod other(SGGeod::fromDegM(i->getLongitude(),
+                                              i->getLatitude(),
+                                              i->getAltitude()));
+                SGGeodesy::inverse(curr, other, course, az2, dist);
+                bearing = fabs(heading - course);
+                if (bearing > 180)
+                    bearing = 360 - bearing;
+                if ((dist < towerMindist) && (bearing < 60.0)) {
+                    towerMindist = dist;
+                    towerClosest = i;
+                }
+            }
+        }
+
+        // Traffic further away than twice the largest allowable distance
+        // can't make us slow down, even when it is the closest aircraft, so
+        // only the ground traffic in that range needs to be compared.
+        double range = 2 * ((1.1 * current->getRadius()) + (1.1 * maxRadius)) + 1.0;
+        intVec nearby;
+        findTrafficNear(trafficCart(lat, lon), range, nearby);
+        for (intVecIterator j = nearby.begin(); j != nearby.end(); j++) {
+            TrafficVectorIterator i = findTraffic(*j);
             if (i == current) {
                 continue;
             }
@@ -359,29 +496,15 @@ void FGGroundController::checkSpeedAdjustment(int id, double lat,
             }
         }
         //Check traffic at the tower controller
-        if (towerController->hasActiveTraffic()) {
-            for (TrafficVectorIterator i =
-                        towerController->getActiveTraffic().begin();
-                    i != towerController->getActiveTraffic().end(); i++) {
-                //cerr << "Comparing " << current->getId() << " and " << i->getId() << endl;
-                SGGeod other(SGGeod::fromDegM(i->getLongitude(),
-                                              i->getLatitude(),
-                                              i->getAltitude()));
-                SGGeodesy::inverse(curr, other, course, az2, dist);
-                bearing = fabs(heading - course);
-                if (bearing > 180)
-                    bearing = 360 - bearing;
-                if ((dist < mindist) && (bearing < 60.0)) {
-                    //cerr << "Current aircraft " << current->getAircraft()->getTrafficRef()->getCallSign()
-                    //     << " is closest to " << i->getAircraft()->getTrafficRef()->getCallSign()
-                    //     << ", which has status " << i->getAircraft()->isScheduledForTakeoff()
-                    //     << endl;
-                    mindist = dist;
-                    closest = i;
-//                    minbearing = bearing;
-                    otherReasonToSlowDown = true;
-                }
-            }
+        if (towerMindist < mindist) {
+            //cerr << "Current aircraft " << current->getAircraft()->getTrafficRef()->getCallSign()
+            //     << " is closest to " << towerClosest->getAircraft()->getTrafficRef()->getCallSign()
+            //     << ", which has status " << towerClosest->getAircraft()->isScheduledForTakeoff()
+            //     << endl;
+            mindist = towerMindist;
+            closest = towerClosest;
+//            minbearing = bearing;
+            otherReasonToSlowDown = true;
         }
         // Finally, check UserPosition
         // Note, as of 2011-08-01, this should no longer be necessecary.
@@ -457,23 +580,13 @@ void FGGroundController::checkHoldPosition(int id, double lat,
 {
     FGGroundNetwork* network = dynamics->parent()->groundNetwork();
     TrafficVectorIterator current;
-    TrafficVectorIterator i = activeTraffic.begin();
-    if (activeTraffic.size()) {
-        //while ((i->getId() != id) && i != activeTraffic.end())
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
-            }
-            i++;
-        }
-    } else {
-        return;
-    }
+    TrafficVectorIterator i = findTraffic(id);
 
     time_t now = globals->get_time_params()->get_cur_time();
-    if (i == activeTraffic.end() || (activeTraffic.size() == 0)) {
+    if (i == activeTraffic.end()) {
         SG_LOG(SG_GENERAL, SG_ALERT,
                "AI error: Trying to access non-existing aircraft in FGGroundNetwork::checkHoldPosition at " << SG_ORIGIN);
+        return;
     }
     current = i;
     // 
@@ -606,21 +719,12 @@ bool FGGroundController::checkForCircularWaits(int id)
     //cerr << "Performing Wait check " << id << endl;
     int target = 0;
     TrafficVectorIterator current, other;
-    TrafficVectorIterator i = activeTraffic.begin();
+    TrafficVectorIterator i = findTraffic(id);
     int trafficSize = activeTraffic.size();
-    if (trafficSize) {
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
-            }
-            i++;
-        }
-    } else {
-        return false;
-    }
-    if (i == activeTraffic.end() || (trafficSize == 0)) {
+    if (i == activeTraffic.end()) {
         SG_LOG(SG_GENERAL, SG_ALERT,
                "AI error: Trying to access non-existing aircraft in FGGroundNetwork::checkForCircularWaits at " << SG_ORIGIN);
+        return false;
     }
 
     current = i;
@@ -636,19 +740,8 @@ bool FGGroundController::checkForCircularWaits(int id)
 
     while ((target > 0) && (target != id) && counter++ < trafficSize) {
         //printed = true;
-        TrafficVectorIterator i = activeTraffic.begin();
-        if (trafficSize) {
-            //while ((i->getId() != id) && i != activeTraffic.end())
-            while (i != activeTraffic.end()) {
-                if (i->getId() == target) {
-                    break;
-                }
-                i++;
-            }
-        } else {
-            return false;
-        }
-        if (i == activeTraffic.end() || (trafficSize == 0)) {
+        TrafficVectorIterator i = findTraffic(target);
+        if (i == activeTraffic.end()) {
             //cerr << "[Waiting for traffic at Runway: DONE] " << endl << endl;;
             // The target id is not found on the current network, which means it's at the tower
             //SG_LOG(SG_GENERAL, SG_ALERT, "AI error: Trying to access non-existing aircraft in FGGroundNetwork::checkForCircularWaits");
@@ -698,19 +791,8 @@ bool FGGroundController::checkForCircularWaits(int id)
 // Note that this function is probably obsolete...
 bool FGGroundController::hasInstruction(int id)
 {
-    TrafficVectorIterator i = activeTraffic.begin();
-    // Search search if the current id has an entry
-    // This might be faster using a map instead of a vector, but let's start by taking a safe route
-    if (activeTraffic.size()) {
-        //while ((i->getId() != id) && i != activeTraffic.end()) {
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
-            }
-            i++;
-        }
-    }
-    if (i == activeTraffic.end() || (activeTraffic.size() == 0)) {
+    TrafficVectorIterator i = findTraffic(id);
+    if (i == activeTraffic.end()) {
         SG_LOG(SG_GENERAL, SG_ALERT,
                "AI error: checking ATC instruction for aircraft without traffic record at " << SG_ORIGIN);
     } else {
@@ -721,19 +803,8 @@ bool FGGroundController::hasInstruction(int id)
 
 FGATCInstruction FGGroundController::getInstruction(int id)
 {
-    TrafficVectorIterator i = activeTraffic.begin();
-    // Search search if the current id has an entry
-    // This might be faster using a map instead of a vector, but let's start by taking a safe route
-    if (activeTraffic.size()) {
-        //while ((i->getId() != id) && i != activeTraffic.end()) {
-        while (i != activeTraffic.end()) {
-            if (i->getId() == id) {
-                break;
-            }
-            i++;
-        }
-    }
-    if (i == activeTraffic.end() || (activeTraffic.size() == 0)) {
+    TrafficVectorIterator i = findTraffic(id);
+    if (i == activeTraffic.end()) {
         SG_LOG(SG_GENERAL, SG_ALERT,
                "AI error: requesting ATC instruction for aircraft without traffic record at " << SG_ORIGIN);
     } else {
@@ -966,6 +1037,7 @@ void FGGroundController::update(double dt)
     //sort(activeTraffic.begin(), activeTraffic.end(), compare_trafficrecords);
     // Handle traffic that is under ground control first; this way we'll prevent clutter at the gate areas.
     // Don't allow an aircraft to pushback when a taxiing aircraft is currently using part of the intended route.
+    updateOncomingTraffic(network);
     for (i = startupTraffic.begin(); i != startupTraffic.end(); ++i) {
         updateStartupTraffic(i, priority, now);
     }
@@ -975,7 +1047,7 @@ void FGGroundController::update(double dt)
     }
 
     eraseDeadTraffic(startupTraffic);
-    eraseDeadTraffic(activeTraffic);
+    eraseDeadGroundTraffic();
 }
 
 void FGGroundController::updateStartupTraffic(TrafficVectorIterator i,
@@ -1007,21 +1079,12 @@ void FGGroundController::updateStartupTraffic(TrafficVectorIterator i,
         return;
     }
 
-    // Check for all active aircraft whether it's current pos segment is
-    // an opposite of one of the departing aircraft's intentions
-    for (TrafficVectorIterator j = activeTraffic.begin(); j != activeTraffic.end(); j++) {
-        int pos = j->getCurrentPosition();
-        if (pos > 0) {
-            FGTaxiSegment *seg = network->findOppositeSegment(pos-1);
-            if (seg) {
-                int posReverse = seg->getIndex();
-                for (intVecIterator k = i->getIntentions().begin(); k != i->getIntentions().end(); k++) {
-                    if ((*k) == posReverse) {
-                        i->denyPushBack();
-                        network->findSegment(posReverse)->block(i->getId(), now, now);
-                    }
-                }
-            }
+    // Check whether any active aircraft is on the opposite of one of the
+    // departing aircraft's intentions
+    for (intVecIterator k = i->getIntentions().begin(); k != i->getIntentions().end(); k++) {
+        if (oncomingTraffic.count(*k)) {
+            i->denyPushBack();
+            network->findSegment(*k)->block(i->getId(), now, now);
         }
     }
     // if the current aircraft is still allowed to pushback, we can start reserving a route for if by blocking all the entry taxiways.
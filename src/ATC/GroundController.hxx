@@ -26,10 +26,15 @@
 #include <simgear/compiler.h>
 
 #include <string>
+#include <unordered_map>
+
+#include <simgear/math/SGMath.hxx>
+#include <simgear/misc/stdint.hxx>
 
 #include <ATC/trafficcontrol.hxx>
 
 class FGAirportDynamics;
+class FGGroundNetwork;
 
 /**************************************************************************************
  * class FGGroundNetWork
@@ -51,6 +56,35 @@ private:
     FGAirport *parent;
     FGAirportDynamics* dynamics;
 
+    /**
+     * Where the record of an aircraft lives in activeTraffic, and the cell
+     * of the proximity grid it was filed under.
+     */
+    struct TrafficIndexEntry
+    {
+        TrafficVectorIterator record;
+        uint64_t cell;
+        SGVec3d cart;
+    };
+    typedef std::unordered_map<int, TrafficIndexEntry> TrafficIndex;
+    typedef std::unordered_map<uint64_t, intVec> TrafficCellMap;
+    typedef std::unordered_map<int, intVec> SegmentOccupancy;
+
+    TrafficIndex trafficIndex;           // aircraft id -> record
+    TrafficCellMap trafficCells;         // grid cell -> ids of the aircraft in it
+    double maxTrafficRadius;             // of all records in activeTraffic
+    // segment -> ids of the aircraft on its opposite segment, rebuilt by update()
+    SegmentOccupancy oncomingTraffic;
+
+    TrafficVectorIterator findTraffic(int id);
+    void indexTraffic(TrafficVectorIterator rec);
+    void updateTrafficCell(int id);
+    void removeFromCell(uint64_t cell, int id);
+    void unindexTraffic(int id);
+    void eraseDeadGroundTraffic();
+    void findTrafficNear(const SGVec3d& cart, double range, intVec& ids) const;
+    void updateOncomingTraffic(FGGroundNetwork* network);
+
 
     void checkSpeedAdjustment(int id, double lat, double lon,
                               double heading, double speed, double alt);
@@ -27,6 +27,7 @@
 #include "FlightHistory.hxx"
 
 #include <algorithm>
+#include <cmath>
 #include <boost/foreach.hpp>
 
 #include <simgear/sg_inlines.h>
@@ -35,18 +36,102 @@
 #include <simgear/misc/strutils.hxx>
 #include <simgear/structure/exception.hxx>
 #include <simgear/math/SGMath.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/misc/stdint.hxx>
+#include <simgear/structure/SGSharedPtr.hxx>
+#include <simgear/threads/SGQueue.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include <Main/fg_props.hxx>
 #include <Main/globals.hxx>
+#include <Main/util.hxx>
+
+/// number of levels of thinned out samples
+const unsigned int DECIMATION_LEVELS = 3;
+/// each level is thinned out this much more than the previous one
+const double DECIMATION_TOLERANCE_FACTOR = 4.0;
+/// paths of this many different edge lengths are kept up to date
+const unsigned int MAX_FILTERED_PATHS = 4;
+
+/**
+ * Samples handed to the log writer
+ */
+class FGFlightHistory::LogBatch : public SGReferenced
+{
+public:
+    std::vector<Sample> samples;
+};
+
+/**
+ * Appends samples to the history log, in a compact binary format:
+ * time (msec, uint32), latitude and longitude (1e-7 deg, int32),
+ * altitude (ft, float), heading, pitch and roll (0.01 deg, int16).
+ */
+class FGFlightHistory::LogWriter : public SGThread
+{
+public:
+    LogWriter(const SGPath& path) :
+        _output(path, std::ios::binary | std::ios::out | std::ios::app)
+    {
+    }
+
+    bool good() const
+    { return _output.good(); }
+
+    virtual void run()
+    {
+        for (;;) {
+            SGSharedPtr<LogBatch> batch = _batches.pop();
+            // A null batch terminates the thread
+            if (!batch)
+                break;
+            BOOST_FOREACH(const Sample& sample, batch->samples) {
+                write(sample);
+            }
+        }
+        _output.flush();
+    }
+
+    void request(LogBatch* batch)
+    { _batches.push(batch); }
+
+    void stop()
+    {
+        _batches.push(SGSharedPtr<LogBatch>());
+        join();
+    }
+
+private:
+    template <class T>
+    void writeValue(T value)
+    { _output.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    void write(const Sample& sample)
+    {
+        writeValue<uint32_t>(static_cast<uint32_t>(sample.simTimeMSec));
+        writeValue<int32_t>(static_cast<int32_t>(SGMiscd::round(sample.position.getLatitudeDeg() * 1e7)));
+        writeValue<int32_t>(static_cast<int32_t>(SGMiscd::round(sample.position.getLongitudeDeg() * 1e7)));
+        writeValue<float>(static_cast<float>(sample.position.getElevationFt()));
+        writeValue<int16_t>(static_cast<int16_t>(SGMiscf::round(SGMiscf::normalizePeriodic(-180, 180, sample.heading) * 100)));
+        writeValue<int16_t>(static_cast<int16_t>(SGMiscf::round(sample.pitch * 100)));
+        writeValue<int16_t>(static_cast<int16_t>(SGMiscf::round(sample.roll * 100)));
+    }
+
+    sg_ofstream _output;
+    SGBlockingQueue<SGSharedPtr<LogBatch> > _batches;
+};
 
 FGFlightHistory::FGFlightHistory() :
     m_sampleInterval(5.0),
-    m_validSampleCount(SAMPLE_BUCKET_WIDTH)
+    m_validSampleCount(SAMPLE_BUCKET_WIDTH),
+    m_decimationToleranceM(10.0),
+    m_logWriter(NULL)
 {
 }
 
 FGFlightHistory::~FGFlightHistory()
 {
+    closeLog();
 }
 
 void FGFlightHistory::init()
@@ -61,6 +146,8 @@ void FGFlightHistory::init()
     
   // cap memory use at 4MB
     m_maxMemoryUseBytes = fgGetInt("/sim/history/max-memory-use-bytes", 1024 * 1024 * 4);
+    m_decimationToleranceM = fgGetDouble("/sim/history/decimation-tolerance-m", 10.0);
+    m_decimated.resize(DECIMATION_LEVELS);
     m_weightOnWheels = NULL;
 // reset the history when we detect a take-off
     if (fgGetBool("/sim/history/clear-on-takeoff", true)) {
@@ -71,13 +158,56 @@ void FGFlightHistory::init()
     // force bucket re-allocation
     m_validSampleCount = SAMPLE_BUCKET_WIDTH;
     m_lastCaptureTime = globals->get_sim_time_sec();
+
+    std::string logFile = fgGetString("/sim/history/log-file", "");
+    if (!logFile.empty()) {
+        openLog(logFile);
+    }
 }
 
 void FGFlightHistory::shutdown()
 {
+    closeLog();
     clear();
 }
 
+void FGFlightHistory::openLog(const std::string& path)
+{
+    SGPath authorizedPath = fgValidatePath(SGPath::fromUtf8(path), true /* write */);
+    if (authorizedPath.isNull()) {
+        SG_LOG(SG_FLIGHT, SG_ALERT, "history: not authorized to write log file " << path);
+        return;
+    }
+
+    LogWriter* writer = new LogWriter(authorizedPath);
+    if (!writer->good()) {
+        SG_LOG(SG_FLIGHT, SG_ALERT, "history: cannot write log file " << authorizedPath);
+        delete writer;
+        return;
+    }
+
+    SG_LOG(SG_FLIGHT, SG_INFO, "history: writing log file " << authorizedPath);
+    m_logWriter = writer;
+    m_logWriter->start();
+    m_logBatch.reserve(SAMPLE_BUCKET_WIDTH);
+}
+
+void FGFlightHistory::closeLog()
+{
+    if (!m_logWriter) {
+        return;
+    }
+
+    if (!m_logBatch.empty()) {
+        SGSharedPtr<LogBatch> batch = new LogBatch;
+        batch->samples.swap(m_logBatch);
+        m_logWriter->request(batch);
+    }
+    m_logWriter->stop();
+    delete m_logWriter;
+    m_logWriter = NULL;
+}
+
 void FGFlightHistory::reinit()
 {
     shutdown();
@@ -116,15 +246,27 @@ void FGFlightHistory::update(double dt)
 void FGFlightHistory::allocateNewBucket()
 {
     SampleBucket* bucket = NULL;
-    if (!m_buckets.empty() && (currentMemoryUseBytes() > m_maxMemoryUseBytes)) {
+    // half of the memory for full rate samples, the other half for the
+    // thinned out levels
+    if (!m_buckets.empty() &&
+        (sizeof(SampleBucket) * m_buckets.size() > m_maxMemoryUseBytes / 2))
+    {
         bucket = m_buckets.front();
         m_buckets.erase(m_buckets.begin());
+        decimate(bucket->samples, SAMPLE_BUCKET_WIDTH, 0);
+        // the filtered paths still hold the full rate samples of the
+        // bucket, or samples dropped altogether
+        BOOST_FOREACH(FilteredPath& filtered, m_filteredPaths) {
+            buildFilteredPath(filtered);
+        }
     } else {
         bucket = new SampleBucket;
     }
     
     m_buckets.push_back(bucket);
     m_validSampleCount = 0;
+
+    fgSetInt("/sim/history/memory-use-bytes", currentMemoryUseBytes());
 }
 
 void FGFlightHistory::capture()
@@ -147,68 +289,235 @@ void FGFlightHistory::capture()
     sample->roll = static_cast<float>(roll);
     
     ++m_validSampleCount;
+
+    BOOST_FOREACH(FilteredPath& filtered, m_filteredPaths) {
+        filterPath(filtered, sample->position);
+    }
+
+    if (m_logWriter) {
+        m_logBatch.push_back(*sample);
+        if (m_logBatch.size() >= SAMPLE_BUCKET_WIDTH) {
+            SGSharedPtr<LogBatch> batch = new LogBatch;
+            batch->samples.swap(m_logBatch);
+            m_logWriter->request(batch);
+            m_logBatch.reserve(SAMPLE_BUCKET_WIDTH);
+        }
+    }
+}
+
+/**
+ * Thin out samples with the Douglas-Peucker algorithm, and append them to
+ * the given level. When the level exceeds its share of the memory, its
+ * older half moves on to the next, coarser level.
+ */
+void FGFlightHistory::decimate(const Sample* samples, size_t count, unsigned int level)
+{
+    if (level >= m_decimated.size()) {
+        // oldest samples are dropped
+        return;
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    const double tolerance = m_decimationToleranceM *
+        std::pow(DECIMATION_TOLERANCE_FACTOR, static_cast<int>(level));
+    const double toleranceSqr = tolerance * tolerance;
+
+    std::vector<SGVec3d> cart(count);
+    for (size_t i = 0; i < count; ++i) {
+        cart[i] = SGVec3d::fromGeod(samples[i].position);
+    }
+
+    std::vector<bool> keep(count, false);
+    keep.front() = keep.back() = true;
+    std::vector<std::pair<size_t, size_t> > stack;
+    stack.push_back(std::make_pair(size_t(0), count - 1));
+    while (!stack.empty()) {
+        size_t first = stack.back().first, last = stack.back().second;
+        stack.pop_back();
+        if (last <= first + 1) {
+            continue;
+        }
+
+        // sample farthest from the segment first-last
+        SGVec3d dir = cart[last] - cart[first];
+        double lenSqr = dot(dir, dir);
+        double maxDistSqr = 0.0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            SGVec3d p = cart[i] - cart[first];
+            double t = (lenSqr > 0.0) ? SGMiscd::clip(dot(p, dir) / lenSqr, 0.0, 1.0) : 0.0;
+            double d2 = distSqr(p, t * dir);
+            if (d2 > maxDistSqr) {
+                maxDistSqr = d2;
+                farthest = i;
+            }
+        }
+
+        if (maxDistSqr > toleranceSqr) {
+            keep[farthest] = true;
+            stack.push_back(std::make_pair(first, farthest));
+            stack.push_back(std::make_pair(farthest, last));
+        }
+    }
+
+    SampleDeque& out = m_decimated[level];
+    for (size_t i = 0; i < count; ++i) {
+        if (keep[i]) {
+            out.push_back(samples[i]);
+        }
+    }
+
+    const size_t levelBudget = m_maxMemoryUseBytes / (2 * m_decimated.size());
+    if (out.size() * sizeof(Sample) > levelBudget) {
+        std::vector<Sample> older(out.begin(), out.begin() + out.size() / 2);
+        out.erase(out.begin(), out.begin() + older.size());
+        decimate(older.data(), older.size(), level + 1);
+    }
+}
+
+void FGFlightHistory::filterPath(FilteredPath& filtered, const SGGeod& pos) const
+{
+    SGVec3d cart(SGVec3d::fromGeod(pos));
+    if (distSqr(cart, filtered.lastOutputCart) >
+        filtered.minEdgeLengthM * filtered.minEdgeLengthM)
+    {
+        filtered.lastOutputCart = cart;
+        filtered.path.push_back(pos);
+    }
 }
 
 PagedPathForHistory_ptr FGFlightHistory::pagedPathForHistory(size_t max_entries, size_t newerThan ) const
 {
     PagedPathForHistory_ptr result = new PagedPathForHistory();
+
+    // oldest, thinned out samples first
+    for (size_t level = m_decimated.size(); (level-- > 0) && max_entries; ) {
+        const SampleDeque& samples = m_decimated[level];
+        if (samples.empty() || (samples.back().simTimeMSec <= newerThan)) {
+            continue;
+        }
+
+        // skip older entries
+        size_t lo = 0, hi = samples.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (samples[mid].simTimeMSec <= newerThan)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        for (; (lo < samples.size()) && max_entries; ++lo, --max_entries) {
+            result->path.push_back(samples[lo].position);
+            result->last_seen = samples[lo].simTimeMSec;
+        }
+    }
+
     if (m_buckets.empty()) {
         return result;
     }
 
-    BOOST_FOREACH(SampleBucket* bucket, m_buckets) {
-        unsigned int count = (bucket == m_buckets.back() ? m_validSampleCount : SAMPLE_BUCKET_WIDTH);
+    // first bucket with samples newer than requested
+    size_t bucketIndex = 0, hiBucket = m_buckets.size();
+    while (bucketIndex < hiBucket) {
+        size_t mid = (bucketIndex + hiBucket) / 2;
+        unsigned int count = (mid + 1 == m_buckets.size() ? m_validSampleCount : SAMPLE_BUCKET_WIDTH);
+        if (m_buckets[mid]->samples[count - 1].simTimeMSec <= newerThan)
+            bucketIndex = mid + 1;
+        else
+            hiBucket = mid;
+    }
 
-        // iterate over all the valid samples in the bucket
-        for (unsigned int index = 0; index < count; ++index) {
-            // skip older entries
-            // TODO: bisect!
-            if( bucket->samples[index].simTimeMSec <= newerThan )
-            continue;
+    for (; (bucketIndex < m_buckets.size()) && max_entries; ++bucketIndex) {
+        const SampleBucket* bucket = m_buckets[bucketIndex];
+        unsigned int count = (bucket == m_buckets.back() ? m_validSampleCount : SAMPLE_BUCKET_WIDTH);
 
-            if( max_entries ) {
-                max_entries--;
-                SGGeod g = bucket->samples[index].position;
-                result->path.push_back(g);
-                result->last_seen = bucket->samples[index].simTimeMSec;
-            } else {
-                goto exit;
-            }
+        // skip older entries
+        unsigned int index = 0, hi = count;
+        while (index < hi) {
+            unsigned int mid = (index + hi) / 2;
+            if (bucket->samples[mid].simTimeMSec <= newerThan)
+                index = mid + 1;
+            else
+                hi = mid;
+        }
 
-        } // of samples iteration
+        for (; (index < count) && max_entries; ++index, --max_entries) {
+            result->path.push_back(bucket->samples[index].position);
+            result->last_seen = bucket->samples[index].simTimeMSec;
+        }
     } // of buckets iteration
 
-exit:
     return result;
 }
 
 
-SGGeodVec FGFlightHistory::pathForHistory(double minEdgeLengthM) const
+/**
+ * (Re)build a filtered path from all the samples in the history, the
+ * thinned out ones first. Its length follows the history this way.
+ */
+void FGFlightHistory::buildFilteredPath(FilteredPath& filtered) const
 {
-    SGGeodVec result;
-    if (m_buckets.empty()) {
-        return result;
+    filtered.path.clear();
+
+    // oldest sample available
+    const Sample* first = NULL;
+    for (size_t level = m_decimated.size(); level-- > 0; ) {
+        if (!m_decimated[level].empty()) {
+            first = &m_decimated[level].front();
+            break;
+        }
     }
-    
-    result.push_back(m_buckets.front()->samples[0].position);
-    SGVec3d lastOutputCart = SGVec3d::fromGeod(result.back());
-    double minLengthSqr = minEdgeLengthM * minEdgeLengthM;
-    
+    if (!first && !m_buckets.empty()) {
+        first = &m_buckets.front()->samples[0];
+    }
+    if (!first) {
+        return;
+    }
+
+    filtered.path.push_back(first->position);
+    filtered.lastOutputCart = SGVec3d::fromGeod(first->position);
+
+    for (size_t level = m_decimated.size(); level-- > 0; ) {
+        BOOST_FOREACH(const Sample& sample, m_decimated[level]) {
+            filterPath(filtered, sample.position);
+        }
+    }
+
     BOOST_FOREACH(SampleBucket* bucket, m_buckets) {
         unsigned int count = (bucket == m_buckets.back() ? m_validSampleCount : SAMPLE_BUCKET_WIDTH);
     
         // iterate over all the valid samples in the bucket
         for (unsigned int index = 0; index < count; ++index) {
-            SGGeod g = bucket->samples[index].position;
-            SGVec3d cart(SGVec3d::fromGeod(g));
-            if (distSqr(cart, lastOutputCart) > minLengthSqr) {
-                lastOutputCart =  cart;
-                result.push_back(g);
-            }
+            filterPath(filtered, bucket->samples[index].position);
         } // of samples iteration
     } // of buckets iteration
-    
-    return result;
+}
+
+SGGeodVec FGFlightHistory::pathForHistory(double minEdgeLengthM) const
+{
+    BOOST_FOREACH(const FilteredPath& filtered, m_filteredPaths) {
+        if (filtered.minEdgeLengthM == minEdgeLengthM) {
+            return filtered.path;
+        }
+    }
+
+    FilteredPath filtered;
+    filtered.minEdgeLengthM = minEdgeLengthM;
+    buildFilteredPath(filtered);
+    if (filtered.path.empty()) {
+        return SGGeodVec();
+    }
+
+    // keep it up to date from now on
+    if (m_filteredPaths.size() >= MAX_FILTERED_PATHS) {
+        m_filteredPaths.erase(m_filteredPaths.begin());
+    }
+    m_filteredPaths.push_back(filtered);
+    return filtered.path;
 }
 
 void FGFlightHistory::clear()
@@ -218,10 +527,22 @@ void FGFlightHistory::clear()
     }
     m_buckets.clear();
     m_validSampleCount = SAMPLE_BUCKET_WIDTH;
+
+    BOOST_FOREACH(SampleDeque& samples, m_decimated) {
+        samples.clear();
+    }
+    m_filteredPaths.clear();
 }
 
 size_t FGFlightHistory::currentMemoryUseBytes() const
 {
-    return sizeof(SampleBucket) * m_buckets.size();
+    size_t bytes = sizeof(SampleBucket) * m_buckets.size();
+    BOOST_FOREACH(const SampleDeque& samples, m_decimated) {
+        bytes += sizeof(Sample) * samples.size();
+    }
+    BOOST_FOREACH(const FilteredPath& filtered, m_filteredPaths) {
+        bytes += sizeof(SGGeod) * filtered.path.size();
+    }
+    return bytes;
 }
 
@@ -27,6 +27,8 @@
 #include <simgear/props/props.hxx>
 #include <simgear/math/SGMath.hxx>
 
+#include <deque>
+#include <string>
 #include <vector>
 
 typedef std::vector<SGGeod> SGGeodVec;
@@ -48,6 +50,11 @@ const unsigned int SAMPLE_BUCKET_WIDTH = 1024;
  * over a long period of time (unlike the replay system), but only a small,
  * fixed set of properties are recorded. (Positioned and orientation, but
  * not velocity, acceleration, control inputs, or so on)
+ *
+ * Recent samples are kept at full rate. Once the memory limit is reached,
+ * older samples are thinned out (Douglas-Peucker) into a few levels of
+ * increasing coarseness, so the whole flight remains available. Every
+ * sample can also be written to a binary log, by a background thread.
  */
 class FGFlightHistory : public SGSubsystem
 {
@@ -60,10 +67,15 @@ public:
     virtual void reinit();
     virtual void update(double dt);
     
+    /**
+     * retrieve up to max_entries positions recorded after the given
+     * time (msec). Cost is proportional to the size of the result.
+     */
     PagedPathForHistory_ptr pagedPathForHistory(size_t max_entries, size_t newerThan = 0) const;
     /**
      * retrieve the path, collapsing segments shorter than
-     * the specified minimum length
+     * the specified minimum length. Paths for recently used lengths are
+     * kept up to date as samples are captured.
      */
     SGGeodVec pathForHistory(double minEdgeLengthM = 50.0) const;
 
@@ -101,6 +113,21 @@ private:
     public:
         Sample samples[SAMPLE_BUCKET_WIDTH];
     };
+
+    typedef std::deque<Sample> SampleDeque;
+
+    /**
+     * A path collapsing short segments, kept up to date by capture()
+     */
+    struct FilteredPath
+    {
+        double minEdgeLengthM;
+        SGVec3d lastOutputCart;
+        SGGeodVec path;
+    };
+
+    class LogBatch;
+    class LogWriter;
     
     double m_lastCaptureTime;
     double m_sampleInterval; ///< sample interval in seconds
@@ -110,6 +137,16 @@ private:
     
 /// number of valid samples in the final bucket
     unsigned int m_validSampleCount;
+
+/// samples older than those of the buckets, thinned out. Level 0 is the
+/// most recent and finest one.
+    std::vector<SampleDeque> m_decimated;
+    double m_decimationToleranceM;
+
+    mutable std::vector<FilteredPath> m_filteredPaths;
+
+    LogWriter* m_logWriter;
+    std::vector<Sample> m_logBatch;
     
     SGPropertyNode_ptr m_weightOnWheels;
     SGPropertyNode_ptr m_enabled;
@@ -122,6 +159,13 @@ private:
     void capture();
   
     size_t currentMemoryUseBytes() const;
+
+    void decimate(const Sample* samples, size_t count, unsigned int level);
+    void filterPath(FilteredPath& filtered, const SGGeod& pos) const;
+    void buildFilteredPath(FilteredPath& filtered) const;
+
+    void openLog(const std::string& path);
+    void closeLog();
 };
 
 #endif
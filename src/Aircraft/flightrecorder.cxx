@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
 
 #include <simgear/debug/logstream.hxx>
 #include <simgear/props/props_io.hxx>
@@ -115,6 +116,17 @@ FGFlightRecorder::reinit(SGPropertyNode_ptr ConfigNode)
                         sizeof(signed char)   * m_CaptureInt8.size()    +
                         sizeof(unsigned char) * ((m_CaptureBool.size()+7)/8); // 8 bools per byte
 
+    // columns of compressed blocks, in record order
+    m_Columns.clear();
+    int Offset = 0;
+    addColumns(Offset, sizeof(double),      1 + m_CaptureDouble.size(), true);
+    addColumns(Offset, sizeof(float),       m_CaptureFloat.size(),      true);
+    addColumns(Offset, sizeof(int),         m_CaptureInteger.size(),    false);
+    addColumns(Offset, sizeof(short int),   m_CaptureInt16.size(),      false);
+    addColumns(Offset, sizeof(signed char), m_CaptureInt8.size(),       false);
+    addColumns(Offset, sizeof(unsigned char), (m_CaptureBool.size()+7)/8, true);
+    assert(Offset == m_TotalRecordSize);
+
     // expose size of actual flight recorder record
     m_RecorderNode->setIntValue("record-size", m_TotalRecordSize);
     SG_LOG(SG_SYSTEMS, SG_INFO, "FlightRecorder: record size is " << m_TotalRecordSize << " bytes");
@@ -575,6 +587,192 @@ FGFlightRecorder::replay(double SimTime, const FGReplayData* _pNextBuffer, const
     }
 }
 
+void
+FGFlightRecorder::addColumns(int& Offset, unsigned Width, size_t Count, bool Xor)
+{
+    for (size_t i=0; i<Count; i++)
+    {
+        TColumn Column;
+        Column.Offset = Offset;
+        Column.Width  = Width;
+        Column.Xor    = Xor;
+        m_Columns.push_back(Column);
+        Offset += Width;
+    }
+}
+
+/* Column modes of compressed blocks */
+static const unsigned char ColumnConstant = 0;  // one value for all records
+static const unsigned char ColumnEncoded  = 1;  // XOR or delta encoded values
+/* XOR header of a value which didn't change */
+static const unsigned char XorUnchanged   = 0xff;
+
+static uint64_t
+loadValue(const unsigned char* p, unsigned Width)
+{
+    switch (Width)
+    {
+        case 8: { uint64_t v; memcpy(&v, p, 8); return v; }
+        case 4: { uint32_t v; memcpy(&v, p, 4); return v; }
+        case 2: { uint16_t v; memcpy(&v, p, 2); return v; }
+        default: return *p;
+    }
+}
+
+static void
+storeValue(unsigned char* p, unsigned Width, uint64_t v)
+{
+    switch (Width)
+    {
+        case 8: { memcpy(p, &v, 8); break; }
+        case 4: { uint32_t v32 = v; memcpy(p, &v32, 4); break; }
+        case 2: { uint16_t v16 = v; memcpy(p, &v16, 2); break; }
+        default: *p = v; break;
+    }
+}
+
+static int64_t
+signExtend(uint64_t v, unsigned Width)
+{
+    unsigned Shift = 64 - 8*Width;
+    return ((int64_t) (v << Shift)) >> Shift;
+}
+
+/** Compress Count records, Stride bytes apart, into a block.
+ * The block stores one column per signal. Columns which don't change
+ * within the block are stored once. Otherwise floating point values are
+ * XORed with their predecessor, and only the non-zero bytes in the
+ * middle are kept; integers are stored as variable length deltas. */
+void
+FGFlightRecorder::encodeBlock(const unsigned char* pRecords, unsigned Count, size_t Stride,
+                              std::vector<unsigned char>& Block) const
+{
+    Block.clear();
+    for (TColumnList::const_iterator it = m_Columns.begin(); it != m_Columns.end(); ++it)
+    {
+        const unsigned Width = it->Width;
+        const unsigned char* p = pRecords + it->Offset;
+
+        uint64_t First = loadValue(p, Width);
+        bool Constant = true;
+        for (unsigned r=1; (r<Count)&&Constant; r++)
+            Constant = (loadValue(p + r*Stride, Width) == First);
+        if (Constant)
+        {
+            Block.push_back(ColumnConstant);
+            Block.insert(Block.end(), p, p + Width);
+            continue;
+        }
+
+        Block.push_back(ColumnEncoded);
+        uint64_t Last = 0;
+        for (unsigned r=0; r<Count; r++)
+        {
+            uint64_t v = loadValue(p + r*Stride, Width);
+            if (it->Xor)
+            {
+                uint64_t x = v ^ Last;
+                if (x == 0)
+                {
+                    Block.push_back(XorUnchanged);
+                }
+                else
+                {
+                    unsigned Lead = 0, Trail = 0;
+                    while (((x >> (8*(Width-1-Lead))) & 0xff) == 0)
+                        Lead++;
+                    while (((x >> (8*Trail)) & 0xff) == 0)
+                        Trail++;
+                    Block.push_back((Lead << 4) | Trail);
+                    for (int b=Width-1-Lead; b>=(int)Trail; b--)
+                        Block.push_back((x >> (8*b)) & 0xff);
+                }
+            }
+            else
+            {
+                // zigzag encoded delta, 7 bits per byte
+                int64_t Delta = signExtend(v, Width) - signExtend(Last, Width);
+                uint64_t z = (((uint64_t) Delta) << 1) ^ (uint64_t) (Delta >> 63);
+                while (z >= 0x80)
+                {
+                    Block.push_back((z & 0x7f) | 0x80);
+                    z >>= 7;
+                }
+                Block.push_back(z);
+            }
+            Last = v;
+        }
+    }
+}
+
+/** Restore Count records from a block built by encodeBlock. */
+bool
+FGFlightRecorder::decodeBlock(const std::vector<unsigned char>& Block, unsigned Count, size_t Stride,
+                              unsigned char* pRecords) const
+{
+    size_t Pos = 0;
+    const size_t Size = Block.size();
+    for (TColumnList::const_iterator it = m_Columns.begin(); it != m_Columns.end(); ++it)
+    {
+        const unsigned Width = it->Width;
+        unsigned char* p = pRecords + it->Offset;
+
+        if (Pos >= Size)
+            return false;
+        if (Block[Pos++] == ColumnConstant)
+        {
+            if (Pos + Width > Size)
+                return false;
+            for (unsigned r=0; r<Count; r++)
+                memcpy(p + r*Stride, &Block[Pos], Width);
+            Pos += Width;
+            continue;
+        }
+
+        uint64_t Last = 0;
+        for (unsigned r=0; r<Count; r++)
+        {
+            uint64_t v;
+            if (it->Xor)
+            {
+                if (Pos >= Size)
+                    return false;
+                unsigned char Header = Block[Pos++];
+                uint64_t x = 0;
+                if (Header != XorUnchanged)
+                {
+                    int Lead = Header >> 4, Trail = Header & 0xf;
+                    if ((Lead + Trail >= (int) Width)||
+                        (Pos + Width - Lead - Trail > Size))
+                        return false;
+                    for (int b=Width-1-Lead; b>=Trail; b--)
+                        x |= ((uint64_t) Block[Pos++]) << (8*b);
+                }
+                v = Last ^ x;
+            }
+            else
+            {
+                uint64_t z = 0;
+                unsigned Shift = 0;
+                unsigned char c;
+                do
+                {
+                    if ((Pos >= Size)||(Shift > 63))
+                        return false;
+                    c = Block[Pos++];
+                    z |= ((uint64_t) (c & 0x7f)) << Shift;
+                    Shift += 7;
+                } while (c & 0x80);
+                int64_t Delta = (int64_t) (z >> 1) ^ -(int64_t) (z & 1);
+                v = (uint64_t) (signExtend(Last, Width) + Delta);
+            }
+            storeValue(p + r*Stride, Width, v);
+            Last = v;
+        }
+    }
+    return Pos == Size;
+}
+
 int
 FGFlightRecorder::getConfig(SGPropertyNode* root, const char* typeStr, const FlightRecorder::TSignalList& SignalList)
 {
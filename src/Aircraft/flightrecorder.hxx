@@ -45,6 +45,18 @@ namespace FlightRecorder
 
     typedef std::vector<TCapture> TSignalList;
 
+    /** One signal's field within a record, when records are stored as
+     *  columns. Floating point and boolean columns are XOR encoded
+     *  against the previous value, integer columns delta encoded. */
+    typedef struct
+    {
+        int                 Offset;
+        unsigned char       Width;
+        bool                Xor;
+    } TColumn;
+
+    typedef std::vector<TColumn> TColumnList;
+
 }
 
 class FGFlightRecorder
@@ -61,6 +73,11 @@ public:
                                          const FGReplayData* pLastBuffer = NULL);
     void            deleteRecord        (FGReplayData* pRecord);
 
+    void            encodeBlock         (const unsigned char* pRecords, unsigned Count, size_t Stride,
+                                         std::vector<unsigned char>& Block) const;
+    bool            decodeBlock         (const std::vector<unsigned char>& Block, unsigned Count, size_t Stride,
+                                         unsigned char* pRecords) const;
+
     int             getRecordSize       (void) { return m_TotalRecordSize;}
     void            getConfig           (SGPropertyNode* root);
 
@@ -73,6 +90,7 @@ private:
                            std::string PropPrefix="", int Count = 1);
     bool haveProperty(FlightRecorder::TSignalList& Capture,SGPropertyNode* pProperty);
     bool haveProperty(SGPropertyNode* pProperty);
+    void addColumns(int& Offset, unsigned Width, size_t Count, bool Xor);
 
     int  getConfig(SGPropertyNode* root, const char* typeStr, const FlightRecorder::TSignalList& SignalList);
 
@@ -86,6 +104,8 @@ private:
     FlightRecorder::TSignalList m_CaptureInt8;
     FlightRecorder::TSignalList m_CaptureBool;
 
+    FlightRecorder::TColumnList m_Columns;
+
     int m_TotalRecordSize;
     std::string m_ConfigName;
     bool m_usingDefaultConfig;
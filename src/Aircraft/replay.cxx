@@ -25,7 +25,9 @@
 #  include "config.h"
 #endif
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <float.h>
 
 #include <simgear/constants.h>
@@ -35,11 +37,13 @@
 #include <simgear/misc/sg_dir.hxx>
 #include <simgear/misc/stdint.hxx>
 #include <simgear/misc/strutils.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include <Main/fg_props.hxx>
 
 #include "replay.hxx"
 #include "flightrecorder.hxx"
+#include "replaytape.hxx"
 
 using std::deque;
 using std::vector;
@@ -70,6 +74,177 @@ namespace ReplayContainer
     };
 }
 
+FGReplayBlockList::FGReplayBlockList(FGFlightRecorder* pRecorder) :
+    m_pRecorder(pRecorder),
+    m_RecordSize(0),
+    m_Stride(0),
+    m_FirstBlock(0),
+    m_FirstFrame(0),
+    m_BlockBytes(0),
+    m_pTape(NULL),
+    m_CacheClock(0)
+{
+}
+
+void
+FGReplayBlockList::clear()
+{
+    m_Times.clear();
+    m_Blocks.clear();
+    m_Open.clear();
+    m_FirstBlock = 0;
+    m_FirstFrame = 0;
+    m_BlockBytes = 0;
+    m_pTape = NULL;
+    Block().swap(m_TapeBuffer);
+    for (int i=0; i<2; i++)
+    {
+        m_Cache[i].Number = -1;
+        Block().swap(m_Cache[i].Frames);
+    }
+    // the recorder may have been reconfigured
+    m_RecordSize = 0;
+}
+
+/** Size the frames for the current recorder configuration. */
+void
+FGReplayBlockList::initRecordSize()
+{
+    m_RecordSize = m_pRecorder->getRecordSize();
+    m_Stride = (m_RecordSize + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+    m_Open.reserve(BLOCK_FRAMES * m_Stride);
+}
+
+void
+FGReplayBlockList::push_back(const FGReplayData* pFrame)
+{
+    if (m_Times.empty() && m_Open.empty() && m_Blocks.empty())
+        initRecordSize();
+
+    const unsigned char* p = (const unsigned char*) pFrame;
+    m_Open.insert(m_Open.end(), p, p + m_RecordSize);
+    m_Open.resize(m_Open.size() + m_Stride - m_RecordSize);
+    m_Times.push_back(pFrame->sim_time);
+
+    if (m_Open.size() == BLOCK_FRAMES * m_Stride)
+        seal();
+}
+
+void
+FGReplayBlockList::seal()
+{
+    m_Blocks.push_back(Stored());
+    Block& Data = m_Blocks.back().Data;
+    m_pRecorder->encodeBlock(&m_Open[0], BLOCK_FRAMES, m_Stride, Data);
+    // don't keep the reserve of the encoder's output
+    Block(Data).swap(Data);
+    m_BlockBytes += Data.size();
+    m_Open.clear();
+}
+
+bool
+FGReplayBlockList::push_tape_block(FGReplayTapeReader* pTape, uint64_t Offset, uint32_t Size,
+                                   const double* pTimes, unsigned Frames)
+{
+    if ((Frames != BLOCK_FRAMES)||
+        (!m_Open.empty())||
+        (m_pTape && (m_pTape != pTape)))
+        return false;
+
+    if (m_Times.empty() && m_Blocks.empty())
+        initRecordSize();
+
+    m_pTape = pTape;
+    m_Blocks.push_back(Stored());
+    m_Blocks.back().TapeOffset = Offset;
+    m_Blocks.back().TapeSize = Size;
+    m_Times.insert(m_Times.end(), pTimes, pTimes + Frames);
+    return true;
+}
+
+void
+FGReplayBlockList::pop_front()
+{
+    m_Times.pop_front();
+    if (m_Blocks.empty())
+    {
+        // frames of the incomplete block
+        if (++m_FirstFrame == m_Open.size() / m_Stride)
+        {
+            m_Open.clear();
+            m_FirstFrame = 0;
+        }
+    }
+    else
+    if (++m_FirstFrame == BLOCK_FRAMES)
+    {
+        m_BlockBytes -= m_Blocks.front().Data.size();
+        m_Blocks.pop_front();
+        m_FirstBlock++;
+        m_FirstFrame = 0;
+    }
+}
+
+size_t
+FGReplayBlockList::upperBound(double Time) const
+{
+    return std::upper_bound(m_Times.begin(), m_Times.end(), Time) - m_Times.begin();
+}
+
+const FGReplayData*
+FGReplayBlockList::at(size_t Index)
+{
+    size_t Frame = Index + m_FirstFrame;
+    size_t BlockIndex = Frame / BLOCK_FRAMES;
+    Frame = Frame % BLOCK_FRAMES;
+
+    if (BlockIndex >= m_Blocks.size())
+    {
+        // frame of the incomplete block
+        return (const FGReplayData*) &m_Open[Frame * m_Stride];
+    }
+
+    long Number = m_FirstBlock + BlockIndex;
+    Decoded* pSlot = &m_Cache[0];
+    if (m_Cache[1].Number == Number)
+        pSlot = &m_Cache[1];
+    else
+    if (m_Cache[0].Number != Number)
+    {
+        // replace the least recently used block
+        if (m_Cache[1].LastUsed < m_Cache[0].LastUsed)
+            pSlot = &m_Cache[1];
+        pSlot->Frames.resize(BLOCK_FRAMES * m_Stride);
+        pSlot->Number = Number;
+        const Stored& Source = m_Blocks[BlockIndex];
+        const Block* pData = &Source.Data;
+        if (Source.TapeSize)
+        {
+            // block left on tape
+            if (!m_pTape->readChunk(Source.TapeOffset, Source.TapeSize, m_TapeBuffer))
+            {
+                SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplaySystem: Cannot read replay data block " << Number << " from tape");
+            }
+            pData = &m_TapeBuffer;
+        }
+        if (!m_pRecorder->decodeBlock(*pData, BLOCK_FRAMES, m_Stride, &pSlot->Frames[0]))
+        {
+            SG_LOG(SG_SYSTEMS, SG_ALERT, "ReplaySystem: Corrupted replay data block " << Number);
+        }
+    }
+    pSlot->LastUsed = ++m_CacheClock;
+    return (const FGReplayData*) &pSlot->Frames[Frame * m_Stride];
+}
+
+size_t
+FGReplayBlockList::memoryUsage() const
+{
+    return m_BlockBytes + m_Blocks.size() * sizeof(Stored) + m_Open.capacity() +
+           m_TapeBuffer.capacity() +
+           m_Times.size() * sizeof(double) +
+           m_Cache[0].Frames.capacity() + m_Cache[1].Frames.capacity();
+}
+
 /**
  * Constructor
  */
@@ -80,12 +255,16 @@ FGReplay::FGReplay() :
     last_lt_time(0.0),
     last_msg_time(0),
     last_replay_state(0),
+    m_pRecorder(new FGFlightRecorder("replay-config")),
+    medium_term(m_pRecorder),
+    long_term(m_pRecorder),
+    m_pTapeReader(NULL),
+    m_pContinuousTape(NULL),
     m_high_res_time(60.0),
     m_medium_res_time(600.0),
     m_low_res_time(3600.0),
     m_medium_sample_rate(0.5), // medium term sample rate (sec)
-    m_long_sample_rate(5.0),   // long term sample rate (sec)
-    m_pRecorder(new FGFlightRecorder("replay-config"))
+    m_long_sample_rate(5.0)    // long term sample rate (sec)
 {
 }
 
@@ -107,21 +286,17 @@ FGReplay::~FGReplay()
 void
 FGReplay::clear()
 {
+    stopContinuousRecording();
+
     while ( !short_term.empty() )
     {
         m_pRecorder->deleteRecord(short_term.front());
         short_term.pop_front();
     }
-    while ( !medium_term.empty() )
-    {
-        m_pRecorder->deleteRecord(medium_term.front());
-        medium_term.pop_front();
-    }
-    while ( !long_term.empty() )
-    {
-        m_pRecorder->deleteRecord(long_term.front());
-        long_term.pop_front();
-    }
+    medium_term.clear();
+    long_term.clear();
+    delete m_pTapeReader;
+    m_pTapeReader = NULL;
     while ( !recycler.empty() )
     {
         m_pRecorder->deleteRecord(recycler.front());
@@ -145,6 +320,10 @@ FGReplay::init()
     replay_time_str = fgGetNode("/sim/replay/time-str",     true);
     replay_looped   = fgGetNode("/sim/replay/looped",       true);
     speed_up        = fgGetNode("/sim/speed-up",            true);
+    chunked_tapes   = fgGetNode("/sim/replay/chunked-tapes", true);
+    record_continuous = fgGetNode("/sim/replay/record-continuous", true);
+    if (!chunked_tapes->hasValue())
+        chunked_tapes->setBoolValue(true);
 
     // alias to keep backward compatibility
     fgGetNode("/sim/freeze/replay-state", true)->alias(replay_master);
@@ -207,9 +386,9 @@ void
 FGReplay::fillRecycler()
 {
     // Create an estimated nr of required ReplayData objects
-    // 120 is an estimated maximum frame rate.
-    int estNrObjects = (int) ((m_high_res_time*120) + (m_medium_res_time*m_medium_sample_rate) +
-                             (m_low_res_time*m_long_sample_rate));
+    // 120 is an estimated maximum frame rate. Medium and long term frames
+    // are copied to compressed blocks, they don't need records.
+    int estNrObjects = (int) (m_high_res_time*120);
     for (int i = 0; i < estNrObjects; i++)
     {
         FGReplayData* r = m_pRecorder->createEmptyRecord();
@@ -318,9 +497,16 @@ FGReplay::start(bool NewTape)
     printTimeStr(StrBuffer,EndTime,false);
     fgSetString("/sim/replay/end-time-str",   StrBuffer);
 
+    // memory used by the recorded frames - and what they'd need uncompressed
+    size_t RecordSize = m_pRecorder->getRecordSize();
     unsigned long buffer_elements =  short_term.size()+medium_term.size()+long_term.size();
-    fgSetDouble("/sim/replay/buffer-size-mbyte",
-                buffer_elements*m_pRecorder->getRecordSize() / (1024*1024.0));
+    double BufferSize = (short_term.size()*RecordSize + medium_term.memoryUsage() +
+                         long_term.memoryUsage()) / (1024*1024.0);
+    fgSetDouble("/sim/replay/buffer-size-mbyte", BufferSize);
+    fgSetDouble("/sim/replay/buffer-size-raw-mbyte",
+                buffer_elements*RecordSize / (1024*1024.0));
+    if (EndTime > StartTime)
+        fgSetDouble("/sim/replay/buffer-mbyte-per-hour", BufferSize * 3600.0 / (EndTime - StartTime));
     if ((fgGetBool("/sim/freeze/master"))||
         (0 == replay_master->getIntValue()))
         guiMessage("Replay active. 'Esc' to stop.");
@@ -497,6 +683,15 @@ FGReplay::update( double dt )
 
     // update the short term list
     short_term.push_back( r );
+
+    // record straight to disk, so long flights don't need to fit in memory
+    if (record_continuous->getBoolValue())
+    {
+        if (m_pContinuousTape || startContinuousRecording())
+            m_pContinuousTape->append(r);
+    }
+    else
+        stopContinuousRecording();
     FGReplayData *st_front = short_term.front();
     
     if (!st_front)
@@ -519,34 +714,28 @@ FGReplay::update( double dt )
             last_mt_time = sim_time;
             st_front = short_term.front();
             medium_term.push_back( st_front );
+            recycler.push_back(st_front);
             short_term.pop_front();
 
-            FGReplayData *mt_front = medium_term.front();
-            if ( sim_time - mt_front->sim_time > m_medium_res_time )
+            if ( sim_time - medium_term.frontTime() > m_medium_res_time )
             {
-                while ( sim_time - mt_front->sim_time > m_medium_res_time )
+                while ( !medium_term.empty() &&
+                        sim_time - medium_term.frontTime() > m_medium_res_time )
                 {
-                    mt_front = medium_term.front();
-                    recycler.push_back(mt_front);
                     medium_term.pop_front();
                 }
                 // update the long term list
-                if ( sim_time - last_lt_time > m_long_sample_rate )
+                if ( !medium_term.empty() &&
+                     sim_time - last_lt_time > m_long_sample_rate )
                 {
                     last_lt_time = sim_time;
-                    mt_front = medium_term.front();
-                    long_term.push_back( mt_front );
+                    long_term.push_back( medium_term.front() );
                     medium_term.pop_front();
 
-                    FGReplayData *lt_front = long_term.front();
-                    if ( sim_time - lt_front->sim_time > m_low_res_time )
+                    while ( !long_term.empty() &&
+                            sim_time - long_term.frontTime() > m_low_res_time )
                     {
-                        while ( sim_time - lt_front->sim_time > m_low_res_time )
-                        {
-                            lt_front = long_term.front();
-                            recycler.push_back(lt_front);
-                            long_term.pop_front();
-                        }
+                        long_term.pop_front();
                     }
                 }
             }
@@ -625,6 +814,32 @@ FGReplay::interpolate( double time, const replay_list_type &list)
     replay(time, list[mid+1], list[mid]);
 }
 
+/**
+ * interpolate a specific time from a compressed list, decoding only
+ * the blocks of the two frames involved
+ */
+void
+FGReplay::interpolate( double time, FGReplayBlockList &list)
+{
+    if ( list.empty() )
+    {
+        return;
+    } else if ( list.size() == 1 )
+    {
+        replay(time, list.front());
+        return;
+    }
+
+    size_t next = list.upperBound(time);
+    if (next < 1)
+        next = 1;
+    else if (next > list.size() - 1)
+        next = list.size() - 1;
+
+    const FGReplayData* pOldFrame = list.at(next-1);
+    replay(time, list.at(next), pOldFrame);
+}
+
 /** 
  *  Replay a saved frame based on time, interpolate from the two
  *  nearest saved frames.
@@ -651,24 +866,24 @@ FGReplay::replay( double time ) {
             interpolate( time, short_term );
         } else if ( ! medium_term.empty() ) {
             t1 = short_term.front()->sim_time;
-            t2 = medium_term.back()->sim_time;
+            t2 = medium_term.backTime();
             if ( time <= t1 && time >= t2 )
             {
                 replay(time, medium_term.back(), short_term.front());
             } else {
-                t1 = medium_term.back()->sim_time;
-                t2 = medium_term.front()->sim_time;
+                t1 = medium_term.backTime();
+                t2 = medium_term.frontTime();
                 if ( time <= t1 && time >= t2 ) {
                     interpolate( time, medium_term );
                 } else if ( ! long_term.empty() ) {
-                    t1 = medium_term.front()->sim_time;
-                    t2 = long_term.back()->sim_time;
+                    t1 = medium_term.frontTime();
+                    t2 = long_term.backTime();
                     if ( time <= t1 && time >= t2 )
                     {
                         replay(time, long_term.back(), medium_term.front());
                     } else {
-                        t1 = long_term.back()->sim_time;
-                        t2 = long_term.front()->sim_time;
+                        t1 = long_term.backTime();
+                        t2 = long_term.frontTime();
                         if ( time <= t1 && time >= t2 ) {
                             interpolate( time, long_term );
                         } else {
@@ -696,7 +911,7 @@ FGReplay::replay( double time ) {
  * given two FGReplayData elements and a time, interpolate between them
  */
 void
-FGReplay::replay(double time, FGReplayData* pCurrentFrame, FGReplayData* pOldFrame)
+FGReplay::replay(double time, const FGReplayData* pCurrentFrame, const FGReplayData* pOldFrame)
 {
     m_pRecorder->replay(time,pCurrentFrame,pOldFrame);
 }
@@ -706,10 +921,10 @@ FGReplay::get_start_time()
 {
     if ( ! long_term.empty() )
     {
-        return long_term.front()->sim_time;
+        return long_term.frontTime();
     } else if ( ! medium_term.empty() )
     {
-        return medium_term.front()->sim_time;
+        return medium_term.frontTime();
     } else if ( ! short_term.empty() )
     {
         return short_term.front()->sim_time;
@@ -767,6 +982,37 @@ saveRawReplayData(gzContainerWriter& output, const replay_list_type& ReplayData,
     return !output.fail();
 }
 
+/** Save compressed replay data in a separate container, in the same raw format */
+static bool
+saveRawReplayData(gzContainerWriter& output, FGReplayBlockList& ReplayData, size_t RecordSize)
+{
+    size_t Count = ReplayData.size();
+
+    if (!output.writeContainerHeader(ReplayContainer::RawData, Count * RecordSize))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Failed to save replay data. Cannot write data container. Disk full?");
+        return false;
+    }
+
+    // frames are decoded one block at a time
+    size_t CheckCount = 0;
+    while ((CheckCount < Count)&&
+           !output.fail())
+    {
+        output.write((const char*)ReplayData.at(CheckCount), RecordSize);
+        CheckCount++;
+    }
+
+    if (CheckCount != Count)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Failed to save replay data. Expected to write " << Count << " records, but wrote " << CheckCount);
+        return false;
+    }
+
+    SG_LOG(SG_SYSTEMS, MY_SG_DEBUG, "Saved " << CheckCount << " records of size " << RecordSize);
+    return !output.fail();
+}
+
 /** Load raw replay data from a separate container */
 static bool
 loadRawReplayData(gzContainerReader& input, FGFlightRecorder* pRecorder, replay_list_type& ReplayData, size_t RecordSize)
@@ -815,6 +1061,53 @@ loadRawReplayData(gzContainerReader& input, FGFlightRecorder* pRecorder, replay_
     return true;
 }
 
+/** Load raw replay data from a separate container into a compressed list */
+static bool
+loadRawReplayData(gzContainerReader& input, FGFlightRecorder* pRecorder, FGReplayBlockList& ReplayData, size_t RecordSize)
+{
+    size_t Size = 0;
+    simgear::ContainerType Type = ReplayContainer::Invalid;
+
+    if (!input.readContainerHeader(&Type, &Size))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Failed to load replay data. Missing data container.");
+        return false;
+    }
+    else
+    if (Type != ReplayContainer::RawData)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Failed to load replay data. Expected data container, got " << Type);
+        return false;
+    }
+
+    size_t Count = Size / RecordSize;
+    SG_LOG(SG_SYSTEMS, MY_SG_DEBUG, "Loading replay data. Container size is " << Size << ", record size " << RecordSize <<
+           ", expected record count " << Count << ".");
+
+    // one record to read into, the list keeps its own copy
+    FGReplayData* pBuffer = pRecorder->createEmptyRecord();
+    size_t CheckCount = 0;
+    for (CheckCount=0; (CheckCount<Count)&&(!input.eof()); ++CheckCount)
+    {
+        input.read((char*) pBuffer, RecordSize);
+        ReplayData.push_back(pBuffer);
+    }
+    pRecorder->deleteRecord(pBuffer);
+
+    if (CheckCount != Count)
+    {
+        if (input.eof())
+        {
+            SG_LOG(SG_SYSTEMS, SG_ALERT, "Unexpected end of file.");
+        }
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Failed to load replay data. Expected " << Count << " records, but got " << CheckCount);
+        return false;
+    }
+
+    SG_LOG(SG_SYSTEMS, MY_SG_DEBUG, "Loaded " << CheckCount << " records of size " << RecordSize);
+    return true;
+}
+
 /** Write flight recorder tape with given filename and meta properties to disk */
 bool
 FGReplay::saveTape(const SGPath& Filename, SGPropertyNode* MetaDataProps)
@@ -862,18 +1155,15 @@ FGReplay::saveTape(const SGPath& Filename, SGPropertyNode* MetaDataProps)
     return ok;
 }
 
-/** Write flight recorder tape to disk. User/script command. */
-bool
-FGReplay::saveTape(const SGPropertyNode* ConfigData)
+/** Meta data stored with a tape: aircraft, duration, version, replay messages. */
+SGPropertyNode_ptr
+FGReplay::createMetaData(const SGPropertyNode* ConfigData, double Duration)
 {
-    const char* tapeDirectory = fgGetString("/sim/replay/tape-directory", "");
-    const char* aircraftType  = fgGetString("/sim/aircraft", "unknown");
-
     SGPropertyNode_ptr myMetaData = new SGPropertyNode();
     SGPropertyNode* meta = myMetaData->getNode("meta", 0, true);
 
     // add some data to the file - so we know for which aircraft/version it was recorded
-    meta->setStringValue("aircraft-type",           aircraftType);
+    meta->setStringValue("aircraft-type",           fgGetString("/sim/aircraft", "unknown"));
     meta->setStringValue("aircraft-description",    fgGetString("/sim/description", ""));
     meta->setStringValue("aircraft-fdm",            fgGetString("/sim/flight-model", ""));
     meta->setStringValue("closest-airport-id",      fgGetString("/sim/airport/closest-airport-id", ""));
@@ -883,7 +1173,6 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
     meta->setStringValue("aircraft-version", aircraft_version);
 
     // add information on the tape's recording duration
-    double Duration = get_end_time()-get_start_time();
     meta->setDoubleValue("tape-duration", Duration);
     char StrBuffer[30];
     printTimeStr(StrBuffer, Duration, false);
@@ -891,17 +1180,22 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
 
     // add simulator version
     copyProperties(fgGetNode("/sim/version", 0, true), meta->getNode("version", 0, true));
-    if (ConfigData->getNode("user-data"))
+    if (ConfigData && ConfigData->getNode("user-data"))
     {
         copyProperties(ConfigData->getNode("user-data"), meta->getNode("user-data", 0, true));
     }
 
     // store replay messages
     copyProperties(fgGetNode("/sim/replay/messages", 0, true), myMetaData->getNode("messages", 0, true));
+    return myMetaData;
+}
 
-    // generate file name (directory + aircraft type + date + time + suffix)
-    SGPath p(tapeDirectory);
-    p.append(aircraftType);
+/** Generate a tape file name (directory + aircraft type + date + time + suffix) */
+SGPath
+FGReplay::createTapeName(const char* Suffix)
+{
+    SGPath p(fgGetString("/sim/replay/tape-directory", ""));
+    p.append(fgGetString("/sim/aircraft", "unknown"));
     p.concat("-");
     time_t calendar_time = time(NULL);
     struct tm *local_tm;
@@ -909,7 +1203,17 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
     char time_str[256];
     strftime( time_str, 256, "%Y%m%d-%H%M%S", local_tm);
     p.concat(time_str);
+    p.concat(Suffix);
     p.concat(".fgtape");
+    return p;
+}
+
+/** Write flight recorder tape to disk. User/script command. */
+bool
+FGReplay::saveTape(const SGPropertyNode* ConfigData)
+{
+    SGPropertyNode_ptr myMetaData = createMetaData(ConfigData, get_end_time()-get_start_time());
+    SGPath p = createTapeName("");
 
     bool ok = true;
     // make sure we're not overwriting something
@@ -921,7 +1225,12 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
     }
 
     if (ok)
-        ok &= saveTape(p, myMetaData.get());
+    {
+        if (chunked_tapes->getBoolValue())
+            ok &= saveChunkedTape(p, myMetaData.get());
+        else
+            ok &= saveTape(p, myMetaData.get());
+    }
 
     if (ok)
         guiMessage("Flight recorder tape saved successfully!");
@@ -937,6 +1246,9 @@ FGReplay::saveTape(const SGPropertyNode* ConfigData)
 bool
 FGReplay::loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData)
 {
+    if (FGReplayTapeReader::isChunkedTape(Filename))
+        return loadChunkedTape(Filename, Preview, UserData);
+
     bool ok = true;
 
     /* open input stream ********************************************/
@@ -1026,6 +1338,7 @@ FGReplay::loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserDat
             if (ok)
             {
                 // reconfigure the recorder - and wipe old data (no longer matches the current recorder)
+                stopContinuousRecording();
                 m_pRecorder->reinit(Config);
                 clear();
                 fillRecycler();
@@ -1088,6 +1401,203 @@ FGReplay::loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserDat
     return ok;
 }
 
+/** Write a chunked tape, which can be seeked without reading all of it. */
+bool
+FGReplay::saveChunkedTape(const SGPath& Filename, SGPropertyNode* MetaData)
+{
+    SGPropertyNode_ptr Config = new SGPropertyNode();
+    m_pRecorder->getConfig(Config.get());
+
+    FGReplayTapeWriter Tape(m_pRecorder);
+    if (!Tape.open(Filename, Config.get()))
+        return false;
+
+    // oldest frames first
+    for (size_t i=0; i<long_term.size(); i++)
+        Tape.append(long_term.at(i));
+    for (size_t i=0; i<medium_term.size(); i++)
+        Tape.append(medium_term.at(i));
+    for (replay_list_type::const_iterator it = short_term.begin(); it != short_term.end(); ++it)
+        Tape.append(*it);
+
+    return Tape.close(MetaData);
+}
+
+/** Read a chunked tape. Only its index is loaded: the chunks stay on disk
+ * and are read when replayed, except for the most recent one.
+ */
+bool
+FGReplay::loadChunkedTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData)
+{
+    SGTimeStamp LoadStart;
+    LoadStart.stamp();
+
+    FGReplayTapeReader* pTape = new FGReplayTapeReader(m_pRecorder);
+    bool ok = pTape->open(Filename);
+    if (!ok)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Cannot open file " << Filename);
+    }
+
+    SGPropertyNode_ptr MetaDataProps = new SGPropertyNode();
+    if (ok)
+    {
+        if (pTape->readMetaData(MetaDataProps))
+            copyProperties(MetaDataProps->getNode("meta", 0, true), UserData);
+        else
+            SG_LOG(SG_SYSTEMS, SG_WARN, "Flight recorder tape has no meta data: " << Filename);
+    }
+
+    if ((ok)&&(!Preview))
+    {
+        SGPropertyNode_ptr Config = new SGPropertyNode();
+        ok = pTape->readConfig(Config);
+        if (ok)
+        {
+            // reconfigure the recorder - and wipe old data (no longer matches the current recorder)
+            stopContinuousRecording();
+            m_pRecorder->reinit(Config);
+            clear();
+            fillRecycler();
+
+            size_t OriginalSize = Config->getIntValue("recorder/record-size", 0);
+            if ((OriginalSize != (size_t) m_pRecorder->getRecordSize())&&
+                (OriginalSize != 0))
+            {
+                ok = false;
+                SG_LOG(SG_SYSTEMS, SG_ALERT, "Error: Data inconsistency. Flight recorder tape has record size " << m_pRecorder->getRecordSize()
+                       << ", expected size was " << OriginalSize << ".");
+            }
+        }
+        else
+        {
+            SG_LOG(SG_SYSTEMS, SG_ALERT, "File not recognized. This is not a valid FlightGear flight recorder tape: " << Filename
+                   << ". Invalid configuration.");
+        }
+
+        if (ok)
+            ok = pTape->readIndex();
+
+        if (ok)
+        {
+            m_pTapeReader = pTape;
+            pTape = NULL;
+
+            const std::vector<FGReplayTapeReader::Chunk>& Chunks = m_pTapeReader->chunks();
+            const std::vector<double>& Times = m_pTapeReader->times();
+            size_t RecordSize = m_pRecorder->getRecordSize();
+            size_t Stride = (RecordSize + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+            std::vector<unsigned char> Data, Frames;
+            size_t First = 0;
+            for (size_t i=0; (i<Chunks.size())&&(ok); i++)
+            {
+                const FGReplayTapeReader::Chunk& c = Chunks[i];
+                bool Last = (i+1 == Chunks.size());
+                if ((!Last)&&
+                    (medium_term.push_tape_block(m_pTapeReader, c.Offset, c.Size, &Times[First], c.Frames)))
+                {
+                    First += c.Frames;
+                    continue;
+                }
+
+                // the most recent frames are kept as records, for the short term list
+                Frames.resize(c.Frames * Stride);
+                ok = m_pTapeReader->readChunk(c.Offset, c.Size, Data) &&
+                     m_pRecorder->decodeBlock(Data, c.Frames, Stride, &Frames[0]);
+                for (unsigned f=0; (f<c.Frames)&&(ok); f++)
+                {
+                    const FGReplayData* pFrame = (const FGReplayData*) &Frames[f * Stride];
+                    if (Last)
+                    {
+                        FGReplayData* pRecord = m_pRecorder->createEmptyRecord();
+                        memcpy(pRecord, pFrame, RecordSize);
+                        short_term.push_back(pRecord);
+                    }
+                    else
+                        medium_term.push_back(pFrame);
+                }
+                First += c.Frames;
+            }
+            if (!ok)
+            {
+                SG_LOG(SG_SYSTEMS, SG_ALERT, "Failed to load replay data. Corrupted chunk in " << Filename);
+            }
+
+            // restore replay messages
+            if (ok)
+            {
+                copyProperties(MetaDataProps->getNode("messages", 0, true),
+                               fgGetNode("/sim/replay/messages", 0, true));
+            }
+            sim_time = get_end_time();
+            last_mt_time = last_lt_time = sim_time;
+
+            SG_LOG(SG_SYSTEMS, SG_INFO, "Loaded index of " << Times.size() << " records in " << Chunks.size()
+                   << " chunks in " << (SGTimeStamp::now() - LoadStart).toMSecs() << " ms");
+        }
+    }
+
+    delete pTape;
+
+    if (!Preview)
+    {
+        if (ok)
+        {
+            guiMessage("Flight recorder tape loaded successfully!");
+            start(true);
+        }
+        else
+            guiMessage("Failed to load tape. See log output.");
+    }
+
+    return ok;
+}
+
+/** Start recording to a new tape on disk. */
+bool
+FGReplay::startContinuousRecording()
+{
+    SGPath p = createTapeName("-continuous");
+    if (p.exists())
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Error, flight recorder tape file with same name already exists.");
+        record_continuous->setBoolValue(false);
+        return false;
+    }
+
+    SGPropertyNode_ptr Config = new SGPropertyNode();
+    m_pRecorder->getConfig(Config.get());
+    m_pContinuousTape = new FGReplayTapeWriter(m_pRecorder);
+    if (!m_pContinuousTape->open(p, Config.get()))
+    {
+        delete m_pContinuousTape;
+        m_pContinuousTape = NULL;
+        // don't retry every frame
+        record_continuous->setBoolValue(false);
+        guiMessage("Failed to start continuous recording! See log output.");
+        return false;
+    }
+
+    SG_LOG(SG_SYSTEMS, SG_INFO, "ReplaySystem: Recording to " << p);
+    return true;
+}
+
+/** Finish the tape recorded to disk, if any. */
+void
+FGReplay::stopContinuousRecording()
+{
+    if (!m_pContinuousTape)
+        return;
+
+    double Duration = m_pContinuousTape->endTime() - m_pContinuousTape->startTime();
+    SGPropertyNode_ptr MetaData = createMetaData(NULL, Duration);
+    if (!m_pContinuousTape->close(MetaData.get()))
+        guiMessage("Failed to save continuous recording! See log output.");
+
+    delete m_pContinuousTape;
+    m_pContinuousTape = NULL;
+}
+
 /** List available tapes in current directory.
  * Limits to tapes matching current aircraft when SameAircraftFilter is enabled.
  */
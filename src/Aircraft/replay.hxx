@@ -31,6 +31,7 @@
 #include <simgear/compiler.h>
 
 #include <simgear/math/sg_types.hxx>
+#include <simgear/misc/stdint.hxx>
 #include <simgear/props/props.hxx>
 #include <simgear/structure/subsystem_mgr.hxx>
 
@@ -38,6 +39,8 @@
 #include <vector>
 
 class FGFlightRecorder;
+class FGReplayTapeReader;
+class FGReplayTapeWriter;
 
 typedef struct {
     double sim_time;
@@ -54,6 +57,83 @@ typedef struct {
 typedef std::deque < FGReplayData *> replay_list_type;
 typedef std::vector < FGReplayMessages > replay_messages_type;
 
+/**
+ * A list of replay frames, compressed in blocks of BLOCK_FRAMES frames
+ * by the flight recorder. Only the most recent, still incomplete block
+ * is kept raw. Blocks may also be left on a chunked tape, and are read
+ * when needed. Frames handed out are decoded on demand and stay valid
+ * until frames of two other blocks have been requested.
+ */
+class FGReplayBlockList
+{
+public:
+    enum { BLOCK_FRAMES = 64 };
+
+    FGReplayBlockList(FGFlightRecorder* pRecorder);
+
+    void   clear();
+    bool   empty() const { return m_Times.empty(); }
+    size_t size()  const { return m_Times.size(); }
+
+    /** Append a copy of the given frame. */
+    void   push_back(const FGReplayData* pFrame);
+    void   pop_front();
+    /** Append a chunk of a tape, without reading it. Fails unless the
+     *  chunk has BLOCK_FRAMES frames and the list has no incomplete block.
+     *  All chunks of a list need to come from the same tape. */
+    bool   push_tape_block(FGReplayTapeReader* pTape, uint64_t Offset, uint32_t Size,
+                           const double* pTimes, unsigned Frames);
+
+    double frontTime() const { return m_Times.front(); }
+    double backTime()  const { return m_Times.back(); }
+    double timeAt(size_t Index) const { return m_Times[Index]; }
+    /** Index of the first frame recorded after the given time. */
+    size_t upperBound(double Time) const;
+
+    const FGReplayData* front() { return at(0); }
+    const FGReplayData* back()  { return at(size()-1); }
+    const FGReplayData* at(size_t Index);
+
+    /** Bytes used by the frames of this list. */
+    size_t memoryUsage() const;
+
+private:
+    typedef std::vector<unsigned char> Block;
+
+    struct Stored
+    {
+        Stored() : TapeOffset(0), TapeSize(0) {}
+        Block    Data;
+        uint64_t TapeOffset;   // where to find the block when not in Data
+        uint32_t TapeSize;
+    };
+
+    struct Decoded
+    {
+        Decoded() : Number(-1), LastUsed(0) {}
+        long          Number;
+        unsigned long LastUsed;
+        Block         Frames;
+    };
+
+    void initRecordSize();
+    void seal();
+
+    FGFlightRecorder*   m_pRecorder;
+    size_t              m_RecordSize;
+    size_t              m_Stride;        // record size, aligned for FGReplayData
+    std::deque<double>  m_Times;
+    std::deque<Stored>  m_Blocks;        // sealed blocks
+    long                m_FirstBlock;    // number of the first sealed block
+    size_t              m_FirstFrame;    // frames of the first block popped already
+    Block               m_Open;          // raw frames of the incomplete block
+    size_t              m_BlockBytes;
+    FGReplayTapeReader* m_pTape;
+    Block               m_TapeBuffer;
+    Decoded             m_Cache[2];
+    unsigned long       m_CacheClock;
+};
+
 /**
  * A recording/replay module for FlightGear flights
  * 
@@ -79,7 +159,12 @@ private:
     void clear();
     FGReplayData* record(double time);
     void interpolate(double time, const replay_list_type &list);
-    void replay(double time, FGReplayData* pCurrentFrame, FGReplayData* pOldFrame=NULL);
+    void interpolate(double time, FGReplayBlockList &list);
+    void replay(double time, const FGReplayData* pCurrentFrame, const FGReplayData* pOldFrame=NULL);
+    SGPropertyNode_ptr createMetaData(const SGPropertyNode* ConfigData, double Duration);
+    SGPath createTapeName(const char* Suffix);
+    bool startContinuousRecording();
+    void stopContinuousRecording();
     void guiMessage(const char* message);
     void loadMessages();
     void fillRecycler();
@@ -93,6 +178,8 @@ private:
     bool listTapes(bool SameAircraftFilter, const SGPath& tapeDirectory);
     bool saveTape(const SGPath& Filename, SGPropertyNode* MetaData);
     bool loadTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData);
+    bool saveChunkedTape(const SGPath& Filename, SGPropertyNode* MetaData);
+    bool loadChunkedTape(const SGPath& Filename, bool Preview, SGPropertyNode* UserData);
 
     double sim_time;
     double last_mt_time;
@@ -102,10 +189,14 @@ private:
     int last_replay_state;
     bool was_finished_already;
 
+    FGFlightRecorder* m_pRecorder;
+
     replay_list_type short_term;
-    replay_list_type medium_term;
-    replay_list_type long_term;
+    FGReplayBlockList medium_term;
+    FGReplayBlockList long_term;
     replay_list_type recycler;
+    FGReplayTapeReader* m_pTapeReader;      // tape the loaded frames are read from
+    FGReplayTapeWriter* m_pContinuousTape;  // tape recording straight to disk
     replay_messages_type replay_messages;
 
     SGPropertyNode_ptr disable_replay;
@@ -114,6 +205,8 @@ private:
     SGPropertyNode_ptr replay_time_str;
     SGPropertyNode_ptr replay_looped;
     SGPropertyNode_ptr speed_up;
+    SGPropertyNode_ptr chunked_tapes;
+    SGPropertyNode_ptr record_continuous;
 
     double m_high_res_time;    // default: 60 secs of high res data
     double m_medium_res_time;  // default: 10 mins of 1 fps data
@@ -121,8 +214,6 @@ private:
     // short term sample rate is as every frame
     double m_medium_sample_rate; // medium term sample rate (sec)
     double m_long_sample_rate;   // long term sample rate (sec)
-
-    FGFlightRecorder* m_pRecorder;
 };
 
 #endif // _FG_REPLAY_HXX
@@ -0,0 +1,468 @@
+// replaytape.cxx - chunked, seekable flight recorder tapes
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string.h>
+#include <sstream>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/props/props_io.hxx>
+#include <simgear/structure/SGReferenced.hxx>
+#include <simgear/structure/SGSharedPtr.hxx>
+#include <simgear/structure/exception.hxx>
+#include <simgear/threads/SGQueue.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+#include "replaytape.hxx"
+#include "flightrecorder.hxx"
+
+/** Magic strings of chunked tapes. Legacy tapes start with a gzip header. */
+static const char ChunkedTapeMagic[] = "FlightGear Chunked Recorder Tape";
+static const char ChunkedTapeTrailerMagic[] = "FGTI";
+static const uint32_t ChunkedTapeVersion = 1;
+
+/* size of the header of a chunk: frame count and data size */
+static const size_t ChunkHeaderSize = 2*sizeof(uint32_t);
+/* size of the trailer: footer offset, chunk count and magic */
+static const size_t TrailerSize = sizeof(uint64_t) + sizeof(uint32_t) + 4;
+
+template <class T>
+static void
+writeValue(std::ostream& output, T Value)
+{
+    output.write((const char*) &Value, sizeof(T));
+}
+
+template <class T>
+static bool
+readValue(std::istream& input, T& Value)
+{
+    input.read((char*) &Value, sizeof(T));
+    return !input.fail();
+}
+
+/** Write properties as XML, preceded by its size */
+static void
+writePropertyBlock(std::ostream& output, const SGPropertyNode* Props)
+{
+    std::ostringstream xml;
+    if (Props)
+        writeProperties(xml, Props, true);
+    const std::string& s = xml.str();
+    writeValue<uint32_t>(output, s.size());
+    output.write(s.data(), s.size());
+}
+
+static bool
+readPropertyBlock(std::istream& input, SGPropertyNode* Props, uint64_t MaxSize)
+{
+    uint32_t Size = 0;
+    if ((!readValue(input, Size))||(Size > MaxSize))
+        return false;
+    std::string xml(Size, 0);
+    input.read(&xml[0], Size);
+    if (input.fail())
+        return false;
+    if (Size == 0)
+        return true;
+    try
+    {
+        readProperties(xml.data(), Size, Props);
+    } catch (const sg_exception &e)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Error reading flight recorder tape, XML parser message:" << e.getFormattedMessage());
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************
+ * FGReplayTapeWriter
+ ******************************************************************/
+
+/** Frames of one chunk, handed to the writer thread */
+struct FGReplayTapeJob : public SGReferenced
+{
+    std::vector<unsigned char> Frames;
+    unsigned Count;
+};
+
+class FGReplayTapeWriter::WriterThread : public SGThread
+{
+public:
+    WriterThread(FGFlightRecorder* pRecorder, const SGPath& Filename, size_t Stride) :
+        m_pRecorder(pRecorder),
+        m_Output(Filename, std::ios::binary | std::ios::out | std::ios::trunc),
+        m_Stride(Stride)
+    {
+    }
+
+    virtual void run()
+    {
+        std::vector<unsigned char> Data;
+        for (;;) {
+            SGSharedPtr<FGReplayTapeJob> job = _jobs.pop();
+            // A null job terminates the thread
+            if (!job)
+                return;
+
+            m_pRecorder->encodeBlock(&job->Frames[0], job->Count, m_Stride, Data);
+            FGReplayTapeReader::Chunk Chunk;
+            Chunk.Offset = (uint64_t) m_Output.tellp() + ChunkHeaderSize;
+            Chunk.Size   = Data.size();
+            Chunk.Frames = job->Count;
+            writeValue<uint32_t>(m_Output, Chunk.Frames);
+            writeValue<uint32_t>(m_Output, Chunk.Size);
+            m_Output.write((const char*) &Data[0], Data.size());
+            m_Chunks.push_back(Chunk);
+        }
+    }
+
+    void request(FGReplayTapeJob* job)
+    { _jobs.push(job); }
+
+    void stop()
+    {
+        _jobs.push(SGSharedPtr<FGReplayTapeJob>());
+        join();
+    }
+
+    // only to be accessed before start and after stop
+    FGFlightRecorder* m_pRecorder;
+    sg_ofstream m_Output;
+    size_t m_Stride;
+    std::vector<FGReplayTapeReader::Chunk> m_Chunks;
+
+private:
+    SGBlockingQueue<SGSharedPtr<FGReplayTapeJob> > _jobs;
+};
+
+FGReplayTapeWriter::FGReplayTapeWriter(FGFlightRecorder* pRecorder) :
+    m_pRecorder(pRecorder),
+    m_pThread(NULL),
+    m_RecordSize(0),
+    m_FrameCount(0)
+{
+}
+
+FGReplayTapeWriter::~FGReplayTapeWriter()
+{
+    if (m_pThread)
+        close(NULL);
+}
+
+bool
+FGReplayTapeWriter::open(const SGPath& Filename, const SGPropertyNode* Config)
+{
+    if (m_pThread)
+        return false;
+
+    m_Filename = Filename;
+    m_RecordSize = m_pRecorder->getRecordSize();
+    m_Frames.clear();
+    m_FrameCount = 0;
+    m_Times.clear();
+
+    WriterThread* pThread = new WriterThread(m_pRecorder, Filename, m_RecordSize);
+    std::ostream& output = pThread->m_Output;
+    output.write(ChunkedTapeMagic, strlen(ChunkedTapeMagic));
+    writeValue<uint32_t>(output, ChunkedTapeVersion);
+    writePropertyBlock(output, Config);
+    if (!output.good())
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Cannot write flight recorder tape " << Filename);
+        delete pThread;
+        return false;
+    }
+
+    m_pThread = pThread;
+    m_pThread->start();
+    return true;
+}
+
+void
+FGReplayTapeWriter::append(const FGReplayData* pFrame)
+{
+    if (!m_pThread)
+        return;
+
+    const unsigned char* p = (const unsigned char*) pFrame;
+    m_Frames.insert(m_Frames.end(), p, p + m_RecordSize);
+    m_Times.push_back(pFrame->sim_time);
+    if (++m_FrameCount == FGReplayBlockList::BLOCK_FRAMES)
+        flush();
+}
+
+void
+FGReplayTapeWriter::flush()
+{
+    if (m_FrameCount == 0)
+        return;
+
+    SGSharedPtr<FGReplayTapeJob> job = new FGReplayTapeJob;
+    job->Frames.swap(m_Frames);
+    job->Count = m_FrameCount;
+    m_pThread->request(job);
+
+    m_Frames.reserve(FGReplayBlockList::BLOCK_FRAMES * m_RecordSize);
+    m_FrameCount = 0;
+}
+
+bool
+FGReplayTapeWriter::close(const SGPropertyNode* MetaData)
+{
+    if (!m_pThread)
+        return false;
+
+    flush();
+    m_pThread->stop();
+
+    std::ostream& output = m_pThread->m_Output;
+    const std::vector<FGReplayTapeReader::Chunk>& Chunks = m_pThread->m_Chunks;
+    uint64_t FooterOffset = output.tellp();
+
+    writePropertyBlock(output, MetaData);
+    for (size_t i=0; i<Chunks.size(); i++)
+    {
+        writeValue<uint64_t>(output, Chunks[i].Offset);
+        writeValue<uint32_t>(output, Chunks[i].Size);
+        writeValue<uint32_t>(output, Chunks[i].Frames);
+    }
+    if (!m_Times.empty())
+        output.write((const char*) &m_Times[0], m_Times.size() * sizeof(double));
+    writeValue<uint64_t>(output, FooterOffset);
+    writeValue<uint32_t>(output, Chunks.size());
+    output.write(ChunkedTapeTrailerMagic, 4);
+
+    bool ok = output.good();
+    if (!ok)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Failed to write flight recorder tape " << m_Filename << ". Disk full?");
+    }
+    else
+    {
+        SG_LOG(SG_SYSTEMS, SG_INFO, "Saved " << m_Times.size() << " records in " << Chunks.size()
+               << " chunks to " << m_Filename);
+    }
+
+    delete m_pThread;
+    m_pThread = NULL;
+    return ok;
+}
+
+/******************************************************************
+ * FGReplayTapeReader
+ ******************************************************************/
+
+FGReplayTapeReader::FGReplayTapeReader(FGFlightRecorder* pRecorder) :
+    m_pRecorder(pRecorder),
+    m_FirstChunk(0),
+    m_FileSize(0)
+{
+}
+
+bool
+FGReplayTapeReader::isChunkedTape(const SGPath& Filename)
+{
+    sg_ifstream input(Filename, std::ios::binary | std::ios::in);
+    char Magic[sizeof(ChunkedTapeMagic)] = {0};
+    input.read(Magic, strlen(ChunkedTapeMagic));
+    return (!input.fail())&&(0 == memcmp(Magic, ChunkedTapeMagic, strlen(ChunkedTapeMagic)));
+}
+
+bool
+FGReplayTapeReader::open(const SGPath& Filename)
+{
+    m_File.open(Filename, std::ios::binary | std::ios::in);
+    if (!m_File.good())
+        return false;
+    m_File.seekg(0, std::ios::end);
+    m_FileSize = m_File.tellg();
+    m_File.seekg(0, std::ios::beg);
+    m_Chunks.clear();
+    m_Times.clear();
+
+    char Magic[sizeof(ChunkedTapeMagic)] = {0};
+    uint32_t Version = 0;
+    m_File.read(Magic, strlen(ChunkedTapeMagic));
+    if ((!readValue(m_File, Version))||
+        (0 != memcmp(Magic, ChunkedTapeMagic, strlen(ChunkedTapeMagic))))
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Not a chunked flight recorder tape: " << Filename);
+        return false;
+    }
+    if (Version != ChunkedTapeVersion)
+    {
+        SG_LOG(SG_SYSTEMS, SG_ALERT, "Unsupported flight recorder tape version " << Version << ": " << Filename);
+        return false;
+    }
+
+    // skip the configuration, to find the first chunk
+    uint32_t ConfigSize = 0;
+    if (!readValue(m_File, ConfigSize))
+        return false;
+    m_FirstChunk = (uint64_t) m_File.tellg() + ConfigSize;
+    return m_FirstChunk <= m_FileSize;
+}
+
+bool
+FGReplayTapeReader::readConfig(SGPropertyNode* Config)
+{
+    m_File.clear();
+    m_File.seekg(strlen(ChunkedTapeMagic) + sizeof(uint32_t));
+    return readPropertyBlock(m_File, Config, m_FileSize);
+}
+
+bool
+FGReplayTapeReader::readTrailer(uint64_t& FooterOffset, uint32_t& ChunkCount)
+{
+    if (m_FileSize < m_FirstChunk + TrailerSize)
+        return false;
+    char Magic[4];
+    m_File.clear();
+    m_File.seekg(m_FileSize - TrailerSize);
+    if ((!readValue(m_File, FooterOffset))||
+        (!readValue(m_File, ChunkCount)))
+        return false;
+    m_File.read(Magic, 4);
+    return (!m_File.fail())&&
+           (0 == memcmp(Magic, ChunkedTapeTrailerMagic, 4))&&
+           (FooterOffset >= m_FirstChunk)&&
+           (FooterOffset < m_FileSize);
+}
+
+bool
+FGReplayTapeReader::readMetaData(SGPropertyNode* MetaData)
+{
+    uint64_t FooterOffset;
+    uint32_t ChunkCount;
+    if (!readTrailer(FooterOffset, ChunkCount))
+        return false;
+    m_File.seekg(FooterOffset);
+    return readPropertyBlock(m_File, MetaData, m_FileSize - FooterOffset);
+}
+
+bool
+FGReplayTapeReader::readIndex()
+{
+    m_Chunks.clear();
+    m_Times.clear();
+
+    uint64_t FooterOffset;
+    uint32_t ChunkCount;
+    if (!readTrailer(FooterOffset, ChunkCount))
+    {
+        SG_LOG(SG_SYSTEMS, SG_WARN, "Flight recorder tape has no index. Was it closed properly? Scanning chunks...");
+        return scanChunks();
+    }
+
+    // skip the meta data
+    uint32_t MetaSize = 0;
+    m_File.seekg(FooterOffset);
+    if (!readValue(m_File, MetaSize))
+        return false;
+    m_File.seekg(MetaSize, std::ios::cur);
+
+    uint64_t FrameCount = 0;
+    m_Chunks.resize(ChunkCount);
+    for (uint32_t i=0; i<ChunkCount; i++)
+    {
+        Chunk& c = m_Chunks[i];
+        if ((!readValue(m_File, c.Offset))||
+            (!readValue(m_File, c.Size))||
+            (!readValue(m_File, c.Frames))||
+            (c.Offset + c.Size > FooterOffset))
+        {
+            SG_LOG(SG_SYSTEMS, SG_ALERT, "Invalid flight recorder tape index.");
+            m_Chunks.clear();
+            return false;
+        }
+        FrameCount += c.Frames;
+    }
+
+    if (FrameCount * sizeof(double) > m_FileSize)
+    {
+        m_Chunks.clear();
+        return false;
+    }
+    m_Times.resize(FrameCount);
+    if (FrameCount)
+        m_File.read((char*) &m_Times[0], FrameCount * sizeof(double));
+    if (m_File.fail())
+    {
+        m_Chunks.clear();
+        m_Times.clear();
+        return false;
+    }
+    return true;
+}
+
+/** Rebuild the index of a tape by reading its chunks. */
+bool
+FGReplayTapeReader::scanChunks()
+{
+    size_t RecordSize = m_pRecorder->getRecordSize();
+    std::vector<unsigned char> Data, Frames;
+    uint64_t Offset = m_FirstChunk;
+    while (Offset + ChunkHeaderSize <= m_FileSize)
+    {
+        Chunk c;
+        m_File.clear();
+        m_File.seekg(Offset);
+        if ((!readValue(m_File, c.Frames))||
+            (!readValue(m_File, c.Size)))
+            break;
+        c.Offset = Offset + ChunkHeaderSize;
+        if ((c.Frames == 0)||
+            (c.Frames > FGReplayBlockList::BLOCK_FRAMES)||
+            (!readChunk(c.Offset, c.Size, Data)))
+            break;
+
+        Frames.resize(c.Frames * RecordSize);
+        if (!m_pRecorder->decodeBlock(Data, c.Frames, RecordSize, &Frames[0]))
+            break;
+        for (uint32_t i=0; i<c.Frames; i++)
+        {
+            // sim_time is the first field of each record
+            double Time;
+            memcpy(&Time, &Frames[i * RecordSize], sizeof(double));
+            m_Times.push_back(Time);
+        }
+
+        m_Chunks.push_back(c);
+        Offset = c.Offset + c.Size;
+    }
+
+    // the last chunk may have been written partially
+    SG_LOG(SG_SYSTEMS, SG_INFO, "Recovered " << m_Times.size() << " records in " << m_Chunks.size() << " chunks.");
+    return !m_Chunks.empty();
+}
+
+bool
+FGReplayTapeReader::readChunk(uint64_t Offset, uint32_t Size, std::vector<unsigned char>& Data)
+{
+    if (Offset + Size > m_FileSize)
+        return false;
+    Data.resize(Size);
+    m_File.clear();
+    m_File.seekg(Offset);
+    if (Size)
+        m_File.read((char*) &Data[0], Size);
+    return !m_File.fail();
+}
@@ -0,0 +1,127 @@
+// replaytape.hxx - chunked, seekable flight recorder tapes
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _FG_REPLAYTAPE_HXX
+#define _FG_REPLAYTAPE_HXX 1
+
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/misc/stdint.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/props/props.hxx>
+
+#include <string>
+#include <vector>
+
+#include "replay.hxx"
+
+/*
+ * Layout of a chunked tape. Numbers are stored in host byte order, like
+ * the records themselves.
+ *
+ *   header:  magic, version, size and XML of the recorder configuration
+ *   chunks:  frame count, data size and data of one compressed block of
+ *            frames (FGFlightRecorder::encodeBlock) each
+ *   footer:  size and XML of the meta data, offset/size/frame count of
+ *            every chunk, and the time of every frame
+ *   trailer: offset of the footer, chunk count, trailer magic
+ *
+ * The footer is written when the tape is closed, so tapes can be written
+ * while recording. Tapes without one (i.e. when the simulator crashed)
+ * are indexed by scanning their chunks.
+ */
+
+/**
+ * Writes a chunked tape. Frames are collected into chunks on the calling
+ * thread, but compressed and written by a background thread.
+ */
+class FGReplayTapeWriter
+{
+public:
+    FGReplayTapeWriter(FGFlightRecorder* pRecorder);
+    ~FGReplayTapeWriter();
+
+    bool   open(const SGPath& Filename, const SGPropertyNode* Config);
+    bool   isOpen() const { return m_pThread != NULL; }
+
+    /** Append a copy of the frame. Frames need to be in time order. */
+    void   append(const FGReplayData* pFrame);
+
+    /** Write the remaining frames, the meta data and the index. */
+    bool   close(const SGPropertyNode* MetaData);
+
+    double startTime() const { return m_Times.empty() ? 0.0 : m_Times.front(); }
+    double endTime()   const { return m_Times.empty() ? 0.0 : m_Times.back(); }
+    const SGPath& path() const { return m_Filename; }
+
+private:
+    class WriterThread;
+
+    void flush();
+
+    FGFlightRecorder*          m_pRecorder;
+    SGPath                     m_Filename;
+    WriterThread*              m_pThread;
+    size_t                     m_RecordSize;
+    std::vector<unsigned char> m_Frames;    // frames of the incomplete chunk
+    unsigned                   m_FrameCount;
+    std::vector<double>        m_Times;
+};
+
+/**
+ * Random access to the chunks of a chunked tape.
+ */
+class FGReplayTapeReader
+{
+public:
+    struct Chunk
+    {
+        uint64_t Offset;   // of the chunk data
+        uint32_t Size;
+        uint32_t Frames;
+    };
+
+    FGReplayTapeReader(FGFlightRecorder* pRecorder);
+
+    /** True when the file is a chunked tape. */
+    static bool isChunkedTape(const SGPath& Filename);
+
+    bool open(const SGPath& Filename);
+    bool readConfig(SGPropertyNode* Config);
+    /** Meta data of the tape. Fails for tapes without footer. */
+    bool readMetaData(SGPropertyNode* MetaData);
+    /** Load the chunk index. Needs the recorder configured for the tape
+     *  already, for tapes without footer. */
+    bool readIndex();
+
+    const std::vector<Chunk>&  chunks() const { return m_Chunks; }
+    /** Time of every frame of the tape, in chunk order. */
+    const std::vector<double>& times()  const { return m_Times; }
+
+    bool readChunk(uint64_t Offset, uint32_t Size, std::vector<unsigned char>& Data);
+
+private:
+    bool readTrailer(uint64_t& FooterOffset, uint32_t& ChunkCount);
+    bool scanChunks();
+
+    FGFlightRecorder*   m_pRecorder;
+    sg_ifstream         m_File;
+    uint64_t            m_FirstChunk;   // offset of the first chunk
+    uint64_t            m_FileSize;
+    std::vector<Chunk>  m_Chunks;
+    std::vector<double> m_Times;
+};
+
+#endif // _FG_REPLAYTAPE_HXX
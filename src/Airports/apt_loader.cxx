@@ -43,6 +43,8 @@
 #include <simgear/misc/sg_path.hxx>
 
 #include <cstddef>              // std::size_t
+#include <cstring>              // std::memcpy(), std::memmove()
+#include <istream>
 #include <string>
 #include <vector>
 #include <utility>              // std::pair, std::move()
@@ -73,8 +75,126 @@ static FGPositioned::Type fptypeFromRobinType(unsigned int aType)
   }
 }
 
+// Splits a stream into lines, reading it in large blocks so that no
+// per-line allocation is needed. A line stays valid until the next call to
+// next(). Like std::getline(), lines don't include the '\n' terminator but
+// may end with '\r'; they are null-terminated.
+class DatLineReader
+{
+public:
+  explicit DatLineReader(std::istream& in)
+    : _in(in), _buf(INITIAL_SIZE), _begin(0), _end(0), _eof(false)
+  { }
+
+  bool next(const char*& line, std::size_t& length)
+  {
+    for (;;) {
+      const char* start = _buf.data() + _begin;
+      const void* nl = memchr(start, '\n', _end - _begin);
+
+      if (nl) {
+        line = start;
+        length = static_cast<const char*>(nl) - start;
+        _buf[_begin + length] = '\0';
+        _begin += length + 1;
+        return true;
+      } else if (_eof) {
+        if (_begin == _end) {
+          return false;
+        }
+
+        // last line, without a terminator (fill() left room for it)
+        line = start;
+        length = _end - _begin;
+        _buf[_end] = '\0';
+        _begin = _end;
+        return true;
+      }
+
+      fill();
+    }
+  }
+
+private:
+  static const std::size_t INITIAL_SIZE = 1 << 16;
+
+  // Move the partial line to the start of the buffer and append to it
+  void fill()
+  {
+    std::size_t partial = _end - _begin;
+    if (partial + 1 >= _buf.size()) {
+      _buf.resize(_buf.size() * 2); // very long line
+    } else if (_begin > 0) {
+      std::memmove(_buf.data(), _buf.data() + _begin, partial);
+    }
+
+    _begin = 0;
+    _end = partial;
+    // keep one char for the null terminator of an unterminated last line
+    _in.read(_buf.data() + _end, _buf.size() - _end - 1);
+    _end += _in.gcount();
+    _eof = !_in;
+  }
+
+  std::istream& _in;
+  std::vector<char> _buf;
+  std::size_t _begin, _end;     // unread part of _buf
+  bool _eof;
+};
+
+// Same as simgear::strutils::split(str, 0, maxsplit), but the strings
+// already in 'tokens' are reused to avoid reallocating them.
+static void splitLine(const char* str, std::size_t len,
+                      vector<string>& tokens, int maxsplit = 0)
+{
+  std::size_t i = 0, count = 0;
+
+  while (i < len) {
+    while (i < len && isspace(static_cast<unsigned char>(str[i]))) ++i;
+    std::size_t j = i;
+    while (i < len && !isspace(static_cast<unsigned char>(str[i]))) ++i;
+    if (j < i) {
+      if (count < tokens.size()) {
+        tokens[count].assign(str + j, i - j);
+      } else {
+        tokens.emplace_back(str + j, i - j);
+      }
+      ++count;
+
+      while (i < len && isspace(static_cast<unsigned char>(str[i]))) ++i;
+      if (maxsplit && (count >= static_cast<std::size_t>(maxsplit)) &&
+          i < len) {
+        if (count < tokens.size()) {
+          tokens[count].assign(str + i, len - i);
+        } else {
+          tokens.emplace_back(str + i, len - i);
+        }
+        ++count;
+        i = len;
+      }
+    }
+  }
+
+  tokens.resize(count);
+}
+
 namespace flightgear
 {
+const char* APTLoader::LineArena::store(const char* str, std::size_t length)
+{
+  if (_blocks.empty() || _used + length + 1 > _blockSize) {
+    _blockSize = (length < BLOCK_SIZE) ? BLOCK_SIZE : length + 1;
+    _blocks.emplace_back(new char[_blockSize]);
+    _used = 0;
+  }
+
+  char* result = _blocks.back().get() + _used;
+  std::memcpy(result, str, length);
+  result[length] = '\0';
+  _used += length + 1;
+  return result;
+}
+
 APTLoader::APTLoader()
   :  last_apt_id(""),
      last_apt_elev(0.0),
@@ -99,28 +219,31 @@ void APTLoader::readAptDatFile(const SGPath &aptdb_file,
                           sg_location(aptdb_file));
   }
 
-  string line;
+  DatLineReader reader(in);
+  const char* line;
+  std::size_t length;
 
   unsigned int rowCode = 0;     // terminology used in the apt.dat format spec
   unsigned int line_num = 0;
   // "airport identifier": terminology used in the apt.dat format spec. It is
   // often an ICAO code, but not always.
   string currentAirportId;
-  // Boolean used to make sure we don't try to load the same airport several
-  // times. Defaults to true only to ensure we don't add garbage to
-  // 'airportInfoMap' under the key "" (empty airport identifier) in case the
-  // apt.dat file doesn't have a start-of-airport row code (1, 16 or 17) after
-  // its header---which would be invalid, anyway.
-  bool skipAirport = true;
+  // Airport currently being read, null if skipped. Defaults to null only to
+  // ensure we don't add garbage to 'airportInfoMap' under the key ""
+  // (empty airport identifier) in case the apt.dat file doesn't have a
+  // start-of-airport row code (1, 16 or 17) after its header---which would
+  // be invalid, anyway.
+  RawAirportInfo* currentAirport = 0;
 
   // Read the apt.dat header (two lines)
-  while ( line_num < 2 && std::getline(in, line) ) {
+  while ( line_num < 2 && reader.next(line, length) ) {
     // 'line' may end with an \r character (tested on Linux, only \n was
     // stripped: std::getline() only discards the _native_ line terminator)
     line_num++;
 
     if ( line_num == 1 ) {
-      std::string stripped_line = simgear::strutils::strip(line);
+      std::string stripped_line =
+        simgear::strutils::strip(string(line, length));
       // First line indicates IBM ("I") or Macintosh ("A") line endings.
       if ( stripped_line != "I" && stripped_line != "A" ) {
         std::string pb = "invalid first line (neither 'I' nor 'A')";
@@ -129,9 +252,7 @@ void APTLoader::readAptDatFile(const SGPath &aptdb_file,
                                   stripped_line);
       }
     } else {     // second line of the file
-      std::istringstream s(line);
-      int apt_dat_format_version;
-      s >> apt_dat_format_version;
+      int apt_dat_format_version = atoi(string(line, length).c_str());
       SG_LOG( SG_GENERAL, SG_INFO,
               "apt.dat format version (" << apt_dat << "): " <<
               apt_dat_format_version );
@@ -140,11 +261,11 @@ void APTLoader::readAptDatFile(const SGPath &aptdb_file,
 
   throwExceptionIfStreamError(in, aptdb_file);
 
-  while ( std::getline(in, line) ) {
+  while ( reader.next(line, length) ) {
     // 'line' may end with an \r character, see above
     line_num++;
 
-    if ( isBlankOrCommentLine(line) )
+    if ( isBlankOrCommentLine(line, length) )
       continue;
 
     if ((line_num % 100) == 0) {
@@ -156,49 +277,51 @@ void APTLoader::readAptDatFile(const SGPath &aptdb_file,
     }
 
     // Extract the first field into 'rowCode'
-    rowCode = atoi(line.c_str());
+    rowCode = atoi(line);
 
     if ( rowCode == 1  /* Airport */ ||
          rowCode == 16 /* Seaplane base */ ||
          rowCode == 17 /* Heliport */ ) {
-      vector<string> tokens(simgear::strutils::split(line));
-      if (tokens.size() < 6) {
+      splitLine(line, length, token);
+      if (token.size() < 6) {
         SG_LOG( SG_GENERAL, SG_WARN,
                 apt_dat << ":"  << line_num << ": invalid airport header "
                 "(at least 6 fields are required)" );
-        skipAirport = true; // discard everything until the next airport header
+        currentAirport = 0; // discard everything until the next airport header
         continue;
       }
 
-      currentAirportId = tokens[4]; // often an ICAO, but not always
+      currentAirportId = token[4]; // often an ICAO, but not always
       // Check if the airport is already in 'airportInfoMap'; get the
       // existing entry, if any, otherwise insert a new one.
       std::pair<AirportInfoMapType::iterator, bool>
         insertRetval = airportInfoMap.insert(
           AirportInfoMapType::value_type(currentAirportId, RawAirportInfo()));
-      skipAirport = !insertRetval.second;
 
-      if ( skipAirport ) {
+      if ( !insertRetval.second ) {
         SG_LOG( SG_GENERAL, SG_INFO,
                 apt_dat << ":"  << line_num << ": skipping airport " <<
                 currentAirportId << " (already defined earlier)" );
+        currentAirport = 0;
       } else {
         // We haven't seen this airport yet in any apt.dat file
-        RawAirportInfo& airportInfo = insertRetval.first->second;
-        airportInfo.file = aptdb_file;
-        airportInfo.rowCode = rowCode;
-        airportInfo.firstLineNum = line_num;
-        airportInfo.firstLineTokens = std::move(tokens);
+        currentAirport = &insertRetval.first->second;
+        currentAirport->file = aptdb_file;
+        currentAirport->rowCode = rowCode;
+        currentAirport->firstLineNum = line_num;
+        currentAirport->firstLine = Line(line_num, rowCode,
+                                         lineArena.store(line, length),
+                                         length);
       }
     } else if ( rowCode == 99 ) {
       SG_LOG( SG_GENERAL, SG_DEBUG,
               apt_dat << ":"  << line_num << ": code 99 found "
               "(normally at end of file)" );
-    } else if ( !skipAirport ) {
+    } else if ( currentAirport ) {
       // Line belonging to an already started, and not skipped airport entry;
       // just append it.
-      airportInfoMap[currentAirportId].otherLines.emplace_back(
-        line_num, rowCode, line);
+      currentAirport->otherLines.emplace_back(
+        line_num, rowCode, lineArena.store(line, length), length);
     }
   } // of file reading loop
 
@@ -216,9 +339,7 @@ void APTLoader::loadAirports()
     // Full path to the apt.dat file this airport info comes from
     const string aptDat = it->second.file.utf8Str();
     last_apt_id = it->first;    // this is just the current airport identifier
-    // The first line for this airport was already split over whitespace, but
-    // remains to be parsed for the most part.
-    parseAirportLine(it->second.rowCode, it->second.firstLineTokens);
+    parseAirportLine(it->second.rowCode, tokenize(it->second.firstLine));
     const LinesList& lines = it->second.otherLines;
 
     // Loop over the second and subsequent lines
@@ -229,21 +350,21 @@ void APTLoader::loadAirports()
 
       if ( rowCode == 10 ) { // Runway v810
         parseRunwayLine810(aptDat, linesIt->number,
-                           simgear::strutils::split(linesIt->str));
+                           tokenize(*linesIt));
       } else if ( rowCode == 100 ) { // Runway v850
         parseRunwayLine850(aptDat, linesIt->number,
-                           simgear::strutils::split(linesIt->str));
+                           tokenize(*linesIt));
       } else if ( rowCode == 101 ) { // Water Runway v850
         parseWaterRunwayLine850(aptDat, linesIt->number,
-                                simgear::strutils::split(linesIt->str));
+                                tokenize(*linesIt));
       } else if ( rowCode == 102 ) { // Helipad v850
         parseHelipadLine850(aptDat, linesIt->number,
-                            simgear::strutils::split(linesIt->str));
+                            tokenize(*linesIt));
       } else if ( rowCode == 18 ) {
         // beacon entry (ignore)
       } else if ( rowCode == 14 ) {  // Viewpoint/control tower
         parseViewpointLine(aptDat, linesIt->number,
-                           simgear::strutils::split(linesIt->str));
+                           tokenize(*linesIt));
       } else if ( rowCode == 19 ) {
         // windsock entry (ignore)
       } else if ( rowCode == 20 ) {
@@ -256,14 +377,14 @@ void APTLoader::loadAirports()
         // ??
       } else if ( rowCode >= 50 && rowCode <= 56) {
         parseCommLine(aptDat, linesIt->number, rowCode,
-                      simgear::strutils::split(linesIt->str));
+                      tokenize(*linesIt));
       } else if ( rowCode == 110 ) {
         pavement = true;
-        parsePavementLine850(simgear::strutils::split(linesIt->str, 0, 4));
+        parsePavementLine850(tokenize(*linesIt, 4));
       } else if ( rowCode >= 111 && rowCode <= 114 ) {
         if ( pavement )
           parsePavementNodeLine850(aptDat, linesIt->number, rowCode,
-                                   simgear::strutils::split(linesIt->str));
+                                   tokenize(*linesIt));
       } else if ( rowCode >= 115 && rowCode <= 116 ) {
         // other pavement nodes (ignore)
       } else if ( rowCode == 120 ) {
@@ -274,7 +395,7 @@ void APTLoader::loadAirports()
         // airport traffic flow (ignore)
       } else {
         std::ostringstream oss;
-        string cleanedLine = cleanLine(linesIt->str);
+        string cleanedLine = cleanLine(*linesIt);
         oss << aptDat << ":" << linesIt->number << ": unknown row code " <<
           rowCode;
         SG_LOG( SG_GENERAL, SG_ALERT, oss.str() << " (" << cleanedLine << ")" );
@@ -298,17 +419,27 @@ void APTLoader::loadAirports()
 }
 
 // Tell whether an apt.dat line is blank or a comment line
-bool APTLoader::isBlankOrCommentLine(const std::string& line)
+bool APTLoader::isBlankOrCommentLine(const char* line, std::size_t length)
 {
-  size_t pos = line.find_first_not_of(" \t");
-  return ( pos == std::string::npos ||
+  std::size_t pos = 0;
+  while (pos < length && (line[pos] == ' ' || line[pos] == '\t')) {
+    pos++;
+  }
+
+  return ( pos == length ||
            line[pos] == '\r' ||
-           line.find("##", pos) == pos );
+           (pos + 1 < length && line[pos] == '#' && line[pos+1] == '#') );
+}
+
+const vector<string>& APTLoader::tokenize(const Line& line, int maxsplit)
+{
+  splitLine(line.str, line.length, token, maxsplit);
+  return token;
 }
 
-std::string APTLoader::cleanLine(const std::string& line)
+std::string APTLoader::cleanLine(const Line& line)
 {
-  std::string res = line;
+  std::string res(line.str, line.length);
 
   // Lines obtained from readAptDatFile() may end with \r, which can be quite
   // confusing when printed to the terminal.
@@ -25,6 +25,8 @@
 #ifndef _FG_APT_LOADER_HXX
 #define _FG_APT_LOADER_HXX
 
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -61,16 +63,39 @@ public:
 private:
   struct Line
   {
-    Line(unsigned int number_, unsigned int rowCode_, std::string str_)
-      : number(number_), rowCode(rowCode_), str(str_) { }
+    Line() : number(0), rowCode(0), str(0), length(0) { }
+    Line(unsigned int number_, unsigned int rowCode_, const char* str_,
+         unsigned int length_)
+      : number(number_), rowCode(rowCode_), str(str_), length(length_) { }
 
     unsigned int number;
     unsigned int rowCode;         // Terminology of the apt.dat spec
-    std::string str;
+    // Null-terminated line text, owned by the LineArena
+    const char* str;
+    unsigned int length;
   };
 
   typedef std::vector<Line> LinesList;
 
+  // Storage for the text of all lines kept in 'airportInfoMap'. Lines are
+  // copied one after the other into large blocks, instead of needing a heap
+  // allocation each.
+  class LineArena
+  {
+  public:
+    LineArena() : _used(0), _blockSize(0) { }
+
+    // Copy 'length' chars from 'str' and a terminating null char
+    const char* store(const char* str, std::size_t length);
+
+  private:
+    static const std::size_t BLOCK_SIZE = 1 << 20;
+
+    std::vector<std::unique_ptr<char[]> > _blocks;
+    std::size_t _used;          // in the last block
+    std::size_t _blockSize;     // of the last block
+  };
+
   struct RawAirportInfo
   {
     // apt.dat file where the airport was defined
@@ -79,9 +104,8 @@ private:
     unsigned int rowCode;
     // Line number in the apt.dat file where the airport definition starts
     unsigned int firstLineNum;
-    // The whitespace-separated strings comprising the first line of the airport
-    // definition
-    std::vector<std::string> firstLineTokens;
+    // First line of the airport definition
+    Line firstLine;
     // Subsequent lines of the airport definition (one element per line)
     LinesList otherLines;
   };
@@ -93,9 +117,13 @@ private:
   APTLoader& operator=(const APTLoader&); // disable copy-assignment operator
 
   // Tell whether an apt.dat line is blank or a comment line
-  bool isBlankOrCommentLine(const std::string& line);
+  bool isBlankOrCommentLine(const char* line, std::size_t length);
+  // Split 'line' over whitespace into 'token', which is returned. See
+  // simgear::strutils::split() for 'maxsplit'.
+  const std::vector<std::string>& tokenize(const Line& line,
+                                           int maxsplit = 0);
   // Return a copy of 'line' with trailing '\r' char(s) removed
-  std::string cleanLine(const std::string& line);
+  std::string cleanLine(const Line& line);
   void throwExceptionIfStreamError(const sg_gzifstream& input_stream,
                                    const SGPath& path);
   void parseAirportLine(unsigned int rowCode,
@@ -119,8 +147,10 @@ private:
     const std::string& aptDat, unsigned int lineNum, unsigned int rowCode,
     const std::vector<std::string>& token);
 
+  // Reused for each line, to avoid reallocating the tokens
   std::vector<std::string> token;
   AirportInfoMapType airportInfoMap;
+  LineArena lineArena;
   double rwy_lat_accum;
   double rwy_lon_accum;
   double last_rwy_heading;
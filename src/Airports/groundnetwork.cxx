@@ -30,6 +30,7 @@
 #include <algorithm>
 #include <fstream>
 #include <map>
+#include <queue>
 #include <boost/foreach.hpp>
 
 #include <simgear/debug/logstream.hxx>
@@ -159,7 +160,8 @@ bool FGTaxiRoute::next(FGTaxiNodeRef& node, int *rte)
  **************************************************************************/
 
 FGGroundNetwork::FGGroundNetwork(FGAirport* airport) :
-    parent(airport)
+    parent(airport),
+    m_routingGraphValid(false)
 {
     hasNetwork = false;
     version = 0;
@@ -325,85 +327,147 @@ static int edgePenalty(FGTaxiNode* tn)
     (tn->getIsOnRunway() ? 1000 : 0);
 }
 
-class ShortestPathData
+// number of recently found routes to keep
+static const size_t ROUTE_CACHE_SIZE = 64;
+
+void FGGroundNetwork::invalidateRoutingGraph()
 {
-public:
-  ShortestPathData() :
-    score(HUGE_VAL)
-  {}
-  
-  double score;
-  FGTaxiNodeRef previousNode;
-};
+    m_routingGraphValid = false;
+    m_routeCache.clear();
+    m_routeCacheOrder.clear();
+}
+
+void FGGroundNetwork::buildRoutingGraph()
+{
+    const int nodeCount = m_nodes.size();
+    m_routingNodeIndex.clear();
+    m_routingNodeCart.resize(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) {
+        m_routingNodeIndex[m_nodes[i].ptr()] = i;
+        m_routingNodeCart[i] = m_nodes[i]->cart();
+    }
+
+    // count the edges of every node, then place them
+    m_routingEdgeStart.assign(nodeCount + 1, 0);
+    BOOST_FOREACH(FGTaxiSegment* seg, segments) {
+        m_routingEdgeStart[m_routingNodeIndex[seg->startNode] + 1]++;
+    }
+    for (int i = 0; i < nodeCount; ++i) {
+        m_routingEdgeStart[i + 1] += m_routingEdgeStart[i];
+    }
+
+    m_routingEdges.resize(segments.size());
+    std::vector<int> fill(m_routingEdgeStart.begin(), m_routingEdgeStart.end() - 1);
+    BOOST_FOREACH(FGTaxiSegment* seg, segments) {
+        FGTaxiNode* target = seg->getEnd();
+        RoutingEdge& edge = m_routingEdges[fill[m_routingNodeIndex[seg->startNode]]++];
+        edge.target = m_routingNodeIndex[target];
+        edge.cost = dist(seg->getStart()->cart(), target->cart()) + edgePenalty(target);
+        edge.segment = seg;
+    }
+
+    m_routingGraphValid = true;
+}
 
 FGTaxiRoute FGGroundNetwork::findShortestRoute(FGTaxiNode* start, FGTaxiNode* end, bool fullSearch)
 {
     if (!start || !end) {
         throw sg_exception("Bad arguments to findShortestRoute");
     }
-//implements Dijkstra's algorithm to find shortest distance route from start to end
-//taken from http://en.wikipedia.org/wiki/Dijkstra's_algorithm
-    FGTaxiNodeVector unvisited(m_nodes);
-    std::map<FGTaxiNode*, ShortestPathData> searchData;
-
-    searchData[start].score = 0.0;
-
-    while (!unvisited.empty()) {
-        // find lowest scored unvisited
-        FGTaxiNodeRef best = unvisited.front();
-        BOOST_FOREACH(FGTaxiNodeRef i, unvisited) {
-            if (searchData[i].score < searchData[best].score) {
-                best = i;
+
+    RouteKey key(start, end);
+    std::map<RouteKey, FGTaxiRoute>::const_iterator cached = m_routeCache.find(key);
+    if (cached != m_routeCache.end()) {
+        return cached->second;
+    }
+
+    if (!m_routingGraphValid) {
+        buildRoutingGraph();
+    }
+
+    // A* over the node indices. The straight line distance never exceeds
+    // the cost of a path, so the first time the end is taken from the
+    // heap, its route is the shortest.
+    std::unordered_map<const FGTaxiNode*, int>::const_iterator it;
+    int startIndex = -1, endIndex = -1;
+    if ((it = m_routingNodeIndex.find(start)) != m_routingNodeIndex.end())
+        startIndex = it->second;
+    if ((it = m_routingNodeIndex.find(end)) != m_routingNodeIndex.end())
+        endIndex = it->second;
+
+    const size_t nodeCount = m_routingNodeCart.size();
+    std::vector<double> score(nodeCount, HUGE_VAL);
+    std::vector<int> previousEdge(nodeCount, -1);
+    std::vector<bool> closed(nodeCount, false);
+
+    typedef std::pair<double, int> HeapEntry;    // estimated total, node
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>,
+                        std::greater<HeapEntry> > open;
+
+    if ((startIndex >= 0) && (endIndex >= 0)) {
+        const SGVec3d& endCart = m_routingNodeCart[endIndex];
+        score[startIndex] = 0.0;
+        open.push(HeapEntry(dist(m_routingNodeCart[startIndex], endCart), startIndex));
+
+        while (!open.empty()) {
+            int best = open.top().second;
+            open.pop();
+            if (closed[best]) {
+                continue; // stale entry
             }
-        }
-      
-      // remove 'best' from the unvisited set
-        FGTaxiNodeVectorIterator newend =
-            remove(unvisited.begin(), unvisited.end(), best);
-        unvisited.erase(newend, unvisited.end());
+            closed[best] = true;
 
-        if (best == end) { // found route or best not connected
-            break;
-        }
-      
-        BOOST_FOREACH(FGTaxiNodeRef target, segmentsFrom(best)) {
-            double edgeLength = dist(best->cart(), target->cart());
-            double alt = searchData[best].score + edgeLength + edgePenalty(target);
-            if (alt < searchData[target].score) {    // Relax (u,v)
-                searchData[target].score = alt;
-                searchData[target].previousNode = best;
+            if (best == endIndex) {
+                break;
             }
-        } // of outgoing arcs/segments from current best node iteration
-    } // of unvisited nodes remaining
 
-    if (searchData[end].score == HUGE_VAL) {
+            for (int e = m_routingEdgeStart[best]; e < m_routingEdgeStart[best + 1]; ++e) {
+                const RoutingEdge& edge = m_routingEdges[e];
+                double alt = score[best] + edge.cost;
+                if (alt < score[edge.target]) {    // Relax (u,v)
+                    score[edge.target] = alt;
+                    previousEdge[edge.target] = e;
+                    open.push(HeapEntry(alt + dist(m_routingNodeCart[edge.target], endCart),
+                                        edge.target));
+                }
+            } // of outgoing arcs/segments from current best node iteration
+        } // of open nodes remaining
+    }
+
+    if ((endIndex < 0) || (score[endIndex] == HUGE_VAL)) {
         // no valid route found
         if (fullSearch) {
             SG_LOG(SG_GENERAL, SG_ALERT,
                    "Failed to find route from waypoint " << start << " to "
                    << end << " at " << parent->getId());
         }
-      
+
         return FGTaxiRoute();
     }
-  
+
     // assemble route from backtrace information
     FGTaxiNodeVector nodes;
     intVec routes;
-    FGTaxiNode *bt = end;
-    
-    while (searchData[bt].previousNode != 0) {
-        nodes.push_back(bt);
-        FGTaxiSegment *segment = findSegment(searchData[bt].previousNode, bt);
-        int idx = segment->getIndex();
-        routes.push_back(idx);
-        bt = searchData[bt].previousNode;
-        
+    int bt = endIndex;
+
+    while (previousEdge[bt] >= 0) {
+        const RoutingEdge& edge = m_routingEdges[previousEdge[bt]];
+        nodes.push_back(m_nodes[bt]);
+        routes.push_back(edge.segment->getIndex());
+        bt = m_routingNodeIndex[edge.segment->startNode];
     }
     nodes.push_back(start);
     reverse(nodes.begin(), nodes.end());
     reverse(routes.begin(), routes.end());
-    return FGTaxiRoute(nodes, routes, searchData[end].score, 0);
+
+    FGTaxiRoute route(nodes, routes, score[endIndex], 0);
+    if (m_routeCacheOrder.size() >= ROUTE_CACHE_SIZE) {
+        m_routeCache.erase(m_routeCacheOrder.front());
+        m_routeCacheOrder.pop_front();
+    }
+    m_routeCache.insert(std::make_pair(key, route));
+    m_routeCacheOrder.push_back(key);
+    return route;
 }
 
 void FGGroundNetwork::unblockAllSegments(time_t now)
@@ -455,6 +519,7 @@ void FGGroundNetwork::addSegment(const FGTaxiNodeRef &from, const FGTaxiNodeRef
 {
     FGTaxiSegment* seg = new FGTaxiSegment(from, to);
     segments.push_back(seg);
+    invalidateRoutingGraph();
 
     FGTaxiNodeVector::iterator it = std::find(m_nodes.begin(), m_nodes.end(), from);
     if (it == m_nodes.end()) {
@@ -470,6 +535,7 @@ void FGGroundNetwork::addSegment(const FGTaxiNodeRef &from, const FGTaxiNodeRef
 void FGGroundNetwork::addParking(const FGParkingRef &park)
 {
     m_parkings.push_back(park);
+    invalidateRoutingGraph();
 
 
     FGTaxiNodeVector::iterator it = std::find(m_nodes.begin(), m_nodes.end(), park);
@@ -478,19 +544,6 @@ void FGGroundNetwork::addParking(const FGParkingRef &park)
     }
 }
 
-FGTaxiNodeVector FGGroundNetwork::segmentsFrom(const FGTaxiNodeRef &from) const
-{
-    FGTaxiNodeVector result;
-    FGTaxiSegmentVector::const_iterator it;
-    for (it = segments.begin(); it != segments.end(); ++it) {
-        if ((*it)->getStart() == from) {
-            result.push_back((*it)->getEnd());
-        }
-    }
-
-    return result;
-}
-
 const intVec& FGGroundNetwork::getTowerFrequencies() const
 {
     return freqTower;
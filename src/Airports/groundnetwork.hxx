@@ -27,6 +27,9 @@
 #include <simgear/compiler.h>
 
 #include <string>
+#include <deque>
+#include <map>
+#include <unordered_map>
 
 #include "gnnode.hxx"
 #include "parking.hxx"
@@ -204,7 +207,33 @@ private:
     void addSegment(const FGTaxiNodeRef& from, const FGTaxiNodeRef& to);
     void addParking(const FGParkingRef& park);
 
-    FGTaxiNodeVector segmentsFrom(const FGTaxiNodeRef& from) const;
+    /**
+     * Compact adjacency of the nodes for routing: the edges leaving node
+     * i are m_routingEdges[m_routingEdgeStart[i] .. m_routingEdgeStart[i+1]).
+     * Built when the first route is requested, dropped when the network
+     * changes.
+     */
+    struct RoutingEdge
+    {
+        int target;
+        double cost;    // length plus penalty for entering the target
+        FGTaxiSegment* segment;
+    };
+
+    bool m_routingGraphValid;
+    std::vector<int> m_routingEdgeStart;
+    std::vector<RoutingEdge> m_routingEdges;
+    std::vector<SGVec3d> m_routingNodeCart;
+    std::unordered_map<const FGTaxiNode*, int> m_routingNodeIndex;
+
+    void buildRoutingGraph();
+    void invalidateRoutingGraph();
+
+    // recently found routes, by start and end node. Routes don't depend
+    // on blocked segments, so these stay valid until the network changes.
+    typedef std::pair<const FGTaxiNode*, const FGTaxiNode*> RouteKey;
+    std::map<RouteKey, FGTaxiRoute> m_routeCache;
+    std::deque<RouteKey> m_routeCacheOrder;
 
     void addAwosFreq     (int val) {
         freqAwos.push_back(val);
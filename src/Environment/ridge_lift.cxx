@@ -146,7 +146,7 @@ void FGRidgeLift::update(double dt) {
 			SGGeod probeGeod = SGGeod::fromGeoc( probe );
 			probe_lat_deg[i] = probeGeod.getLatitudeDeg();
 			probe_lon_deg[i] = probeGeod.getLongitudeDeg();
-			if (!globals->get_scenery()->get_elevation_m( probeGeod, probe_elev_m[i], NULL )) {
+			if (!globals->get_scenery()->get_approx_elevation_m( probeGeod, probe_elev_m[i] )) {
 				// no ground found? use elevation of previous probe :-(
 				probe_elev_m[i] = probe_elev_m[i-1];
 			}
@@ -86,7 +86,7 @@ FMAX (double a, double b)
 
 class FGFSGroundCallback : public FGGroundCallback {
 public:
-  FGFSGroundCallback(FGJSBsim* ifc) : mInterface(ifc) {}
+  FGFSGroundCallback(FGJSBsim* ifc) : mInterface(ifc), mBatchTime(-1) {}
   virtual ~FGFSGroundCallback() {}
 
   /** Get the altitude above sea level dependent on the location. */
@@ -99,13 +99,43 @@ public:
     return alt * SG_METER_TO_FEET;
   }
 
+  /** Query the ground below all the gear locations in one batch. */
+  virtual void PrepareAGLevels(double t,
+                               const std::vector<FGLocation>& locations) {
+    unsigned count = locations.size();
+    mBatchTime = t;
+    mBatchLocations = locations;
+    mBatchResults.resize(count);
+    std::vector<double> pts(3*count);
+    for (unsigned i = 0; i < count; ++i) {
+      pts[3*i] = locations[i](1);
+      pts[3*i+1] = locations[i](2);
+      pts[3*i+2] = locations[i](3);
+    }
+    mInterface->get_agl_multi_ft(t, count, (const double (*)[3])pts.data(),
+                                 SG_METER_TO_FEET*2, mBatchResults.data());
+  }
+
   /** Compute the altitude above ground. */
   virtual double GetAGLevel(double t, const FGLocation& l,
                             FGLocation& cont, FGColumnVector3& n,
                             FGColumnVector3& v, FGColumnVector3& w) const {
     double contact[3], normal[3], vel[3], angularVel[3];
-    double agl = mInterface->get_agl_ft(t, l, SG_METER_TO_FEET*2, contact,
-                                        normal, vel, angularVel);
+    double agl;
+    const FGGroundCache::AglResult* result = findBatchResult(t, l);
+    if (result) {
+      for (int k=0; k<3; ++k) {
+        contact[k] = result->contact[k];
+        normal[k] = result->normal[k];
+        vel[k] = result->linearVel[k];
+        angularVel[k] = result->angularVel[k];
+      }
+      double pt[3] = { l(1), l(2), l(3) };
+      agl = mInterface->update_ground_contact(pt, contact, result->material);
+    } else {
+      agl = mInterface->get_agl_ft(t, l, SG_METER_TO_FEET*2, contact,
+                                   normal, vel, angularVel);
+    }
     n = FGColumnVector3( normal[0], normal[1], normal[2] );
     v = FGColumnVector3( vel[0], vel[1], vel[2] );
     w = FGColumnVector3( angularVel[0], angularVel[1], angularVel[2] );
@@ -132,7 +162,23 @@ public:
   virtual void SetTerrainGeoCentRadius(double radius) {}
   virtual void SetSeaLevelRadius(double radius) {}
 private:
+  // Returns the batch result prepared for exactly that time and location
+  const FGGroundCache::AglResult*
+  findBatchResult(double t, const FGLocation& l) const {
+    if (t != mBatchTime)
+      return 0;
+    for (unsigned i = 0; i < mBatchLocations.size(); ++i) {
+      if (mBatchLocations[i] == l)
+        return &mBatchResults[i];
+    }
+    return 0;
+  }
+
   FGJSBsim* mInterface;
+
+  double mBatchTime;
+  std::vector<FGLocation> mBatchLocations;
+  std::vector<FGGroundCache::AglResult> mBatchResults;
 };
 
 // FG uses a squared normalized magnitude for turbulence
@@ -1360,6 +1406,13 @@ FGJSBsim::get_agl_ft(double t, const FGColumnVector3& loc, double alt_off,
   FGInterface::get_agl_ft(t, pt, alt_off, contact, normal, vel,
                           angularVel, material, id);
 
+  return update_ground_contact(pt, contact, material);
+}
+
+double
+FGJSBsim::update_ground_contact(const double pt[3], const double contact[3],
+                                const simgear::BVHMaterial* material)
+{
   SGGeod geodPt = SGGeod::fromCart(SG_FEET_TO_METER*SGVec3d(pt));
   SGQuatd hlToEc = SGQuatd::fromLonLat(geodPt);
 
@@ -221,6 +221,11 @@ public:
     double get_agl_ft(double t, const JSBSim::FGColumnVector3& loc,
                       double alt_off, double contact[3], double normal[3],
                       double vel[3], double angularVel[3]);
+
+    // Apply the ground material found at contact below pt to the ground
+    // reactions and return the altitude of pt above that contact in ft.
+    double update_ground_contact(const double pt[3], const double contact[3],
+                                 const simgear::BVHMaterial* material);
 private:
     JSBSim::FGFDMExec *fdmex;
     JSBSim::FGInitialCondition *fgic;
@@ -38,6 +38,8 @@ SENTRY
 INCLUDES
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 
+#include <vector>
+
 #include "simgear/structure/SGReferenced.hxx"
 #include "simgear/structure/SGSharedPtr.hxx"
 
@@ -110,6 +112,20 @@ public:
                             FGColumnVector3& w) const
   { return GetAGLevel(time, location, contact, normal, v, w); }
 
+  /** Prepare the altitude above ground queries for a set of locations.
+      An implementation may compute the answers for all the locations at
+      once and serve the following GetAGLevel() calls for exactly these
+      locations from that batch. The default implementation does nothing.
+      @param t simulation time
+      @param locations the locations that are queried next */
+  virtual void PrepareAGLevels(double t,
+                               const std::vector<FGLocation>& locations) { }
+
+  /** Prepare the altitude above ground queries for a set of locations.
+      @param locations the locations that are queried next */
+  void PrepareAGLevels(const std::vector<FGLocation>& locations)
+  { PrepareAGLevels(time, locations); }
+
   /** Compute the local terrain radius
       @param t simulation time
       @param location location
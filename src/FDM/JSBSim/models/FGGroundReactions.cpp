@@ -109,6 +109,16 @@ bool FGGroundReactions::Run(bool Holding)
 
   multipliers.clear();
 
+  // Hand all the gear contact queries of this step to the ground callback
+  // at once, so it has the chance to compute them in a single batch.
+  gearLocations.clear();
+  for (unsigned int i=0; i<lGear.size(); i++) {
+    if (lGear[i]->GetGearUnitDown())
+      gearLocations.push_back(lGear[i]->GetLocation());
+  }
+  if (!gearLocations.empty())
+    FGLocation::GetGroundCallback()->PrepareAGLevels(gearLocations);
+
   // Sum forces and moments for all gear, here.
   // Some optimizations may be made here - or rather in the gear code itself.
   // The gear ::Run() method is called several times - once for each gear.
@@ -127,6 +127,7 @@ private:
   FGColumnVector3 vForces;
   FGColumnVector3 vMoments;
   std::vector <LagrangeMultiplier*> multipliers;
+  std::vector <FGLocation> gearLocations;
   double DsCmd;
 
   void bind(void);
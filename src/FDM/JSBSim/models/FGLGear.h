@@ -250,6 +250,12 @@ public:
     return vWhlBodyVec(idx);
   }
 
+  /** Gets the location of the uncompressed gear in the earth frame. This
+      is the location GetBodyForces() queries the ground for. */
+  FGLocation GetLocation(void) const {
+    return in.Location.LocalToLocation(in.Tb2l * GetBodyLocation());
+  }
+
   const FGColumnVector3& GetLocalGear(void) const { return vLocalGear; }
   double GetLocalGear(int idx) const { return vLocalGear(idx); }
 
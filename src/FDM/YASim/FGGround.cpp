@@ -2,6 +2,8 @@
   #include <config.h>
 #endif
 
+#include <vector>
+
 #include <simgear/scene/material/mat.hxx>
 
 #include <FDM/flight.hxx>
@@ -51,6 +53,25 @@ void FGGround::getGroundPlane(const double pos[3],
     for(int i=0; i<3; i++) vel[i] = dvel[i];
 }
 
+void FGGround::getGroundPlanes(int count, const double pos[][3],
+                               double plane[][4], float vel[][3],
+                               const simgear::BVHMaterial **material)
+{
+    // One walk through the ground cache for all the points
+    if((int)_results.size() < count)
+        _results.resize(count);
+    _iface->get_agl_multi_m(_toff, count, pos, 2, _results.data());
+
+    for(int i=0; i<count; i++) {
+        const FGGroundCache::AglResult& r = _results[i];
+        for(int j=0; j<3; j++) plane[i][j] = r.normal[j];
+        // The plane below the actual contact point.
+        plane[i][3] = dot(r.normal, r.contact);
+        for(int j=0; j<3; j++) vel[i][j] = r.linearVel[j];
+        material[i] = r.material;
+    }
+}
+
 bool FGGround::caughtWire(const double pos[4][3])
 {
     return _iface->caught_wire_m(_toff, pos);
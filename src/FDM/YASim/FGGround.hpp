@@ -1,6 +1,10 @@
 #ifndef _FGGROUND_HPP
 #define _FGGROUND_HPP
 
+#include <vector>
+
+#include <FDM/groundcache.hxx>
+
 #include "Ground.hpp"
 
 class FGInterface;
@@ -25,6 +29,10 @@ public:
                                 double plane[4], float vel[3],
                                 const simgear::BVHMaterial **material);
 
+    virtual void getGroundPlanes(int count, const double pos[][3],
+                                 double plane[][4], float vel[][3],
+                                 const simgear::BVHMaterial **material);
+
     virtual bool caughtWire(const double pos[4][3]);
 
     virtual bool getWire(double end[2][3], float vel[2][3]);
@@ -39,6 +47,8 @@ public:
 private:
     FGInterface *_iface;
     double _toff;
+    // Reused by getGroundPlanes, so a frame does not allocate.
+    std::vector<FGGroundCache::AglResult> _results;
 };
 
 }; // namespace yasim
@@ -40,6 +40,14 @@ void Ground::getGroundPlane(const double pos[3],
     getGroundPlane(pos,plane,vel);
 }
 
+void Ground::getGroundPlanes(int count, const double pos[][3],
+                             double plane[][4], float vel[][3],
+                             const simgear::BVHMaterial **material)
+{
+    for(int i=0; i<count; i++)
+        getGroundPlane(pos[i], plane[i], vel[i], &material[i]);
+}
+
 bool Ground::caughtWire(const double pos[4][3])
 {
     return false;
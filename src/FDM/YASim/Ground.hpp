@@ -18,6 +18,12 @@ public:
                                 double plane[4], float vel[3],
                                 const simgear::BVHMaterial **material);
 
+    // Ground planes for count points at once. The default just asks
+    // getGroundPlane for each of them.
+    virtual void getGroundPlanes(int count, const double pos[][3],
+                                 double plane[][4], float vel[][3],
+                                 const simgear::BVHMaterial **material);
+
     virtual bool caughtWire(const double pos[4][3]);
 
     virtual bool getWire(double end[2][3], float vel[2][3]);
@@ -72,6 +72,7 @@ Model::~Model()
 {
     // FIXME: who owns these things?  Need a policy
     delete _ground_cb;
+    sizeGearBuffers(0);
     delete _hook;
     delete _launchbar;
     for(int i=0; i<_hitches.size();i++)
@@ -185,6 +186,25 @@ void Model::setGroundEffect(const float* pos, float span, float mul)
     _groundEffect = mul;
 }
 
+void Model::sizeGearBuffers(int ngear)
+{
+    delete[] _gearPt;
+    delete[] _gearGround;
+    delete[] _gearVel;
+    delete[] _gearMaterial;
+    _gearPt = nullptr;
+    _gearGround = nullptr;
+    _gearVel = nullptr;
+    _gearMaterial = nullptr;
+    _gearBufSize = ngear;
+    if(ngear <= 0)
+        return;
+    _gearPt = new double[ngear][3];
+    _gearGround = new double[ngear][4];
+    _gearVel = new float[ngear][3];
+    _gearMaterial = new const simgear::BVHMaterial*[ngear];
+}
+
 void Model::updateGround(State* s)
 {
     float dummy[3];
@@ -192,7 +212,10 @@ void Model::updateGround(State* s)
 
     int i;
     // The landing gear
-    for(i=0; i<_gears.size(); i++) {
+    int ngear = _gears.size();
+    if(ngear != _gearBufSize)
+        sizeGearBuffers(ngear);
+    for(i=0; i<ngear; i++) {
 	Gear* g = (Gear*)_gears.get(i);
 
 	// Get the point of ground contact
@@ -204,15 +227,18 @@ void Model::updateGround(State* s)
 	Math::add3(cmpr, pos, pos);
         // Transform the local coordinates of the contact point to
         // global coordinates.
-        double pt[3];
-        s->posLocalToGlobal(pos, pt);
+        s->posLocalToGlobal(pos, _gearPt[i]);
+    }
 
-        // Ask for the ground plane in the global coordinate system
-        double global_ground[4];
-        float global_vel[3];
-        const simgear::BVHMaterial* material;
-        _ground_cb->getGroundPlane(pt, global_ground, global_vel, &material);
-        g->setGlobalGround(global_ground, global_vel, pt[0], pt[1], material);
+    // Ask for all the ground planes in the global coordinate system
+    // at once, so the ground cache is walked only once for all gears.
+    if(ngear > 0)
+        _ground_cb->getGroundPlanes(ngear, _gearPt, _gearGround, _gearVel,
+                                    _gearMaterial);
+    for(i=0; i<ngear; i++) {
+	Gear* g = (Gear*)_gears.get(i);
+        g->setGlobalGround(_gearGround[i], _gearVel[i],
+                           _gearPt[i][0], _gearPt[i][1], _gearMaterial[i]);
     }
 
     for(i=0; i<_hitches.size(); i++) {
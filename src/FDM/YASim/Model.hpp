@@ -10,6 +10,10 @@
 #include "Atmosphere.hpp"
 #include <simgear/props/props.hxx>
 
+namespace simgear {
+class BVHMaterial;
+}
+
 namespace yasim {
 
 // Declare the types whose pointers get passed around here
@@ -83,6 +87,7 @@ private:
     void calcGearForce(Gear* g, float* v, float* rot, float* ground);
     float gearFriction(float wgt, float v, Gear* g);
     void localWind(const float* pos, const yasim::State* s, float* out, float alt, bool is_rotor = false);
+    void sizeGearBuffers(int ngear);
 
     Integrator _integrator;
     RigidBody _body;
@@ -103,6 +108,14 @@ private:
 
     Ground* _ground_cb;
     double _global_ground[4] {0,0,1, -1e5};
+
+    // Scratch space for the batched gear ground queries, sized once
+    // for the number of gears.
+    int _gearBufSize {0};
+    double (*_gearPt)[3] {nullptr};
+    double (*_gearGround)[4] {nullptr};
+    float (*_gearVel)[3] {nullptr};
+    const simgear::BVHMaterial** _gearMaterial {nullptr};
     Atmosphere _atmo;
     float _wind[3] {0,0,0};
     
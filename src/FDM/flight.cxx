@@ -26,6 +26,8 @@
 
 #include "flight.hxx"
 
+#include <vector>
+
 #include <simgear/constants.h>
 #include <simgear/debug/logstream.hxx>
 #include <simgear/timing/timestamp.hxx>
@@ -418,6 +420,33 @@ FGInterface::bind ()
 
   _tiedProperties.Tie("/accelerations/n-z-cg-fps_sec",
                       this, &FGInterface::get_N_Z_cg); // read-only
+
+  // Ground cache mode and build statistics
+  _tiedProperties.Tie("/fdm/ground-cache/incremental", &ground_cache,
+                      &FGGroundCache::get_incremental,
+                      &FGGroundCache::set_incremental);
+  _tiedProperties.Tie("/fdm/ground-cache/prediction-time-sec", &ground_cache,
+                      &FGGroundCache::get_prediction_time,
+                      &FGGroundCache::set_prediction_time);
+  _tiedProperties.Tie("/fdm/ground-cache/async", &ground_cache,
+                      &FGGroundCache::get_async,
+                      &FGGroundCache::set_async);
+  _tiedProperties.Tie("/fdm/ground-cache/build-count", &ground_cache,
+                      &FGGroundCache::get_build_count); // read-only
+  _tiedProperties.Tie("/fdm/ground-cache/reuse-count", &ground_cache,
+                      &FGGroundCache::get_reuse_count); // read-only
+  _tiedProperties.Tie("/fdm/ground-cache/build-time-sec", &ground_cache,
+                      &FGGroundCache::get_build_time_sec); // read-only
+  _tiedProperties.Tie("/fdm/ground-cache/last-build-time-sec", &ground_cache,
+                      &FGGroundCache::get_last_build_time_sec); // read-only
+  _tiedProperties.Tie("/fdm/ground-cache/max-build-time-sec", &ground_cache,
+                      &FGGroundCache::get_max_build_time_sec); // read-only
+  _tiedProperties.Tie("/fdm/ground-cache/prefetch-count", &ground_cache,
+                      &FGGroundCache::get_prefetch_count); // read-only
+  _tiedProperties.Tie("/fdm/ground-cache/prefetch-swap-count", &ground_cache,
+                      &FGGroundCache::get_prefetch_swap_count); // read-only
+  _tiedProperties.Tie("/fdm/ground-cache/miss-count", &ground_cache,
+                      &FGGroundCache::get_miss_count); // read-only
 }
 
 
@@ -646,12 +675,20 @@ void FGInterface::_busdump(void)
     SG_LOG(SG_FLIGHT,SG_INFO,"altitude_agl: " << _state.altitude_agl );
 }
 
+SGVec3d
+FGInterface::_groundCacheVelocityM() const
+{
+  SGQuatd hlToEc = SGQuatd::fromLonLat(_state.geodetic_position_v);
+  return SG_FEET_TO_METER*hlToEc.rotate(_state.v_local_v);
+}
+
 bool
 FGInterface::prepare_ground_cache_m(double startSimTime, double endSimTime,
                                     const double pt[3], double rad)
 {
   return ground_cache.prepare_ground_cache(startSimTime, endSimTime,
-                                           SGVec3d(pt), rad);
+                                           SGVec3d(pt), rad,
+                                           _groundCacheVelocityM());
 }
 
 bool
@@ -661,7 +698,8 @@ FGInterface::prepare_ground_cache_ft(double startSimTime, double endSimTime,
   // Convert units and do the real work.
   SGVec3d pt_ft = SG_FEET_TO_METER*SGVec3d(pt);
   return ground_cache.prepare_ground_cache(startSimTime, endSimTime,
-                                           pt_ft, rad*SG_FEET_TO_METER);
+                                           pt_ft, rad*SG_FEET_TO_METER,
+                                           _groundCacheVelocityM());
 }
 
 bool
@@ -778,6 +816,49 @@ FGInterface::get_agl_ft(double t, const double pt[3], double max_altoff,
   return ret;
 }
 
+unsigned
+FGInterface::get_agl_multi_m(double t, unsigned count, const double pt[][3],
+                             double max_altoff,
+                             FGGroundCache::AglResult results[])
+{
+  std::vector<SGVec3d> pt_m(count);
+  for (unsigned i = 0; i < count; ++i)
+    pt_m[i] = SGVec3d(pt[i]) - max_altoff*ground_cache.get_down();
+
+  unsigned ret = ground_cache.get_agl_multi(t, count, pt_m.data(), results);
+  for (unsigned i = 0; i < count; ++i) {
+    // correct the linear velocity to the contact point, see get_agl_m
+    FGGroundCache::AglResult& result = results[i];
+    result.linearVel += cross(result.angularVel, result.contact - pt_m[i]);
+  }
+  return ret;
+}
+
+unsigned
+FGInterface::get_agl_multi_ft(double t, unsigned count, const double pt[][3],
+                              double max_altoff,
+                              FGGroundCache::AglResult results[])
+{
+  // Convert units and do the real work.
+  std::vector<SGVec3d> pt_m(count);
+  for (unsigned i = 0; i < count; ++i) {
+    pt_m[i] = SGVec3d(pt[i]) - max_altoff*ground_cache.get_down();
+    pt_m[i] *= SG_FEET_TO_METER;
+  }
+
+  unsigned ret = ground_cache.get_agl_multi(t, count, pt_m.data(), results);
+  for (unsigned i = 0; i < count; ++i) {
+    // correct the linear velocity to the contact point, see get_agl_m
+    FGGroundCache::AglResult& result = results[i];
+    result.linearVel += cross(result.angularVel, result.contact - pt_m[i]);
+
+    // Convert units back ...
+    result.contact *= SG_METER_TO_FEET;
+    result.linearVel *= SG_METER_TO_FEET;
+  }
+  return ret;
+}
+
 bool
 FGInterface::get_nearest_m(double t, const double pt[3], double maxDist,
                            double contact[3], double normal[3],
@@ -832,18 +913,19 @@ FGInterface::get_groundlevel_m(const SGGeod& geod)
   // FIXME: how to handle t - ref_time differences ???
   SGVec3d cpos;
   double ref_time = 0, radius;
-  // Prepare the ground cache for that position.
+  // Prepare the ground cache for that position. This is a probe and
+  // not where the vehicle is going, so no velocity is given.
   if (!is_valid_m(&ref_time, cpos.data(), &radius)) {
     double startTime = ref_time;
     double endTime = startTime + 1;
-    bool ok = prepare_ground_cache_m(startTime, endTime, pos.data(), 10);
+    bool ok = ground_cache.prepare_ground_cache(startTime, endTime, pos, 10);
     /// This is most likely the case when the given altitude is
     /// too low, try with a new altitude of 10000m, that should be
     /// sufficient to find a ground level below everywhere on our planet
     if (!ok) {
       pos = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, 10000));
       /// If there is still no ground, return sea level radius
-      if (!prepare_ground_cache_m(startTime, endTime, pos.data(), 10))
+      if (!ground_cache.prepare_ground_cache(startTime, endTime, pos, 10))
         return 0;
     }
   } else if (radius*radius <= distSqr(pos, cpos)) {
@@ -854,14 +936,14 @@ FGInterface::get_groundlevel_m(const SGGeod& geod)
     if (!(10 < radius)) // Well this strange compare is nan safe
       radius = 10;
 
-    bool ok = prepare_ground_cache_m(startTime, endTime, pos.data(), radius);
+    bool ok = ground_cache.prepare_ground_cache(startTime, endTime, pos, radius);
     /// This is most likely the case when the given altitude is
     /// too low, try with a new altitude of 10000m, that should be
     /// sufficient to find a ground level below everywhere on our planet
     if (!ok) {
       pos = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, 10000));
       /// If there is still no ground, return sea level radius
-      if (!prepare_ground_cache_m(startTime, endTime, pos.data(), radius))
+      if (!ground_cache.prepare_ground_cache(startTime, endTime, pos, radius))
         return 0;
     }
   }
@@ -234,6 +234,9 @@ protected:
 
     void _busdump(void);
     void _updatePositionM(const SGVec3d& cartPos);
+    // The vehicle velocity in the earth centered frame in meters per
+    // second, for the ground cache volume prediction.
+    SGVec3d _groundCacheVelocityM() const;
     void _updatePositionFt(const SGVec3d& cartPos) {
         _updatePositionM(SG_FEET_TO_METER*cartPos);
     }
@@ -720,6 +723,18 @@ public:
                     double contact[3], double normal[3], double linearVel[3],
                     double angularVel[3], simgear::BVHMaterial const*& material,
                     simgear::BVHNode::Id& id);
+
+    // Batched version of get_agl_m/get_agl_ft for count points at the same
+    // time t. The ground cache is walked only once for all of them.
+    // The results are in the units of the respective call and the
+    // velocities are given at the contact point.
+    // Returns the number of points with a valid ground result.
+    unsigned get_agl_multi_m(double t, unsigned count, const double pt[][3],
+                             double max_altoff,
+                             FGGroundCache::AglResult results[]);
+    unsigned get_agl_multi_ft(double t, unsigned count, const double pt[][3],
+                              double max_altoff,
+                              FGGroundCache::AglResult results[]);
     double get_groundlevel_m(double lat, double lon, double alt);
     double get_groundlevel_m(const SGGeod& geod);
 
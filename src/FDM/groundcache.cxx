@@ -26,7 +26,9 @@
 
 #include "groundcache.hxx"
 
+#include <cmath>
 #include <utility>
+#include <vector>
 
 #include <osg/Drawable>
 #include <osg/Geode>
@@ -45,6 +47,9 @@
 #include <simgear/scene/util/SGNodeMasks.hxx>
 #include <simgear/scene/util/SGSceneUserData.hxx>
 #include <simgear/scene/util/OsgMath.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGQueue.hxx>
 
 #include <simgear/bvh/BVHNode.hxx>
 #include <simgear/bvh/BVHGroup.hxx>
@@ -67,6 +72,7 @@
 
 #include <Main/globals.hxx>
 #include <Scenery/scenery.hxx>
+#include <Scenery/MultiLineSegmentVisitor.hxx>
 
 #include "flight.hxx"
 
@@ -75,8 +81,10 @@ using namespace simgear;
 class FGGroundCache::CacheFill : public osg::NodeVisitor {
 public:
     CacheFill(const SGVec3d& center, const SGVec3d& down, const double& radius,
-              const double& startTime, const double& endTime) :
+              const double& startTime, const double& endTime,
+              bool snapshot = false) :
         osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _snapshot(snapshot),
         _center(center),
         _down(down),
         _radius(radius),
@@ -240,6 +248,13 @@ public:
         if (!bvNode)
             return;
 
+        // For a snapshot just reference the whole bounding volume tree,
+        // the prefetch thread picks the part within the sphere later.
+        if (_snapshot) {
+            mSubTreeCollector.addNode(bvNode);
+            return;
+        }
+
         // Find a croase ground intersection 
         SGLineSegmentd line(_center + _radius*_down, _center + _maxDown*_down);
         simgear::BVHLineSegmentVisitor lineSegmentVisitor(line, _startTime);
@@ -279,6 +294,7 @@ public:
     { return _material; }
     
 private:
+    bool _snapshot;
     SGVec3d _center;
     SGVec3d _down;
     double _radius;
@@ -292,6 +308,117 @@ private:
     bool _haveHit;
 };
 
+// A ground cache volume that is built by the prefetch thread.
+// The main thread fills in the request and the scene snapshot, the
+// prefetch thread everything below.
+class FGGroundCache::Prefetch : public SGReferenced {
+public:
+    Prefetch() :
+        radius(0),
+        startTime(0),
+        endTime(0),
+        timeOffset(0),
+        altitude(0),
+        material(0),
+        foundGround(false)
+    { }
+
+    void build()
+    {
+        // Rough ground altitude below the cache, taken from the whole
+        // snapshot as CacheFill does it.
+        double maxDown = SGGeod::fromCart(center).getElevationM() + 9999;
+        SGLineSegmentd line(center + radius*down, center + maxDown*down);
+        simgear::BVHLineSegmentVisitor belowVisitor(line, startTime + timeOffset);
+        sceneTree->accept(belowVisitor);
+        if (!belowVisitor.empty()) {
+            altitude = SGGeod::fromCart(belowVisitor.getPoint()).getElevationM();
+            material = belowVisitor.getMaterial();
+            foundGround = true;
+        }
+
+        // Get that part of the snapshot that intersects our sphere
+        simgear::BVHSubTreeCollector subTreeCollector(SGSphered(center, radius));
+        sceneTree->accept(subTreeCollector);
+        localTree = subTreeCollector.getNode();
+
+        if (!foundGround && localTree) {
+            // Try upwards from the lowest point of the cache
+            SGLineSegmentd line(center + radius*down, center - 1e3*down);
+            simgear::BVHLineSegmentVisitor lineSegmentVisitor(line, startTime + timeOffset);
+            localTree->accept(lineSegmentVisitor);
+            if (!lineSegmentVisitor.empty()) {
+                SGGeod geodPt = SGGeod::fromCart(lineSegmentVisitor.getPoint());
+                altitude = geodPt.getElevationM();
+                material = lineSegmentVisitor.getMaterial();
+                foundGround = true;
+            }
+        }
+
+        // Drop the references to the scenery as early as possible
+        sceneTree = 0;
+    }
+
+    // The request
+    SGSharedPtr<simgear::BVHNode> sceneTree;
+    SGVec3d center;
+    SGVec3d down;
+    double radius;
+    double startTime;
+    double endTime;
+    double timeOffset;
+
+    // The result
+    SGSharedPtr<simgear::BVHNode> localTree;
+    double altitude;
+    const simgear::BVHMaterial* material;
+    bool foundGround;
+};
+
+class FGGroundCache::PrefetchThread : public SGThread {
+public:
+    virtual void run()
+    {
+        for (;;) {
+            SGSharedPtr<Prefetch> prefetch = _requests.pop();
+            // A null request terminates the thread
+            if (!prefetch)
+                return;
+            prefetch->build();
+
+            SGGuard<SGMutex> g(_lock);
+            _result = prefetch;
+            _done.signal();
+        }
+    }
+
+    void request(Prefetch* prefetch)
+    { _requests.push(prefetch); }
+
+    void stop()
+    {
+        _requests.push(SGSharedPtr<Prefetch>());
+        join();
+    }
+
+    // Returns the finished prefetch if there is one within waitMSec
+    SGSharedPtr<Prefetch> takeResult(unsigned waitMSec)
+    {
+        SGGuard<SGMutex> g(_lock);
+        if (!_result && waitMSec)
+            _done.wait(_lock, waitMSec);
+        SGSharedPtr<Prefetch> result = _result;
+        _result = 0;
+        return result;
+    }
+
+private:
+    SGBlockingQueue<SGSharedPtr<Prefetch> > _requests;
+    SGMutex _lock;
+    SGWaitCondition _done;
+    SGSharedPtr<Prefetch> _result;
+};
+
 FGGroundCache::FGGroundCache() :
     _altitude(0),
     _material(0),
@@ -301,37 +428,238 @@ FGGroundCache::FGGroundCache() :
     reference_wgs84_point(SGVec3d(0, 0, 0)),
     reference_vehicle_radius(0),
     down(0.0, 0.0, 0.0),
-    found_ground(false)
+    found_ground(false),
+    _incremental(false),
+    _predictionTime(1),
+    _predictedCenter(SGVec3d(0, 0, 0)),
+    _predictedRadius(0),
+    _predictedEndTime(0),
+    _async(false),
+    _prefetchThread(0),
+    _prefetchPending(false),
+    _prefetchCount(0),
+    _prefetchSwapCount(0),
+    _missCount(0),
+    _buildCount(0),
+    _reuseCount(0),
+    _buildTimeSum(0),
+    _lastBuildTime(0),
+    _maxBuildTime(0)
 {
 #ifdef GROUNDCACHE_DEBUG
     _lookupTime = SGTimeStamp::fromSec(0.0);
     _lookupCount = 0;
     _buildTime = SGTimeStamp::fromSec(0.0);
-    _buildCount = 0;
+    _debugBuildCount = 0;
 #endif
 }
 
 FGGroundCache::~FGGroundCache()
 {
+    set_async(false);
+}
+
+void
+FGGroundCache::set_async(bool async)
+{
+    _async = async;
+    if (_async && !_prefetchThread) {
+        _prefetchThread = new PrefetchThread;
+        _prefetchThread->start();
+    } else if (!_async && _prefetchThread) {
+        _prefetchThread->stop();
+        delete _prefetchThread;
+        _prefetchThread = 0;
+        _prefetchPending = false;
+    }
+}
+
+osg::Node*
+FGGroundCache::get_scene() const
+{
+    if (_scene.valid())
+        return _scene.get();
+    return globals->get_scenery()->get_scene_graph();
+}
+
+bool
+FGGroundCache::schedule_scene(const SGGeod& position, double range_m)
+{
+    if (_scene.valid())
+        return true;
+    return globals->get_scenery()->schedule_scenery(position, range_m, 1.0);
 }
 
+bool
+FGGroundCache::swap_prefetch(double startSimTime, double endSimTime,
+                             const SGVec3d& pt, double rad, unsigned waitMSec)
+{
+    SGSharedPtr<Prefetch> prefetch = _prefetchThread->takeResult(waitMSec);
+    if (!prefetch)
+        return false;
+    _prefetchPending = false;
+
+    // The prediction did not work out, just drop it
+    if (!prefetch->foundGround)
+        return false;
+    if (startSimTime < prefetch->startTime || prefetch->endTime < endSimTime)
+        return false;
+    if (prefetch->radius < dist(pt, prefetch->center) + rad)
+        return false;
+
+    _localBvhTree = prefetch->localTree;
+    _altitude = prefetch->altitude;
+    _material = prefetch->material;
+    found_ground = true;
+    down = prefetch->down;
+    reference_wgs84_point = prefetch->center;
+    reference_vehicle_radius = prefetch->radius;
+    cache_ref_time = startSimTime;
+    _predictedCenter = prefetch->center;
+    _predictedRadius = prefetch->radius;
+    _predictedEndTime = prefetch->endTime;
+    ++_prefetchSwapCount;
+
+    return true;
+}
+
+void
+FGGroundCache::request_prefetch(double startSimTime, const SGVec3d& pt,
+                                const SGVec3d& velocity, double rad)
+{
+    // Cover the time from shortly before the current volume runs out
+    // until one prediction time later.
+    double horizon = SGMiscd::max(_predictionTime, 0.1);
+    double startTime = SGMiscd::max(startSimTime,
+                                    _predictedEndTime - 0.5*horizon);
+    double endTime = startTime + 1.5*horizon;
+    SGVec3d startPt = pt + (startTime - startSimTime)*velocity;
+    SGVec3d endPt = pt + (endTime - startSimTime)*velocity;
+
+    SGSharedPtr<Prefetch> prefetch = new Prefetch;
+    prefetch->center = 0.5*(startPt + endPt);
+    prefetch->radius = rad + 0.5*dist(startPt, endPt);
+    prefetch->startTime = startTime;
+    prefetch->endTime = endTime;
+    prefetch->timeOffset = cache_time_offset;
+
+    // Only snapshot scenery that is completely loaded, tiles that are
+    // still on their way would be missing in the prefetched volume.
+    SGGeod geodPt = SGGeod::fromCart(prefetch->center);
+    if (!schedule_scene(geodPt, prefetch->radius))
+        return;
+
+    SGQuatd hlToEc = SGQuatd::fromLonLat(geodPt);
+    prefetch->down = hlToEc.rotate(SGVec3d(0, 0, 1));
+
+    // Collecting just the references to the bounding volume trees is
+    // cheap, the expensive part of cutting out the sphere happens in the
+    // prefetch thread. The snapshot keeps the trees alive even if their
+    // tiles get unloaded in the meantime.
+    CacheFill snapshot(prefetch->center, prefetch->down, prefetch->radius,
+                       startTime + cache_time_offset,
+                       endTime + cache_time_offset, true);
+    get_scene()->accept(snapshot);
+    prefetch->sceneTree = snapshot.getBVHNode();
+    if (!prefetch->sceneTree)
+        return;
+
+    _prefetchThread->request(prefetch);
+    _prefetchPending = true;
+    ++_prefetchCount;
+}
+
+// Faster than anything that flies in the atmosphere, a velocity above
+// that is taken as broken input.
+static const double maxPlausibleSpeed = 1e4;
+
+// How long the simulation step may wait for a prefetch that is still
+// being built before it goes on with the current tree.
+static const unsigned maxPrefetchWaitMSec = 2;
+
 bool
 FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
-                                    const SGVec3d& pt, double rad)
+                                    const SGVec3d& pt, double rad,
+                                    const SGVec3d& vehicleVelocity)
 {
-#ifdef GROUNDCACHE_DEBUG
+    // The velocity is only used to predict the volume. Rather predict
+    // nothing than a volume blown up by a reset or broken FDM state.
+    SGVec3d velocity = vehicleVelocity;
+    if (!(norm(velocity) < maxPlausibleSpeed))
+        velocity = SGVec3d::zeros();
+    double requestTime = startSimTime;
+
+    // If we have an active wire, get some more area into the groundcache
+    double requestRad = rad;
+    if (_wire)
+        requestRad = SGMiscd::max(200, requestRad);
+
+    // In incremental or asynchronous mode, just keep the tree if the
+    // requested ball and time interval are still covered by the
+    // predicted volume.
+    if ((_incremental || _async) && found_ground && _localBvhTree
+        && endSimTime <= _predictedEndTime
+        && dist(pt, _predictedCenter) + requestRad <= _predictedRadius) {
+        cache_ref_time = startSimTime;
+        ++_reuseCount;
+        if (_async && !_prefetchPending)
+            request_prefetch(startSimTime, pt, velocity, requestRad);
+        return found_ground;
+    }
+
+    // Otherwise, in asynchronous mode, see if the prefetch thread has
+    // the next volume, giving it a moment if it is still working on it.
+    if (_async && _prefetchPending
+        && swap_prefetch(startSimTime, endSimTime, pt, requestRad,
+                         maxPrefetchWaitMSec)) {
+        request_prefetch(startSimTime, pt, velocity, requestRad);
+        return found_ground;
+    }
+
+    // Once there is a tree, asynchronous mode never collects the scene
+    // graph on the main thread. Keep answering from the tree we have,
+    // points outside of it get the coarse altitude below the cache, and
+    // ask for a volume around where the vehicle actually is.
+    if (_async && found_ground && _localBvhTree) {
+        cache_ref_time = startSimTime;
+        ++_missCount;
+        if (!_prefetchPending) {
+            // The current volume is used up, so start the next one now
+            // and widen it by how far the request sticks out of it.
+            double overshoot = dist(pt, _predictedCenter) + requestRad
+                - _predictedRadius;
+            overshoot = SGMiscd::clip(overshoot, 0, _predictedRadius);
+            _predictedEndTime = SGMiscd::min(_predictedEndTime, startSimTime);
+            request_prefetch(startSimTime, pt, velocity,
+                             requestRad + overshoot);
+        }
+        return found_ground;
+    }
+
     SGTimeStamp t0 = SGTimeStamp::now();
-#endif
 
     // Empty cache.
     found_ground = false;
 
-    SGGeod geodPt = SGGeod::fromCart(pt);
+    // In incremental mode build the cache for the volume the vehicle
+    // is predicted to sweep through during the prediction time.
+    SGVec3d center = pt;
+    if (_incremental || _async) {
+        double predictedEndTime = startSimTime + _predictionTime;
+        if (endSimTime < predictedEndTime) {
+            SGVec3d travel = (predictedEndTime - startSimTime)*velocity;
+            center = pt + 0.5*travel;
+            rad += 0.5*norm(travel);
+            endSimTime = predictedEndTime;
+        }
+    }
+
+    SGGeod geodPt = SGGeod::fromCart(center);
     // Don't blow away the cache ground_radius and stuff if there's no
     // scenery
-    if (!globals->get_scenery()->schedule_scenery(geodPt, rad, 1.0)) {
+    if (!schedule_scene(geodPt, rad)) {
         SG_LOG(SG_FLIGHT, SG_BULK, "prepare_ground_cache(): scenery_available "
-               "returns false at " << geodPt << " " << pt << " " << rad);
+               "returns false at " << geodPt << " " << center << " " << rad);
         return false;
     }
     _material = 0;
@@ -341,10 +669,13 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
         rad = SGMiscd::max(200, rad);
     
     // Store the parameters we used to build up that cache.
-    reference_wgs84_point = pt;
+    reference_wgs84_point = center;
     reference_vehicle_radius = rad;
     // Store the time reference used to compute movements of moving triangles.
     cache_ref_time = startSimTime;
+    _predictedCenter = center;
+    _predictedRadius = rad;
+    _predictedEndTime = endSimTime;
     
     // Get a normalized down vector valid for the whole cache
     SGQuatd hlToEc = SGQuatd::fromLonLat(geodPt);
@@ -353,8 +684,8 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
     // Get the ground cache, that is a local collision tree of the environment
     startSimTime += cache_time_offset;
     endSimTime += cache_time_offset;
-    CacheFill subtreeCollector(pt, down, rad, startSimTime, endSimTime);
-    globals->get_scenery()->get_scene_graph()->accept(subtreeCollector);
+    CacheFill subtreeCollector(center, down, rad, startSimTime, endSimTime);
+    get_scene()->accept(subtreeCollector);
     _localBvhTree = subtreeCollector.getBVHNode();
 
     if (subtreeCollector.getHaveElevationBelowCache()) {
@@ -366,7 +697,8 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
     } else if (_localBvhTree) {
         // We have nothing below us, so try starting with the lowest point
         // upwards for a croase altitude value
-        SGLineSegmentd line(pt + reference_vehicle_radius*down, pt - 1e3*down);
+        SGLineSegmentd line(center + reference_vehicle_radius*down,
+                            center - 1e3*down);
         simgear::BVHLineSegmentVisitor lineSegmentVisitor(line, startSimTime);
         _localBvhTree->accept(lineSegmentVisitor);
 
@@ -378,7 +710,7 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
         }
     }
     
-    if (!found_ground) {
+    if (!found_ground && !_scene.valid()) {
         // Ok, still nothing here?? Last resort ...
         double alt = 0;
         _material = 0;
@@ -393,20 +725,29 @@ FGGroundCache::prepare_ground_cache(double startSimTime, double endSimTime,
         SG_LOG(SG_FLIGHT, SG_WARN, "prepare_ground_cache(): trying to build "
                "cache without any scenery below the aircraft");
 
-#ifdef GROUNDCACHE_DEBUG
+    // Start with the next volume in the background
+    if (_async && found_ground && !_prefetchPending)
+        request_prefetch(requestTime, pt, velocity, requestRad);
+
     t0 = SGTimeStamp::now() - t0;
+    _lastBuildTime = t0.toSecs();
+    _buildTimeSum += _lastBuildTime;
+    _maxBuildTime = SGMiscd::max(_maxBuildTime, _lastBuildTime);
+    ++_buildCount;
+
+#ifdef GROUNDCACHE_DEBUG
     _buildTime += t0;
-    _buildCount++;
+    _debugBuildCount++;
 
-    if (_buildCount > 60) {
+    if (_debugBuildCount > 60) {
         double buildTime = 0;
-        if (_buildCount)
-            buildTime = _buildTime.toSecs()/_buildCount;
+        if (_debugBuildCount)
+            buildTime = _buildTime.toSecs()/_debugBuildCount;
         double lookupTime = 0;
         if (_lookupCount)
             lookupTime = _lookupTime.toSecs()/_lookupCount;
         _buildTime = SGTimeStamp::fromSec(0.0);
-        _buildCount = 0;
+        _debugBuildCount = 0;
         _lookupTime = SGTimeStamp::fromSec(0.0);
         _lookupCount = 0;
         SG_LOG(SG_FLIGHT, SG_ALERT, "build time = " << buildTime
@@ -739,6 +1080,64 @@ FGGroundCache::get_agl(double t, const SGVec3d& pt, SGVec3d& contact,
     }
 }
 
+unsigned
+FGGroundCache::get_agl_multi(double t, unsigned count, const SGVec3d pt[],
+                             AglResult results[])
+{
+#ifdef GROUNDCACHE_DEBUG
+    SGTimeStamp t0 = SGTimeStamp::now();
+#endif
+
+    // Set up all the ground intersection queries at once
+    t += cache_time_offset;
+    FGMultiLineSegmentVisitor multiLineSegmentVisitor(t);
+    for (unsigned i = 0; i < count; ++i) {
+        SGLineSegmentd line(pt[i], pt[i] + 10*reference_vehicle_radius*down);
+        multiLineSegmentVisitor.addLineSegment(line);
+    }
+    if (_localBvhTree && count)
+        _localBvhTree->accept(multiLineSegmentVisitor);
+
+#ifdef GROUNDCACHE_DEBUG
+    t0 = SGTimeStamp::now() - t0;
+    _lookupTime += t0;
+    _lookupCount += count;
+#endif
+
+    unsigned numValid = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        const FGMultiLineSegmentVisitor::Ray& ray
+            = multiLineSegmentVisitor.getRay(i);
+        AglResult& result = results[i];
+        if (ray.haveHit) {
+            // Have an intersection
+            result.contact = ray.lineSegment.getEnd();
+            result.normal = ray.normal;
+            if (0 < dot(result.normal, down))
+                result.normal = -result.normal;
+            result.linearVel = ray.linearVelocity;
+            result.angularVel = ray.angularVelocity;
+            result.material = ray.material;
+            result.id = ray.id;
+            result.valid = true;
+        } else {
+            // Same fallback as in get_agl
+            SGGeod geodPt = SGGeod::fromCart(pt[i]);
+            geodPt.setElevationM(_altitude);
+            result.contact = SGVec3d::fromGeod(geodPt);
+            result.normal = -down;
+            result.linearVel = SGVec3d(0, 0, 0);
+            result.angularVel = SGVec3d(0, 0, 0);
+            result.material = _material;
+            result.id = 0;
+            result.valid = found_ground;
+        }
+        if (result.valid)
+            ++numValid;
+    }
+    return numValid;
+}
+
 
 bool
 FGGroundCache::get_nearest(double t, const SGVec3d& pt, double maxDist,
@@ -30,11 +30,14 @@
 #include <simgear/bvh/BVHNode.hxx>
 #include <simgear/structure/SGSharedPtr.hxx>
 
+#include <simgear/timing/timestamp.hxx>
+
+#include <osg/Node>
+#include <osg/ref_ptr>
+
 // #define GROUNDCACHE_DEBUG
 #ifdef GROUNDCACHE_DEBUG
 #include <osg/Group>
-#include <osg/ref_ptr>
-#include <simgear/timing/timestamp.hxx>
 #endif
 
 namespace simgear {
@@ -44,6 +47,18 @@ class BVHMaterial;
 
 class FGGroundCache {
 public:
+    // The ground returns for a single point of a get_agl_multi query.
+    struct AglResult {
+        SGVec3d contact;
+        SGVec3d normal;
+        SGVec3d linearVel;
+        SGVec3d angularVel;
+        simgear::BVHNode::Id id;
+        const simgear::BVHMaterial* material;
+        // Same meaning as the return value of get_agl
+        bool valid;
+    };
+
     FGGroundCache();
     ~FGGroundCache();
 
@@ -54,8 +69,60 @@ public:
     // Prepare the ground cache for the wgs84 position pt_*.
     // That is take all vertices in the ball with radius rad around the
     // position given by the pt_* and store them in a local scene graph.
+    // The vehicle velocity in the earth centered frame is used to predict
+    // the volume in incremental and asynchronous mode, implausible
+    // values are taken as standing still.
     bool prepare_ground_cache(double startSimTime, double endSimTime,
-                              const SGVec3d& pt, double rad);
+                              const SGVec3d& pt, double rad,
+                              const SGVec3d& velocity = SGVec3d::zeros());
+
+    // In incremental mode a cache that was built is kept for the volume
+    // the vehicle is predicted to move through within the prediction
+    // time. Later calls to prepare_ground_cache that stay within that
+    // volume reuse the tree instead of collecting it again.
+    bool get_incremental() const
+    { return _incremental; }
+    void set_incremental(bool incremental)
+    { _incremental = incremental; }
+    double get_prediction_time() const
+    { return _predictionTime; }
+    void set_prediction_time(double predictionTime)
+    { _predictionTime = predictionTime; }
+
+    // In asynchronous mode the cache for the volume the vehicle is
+    // predicted to enter next is built by a worker thread. Once the
+    // vehicle leaves the current volume that result is swapped in if it
+    // covers the request. Only the first cache is collected on the main
+    // thread. If no prefetched volume covers a later request within a
+    // few milliseconds, the current tree is kept and that is counted as
+    // a miss.
+    bool get_async() const
+    { return _async; }
+    void set_async(bool async);
+
+    // The scene graph the cache is collected from. By default that is
+    // the scenery, and the cache is only built once its tiles are
+    // loaded. A scene given here is taken as completely loaded.
+    void set_scene(osg::Node* scene)
+    { _scene = scene; }
+
+    // Build statistics
+    int get_build_count() const
+    { return _buildCount; }
+    int get_reuse_count() const
+    { return _reuseCount; }
+    double get_build_time_sec() const
+    { return _buildTimeSum; }
+    double get_last_build_time_sec() const
+    { return _lastBuildTime; }
+    double get_max_build_time_sec() const
+    { return _maxBuildTime; }
+    int get_prefetch_count() const
+    { return _prefetchCount; }
+    int get_prefetch_swap_count() const
+    { return _prefetchSwapCount; }
+    int get_miss_count() const
+    { return _missCount; }
 
     // Returns true if the cache is valid.
     // Also the reference time, point and radius values where the cache
@@ -92,6 +159,13 @@ public:
                  simgear::BVHNode::Id& id,
                  const simgear::BVHMaterial*& material);
 
+    // Same as get_agl, but for count points at once.
+    // All down rays are traced together in a single walk through the
+    // local tree, so neighbouring gear contacts share the tree descent.
+    // Returns the number of points with a valid result.
+    unsigned get_agl_multi(double t, unsigned count, const SGVec3d pt[],
+                           AglResult results[]);
+
     bool get_nearest(double t, const SGVec3d& pt, double maxDist,
                      SGVec3d& contact, SGVec3d& linearVel, SGVec3d& angularVel,
                      simgear::BVHNode::Id& id,
@@ -112,7 +186,23 @@ public:
     void release_wire(void);
 
 private:
+    // The scene graph to collect from and whether it is loaded within
+    // range_m of position.
+    osg::Node* get_scene() const;
+    bool schedule_scene(const SGGeod& position, double range_m);
+
+    // Take a finished prefetch if it covers the request, returns true
+    // if the cache was replaced by it.
+    bool swap_prefetch(double startSimTime, double endSimTime,
+                       const SGVec3d& pt, double rad, unsigned waitMSec);
+    // Snapshot the scene graph near the volume the vehicle is predicted
+    // to enter next and hand it to the prefetch thread.
+    void request_prefetch(double startSimTime, const SGVec3d& pt,
+                          const SGVec3d& velocity, double rad);
+
     class CacheFill;
+    class Prefetch;
+    class PrefetchThread;
     class BodyFinder;
     class CatapultFinder;
     class WireIntersector;
@@ -139,12 +229,37 @@ private:
     bool found_ground;
 
     SGSharedPtr<simgear::BVHNode> _localBvhTree;
+    osg::ref_ptr<osg::Node> _scene;
+
+    // Incremental mode state
+    bool _incremental;
+    double _predictionTime;
+    // The volume and the end of the time interval the current tree is
+    // valid for.
+    SGVec3d _predictedCenter;
+    double _predictedRadius;
+    double _predictedEndTime;
+
+    // Asynchronous mode state
+    bool _async;
+    PrefetchThread* _prefetchThread;
+    bool _prefetchPending;
+
+    // Build statistics
+    int _prefetchCount;
+    int _prefetchSwapCount;
+    int _missCount;
+    int _buildCount;
+    int _reuseCount;
+    double _buildTimeSum;
+    double _lastBuildTime;
+    double _maxBuildTime;
 
 #ifdef GROUNDCACHE_DEBUG
     SGTimeStamp _lookupTime;
     unsigned _lookupCount;
     SGTimeStamp _buildTime;
-    unsigned _buildCount;
+    unsigned _debugBuildCount;
 
     osg::ref_ptr<osg::Group> _group;
 #endif
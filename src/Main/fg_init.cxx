@@ -660,6 +660,12 @@ fgInitNav ()
         }
     }
 
+  // optionally hold the whole spatial index in memory, trading memory for
+  // fewer database reads in spatial searches
+  if (fgGetBool("/sim/navdb/octree-snapshot", false)) {
+    cache->loadOctreeSnapshot();
+  }
+
   FGTACANList *channellist = new FGTACANList;
   globals->set_channellist( channellist );
   
@@ -26,6 +26,7 @@
 
 #include <simgear/compiler.h>
 
+#include <cmath>
 #include <cstdlib>             // atoi()
 
 #include <string>
@@ -40,6 +41,8 @@
 #include <simgear/math/sg_types.hxx>
 #include <simgear/timing/timestamp.hxx>
 #include <simgear/misc/strutils.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
 
 #include <Network/protocol.hxx>
 #include <Network/ATC-Main.hxx>
@@ -68,20 +71,153 @@
 #endif
 
 #include "globals.hxx"
+#include "fg_props.hxx"
 #include "fg_io.hxx"
 
 using std::atoi;
 using std::string;
 
 
-FGIO::FGIO()
+const double FGIO::ChannelTiming::BinEdgesUSec[NumBins - 1] =
+    { 50, 100, 200, 500, 1000, 2000, 5000 };
+
+FGIO::ChannelTiming::ChannelTiming() :
+    overruns(0),
+    started(false)
 {
+    for (int i = 0; i < NumBins; ++i) {
+        jitter[i] = latency[i] = 0;
+    }
 }
 
+int FGIO::ChannelTiming::bin(double usec)
+{
+    int i = 0;
+    while ((i < NumBins - 1) && (usec >= BinEdgesUSec[i])) {
+        ++i;
+    }
+    return i;
+}
 
-FGIO::~FGIO()
+void FGIO::ChannelTiming::record(const SGTimeStamp& start,
+                                 const SGTimeStamp& end, double hz)
+{
+    if (started) {
+        double interval = (start - lastStart).toUSecs();
+        ++jitter[bin(fabs(interval - 1e6 / hz))];
+    }
+    ++latency[bin((end - start).toUSecs())];
+    lastStart = start;
+    started = true;
+}
+
+
+/**
+ * Runs the process() calls of channels on their own thread, each at its
+ * own rate, independent of the frame rate. The lock is held while a
+ * channel processes; the main thread takes it to exchange the property
+ * snapshots of the channels and to publish their timing.
+ */
+class FGIO::IOThread : public SGThread
 {
+public:
+    IOThread() :
+        _quit(false)
+    {}
+
+    void add(FGProtocol* protocol, ChannelTiming* timing)
+    {
+        Channel c = { protocol, timing, SGTimeStamp() };
+        _channels.push_back(c);
+    }
+
+    bool empty() const
+    { return _channels.empty(); }
+
+    SGMutex& lock()
+    { return _lock; }
+
+    void quit()
+    {
+        SGGuard<SGMutex> g(_lock);
+        _quit = true;
+    }
+
+    virtual void run()
+    {
+        SGTimeStamp now = SGTimeStamp::now();
+        for (size_t i = 0; i < _channels.size(); ++i) {
+            _channels[i].due = now;
+        }
+
+        // there are few channels, so finding the next one due by looking
+        // at all of them is as good as any timer queue
+        while (true) {
+            Channel* next = &_channels[0];
+            for (size_t i = 1; i < _channels.size(); ++i) {
+                if (_channels[i].due < next->due)
+                    next = &_channels[i];
+            }
 
+            now = SGTimeStamp::now();
+            if (now < next->due) {
+                // wake up now and then to notice a shutdown
+                SGTimeStamp wake = now + SGTimeStamp::fromMSec(10);
+                SGTimeStamp::sleepUntil((next->due < wake) ? next->due : wake);
+                SGGuard<SGMutex> g(_lock);
+                if (_quit)
+                    break;
+                continue;
+            }
+
+            SGGuard<SGMutex> g(_lock);
+            if (_quit)
+                break;
+            FGProtocol* p = next->protocol;
+            if (!p->is_enabled()) {
+                next->due += SGTimeStamp::fromSec(1);
+                continue;
+            }
+
+            SGTimeStamp start = SGTimeStamp::now();
+            p->process();
+            p->inc_count();
+            SGTimeStamp end = SGTimeStamp::now();
+            next->timing->record(start, end, p->get_hz());
+
+            // skip the periods that were missed, rather than catching up
+            SGTimeStamp period = SGTimeStamp::fromSec(1 / p->get_hz());
+            next->due += period;
+            while (next->due < end) {
+                next->due += period;
+                next->timing->overruns++;
+            }
+        }
+    }
+
+private:
+    struct Channel
+    {
+        FGProtocol* protocol;
+        ChannelTiming* timing;
+        SGTimeStamp due;
+    };
+
+    std::vector<Channel> _channels;
+    SGMutex _lock;
+    bool _quit;
+};
+
+
+FGIO::FGIO() :
+    _thread(NULL)
+{
+}
+
+
+FGIO::~FGIO()
+{
+    stop_thread();
 }
 
 
@@ -352,6 +488,84 @@ FGIO::init()
     for (; i != end; ++i ) {
         add_channel( *i );
     } // of channel options iteration
+
+    _timing.resize(io_channels.size());
+    for (size_t i = 0; i < io_channels.size(); ++i) {
+        SGPropertyNode* node = fgGetNode("/sim/io/channel", i, true);
+        node->setDoubleValue("hz", io_channels[i]->get_hz());
+        _timingNodes.push_back(node);
+    }
+
+    if (fgGetBool("/sim/io/thread", false)) {
+        start_thread();
+    }
+}
+
+// move the channels which support it to the I/O thread
+void FGIO::start_thread()
+{
+    IOThread* thread = new IOThread;
+    for (size_t i = 0; i < io_channels.size(); ++i) {
+        FGProtocol* p = io_channels[i];
+        if (!p->supports_io_thread() || (p->get_hz() <= 0)) {
+            continue;
+        }
+
+        p->set_threaded(true);
+        p->sync_properties();
+        thread->add(p, &_timing[i]);
+    }
+
+    if (thread->empty()) {
+        SG_LOG( SG_IO, SG_INFO, "No I/O channels can run on the I/O thread." );
+        delete thread;
+        return;
+    }
+
+    _thread = thread;
+    _thread->start();
+}
+
+void FGIO::stop_thread()
+{
+    if (!_thread) {
+        return;
+    }
+
+    _thread->quit();
+    _thread->join();
+    delete _thread;
+    _thread = NULL;
+
+    for (size_t i = 0; i < io_channels.size(); ++i) {
+        if (io_channels[i]->is_threaded()) {
+            // apply the inputs received last
+            io_channels[i]->sync_properties();
+            io_channels[i]->set_threaded(false);
+        }
+    }
+}
+
+void FGIO::publish_timing()
+{
+    static const char* binNames[ChannelTiming::NumBins] = {
+        "below-50", "below-100", "below-200", "below-500",
+        "below-1000", "below-2000", "below-5000", "above-5000"
+    };
+
+    for (size_t i = 0; i < _timingNodes.size(); ++i) {
+        SGPropertyNode* node = _timingNodes[i];
+        const ChannelTiming& timing = _timing[i];
+        node->setBoolValue("threaded", io_channels[i]->is_threaded());
+        node->setLongValue("count", io_channels[i]->get_count());
+        node->setIntValue("overruns", timing.overruns);
+        SGPropertyNode* jitter = node->getNode("jitter-us", true);
+        SGPropertyNode* latency = node->getNode("latency-us", true);
+        for (int j = 0; j < ChannelTiming::NumBins; ++j) {
+            jitter->setIntValue(binNames[j], timing.jitter[j]);
+            latency->setIntValue(binNames[j], timing.latency[j]);
+        }
+    }
 }
 
 // add another I/O channel
@@ -389,29 +603,47 @@ FGIO::update( double /* delta_time_sec */ )
     // see http://code.google.com/p/flightgear-bugs/issues/detail?id=125
     double delta_time_sec = _realDeltaTime->getDoubleValue();
 
-    ProtocolVec::iterator i = io_channels.begin();
-    ProtocolVec::iterator end = io_channels.end();
-    for (; i != end; ++i ) {
-        FGProtocol* p = *i;
-        if (!p->is_enabled()) {
+    for (size_t i = 0; i < io_channels.size(); ++i ) {
+        FGProtocol* p = io_channels[i];
+        if (!p->is_enabled() || p->is_threaded()) {
             continue;
         }
 
         p->dec_count_down( delta_time_sec );
         double dt = 1 / p->get_hz();
         if ( p->get_count_down() < 0.33 * dt ) {
+            SGTimeStamp start = SGTimeStamp::now();
             p->process();
             p->inc_count();
+            _timing[i].record(start, SGTimeStamp::now(), p->get_hz());
+            p->inc_count_down( dt );
             while ( p->get_count_down() < 0.33 * dt ) {
                 p->inc_count_down( dt );
+                _timing[i].overruns++;
             }
         } // of channel processing
     } // of io_channels iteration
+
+    if (!_thread) {
+        publish_timing();
+        return;
+    }
+
+    // the channels on the I/O thread don't process meanwhile
+    SGGuard<SGMutex> g(_thread->lock());
+    for (size_t i = 0; i < io_channels.size(); ++i ) {
+        if (io_channels[i]->is_threaded()) {
+            io_channels[i]->sync_properties();
+        }
+    }
+    publish_timing();
 }
 
 void
 FGIO::shutdown()
 {
+    stop_thread();
+
     ProtocolVec::iterator i = io_channels.begin();
     ProtocolVec::iterator end = io_channels.end();
     for (; i != end; ++i )
@@ -425,6 +657,8 @@ FGIO::shutdown()
     }
 
     io_channels.clear();
+    _timing.clear();
+    _timingNodes.clear();
 }
 
 void
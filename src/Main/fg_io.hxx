@@ -28,6 +28,7 @@
 #include <simgear/compiler.h>
 #include <simgear/structure/subsystem_mgr.hxx>
 #include <simgear/props/props.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include <vector>
 #include <string>
@@ -53,13 +54,43 @@ private:
     void add_channel(const std::string& config);
     FGProtocol* parse_port_config( const std::string& cfgstr );
 
-private:
+    void start_thread();
+    void stop_thread();
+    void publish_timing();
+
+    /**
+     * Timing of the process() calls of a channel, as histograms: how far
+     * the intervals between calls are off the channel rate (jitter), and
+     * how long the calls take (latency).
+     */
+    struct ChannelTiming
+    {
+        enum { NumBins = 8 };
+        static const double BinEdgesUSec[NumBins - 1];
+
+        ChannelTiming();
+        void record(const SGTimeStamp& start, const SGTimeStamp& end, double hz);
+        static int bin(double usec);
+
+        unsigned jitter[NumBins];
+        unsigned latency[NumBins];
+        unsigned overruns;   // periods skipped since the channel fell behind
+        SGTimeStamp lastStart;
+        bool started;
+    };
+
+    class IOThread;
 
     // define the global I/O channel list
     //io_container global_io_list;
     
     typedef std::vector< FGProtocol* > ProtocolVec;
     ProtocolVec io_channels;
+    std::vector<ChannelTiming> _timing;   // of the channel at the same index
+    std::vector<SGPropertyNode_ptr> _timingNodes;
+
+    // runs the channels that support it, when /sim/io/thread is set
+    IOThread* _thread;
     
     SGPropertyNode_ptr _realDeltaTime;
 };
@@ -0,0 +1,166 @@
+// mpdelta.cxx -- Delta encoding of multiplayer position messages
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "mpdelta.hxx"
+
+#include <cstring>
+
+#include "mpmessages.hxx"
+
+FGMPDeltaEncoder::FGMPDeltaEncoder() :
+  mKeyframe(MP_DELTA_PROBE),
+  mIsKeyframe(false),
+  mDeltaPackets(0),
+  mStep(0),
+  mKeyframePropertyCount(0)
+{
+}
+
+bool
+FGMPDeltaEncoder::begin(size_t propertyCount, unsigned keyframeInterval)
+{
+  mIsKeyframe = mKeyframeOffsets.empty()
+    || ++mDeltaPackets >= keyframeInterval
+    || mKeyframePropertyCount != propertyCount;
+  if (mIsKeyframe) {
+    // the number has to fit above the flags in the header
+    mKeyframe = (mKeyframe + 1) & (~0u >> MP_KEYFRAME_SHIFT);
+    if (mKeyframe == MP_DELTA_PROBE)
+      ++mKeyframe;
+    mDeltaPackets = 0;
+    mKeyframeOffsets.clear();
+    mKeyframePropertyCount = propertyCount;
+  }
+  mStep = 0;
+  return mIsKeyframe;
+}
+
+void
+FGMPDeltaEncoder::reset()
+{
+  mKeyframeOffsets.clear();
+  mIsKeyframe = false;
+}
+
+char*
+FGMPDeltaEncoder::filter(const char* data, char* start, char* end)
+{
+  unsigned step = mStep++;
+  if (mIsKeyframe) {
+    mKeyframeOffsets.push_back(start - data);
+    return end;
+  }
+
+  if (step + 1 < mKeyframeOffsets.size()) {
+    size_t offset = mKeyframeOffsets[step];
+    size_t length = mKeyframeOffsets[step + 1] - offset;
+    if (length == size_t(end - start)
+        && memcmp(start, mKeyframeData.data() + offset, length) == 0)
+      return start;
+  }
+  return end;
+}
+
+void
+FGMPDeltaEncoder::end(const char* data, const char* end)
+{
+  if (!mIsKeyframe)
+    return;
+  mKeyframeOffsets.push_back(end - data);
+  mKeyframeData.assign(data, end);
+}
+
+void
+FGMPDeltaEncoder::setKeyframeBools(unsigned block, int value)
+{
+  if (mKeyframeBools.size() <= block)
+    mKeyframeBools.resize(block + 1, 0);
+  mKeyframeBools[block] = value;
+}
+
+bool
+FGMPDeltaEncoder::boolsChanged(unsigned block, int value) const
+{
+  if (mKeyframeBools.size() <= block)
+    return value != 0;
+  return mKeyframeBools[block] != value;
+}
+
+FGMPDeltaDecoder::FGMPDeltaDecoder() :
+  mKeyframe(MP_DELTA_PROBE),
+  mHaveKeyframe(false)
+{
+}
+
+FGMPDeltaDecoder::~FGMPDeltaDecoder()
+{
+  clear();
+}
+
+void
+FGMPDeltaDecoder::clear()
+{
+  for (size_t i = 0; i < mKeyframeProperties.size(); ++i)
+    delete mKeyframeProperties[i];
+  mKeyframeProperties.clear();
+  mKeyframeIndex.clear();
+}
+
+void
+FGMPDeltaDecoder::setKeyframe(const std::vector<FGPropertyData*>& properties,
+                              uint32_t keyframe)
+{
+  clear();
+  for (size_t i = 0; i < properties.size(); ++i) {
+    mKeyframeIndex[properties[i]->id] = i;
+    mKeyframeProperties.push_back(properties[i]->clone());
+  }
+  mKeyframe = keyframe;
+  mHaveKeyframe = true;
+}
+
+bool
+FGMPDeltaDecoder::complete(std::vector<FGPropertyData*>& properties,
+                           uint32_t keyframe)
+{
+  if (!mHaveKeyframe || keyframe != mKeyframe)
+    return false;
+
+  // A property the keyframe does not have, like a block of bools that
+  // were all false, would make the list longer than the keyframe's,
+  // and interpolation skips lists of different lengths altogether.
+  // Drop it, the next keyframe brings it.
+  mMergedProperties.assign(mKeyframeProperties.size(), nullptr);
+  for (size_t i = 0; i < properties.size(); ++i) {
+    std::map<unsigned, size_t>::const_iterator it
+      = mKeyframeIndex.find(properties[i]->id);
+    if (it != mKeyframeIndex.end() && !mMergedProperties[it->second])
+      mMergedProperties[it->second] = properties[i];
+    else
+      delete properties[i];
+  }
+  for (size_t i = 0; i < mKeyframeProperties.size(); ++i) {
+    if (!mMergedProperties[i])
+      mMergedProperties[i] = mKeyframeProperties[i]->clone();
+  }
+  properties.swap(mMergedProperties);
+  mMergedProperties.clear();
+  return true;
+}
@@ -0,0 +1,113 @@
+// mpdelta.hxx -- Delta encoding of multiplayer position messages
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef MPDELTA_H
+#define MPDELTA_H
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include <simgear/misc/stdint.hxx>
+
+struct FGPropertyData;
+
+/**
+ * The sending side: decides which messages are keyframes and drops the
+ * properties of the others that encode the same as in the keyframe.
+ * Properties are taken as the encoded bytes, in the order of the message.
+ */
+class FGMPDeltaEncoder
+{
+public:
+  FGMPDeltaEncoder();
+
+  // Start the properties of a message with propertyCount properties.
+  // Returns true if it is a keyframe, which is due every keyframeInterval
+  // messages and whenever the number of properties changes.
+  bool begin(size_t propertyCount, unsigned keyframeInterval);
+  // Delta messages are not used for now, start with a keyframe when they
+  // are again.
+  void reset();
+
+  // The number of the keyframe of the current message, never
+  // MP_DELTA_PROBE.
+  uint32_t getKeyframe() const
+  { return mKeyframe; }
+  bool isKeyframe() const
+  { return mIsKeyframe; }
+
+  // Called for each property encoded at [start, end), with the start of
+  // the properties in data. Returns the position to encode the next
+  // property at, start if the property is dropped.
+  char* filter(const char* data, char* start, char* end);
+  // Called with the end of the properties; keyframes keep them.
+  void end(const char* data, const char* end);
+
+  // Blocks of bools, by block index. Keyframes keep their value, delta
+  // messages only send the ones which differ from it.
+  void setKeyframeBools(unsigned block, int value);
+  bool boolsChanged(unsigned block, int value) const;
+
+private:
+  uint32_t mKeyframe;
+  bool mIsKeyframe;
+  // messages since the keyframe, properties of the current message
+  unsigned mDeltaPackets;
+  unsigned mStep;
+
+  // The encoded properties of the keyframe with the start offset of each
+  // property, and one more entry for the end.
+  std::vector<char> mKeyframeData;
+  std::vector<size_t> mKeyframeOffsets;
+  size_t mKeyframePropertyCount;
+  std::vector<int> mKeyframeBools;
+};
+
+/**
+ * The receiving side: completes the properties of delta messages from
+ * the keyframe they refer to.
+ */
+class FGMPDeltaDecoder
+{
+public:
+  FGMPDeltaDecoder();
+  ~FGMPDeltaDecoder();
+
+  // Keep a copy of the properties of a keyframe.
+  void setKeyframe(const std::vector<FGPropertyData*>& properties,
+                   uint32_t keyframe);
+  // Complete the changed properties of a delta message from its keyframe,
+  // in the order of the keyframe. Returns false and leaves the properties
+  // alone if that keyframe was missed.
+  bool complete(std::vector<FGPropertyData*>& properties, uint32_t keyframe);
+
+private:
+  FGMPDeltaDecoder(const FGMPDeltaDecoder&);
+  FGMPDeltaDecoder& operator=(const FGMPDeltaDecoder&);
+
+  void clear();
+
+  // Properties of the last keyframe, and their index by id
+  std::vector<FGPropertyData*> mKeyframeProperties;
+  std::map<unsigned, size_t> mKeyframeIndex;
+  uint32_t mKeyframe;
+  bool mHaveKeyframe;
+  // scratch list for completing properties
+  std::vector<FGPropertyData*> mMergedProperties;
+};
+
+#endif
@@ -0,0 +1,120 @@
+// mpmessages.cxx -- Storage for the received multiplayer properties
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "mpmessages.hxx"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+namespace
+{
+  // Properties are decoded on the network thread and released on the main
+  // thread, hence the lock.
+  SGMutex poolLock;
+  std::vector<void*> pool;
+  // enough for a few hundred pilots' worth of interpolation buffers
+  const std::size_t MAX_POOL_SIZE = 1 << 17;
+
+  std::atomic<unsigned> allocations(0);
+}
+
+char* FGPropertyData::allocString(unsigned length)
+{
+  if (length < INLINE_STRING_SIZE) {
+    string_value = inline_string;
+  } else {
+    string_value = new char[length + 1];
+    ++allocations;
+  }
+  return string_value;
+}
+
+void FGPropertyData::freeString()
+{
+  if (string_value != inline_string) {
+    delete [] string_value;
+  }
+  string_value = nullptr;
+}
+
+void* FGPropertyData::operator new(std::size_t size)
+{
+  if (size == sizeof(FGPropertyData)) {
+    SGGuard<SGMutex> g(poolLock);
+    if (!pool.empty()) {
+      void* p = pool.back();
+      pool.pop_back();
+      return p;
+    }
+  }
+
+  ++allocations;
+  return ::operator new(size);
+}
+
+void FGPropertyData::operator delete(void* p)
+{
+  if (!p) {
+    return;
+  }
+
+  {
+    SGGuard<SGMutex> g(poolLock);
+    if (pool.size() < MAX_POOL_SIZE) {
+      pool.push_back(p);
+      return;
+    }
+  }
+
+  ::operator delete(p);
+}
+
+FGPropertyData* FGPropertyData::clone() const
+{
+  FGPropertyData* p = new FGPropertyData;
+  p->id = id;
+  p->type = type;
+  switch (type) {
+  case simgear::props::STRING:
+  case simgear::props::UNSPECIFIED:
+    if (string_value) {
+      strcpy(p->allocString(strlen(string_value)), string_value);
+    }
+    break;
+  case simgear::props::FLOAT:
+  case simgear::props::DOUBLE:
+    p->float_value = float_value;
+    break;
+  default:
+    p->int_value = int_value;
+    break;
+  }
+  return p;
+}
+
+unsigned FGPropertyData::heapAllocations()
+{
+  return allocations;
+}
@@ -35,6 +35,7 @@
 *
 ******************************************************************/
 
+#include <cstddef>
 #include <vector>
 
 #include <simgear/compiler.h>
@@ -56,6 +57,28 @@ const uint32_t PROTO_VER = 0x00010001;  // 1.1
 #define RESET_DATA_ID           6
 #define POS_DATA_ID             7
 #define MP_2017_DATA_ID         8
+#define MP_DELTA_DATA_ID        9
+
+// Capability flags, sent in the low byte of the ReplyPort field of the
+// message header which is otherwise unused.
+// The sender can decode MP_DELTA_DATA_ID messages.
+const uint32_t MP_CAPABILITY_DELTA = 1;
+// This POS_DATA_ID message is a keyframe for the sender's delta messages,
+// its number is in the ReplyPort bits from MP_KEYFRAME_SHIFT up.
+const uint32_t MP_FLAG_DELTA_KEYFRAME = 2;
+const unsigned MP_KEYFRAME_SHIFT = 8;
+
+// Delta position messages are laid out like POS_DATA_ID messages with the
+// V2 property encoding, but their properties only contain the values that
+// changed since the last keyframe. The pad of T_PositionMsg holds the
+// number of that keyframe. Keyframes are plain POS_DATA_ID messages with
+// all properties, so clients and servers which drop unknown message ids
+// still get a complete position every keyframe interval.
+// Keyframes are numbered from 1. A delta message for keyframe 0 is a
+// probe, sent next to the position messages while it is unknown whether
+// the server relays delta messages. Receivers learn from it that it does,
+// and otherwise ignore it.
+const uint32_t MP_DELTA_PROBE = 0;
 
 // XDR demands 4 byte alignment, but some compilers use8 byte alignment
 // so it's safe to let the overall size of a network message be a 
@@ -116,7 +139,13 @@ struct T_PositionMsg {
     xdr_data_t pad;
 };
 
+// Received property value. Instances are recycled through a pool by their
+// operator new/delete, and short strings are stored in the object itself,
+// so decoding a message doesn't need the heap once the pool is warm.
 struct FGPropertyData {
+  // strings up to this size, including the null char, are stored inline
+  static const unsigned INLINE_STRING_SIZE = 32;
+
   unsigned id;
   
   // While the type isn't transmitted, it is needed for the destructor
@@ -130,9 +159,25 @@ struct FGPropertyData {
   ~FGPropertyData() {
     if ((type == simgear::props::STRING) || (type == simgear::props::UNSPECIFIED))
     {
-      delete [] string_value;
+      freeString();
     }
   }
+
+  // Point string_value to storage for 'length' chars and a null char
+  char* allocString(unsigned length);
+  void freeString();
+
+  FGPropertyData* clone() const;
+
+  static void* operator new(std::size_t size);
+  static void operator delete(void* p);
+
+  // Number of heap allocations done for received properties so far:
+  // pool misses and long strings. Thread-safe.
+  static unsigned heapAllocations();
+
+private:
+  char inline_string[INLINE_STRING_SIZE];
 };
 
 
@@ -169,6 +214,12 @@ struct FGExternalMotionData {
   std::vector<FGPropertyData*> properties;
 
   ~FGExternalMotionData()
+  {
+      clearProperties();
+  }
+
+  // Delete the properties, keeping the capacity of the list
+  void clearProperties()
   {
       std::vector<FGPropertyData*>::const_iterator propIt;
       std::vector<FGPropertyData*>::const_iterator propItEnd;
@@ -180,6 +231,7 @@ struct FGExternalMotionData {
         delete *propIt;
         propIt++;
       }
+      properties.clear();
   }
 };
 
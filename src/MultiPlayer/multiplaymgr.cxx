@@ -33,6 +33,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <errno.h>
 
@@ -42,6 +43,7 @@
 #include <simgear/props/props.hxx>
 #include <simgear/structure/commands.hxx>
 #include <simgear/structure/event_mgr.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include <AIModel/AIManager.hxx>
 #include <AIModel/AIMultiplayer.hxx>
@@ -192,9 +194,8 @@ static xdr_data_t *decode_received_launchbar_state(const IdPropertyList *propDef
 
     p->id = 108; // this is for the string property for gear/launchbar/state
     if (p->string_value && p->type == simgear::props::STRING)
-        delete[] p->string_value;
-    p->string_value = new char[strlen(stringvalue) + 1];
-    strcpy(p->string_value, stringvalue);
+        p->freeString();
+    strcpy(p->allocString(strlen(stringvalue)), stringvalue);
     p->type = simgear::props::STRING;
     return xdr;
 }
@@ -710,6 +711,84 @@ private:
    FGMultiplayMgr* _multiplay;
 };
 
+//////////////////////////////////////////////////////////////////////
+//
+//  Network thread reading the receive socket. Position messages are
+//  decoded on this thread, into the slots of a single producer, single
+//  consumer ring that the main thread drains in FGMultiplayMgr::update.
+//  The slots are reused, so in steady state the only allocations left
+//  are those of the decoded properties.
+//
+//////////////////////////////////////////////////////////////////////
+class MPReceiveThread : public SGThread
+{
+public:
+  struct Position
+  {
+    char callsign[MAX_CALLSIGN_LEN];
+    char model[MAX_MODEL_NAME_LEN];
+    long stamp;
+    unsigned msgId;
+    uint32_t capabilities;
+    uint32_t keyframe;
+    FGExternalMotionData motionInfo;
+  };
+
+  MPReceiveThread(simgear::Socket* socket, int debugLevel) :
+    _socket(socket),
+    _head(0),
+    _tail(0),
+    _stop(false),
+    _debugLevel(debugLevel),
+    _dropped(0)
+  {
+  }
+
+  virtual void run();
+
+  void stop()
+  {
+    _stop = true;
+    join();
+  }
+
+  void setDebugLevel(int debugLevel)
+  {
+    _debugLevel = debugLevel;
+  }
+
+  // oldest position not yet applied by the main thread, null if none
+  Position* front()
+  {
+    unsigned head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire))
+      return 0;
+    return &_ring[head % RING_SIZE];
+  }
+
+  // release the slot returned by front() to the network thread
+  void pop()
+  {
+    _head.store(_head.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+private:
+  // enough for a few frames of a busy server
+  static const unsigned RING_SIZE = 1024;
+  // how long to wait for data before checking whether to stop
+  static const int SELECT_TIMEOUT_MSEC = 100;
+
+  simgear::Socket* _socket;
+  Position _ring[RING_SIZE];
+  std::atomic<unsigned> _head; // next slot to consume
+  std::atomic<unsigned> _tail; // next slot to fill
+  std::atomic<bool> _stop;
+  std::atomic<int> _debugLevel;
+  // positions dropped because the main thread lagged behind
+  std::atomic<unsigned> _dropped;
+};
+
 //////////////////////////////////////////////////////////////////////
 //
 //  handle command "multiplayer-connect"
@@ -846,6 +925,21 @@ FGMultiplayMgr::FGMultiplayMgr()
   pMultiPlayDebugLevel = fgGetNode("/sim/multiplay/debug-level", true);
   pMultiPlayRange = fgGetNode("/sim/multiplay/visibility-range-nm", true);
   pMultiPlayRange->setIntValue(100);
+  pRxPackets = fgGetNode("/sim/multiplay/stats/rx-packets", true);
+  pRxAllocations = fgGetNode("/sim/multiplay/stats/rx-heap-allocations", true);
+  pRxAllocationsPerPacket =
+    fgGetNode("/sim/multiplay/stats/rx-heap-allocations-per-packet", true);
+  mRxPackets = 0;
+  mStatsRxPackets = 0;
+  mStatsRxAllocations = 0;
+  pDeltaEncoding = fgGetNode("/sim/multiplay/delta-encoding", true);
+  pDeltaKeyframeInterval =
+    fgGetNode("/sim/multiplay/delta-keyframe-interval", true);
+  pServerRelaysDelta = fgGetNode("/sim/multiplay/server-relays-delta", true);
+  if (pDeltaKeyframeInterval->getIntValue() <= 0)
+    pDeltaKeyframeInterval->setIntValue(20);
+  pTxEncodeTime = fgGetNode("/sim/multiplay/stats/tx-encode-usec", true);
+  mProbePackets = 0;
 } // FGMultiplayMgr::FGMultiplayMgr()
 //////////////////////////////////////////////////////////////////////
 
@@ -946,6 +1040,12 @@ FGMultiplayMgr::init (void)
             << strerror(errno) << "(errno " << errno << ")");
     return;
   }
+
+  if (fgGetBool("/sim/multiplay/receive-thread", true)) {
+    mReceiveThread.reset(new MPReceiveThread(mSocket.get(),
+                                             pMultiPlayDebugLevel->getIntValue()));
+    mReceiveThread->start();
+  }
   
   mPropertiesChanged = true;
   mListener = new MPPropertyListener(this);
@@ -974,6 +1074,11 @@ void
 FGMultiplayMgr::shutdown (void) 
 {
   fgSetBool("/sim/multiplay/online", false);
+
+  if (mReceiveThread) {
+    mReceiveThread->stop();
+    mReceiveThread.reset();
+  }
   
   if (mSocket.get()) {
     mSocket->close();
@@ -1082,6 +1187,81 @@ union FGMultiplayMgr::MsgBuf
     T_MsgHdr Header;
 };
 
+void
+MPReceiveThread::run()
+{
+  unsigned droppedReported = 0;
+
+  while (!_stop) {
+    simgear::Socket* reads[] = { _socket, 0 };
+    if (simgear::Socket::select(reads, 0, SELECT_TIMEOUT_MSEC) <= 0)
+      continue;
+
+    for (;;) {
+      FGMultiplayMgr::MsgBuf msgBuf;
+      simgear::IPAddress SenderAddress;
+      int status = FGMultiplayMgr::receiveMessage(*_socket, msgBuf,
+                                                  SenderAddress);
+      if (status == 0)
+        break;
+      else if (status < 0)
+        continue; // skip invalid messages
+
+      switch (msgBuf.msgHdr()->MsgId) {
+      case CHAT_MSG_ID:
+        FGMultiplayMgr::ProcessChatMsg(msgBuf, SenderAddress);
+        break;
+      case POS_DATA_ID:
+      case MP_DELTA_DATA_ID:
+      {
+        unsigned tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == RING_SIZE) {
+          ++_dropped;
+          break;
+        }
+
+        Position& pos = _ring[tail % RING_SIZE];
+        // normally taken over by FGAIMultiplayer::addMotionInfo
+        std::vector<FGPropertyData*>& props = pos.motionInfo.properties;
+        for (unsigned i = 0; i < props.size(); ++i)
+          delete props[i];
+        props.clear();
+
+        if (!FGMultiplayMgr::decodePosMsg(msgBuf, pos.motionInfo,
+                                          _debugLevel))
+          break;
+
+        strncpy(pos.callsign, msgBuf.msgHdr()->Callsign, MAX_CALLSIGN_LEN);
+        pos.callsign[MAX_CALLSIGN_LEN - 1] = '\0';
+        strncpy(pos.model, msgBuf.posMsg()->Model, MAX_MODEL_NAME_LEN);
+        pos.model[MAX_MODEL_NAME_LEN - 1] = '\0';
+        pos.stamp = SGTimeStamp::now().getSeconds();
+        pos.msgId = msgBuf.msgHdr()->MsgId;
+        pos.capabilities = msgBuf.msgHdr()->ReplyPort;
+        pos.keyframe = XDR_decode_uint32(msgBuf.posMsg()->pad);
+        _tail.store(tail + 1, std::memory_order_release);
+        break;
+      }
+      case UNUSABLE_POS_DATA_ID:
+      case OLD_OLD_POS_DATA_ID:
+      case OLD_PROP_MSG_ID:
+      case OLD_POS_DATA_ID:
+        break;
+      default:
+        SG_LOG( SG_NETWORK, SG_DEBUG, "MPReceiveThread - "
+                << "Unknown message Id received: " << msgBuf.msgHdr()->MsgId );
+        break;
+      }
+    }
+
+    if (_dropped != droppedReported) {
+      droppedReported = _dropped;
+      SG_LOG(SG_NETWORK, SG_INFO, "MPReceiveThread - main thread lagging, "
+             << droppedReported << " position messages dropped so far");
+    }
+  }
+}
+
 bool
 FGMultiplayMgr::isSane(const FGExternalMotionData& motionInfo)
 {
@@ -1128,6 +1308,11 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
   static unsigned msgLen = 0;
   T_PositionMsg* PosMsg = msgBuf.posMsg();
 
+  // Only send delta messages when every pilot around can decode them,
+  // and the server is known to pass them on
+  bool useDelta = protocolToUse > 1 && pDeltaEncoding->getBoolValue()
+      && pServerRelaysDelta->getBoolValue() && peersDeltaCapable();
+
   /*
    * This is to provide a level of compatibility with the new V2 packets.
    * By setting padding it will force older clients to use verify properties which will
@@ -1135,7 +1320,12 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
    * MP2017(V2) (for V1 clients) will always have an unknown property because V2 transmits
    * the protocol version as the very first property as a shortint.
    */
-  if (protocolToUse > 1)
+  if (useDelta)
+  {
+      // set when encoding the properties: delta messages hold the keyframe
+      // number in the pad, keyframes are V2 messages
+  }
+  else if (protocolToUse > 1)
       PosMsg->pad = XDR_encode_int32(V2_PAD_MAGIC);
   else
       PosMsg->pad = 0;
@@ -1200,6 +1390,31 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
       struct BoolArrayBuffer boolBuffer[MAX_BOOL_BUFFERS];
       memset(&boolBuffer, 0, sizeof(boolBuffer));
 
+      SGTimeStamp encodeStart;
+      encodeStart.stamp();
+
+      /*
+       * Delta messages only carry the properties that changed since the last keyframe.
+       * Keyframes carry all of them, and are sent periodically so that pilots joining
+       * or losing packets catch up, and whenever the set of properties changes.
+       * They go out as plain POS_DATA_ID messages, flagged in the header.
+       */
+      bool keyframe = false;
+      if (useDelta)
+      {
+          keyframe = mDeltaEncoder.begin(motionInfo.properties.size(),
+                                         pDeltaKeyframeInterval->getIntValue());
+          if (keyframe)
+              PosMsg->pad = XDR_encode_int32(V2_PAD_MAGIC);
+          else
+              PosMsg->pad = XDR_encode_uint32(mDeltaEncoder.getKeyframe());
+      }
+      else
+      {
+          // start with a keyframe when delta messages are used again
+          mDeltaEncoder.reset();
+      }
+
       for (int partition = 1; partition <= protocolToUse; partition++)
       {
           std::vector<FGPropertyData*>::const_iterator it = motionInfo.properties.begin();
@@ -1232,6 +1447,7 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
                   // First element is the ID. Write it out when we know we have room for
                   // the whole property.
                   xdr_data_t id = XDR_encode_uint32((*it)->id);
+                  char* propStart = (char*)ptr;
 
 
                   /*
@@ -1301,7 +1517,12 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
                       }
                       case TT_BOOLARRAY:
                       {
-                          if ((*it)->int_value)
+                          /*
+                           * With delta encoding, keyframes carry every block in use even when
+                           * all its bools are false, so no later delta adds a block the
+                           * receivers' keyframe does not have.
+                           */
+                          if ((*it)->int_value || useDelta)
                           {
                               struct BoolArrayBuffer *boolBuf = nullptr;
                               if ((*it)->id > BOOLARRAY_START_ID && (*it)->id <= BOOLARRAY_END_ID + BOOLARRAY_BLOCKSIZE)
@@ -1310,7 +1531,7 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
                                   boolBuf = &boolBuffer[buffer_block];
                                   boolBuf->propertyId = BOOLARRAY_START_ID + buffer_block * BOOLARRAY_BLOCKSIZE;
                               }
-                              if (boolBuf)
+                              if (boolBuf && (*it)->int_value)
                               {
                                   int bitidx = (*it)->id - boolBuf->propertyId;
                                   boolBuf->boolValue |= 1 << bitidx;
@@ -1458,17 +1679,37 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
                           break;
                       }
                   }
+
+                  if (useDelta)
+                      ptr = (xdr_data_t*)mDeltaEncoder.filter((char*)data, propStart, (char*)ptr);
               }
               ++it;
           }
       }
       escape:
 
+      if (keyframe)
+      {
+          mDeltaEncoder.end((char*)data, (char*)ptr);
+          for (int boolIdx = 0; boolIdx < MAX_BOOL_BUFFERS; boolIdx++)
+              mDeltaEncoder.setKeyframeBools(boolIdx, boolBuffer[boolIdx].boolValue);
+      }
+
       /*
       * Send the boolean arrays (if present) as single 32bit integers.
       */
       for (int boolIdx = 0; boolIdx < MAX_BOOL_BUFFERS; boolIdx++)
       {
+          /*
+           * Deltas only carry the blocks that changed, including blocks that went all false
+           * and are otherwise not sent.
+           */
+          if (useDelta && !keyframe)
+          {
+              if (!mDeltaEncoder.boolsChanged(boolIdx, boolBuffer[boolIdx].boolValue))
+                  continue;
+              boolBuffer[boolIdx].propertyId = BOOLARRAY_START_ID + boolIdx * BOOLARRAY_BLOCKSIZE;
+          }
           if (boolBuffer[boolIdx].propertyId)
           {
               if (ptr + 2 >= msgEnd)
@@ -1481,7 +1722,12 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
       }
 
       msgLen = reinterpret_cast<char*>(ptr) - msgBuf.Msg;
-      FillMsgHdr(msgBuf.msgHdr(), POS_DATA_ID, msgLen);
+      if (keyframe)
+          FillMsgHdr(msgBuf.msgHdr(), POS_DATA_ID, msgLen,
+                     MP_FLAG_DELTA_KEYFRAME | (mDeltaEncoder.getKeyframe() << MP_KEYFRAME_SHIFT));
+      else
+          FillMsgHdr(msgBuf.msgHdr(), useDelta ? MP_DELTA_DATA_ID : POS_DATA_ID, msgLen);
+      pTxEncodeTime->setDoubleValue((SGTimeStamp::now() - encodeStart).toUSecs());
 
       /*
       * Informational:
@@ -1515,8 +1761,67 @@ FGMultiplayMgr::SendMyPosition(const FGExternalMotionData& motionInfo)
   }
   if (msgLen > 0)
       mSocket->sendto(msgBuf.Msg, msgLen, 0, &mServer);
+
+  /*
+   * Nobody sends delta messages before the server is known to relay them, so the
+   * first ones through are probes: once every keyframe interval, a copy of the
+   * position message as a delta message for no keyframe. They cost nothing if the
+   * server drops them, and once one gets through, both sides start sending deltas.
+   */
+  if (msgLen > 0 && protocolToUse > 1 && pDeltaEncoding->getBoolValue()
+      && !pServerRelaysDelta->getBoolValue() && peersDeltaCapable()
+      && ++mProbePackets >= (unsigned)pDeltaKeyframeInterval->getIntValue())
+  {
+      mProbePackets = 0;
+      MsgBuf probe(msgBuf);
+      FillMsgHdr(probe.msgHdr(), MP_DELTA_DATA_ID, msgLen);
+      probe.posMsg()->pad = XDR_encode_uint32(MP_DELTA_PROBE);
+      mSocket->sendto(probe.Msg, msgLen, 0, &mServer);
+  }
   SG_LOG(SG_NETWORK, SG_BULK, "FGMultiplayMgr::SendMyPosition");
 } // FGMultiplayMgr::SendMyPosition()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Peers announce that they decode delta messages in the header of
+//  everything they send. Older clients drop messages with unknown
+//  ids, so deltas are only sent when all pilots around announce it,
+//  and there is at least one of them to send them to.
+//
+//////////////////////////////////////////////////////////////////////
+bool
+FGMultiplayMgr::peersDeltaCapable()
+{
+  if (mMultiPlayerMap.empty())
+    return false;
+  MultiPlayerMap::const_iterator it = mMultiPlayerMap.begin();
+  for (; it != mMultiPlayerMap.end(); ++it) {
+    if (!it->second->getDeltaCapable())
+      return false;
+  }
+  return true;
+} // FGMultiplayMgr::peersDeltaCapable()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Servers which don't know MP_DELTA_DATA_ID drop them. Receiving one
+//  from another pilot, which may be one of the probes sent until then,
+//  shows that ours passes them on. It can also be set up front for a
+//  server known to do so.
+//
+//////////////////////////////////////////////////////////////////////
+void
+FGMultiplayMgr::serverRelaysDelta()
+{
+  if (pServerRelaysDelta->getBoolValue())
+    return;
+  SG_LOG(SG_NETWORK, SG_INFO, "FGMultiplayMgr - "
+         << "the server relays delta position messages");
+  pServerRelaysDelta->setBoolValue(true);
+} // FGMultiplayMgr::serverRelaysDelta()
+//////////////////////////////////////////////////////////////////////
 
 short FGMultiplayMgr::get_scaled_short(double v, double scale)
 {
@@ -1570,48 +1875,28 @@ FGMultiplayMgr::SendTextMessage(const string &MsgText)
 
 //////////////////////////////////////////////////////////////////////
 //
-//  Name: ProcessData
-//  Description: Processes data waiting at the receive socket. The
-//  processing ends when there is no more data at the socket.
-//  
+//  Read the next message waiting at the socket and decode its header.
+//  Returns 1 for a valid message, 0 when there is no more data and -1
+//  when the message was invalid.
+//
 //////////////////////////////////////////////////////////////////////
-void
-FGMultiplayMgr::update(double dt) 
+int
+FGMultiplayMgr::receiveMessage(simgear::Socket& socket, MsgBuf& msgBuf,
+                               simgear::IPAddress& SenderAddress)
 {
-  if (!mInitialised)
-    return;
-
-  /// Just for expiry
-  long stamp = SGTimeStamp::now().getSeconds();
-
-  //////////////////////////////////////////////////
-  //  Send if required
-  //////////////////////////////////////////////////
-  mTimeUntilSend -= dt;
-  if (mTimeUntilSend <= 0.0) {
-    Send();
-  }
-
-  //////////////////////////////////////////////////
-  //  Read the receive socket and process any data
-  //////////////////////////////////////////////////
-  ssize_t bytes;
-  do {
-    MsgBuf msgBuf;
     //////////////////////////////////////////////////
     //  Although the recv call asks for 
     //  MAX_PACKET_SIZE of data, the number of bytes
     //  returned will only be that of the next
     //  packet waiting to be processed.
     //////////////////////////////////////////////////
-    simgear::IPAddress SenderAddress;
-    int RecvStatus = mSocket->recvfrom(msgBuf.Msg, sizeof(msgBuf.Msg), 0,
-                              &SenderAddress);
+    int RecvStatus = socket.recvfrom(msgBuf.Msg, sizeof(msgBuf.Msg), 0,
+                                     &SenderAddress);
     //////////////////////////////////////////////////
     //  no Data received
     //////////////////////////////////////////////////
     if (RecvStatus == 0)
-        break;
+        return 0;
 
     // socket error reported?
     // errno isn't thread-safe - so only check its value when
@@ -1620,7 +1905,7 @@ FGMultiplayMgr::update(double dt)
         ((errno == EAGAIN) || (errno == 0))) // MSVC output "NoError" otherwise
     {
         // ignore "normal" errors
-        break;
+        return 0;
     }
 
     if (RecvStatus<0)
@@ -1635,15 +1920,15 @@ FGMultiplayMgr::update(double dt)
         SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - Unable to receive data. "
             << strerror(errno) << "(errno " << errno << ")");
 #endif
-        break;
+        return 0;
     }
 
     // status is positive: bytes received
-    bytes = (ssize_t) RecvStatus;
+    ssize_t bytes = (ssize_t) RecvStatus;
     if (bytes <= static_cast<ssize_t>(sizeof(T_MsgHdr))) {
       SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
               << "received message with insufficient data" );
-      break;
+      return -1;
     }
     //////////////////////////////////////////////////
     //  Read header
@@ -1658,39 +1943,107 @@ FGMultiplayMgr::update(double dt)
     if (MsgHdr->Magic != MSG_MAGIC) {
       SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
               << "message has invalid magic number!" );
-      break;
+      return -1;
     }
     if (MsgHdr->Version != PROTO_VER) {
       SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
               << "message has invalid protocol number!" );
-      break;
+      return -1;
     }
     if (static_cast<ssize_t>(MsgHdr->MsgLen) != bytes) {
       SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
              << "message from " << MsgHdr->Callsign << " has invalid length!");
-      break;
+      return -1;
     }
-    //////////////////////////////////////////////////
-    //  Process messages
-    //////////////////////////////////////////////////
-    switch (MsgHdr->MsgId) {
-    case CHAT_MSG_ID:
-      ProcessChatMsg(msgBuf, SenderAddress);
-      break;
-    case POS_DATA_ID:
-      ProcessPosMsg(msgBuf, SenderAddress, stamp);
-      break;
-    case UNUSABLE_POS_DATA_ID:
-    case OLD_OLD_POS_DATA_ID:
-    case OLD_PROP_MSG_ID:
-    case OLD_POS_DATA_ID:
-      break;
-    default:
-      SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
-              << "Unknown message Id received: " << MsgHdr->MsgId );
-      break;
+
+    return 1;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Name: ProcessData
+//  Description: Processes data waiting at the receive socket. The
+//  processing ends when there is no more data at the socket.
+//  
+//////////////////////////////////////////////////////////////////////
+void
+FGMultiplayMgr::update(double dt) 
+{
+  if (!mInitialised)
+    return;
+
+  /// Just for expiry
+  long stamp = SGTimeStamp::now().getSeconds();
+
+  //////////////////////////////////////////////////
+  //  Send if required
+  //////////////////////////////////////////////////
+  mTimeUntilSend -= dt;
+  if (mTimeUntilSend <= 0.0) {
+    Send();
+  }
+
+  //////////////////////////////////////////////////
+  //  Apply the positions decoded by the network
+  //  thread, or read the receive socket and process
+  //  any data
+  //////////////////////////////////////////////////
+  if (mReceiveThread) {
+    mReceiveThread->setDebugLevel(pMultiPlayDebugLevel->getIntValue());
+    MPReceiveThread::Position* pos;
+    while ((pos = mReceiveThread->front()) != 0) {
+      if (pos->msgId == MP_DELTA_DATA_ID)
+        serverRelaysDelta();
+      applyPosMsg(pos->callsign, pos->model, pos->motionInfo, pos->stamp,
+                  pos->msgId, pos->capabilities, pos->keyframe);
+      mReceiveThread->pop();
     }
-  } while (bytes > 0);
+  } else {
+    for (;;) {
+      MsgBuf msgBuf;
+      simgear::IPAddress SenderAddress;
+      if (receiveMessage(*mSocket, msgBuf, SenderAddress) <= 0)
+        break;
+
+      //////////////////////////////////////////////////
+      //  Process messages
+      //////////////////////////////////////////////////
+      switch (msgBuf.msgHdr()->MsgId) {
+      case CHAT_MSG_ID:
+        ProcessChatMsg(msgBuf, SenderAddress);
+        break;
+      case MP_DELTA_DATA_ID:
+        serverRelaysDelta();
+        ProcessPosMsg(msgBuf, SenderAddress, stamp);
+        break;
+      case POS_DATA_ID:
+        ProcessPosMsg(msgBuf, SenderAddress, stamp);
+        break;
+      case UNUSABLE_POS_DATA_ID:
+      case OLD_OLD_POS_DATA_ID:
+      case OLD_PROP_MSG_ID:
+      case OLD_POS_DATA_ID:
+        break;
+      default:
+        SG_LOG( SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
+                << "Unknown message Id received: " << msgBuf.msgHdr()->MsgId );
+        break;
+      }
+    }
+  }
+
+  // allocation statistics, to check that decoding has become allocation
+  // free once the property pool is warm
+  if (mRxPackets != mStatsRxPackets) {
+    unsigned allocations = FGPropertyData::heapAllocations();
+    pRxPackets->setIntValue(mRxPackets);
+    pRxAllocations->setIntValue(allocations);
+    pRxAllocationsPerPacket->setDoubleValue(
+      double(allocations - mStatsRxAllocations) / (mRxPackets - mStatsRxPackets));
+    mStatsRxPackets = mRxPackets;
+    mStatsRxAllocations = allocations;
+  }
 
   // check for expiry
   MultiPlayerMap::iterator it = mMultiPlayerMap.begin();
@@ -1821,8 +2174,7 @@ FGMultiplayMgr::Send()
 
             if (len > 0)
             {
-                pData->string_value = new char[len + 1];
-                strcpy(pData->string_value, cstr);
+                strcpy(pData->allocString(len), cstr);
             }
             else
             {
@@ -1853,15 +2205,34 @@ FGMultiplayMgr::Send()
 void
 FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
    const simgear::IPAddress& SenderAddress, long stamp)
+{
+   FGExternalMotionData motionInfo;
+   const T_MsgHdr* MsgHdr = Msg.msgHdr();
+   if (decodePosMsg(Msg, motionInfo, pMultiPlayDebugLevel->getIntValue()))
+      applyPosMsg(MsgHdr->Callsign, Msg.posMsg()->Model, motionInfo,
+                  stamp, MsgHdr->MsgId, MsgHdr->ReplyPort,
+                  XDR_decode_uint32(Msg.posMsg()->pad));
+} // FGMultiplayMgr::ProcessPosMsg()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Decode a position message into motionInfo, which must have no
+//  properties. This touches no state, so it may run on the network
+//  thread. Returns false if the message should be dropped.
+//
+//////////////////////////////////////////////////////////////////////
+bool
+FGMultiplayMgr::decodePosMsg(const FGMultiplayMgr::MsgBuf& Msg,
+   FGExternalMotionData& motionInfo, int debugLevel)
 {
    const T_MsgHdr* MsgHdr = Msg.msgHdr();
    if (MsgHdr->MsgLen < sizeof(T_MsgHdr) + sizeof(T_PositionMsg)) {
       SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::MP_ProcessData - "
          << "Position message received with insufficient data");
-      return;
+      return false;
    }
    const T_PositionMsg* PosMsg = Msg.posMsg();
-   FGExternalMotionData motionInfo;
    motionInfo.time = XDR_decode_double(PosMsg->time);
    motionInfo.lag = XDR_decode_double(PosMsg->lag);
    for (unsigned i = 0; i < 3; ++i)
@@ -1886,7 +2257,7 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
       SG_LOG(SG_NETWORK, SG_DEBUG, "FGMultiplayMgr::ProcessPosMsg - "
          << "Position message with invalid data (NaN) received from "
          << MsgHdr->Callsign);
-      return;
+      return false;
    }
 
    //cout << "INPUT MESSAGE\n";
@@ -1915,7 +2286,8 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
      * This will preserve the position info but not transmit the properties; which is about
      * the most reasonable compromise we can have
      */
-    if (PosMsg->pad != 0 && XDR_decode_int32(PosMsg->pad) != V2_PAD_MAGIC) {
+    if (MsgHdr->MsgId != MP_DELTA_DATA_ID && PosMsg->pad != 0
+        && XDR_decode_int32(PosMsg->pad) != V2_PAD_MAGIC) {
         if (verifyProperties(&PosMsg->pad, Msg.propsRecvdEnd()))
             xdr = &PosMsg->pad;
         else if (!verifyProperties(xdr, Msg.propsRecvdEnd()))
@@ -1941,7 +2313,7 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
             short_int_encoded = true;
         }
 
-        if (pMultiPlayDebugLevel->getIntValue() & 8)
+        if (debugLevel & 8)
             SG_LOG(SG_NETWORK, SG_INFO,
                 "[RECV] add " << std::hex << xdr
                 << std::dec <<
@@ -2055,7 +2427,7 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
             if (short_int_encoded)
             {
                 uint32_t length = int_value;
-                pData->string_value = new char[length + 1];
+                pData->allocString(length);
 
                 char *cptr = (char*)xdr;
                 for (unsigned i = 0; i < length; i++)
@@ -2076,7 +2448,7 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
                 // Old versions truncated the string but left the length unadjusted.
                 if (length > MAX_TEXT_SIZE)
                     length = MAX_TEXT_SIZE;
-                pData->string_value = new char[length + 1];
+                pData->allocString(length);
                 //cout << " String: ";
                 for (unsigned i = 0; i < length; i++)
                 {
@@ -2121,11 +2493,36 @@ FGMultiplayMgr::ProcessPosMsg(const FGMultiplayMgr::MsgBuf& Msg,
     }
   }
  noprops:
-  FGAIMultiplayer* mp = getMultiplayer(MsgHdr->Callsign);
+  return true;
+} // FGMultiplayMgr::decodePosMsg()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//
+//  hand a decoded position over to the multiplayer it comes from,
+//  which takes the properties of motionInfo
+//
+//////////////////////////////////////////////////////////////////////
+void
+FGMultiplayMgr::applyPosMsg(const char* callsign, const char* model,
+   FGExternalMotionData& motionInfo, long stamp,
+   unsigned msgId, unsigned capabilities, unsigned keyframe)
+{
+  FGAIMultiplayer* mp = getMultiplayer(callsign);
   if (!mp)
-    mp = addMultiplayer(MsgHdr->Callsign, PosMsg->Model);
-  mp->addMotionInfo(motionInfo, stamp);
-} // FGMultiplayMgr::ProcessPosMsg()
+    mp = addMultiplayer(callsign, model);
+  mp->setDeltaCapable((capabilities & MP_CAPABILITY_DELTA) != 0);
+  if (msgId == MP_DELTA_DATA_ID && keyframe == MP_DELTA_PROBE)
+    return;
+  if (msgId == MP_DELTA_DATA_ID)
+    mp->addDeltaMotionInfo(motionInfo, stamp, keyframe, false);
+  else if (capabilities & MP_FLAG_DELTA_KEYFRAME)
+    mp->addDeltaMotionInfo(motionInfo, stamp,
+                           capabilities >> MP_KEYFRAME_SHIFT, true);
+  else
+    mp->addMotionInfo(motionInfo, stamp);
+  ++mRxPackets;
+} // FGMultiplayMgr::applyPosMsg()
 //////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
@@ -2160,7 +2557,8 @@ FGMultiplayMgr::ProcessChatMsg(const MsgBuf& Msg,
 //////////////////////////////////////////////////////////////////////
 
 void
-FGMultiplayMgr::FillMsgHdr(T_MsgHdr *MsgHdr, int MsgId, unsigned _len)
+FGMultiplayMgr::FillMsgHdr(T_MsgHdr *MsgHdr, int MsgId, unsigned _len,
+                           uint32_t flags)
 {
   uint32_t len;
   switch (MsgId) {
@@ -2168,18 +2566,22 @@ FGMultiplayMgr::FillMsgHdr(T_MsgHdr *MsgHdr, int MsgId, unsigned _len)
     len = sizeof(T_MsgHdr) + sizeof(T_ChatMsg);
     break;
   case POS_DATA_ID:
+  case MP_DELTA_DATA_ID:
     len = _len;
     break;
   default:
     len = sizeof(T_MsgHdr);
     break;
   }
+  uint32_t capabilities = flags;
+  if (pDeltaEncoding->getBoolValue())
+    capabilities |= MP_CAPABILITY_DELTA;
   MsgHdr->Magic            = XDR_encode_uint32(MSG_MAGIC);
   MsgHdr->Version          = XDR_encode_uint32(PROTO_VER);
   MsgHdr->MsgId            = XDR_encode_uint32(MsgId);
   MsgHdr->MsgLen           = XDR_encode_uint32(len);
   MsgHdr->RequestedRangeNm = XDR_encode_shortints32(0,pMultiPlayRange->getIntValue());
-  MsgHdr->ReplyPort        = 0;
+  MsgHdr->ReplyPort        = XDR_encode_uint32(capabilities);
   strncpy(MsgHdr->Callsign, mCallsign.c_str(), MAX_CALLSIGN_LEN);
   MsgHdr->Callsign[MAX_CALLSIGN_LEN - 1] = '\0';
 }
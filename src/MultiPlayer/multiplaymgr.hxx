@@ -43,8 +43,11 @@ const int MAX_MP_PROTOCOL_VERSION = 2;
 #include <simgear/io/raw_socket.hxx>
 #include <simgear/structure/subsystem_mgr.hxx>
 
+#include "mpdelta.hxx"
+
 struct FGExternalMotionData;
 class MPPropertyListener;
+class MPReceiveThread;
 struct T_MsgHdr;
 class FGAIMultiplayer;
 
@@ -67,6 +70,7 @@ public:
   
 private:
   friend class MPPropertyListener;
+  friend class MPReceiveThread;
   
   void setPropertiesChanged()
   {
@@ -85,23 +89,37 @@ private:
   
   void Send();
   void SendMyPosition(const FGExternalMotionData& motionInfo);
+  bool peersDeltaCapable();
+  void serverRelaysDelta();
   short get_scaled_short(double v, double scale);
 
   union MsgBuf;
   FGAIMultiplayer* addMultiplayer(const std::string& callsign,
                                   const std::string& modelName);
   FGAIMultiplayer* getMultiplayer(const std::string& callsign);
-  void FillMsgHdr(T_MsgHdr *MsgHdr, int iMsgId, unsigned _len = 0u);
+  // flags are or-ed into the capabilities of the header
+  void FillMsgHdr(T_MsgHdr *MsgHdr, int iMsgId, unsigned _len = 0u,
+                  uint32_t flags = 0);
+  static int receiveMessage(simgear::Socket& socket, MsgBuf& msgBuf,
+                            simgear::IPAddress& SenderAddress);
   void ProcessPosMsg(const MsgBuf& Msg, const simgear::IPAddress& SenderAddress,
                      long stamp);
-  void ProcessChatMsg(const MsgBuf& Msg, const simgear::IPAddress& SenderAddress);
-  bool isSane(const FGExternalMotionData& motionInfo);
+  static bool decodePosMsg(const MsgBuf& Msg, FGExternalMotionData& motionInfo,
+                           int debugLevel);
+  void applyPosMsg(const char* callsign, const char* model,
+                   FGExternalMotionData& motionInfo, long stamp,
+                   unsigned msgId, unsigned capabilities, unsigned keyframe);
+  static void ProcessChatMsg(const MsgBuf& Msg,
+                             const simgear::IPAddress& SenderAddress);
+  static bool isSane(const FGExternalMotionData& motionInfo);
 
   /// maps from the callsign string to the FGAIMultiplayer
   typedef std::map<std::string, SGSharedPtr<FGAIMultiplayer> > MultiPlayerMap;
   MultiPlayerMap mMultiPlayerMap;
 
   std::unique_ptr<simgear::Socket> mSocket;
+  // reads and decodes received messages, when enabled
+  std::unique_ptr<MPReceiveThread> mReceiveThread;
   simgear::IPAddress mServer;
   bool mHaveServer;
   bool mInitialised;
@@ -115,12 +133,29 @@ private:
   SGPropertyNode *pXmitLen;
   SGPropertyNode *pMultiPlayDebugLevel;
   SGPropertyNode *pMultiPlayRange;
+  SGPropertyNode *pDeltaEncoding;
+  SGPropertyNode *pDeltaKeyframeInterval;
+  SGPropertyNode *pServerRelaysDelta;
+  SGPropertyNode *pTxEncodeTime;
+  SGPropertyNode *pRxPackets;
+  SGPropertyNode *pRxAllocations;
+  SGPropertyNode *pRxAllocationsPerPacket;
+
+  // received position messages, and heap allocations for their properties
+  // at the last statistics update
+  unsigned mRxPackets;
+  unsigned mStatsRxPackets;
+  unsigned mStatsRxAllocations;
 
   typedef std::map<unsigned int, const struct IdPropertyList*> PropertyDefinitionMap;
   PropertyDefinitionMap mPropertyDefinition;
 
   bool mPropertiesChanged;
 
+  FGMPDeltaEncoder mDeltaEncoder;
+  // position messages sent since the last delta probe
+  unsigned mProbePackets;
+
   MPPropertyListener* mListener;
   
   double mDt; // reciprocal of /sim/multiplay/tx-rate-hz
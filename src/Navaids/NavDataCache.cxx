@@ -26,7 +26,10 @@
 #include "NavDataCache.hxx"
 
 // std
+#include <algorithm>
+#include <cctype>
 #include <cstddef>  // for std::size_t
+#include <exception>
 #include <map>
 #include <cassert>
 #include <stdint.h> // for int64_t
@@ -125,6 +128,64 @@ void f_distanceCartSqrFunction(sqlite3_context* ctx, int argc, sqlite3_value* ar
   sqlite3_result_double(ctx, distSqr(posA, posB));
 }
 
+// types of the items in the search index: airports, fixes and navaids,
+// as offered by the airport list and the launcher's location search
+#define SEARCH_TYPES "((type >= 1 AND type <= 3) OR (type >= 9 AND type <= 11))"
+
+/**
+ * Split text into the words of the search index: lower case runs of ASCII
+ * letters and digits. Other bytes of UTF-8 sequences are part of words,
+ * any other character separates them.
+ */
+string_list searchWords(const std::string& text)
+{
+  string_list words;
+  std::string word;
+  for (std::size_t i = 0; i <= text.size(); ++i) {
+    unsigned char c = (i < text.size()) ? text[i] : ' ';
+    if ((c >= 0x80) || isalnum(c)) {
+      word.push_back(tolower(c));
+    } else if (!word.empty()) {
+      words.push_back(word);
+      word.clear();
+    }
+  }
+  return words;
+}
+
+/**
+ * SQL selecting ident, name and rowid of the items which have a word
+ * starting with each of the numWords search words, best matches first:
+ * exact idents, idents, exact name words, then names starting with the
+ * first search word. With namesOnly, idents aren't searched. Bind the
+ * words with bindSearchWords().
+ */
+string searchWordsQuery(std::size_t numWords, const string& typeFilter,
+                        bool namesOnly)
+{
+  const char* kindFilter = namesOnly ? " AND kind=1" : "";
+  std::ostringstream q;
+  q << "SELECT ident, name, positioned.rowid FROM positioned, "
+       "(SELECT item, MIN(kind * 2 + (word <> ?1)) AS rank FROM search_word "
+       "WHERE word >= ?1 AND word < ?2" << kindFilter;
+  for (std::size_t i = 1; i < numWords; ++i) {
+    q << " AND item IN (SELECT item FROM search_word WHERE word >= ?"
+      << (2 * i + 1) << " AND word < ?" << (2 * i + 2) << kindFilter << ")";
+  }
+  q << " GROUP BY item) AS matches WHERE positioned.rowid=matches.item AND "
+    << typeFilter << " ORDER BY matches.rank, name";
+  return q.str();
+}
+
+void bindSearchWords(sqlite3_stmt* stmt, const string_list& words)
+{
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    // words never contain 0xff, so this is past all words they start
+    sqlite_bind_temp_stdstring(stmt, 2 * i + 1, words[i]);
+    sqlite_bind_temp_stdstring(stmt, 2 * i + 2, words[i] + '\xff');
+  }
+}
+
 
 static string cleanRunwayNo(const string& aRwyNo)
 {
@@ -210,6 +271,13 @@ public:
     void setProgress(NavDataCache::RebuildPhase ph, unsigned int percent)
     {
         SGGuard<SGMutex> g(_lock);
+        if (ph != _phase) {
+            if (_phase != NavDataCache::REBUILD_UNKNOWN) {
+                SG_LOG(SG_NAVCACHE, SG_INFO, "rebuild phase " << _phase <<
+                       " took:" << _phaseStart.elapsedMSec() << "msec");
+            }
+            _phaseStart.stamp();
+        }
         _phase = ph;
         _completionPercent = percent;
     }
@@ -217,11 +285,61 @@ public:
 private:
   NavDataCache* _cache;
     NavDataCache::RebuildPhase _phase;
+    SGTimeStamp _phaseStart;
     unsigned int _completionPercent;
   mutable SGMutex _lock;
   bool _isFinished;
 };
 
+/**
+ * Worker used during a cache rebuild to read and tokenize one group of
+ * .dat files while the rebuild thread is busy writing another group to
+ * the database. Jobs must not access SQLite: the rebuild thread remains
+ * the only writer. An exception thrown by the job is rethrown by finish().
+ */
+class ParseThread : public SGThread
+{
+public:
+  ParseThread(std::function<void()> job) :
+    _job(job),
+    _joined(false)
+  {
+    start();
+  }
+
+  ~ParseThread()
+  {
+    // only reached without finish() when the rebuild is being unwound
+    if (!_joined) {
+      join();
+    }
+  }
+
+  virtual void run()
+  {
+    try {
+      _job();
+    } catch (...) {
+      _error = std::current_exception();
+    }
+  }
+
+  // wait for the job to complete, rethrowing its exception if any
+  void finish()
+  {
+    join();
+    _joined = true;
+    if (_error) {
+      std::rethrow_exception(_error);
+    }
+  }
+
+private:
+  std::function<void()> _job;
+  std::exception_ptr _error;
+  bool _joined;
+};
+
 ////////////////////////////////////////////////////////////////////////////
 
 typedef std::map<PositionedID, FGPositionedRef> PositionedCache;
@@ -583,7 +701,8 @@ public:
   // define a new octree node (with no children)
     insertOctree = prepare("INSERT INTO octree (rowid, children) VALUES (?1, 0)");
 
-    getOctreeLeafChildren = prepare("SELECT rowid, type FROM positioned WHERE octree_node=?1");
+    getOctreeLeafChildren = prepare("SELECT rowid, type, cart_x, cart_y, cart_z "
+                                    "FROM positioned WHERE octree_node=?1");
 
     searchAirports = prepare("SELECT ident, name FROM positioned WHERE (name LIKE ?1 OR ident LIKE ?1) " AND_TYPED);
     sqlite3_bind_int(searchAirports, 2, FGPositioned::AIRPORT);
@@ -845,6 +964,44 @@ public:
     deferredOctreeUpdates.clear();
   }
 
+  /**
+   * Index the words of the idents and names of airports, fixes and
+   * navaids, so searching them needs no scan of the positioned table.
+   */
+  void buildSearchIndex()
+  {
+    SGTimeStamp st;
+    st.stamp();
+    sqlite3_stmt_ptr items = prepare("SELECT rowid, ident, name FROM positioned WHERE "
+                                     SEARCH_TYPES);
+    sqlite3_stmt_ptr insertWord = prepare("INSERT INTO search_word (word, kind, item) "
+                                          "VALUES (?1, ?2, ?3)");
+    unsigned int numWords = 0;
+    while (stepSelect(items)) {
+      PositionedID rowid = sqlite3_column_int64(items, 0);
+      for (int kind = 0; kind < 2; ++kind) {
+        const char* text = (const char*) sqlite3_column_text(items, kind + 1);
+        string_list words = searchWords(text ? text : "");
+        // each word once per item and kind
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        BOOST_FOREACH(const std::string& word, words) {
+          sqlite_bind_stdstring(insertWord, 1, word);
+          sqlite3_bind_int(insertWord, 2, kind);
+          sqlite3_bind_int64(insertWord, 3, rowid);
+          execInsert(insertWord);
+          ++numWords;
+        }
+      }
+    }
+
+    reset(items);
+    finalize(items);
+    finalize(insertWord);
+    SG_LOG(SG_NAVCACHE, SG_INFO, "building search index (" << numWords <<
+           " words) took:" << st.elapsedMSec());
+  }
+
   void removePositionedWithIdent(FGPositioned::Type ty, const std::string& aIdent)
   {
     sqlite3_bind_int(removePOIQuery, 1, ty);
@@ -1381,37 +1538,46 @@ void NavDataCache::setRebuildPhaseProgress(RebuildPhase ph, unsigned int percent
     d->rebuilder->setProgress(ph, percent);
 }
 
-void NavDataCache::loadDatFiles(
-    DatFileType type,
-    std::function<void(const SGPath&, std::size_t, std::size_t)> loader)
+void NavDataCache::readDatFiles(
+    const DatFilesGroupInfo& datFilesInfo,
+    std::function<void(const SGPath&, std::size_t, std::size_t)> reader)
 {
   SGTimeStamp st;
-  string typeStr = datTypeStr[type];
-  string_list datFiles;
-  NavDataCache::DatFilesGroupInfo datFilesInfo = getDatFilesInfo(type);
-  const PathList datPaths = datFilesInfo.paths;
+  const string& typeStr = datTypeStr[datFilesInfo.datFileType];
+  const PathList& datPaths = datFilesInfo.paths;
   std::size_t bytesReadSoFar = 0;
 
   st.stamp();
   for (PathList::const_iterator it = datPaths.begin();
        it != datPaths.end(); it++) {
-    string path = it->realpath().utf8Str();
-    datFiles.push_back(path);
     SG_LOG(SG_GENERAL, SG_INFO,
-           "Loading " + typeStr + ".dat file: '" << path << "'");
-    loader(*it, bytesReadSoFar, datFilesInfo.totalSize);
+           "Loading " + typeStr + ".dat file: '" <<
+           it->realpath().utf8Str() << "'");
+    reader(*it, bytesReadSoFar, datFilesInfo.totalSize);
     bytesReadSoFar += it->sizeInBytes();
-    stampCacheFile(*it); // this uses the realpath() of the file
   }
 
-  // Store the list of .dat files we have loaded
-  writeOrderedStringListProperty(typeStr + ".dat files", datFiles,
-                                 SGPath::pathListSep);
   SG_LOG(SG_NAVCACHE, SG_INFO,
-         typeStr + ".dat files load took: " <<
+         typeStr + ".dat files read took: " <<
          st.elapsedMSec());
 }
 
+void NavDataCache::stampDatFiles(const DatFilesGroupInfo& datFilesInfo)
+{
+  string_list datFiles;
+  const PathList& datPaths = datFilesInfo.paths;
+
+  for (PathList::const_iterator it = datPaths.begin();
+       it != datPaths.end(); it++) {
+    datFiles.push_back(it->realpath().utf8Str());
+    stampCacheFile(*it); // this uses the realpath() of the file
+  }
+
+  // Store the list of .dat files we have loaded
+  writeOrderedStringListProperty(datTypeStr[datFilesInfo.datFileType] +
+                                 ".dat files", datFiles, SGPath::pathListSep);
+}
+
 void NavDataCache::doRebuild()
 {
   rebuildInProgress = true;
@@ -1431,10 +1597,40 @@ void NavDataCache::doRebuild()
         FixesLoader fixesLoader;
         NavLoader navLoader;
 
+        // Copies, since the readers below run concurrently with us
+        const DatFilesGroupInfo aptFilesInfo = getDatFilesInfo(DATFILETYPE_APT);
+        const DatFilesGroupInfo fixFilesInfo = getDatFilesInfo(DATFILETYPE_FIX);
+        const DatFilesGroupInfo navFilesInfo = getDatFilesInfo(DATFILETYPE_NAV);
+        std::vector<FixesLoader::FixRecordList> fixRecords(
+          fixFilesInfo.paths.size());
+        std::vector<NavLoader::NavRecordList> navRecords(
+          navFilesInfo.paths.size());
+
         using namespace std::placeholders;  // for _1, _2, _3...
 
-        loadDatFiles(DATFILETYPE_APT,
-                     std::bind(&APTLoader::readAptDatFile, &aptLoader, _1, _2, _3));
+        // Reading and tokenizing the .dat files is done on worker threads,
+        // one per file group, while this thread inserts the data into the
+        // database in the usual order (airports, fixes, navaids) so that
+        // the cross-references between them resolve as before. Declared
+        // after the data they fill in, so they are joined first.
+        ParseThread aptReader([&]() {
+          readDatFiles(aptFilesInfo,
+                       std::bind(&APTLoader::readAptDatFile, &aptLoader,
+                                 _1, _2, _3));
+        });
+        ParseThread fixReader([&]() {
+          for (std::size_t i = 0; i < fixFilesInfo.paths.size(); i++) {
+            FixesLoader::readFixes(fixFilesInfo.paths[i], fixRecords[i]);
+          }
+        });
+        ParseThread navReader([&]() {
+          for (std::size_t i = 0; i < navFilesInfo.paths.size(); i++) {
+            NavLoader::readNav(navFilesInfo.paths[i], navRecords[i]);
+          }
+        });
+
+        aptReader.finish();
+        stampDatFiles(aptFilesInfo);
 
         st.stamp();
         setRebuildPhaseProgress(REBUILD_UNKNOWN);
@@ -1448,10 +1644,29 @@ void NavDataCache::doRebuild()
         metarDataLoad(d->metarDatPath);
         stampCacheFile(d->metarDatPath);
 
-        loadDatFiles(DATFILETYPE_FIX,
-                     std::bind(&FixesLoader::loadFixes, &fixesLoader, _1, _2, _3));
-        loadDatFiles(DATFILETYPE_NAV,
-                     std::bind(&NavLoader::loadNav, &navLoader, _1, _2, _3));
+        fixReader.finish();
+        st.stamp();
+        std::size_t bytesReadSoFar = 0;
+        for (std::size_t i = 0; i < fixRecords.size(); i++) {
+          fixesLoader.loadFixRecords(fixFilesInfo.paths[i], fixRecords[i],
+                                     bytesReadSoFar, fixFilesInfo.totalSize);
+          bytesReadSoFar += fixFilesInfo.paths[i].sizeInBytes();
+          FixesLoader::FixRecordList().swap(fixRecords[i]);
+        }
+        stampDatFiles(fixFilesInfo);
+        SG_LOG(SG_NAVCACHE, SG_INFO, "loading fixes took:" << st.elapsedMSec());
+
+        navReader.finish();
+        st.stamp();
+        bytesReadSoFar = 0;
+        for (std::size_t i = 0; i < navRecords.size(); i++) {
+          navLoader.loadNavRecords(navFilesInfo.paths[i], navRecords[i],
+                                   bytesReadSoFar, navFilesInfo.totalSize);
+          bytesReadSoFar += navFilesInfo.paths[i].sizeInBytes();
+          NavLoader::NavRecordList().swap(navRecords[i]);
+        }
+        stampDatFiles(navFilesInfo);
+        SG_LOG(SG_NAVCACHE, SG_INFO, "loading navaids took:" << st.elapsedMSec());
 
         setRebuildPhaseProgress(REBUILD_UNKNOWN);
         st.stamp();
@@ -1489,6 +1704,7 @@ void NavDataCache::doRebuild()
           SG_LOG(SG_NAVCACHE, SG_INFO, "awy.dat load took:" << st.elapsedMSec());
 
           d->flushDeferredOctreeUpdates();
+          d->buildSearchIndex();
 
           string sceneryPaths = SGPath::join(globals->get_fg_scenery(), ";");
           writeStringProperty("scenery_paths", sceneryPaths);
@@ -1999,23 +2215,60 @@ void NavDataCache::defineOctreeNode(Octree::Branch* pr, Octree::Node* nd)
 #endif
 }
 
-TypedPositionedVec
+SpatialPositionedVec
 NavDataCache::getOctreeLeafChildren(int64_t octreeNodeId)
 {
   sqlite3_bind_int64(d->getOctreeLeafChildren, 1, octreeNodeId);
 
-  TypedPositionedVec r;
+  SpatialPositionedVec r;
   while (d->stepSelect(d->getOctreeLeafChildren)) {
-    FGPositioned::Type ty = static_cast<FGPositioned::Type>
+    SpatialPositioned sp;
+    sp.guid = sqlite3_column_int64(d->getOctreeLeafChildren, 0);
+    sp.type = static_cast<FGPositioned::Type>
       (sqlite3_column_int(d->getOctreeLeafChildren, 1));
-    r.push_back(std::make_pair(ty,
-                sqlite3_column_int64(d->getOctreeLeafChildren, 0)));
+    sp.cart = SGVec3d(sqlite3_column_double(d->getOctreeLeafChildren, 2),
+                      sqlite3_column_double(d->getOctreeLeafChildren, 3),
+                      sqlite3_column_double(d->getOctreeLeafChildren, 4));
+    r.push_back(sp);
   }
 
   d->reset(d->getOctreeLeafChildren);
   return r;
 }
 
+void NavDataCache::loadOctreeSnapshot()
+{
+  SGTimeStamp st;
+  st.stamp();
+
+  Octree::BranchChildrenMap branches;
+  sqlite3_stmt_ptr q = d->prepare("SELECT rowid, children FROM octree");
+  while (d->stepSelect(q)) {
+    branches[sqlite3_column_int64(q, 0)] = sqlite3_column_int(q, 1);
+  }
+  d->finalize(q);
+
+  Octree::LeafChildrenMap leaves;
+  unsigned int count = 0;
+  q = d->prepare("SELECT rowid, type, octree_node, cart_x, cart_y, cart_z "
+                 "FROM positioned WHERE octree_node IS NOT NULL");
+  while (d->stepSelect(q)) {
+    SpatialPositioned sp;
+    sp.guid = sqlite3_column_int64(q, 0);
+    sp.type = static_cast<FGPositioned::Type>(sqlite3_column_int(q, 1));
+    sp.cart = SGVec3d(sqlite3_column_double(q, 3),
+                      sqlite3_column_double(q, 4),
+                      sqlite3_column_double(q, 5));
+    leaves[sqlite3_column_int64(q, 2)].push_back(sp);
+    ++count;
+  }
+  d->finalize(q);
+
+  Octree::global_spatialOctree->loadSnapshot(branches, leaves);
+  SG_LOG(SG_NAVCACHE, SG_INFO, "loaded octree snapshot (" << count <<
+         " items) in " << st.elapsedMSec() << "msec");
+}
+
 
 /**
  * A special purpose helper (used by FGAirport::searchNamesAndIdents) to
@@ -2027,12 +2280,27 @@ char** NavDataCache::searchAirportNamesAndIdents(const std::string& aFilter)
   sqlite3_stmt_ptr stmt;
   unsigned int numMatches = 0, numAllocated = 16;
   string searchTerm("%" + aFilter + "%");
+  string_list words(searchWords(aFilter));
+  SGTimeStamp st;
+  st.stamp();
   if (aFilter.empty()) {
     stmt = d->getAllAirports;
     numAllocated = 4096; // start much larger for all airports
-  } else {
+  } else if (words.empty()) {
+    // nothing to look up in the search index, fall back to a scan
     stmt = d->searchAirports;
     sqlite_bind_stdstring(stmt, 1, searchTerm);
+  } else {
+    std::ostringstream types;
+    types << "type>=" << FGPositioned::AIRPORT << " AND type<=" << FGPositioned::SEAPORT;
+    string sql = searchWordsQuery(words.size(), types.str(), false);
+    stmt = d->findByStringDict[sql];
+    if (!stmt) {
+      stmt = d->prepare(sql);
+      d->findByStringDict[sql] = stmt;
+    }
+
+    bindSearchWords(stmt, words);
   }
 
   char** result = (char**) malloc(sizeof(char*) * numAllocated);
@@ -2075,6 +2343,8 @@ char** NavDataCache::searchAirportNamesAndIdents(const std::string& aFilter)
 
   result[numMatches] = NULL; // end of list marker
   d->reset(stmt);
+  SG_LOG(SG_NAVCACHE, SG_DEBUG, "searching airports for '" << aFilter << "': " <<
+         numMatches << " matches in " << st.elapsedUSec() << "usec");
   return result;
 }
 
@@ -2283,6 +2553,34 @@ AirwayEdgeVec NavDataCache::airwayEdgesFrom(int network, PositionedID pos)
   return result;
 }
 
+AirwayNetworkEdgeVec NavDataCache::airwayNetworkEdges(int network)
+{
+  sqlite3_stmt_ptr q = d->prepare("SELECT e.airway, e.a, e.b, "
+                                  "pa.cart_x, pa.cart_y, pa.cart_z, "
+                                  "pb.cart_x, pb.cart_y, pb.cart_z "
+                                  "FROM airway_edge AS e, positioned AS pa, positioned AS pb "
+                                  "WHERE e.network=?1 AND pa.rowid=e.a AND pb.rowid=e.b");
+  sqlite3_bind_int(q, 1, network);
+
+  AirwayNetworkEdgeVec result;
+  while (d->stepSelect(q)) {
+    AirwayNetworkEdge e;
+    e.airway = sqlite3_column_int(q, 0);
+    e.from = sqlite3_column_int64(q, 1);
+    e.to = sqlite3_column_int64(q, 2);
+    e.fromCart = SGVec3d(sqlite3_column_double(q, 3),
+                         sqlite3_column_double(q, 4),
+                         sqlite3_column_double(q, 5));
+    e.toCart = SGVec3d(sqlite3_column_double(q, 6),
+                       sqlite3_column_double(q, 7),
+                       sqlite3_column_double(q, 8));
+    result.push_back(e);
+  }
+
+  d->finalize(q);
+  return result;
+}
+
 PositionedIDVec NavDataCache::airwayWaypts(int id)
 {
     sqlite3_bind_int(d->airwayEdges, 1, id);
@@ -2409,18 +2707,21 @@ class NavDataCache::ThreadedGUISearch::ThreadedGUISearchPrivate : public SGThrea
 public:
     ThreadedGUISearchPrivate() :
         db(NULL),
+        resultColumn(0),
         isComplete(false),
         quit(false)
     {}
 
     virtual void run()
     {
+        SGTimeStamp st;
+        st.stamp();
         while (!quit) {
             int err = sqlite3_step(query);
             if (err == SQLITE_DONE) {
                 break;
             } else if (err == SQLITE_ROW) {
-                PositionedID r = sqlite3_column_int64(query, 0);
+                PositionedID r = sqlite3_column_int64(query, resultColumn);
                 SGGuard<SGMutex> g(lock);
                 results.push_back(r);
             } else if (err == SQLITE_BUSY) {
@@ -2434,11 +2735,14 @@ public:
 
         SGGuard<SGMutex> g(lock);
         isComplete = true;
+        SG_LOG(SG_NAVCACHE, SG_DEBUG, "threaded search: " << results.size() <<
+               " matches in " << st.elapsedUSec() << "usec");
     }
 
     SGMutex lock;
     sqlite3* db;
     sqlite3_stmt_ptr query;
+    int resultColumn;   // of the rowid
     PositionedIDVec results;
     bool isComplete;
     bool quit;
@@ -2452,9 +2756,20 @@ NavDataCache::ThreadedGUISearch::ThreadedGUISearch(const std::string& term) :
     std::string pathUtf8 = p.utf8Str();
     sqlite3_open_v2(pathUtf8.c_str(), &d->db, openFlags, NULL);
 
-    std::string sql = "SELECT rowid FROM positioned WHERE name LIKE '%" + term
-        + "%' AND ((type >= 1 AND type <= 3) OR ((type >= 9 AND type <= 11))) ";
-    sqlite3_prepare_v2(d->db, sql.c_str(), sql.length(), &d->query, NULL);
+    string_list words(searchWords(term));
+    if (words.empty()) {
+        // nothing to look up in the search index, fall back to a scan
+        std::string sql = "SELECT rowid FROM positioned WHERE name LIKE ?1 AND " SEARCH_TYPES;
+        sqlite3_prepare_v2(d->db, sql.c_str(), sql.length(), &d->query, NULL);
+        sqlite_bind_temp_stdstring(d->query, 1, "%" + term + "%");
+    } else {
+        // ranked, so the results the launcher shows first are the best ones.
+        // Idents aren't searched, the launcher looks those up itself.
+        std::string sql = searchWordsQuery(words.size(), SEARCH_TYPES, true);
+        sqlite3_prepare_v2(d->db, sql.c_str(), sql.length(), &d->query, NULL);
+        bindSearchWords(d->query, words);
+        d->resultColumn = 2;
+    }
 
     d->start();
 }
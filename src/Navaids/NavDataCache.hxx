@@ -44,10 +44,30 @@ typedef std::pair<PositionedID, PositionedID> AirportRunwayPair;
 typedef std::pair<FGPositioned::Type, PositionedID> TypedPositioned;
 typedef std::vector<TypedPositioned> TypedPositionedVec;
 
+/// a positioned item in the spatial index, with its type and position
+struct SpatialPositioned
+{
+  FGPositioned::Type type;
+  PositionedID guid;
+  SGVec3d cart;
+};
+
+typedef std::vector<SpatialPositioned> SpatialPositionedVec;
+
 // pair of airway ID, destination node ID
 typedef std::pair<int, PositionedID> AirwayEdge;
 typedef std::vector<AirwayEdge> AirwayEdgeVec;
 
+/// an edge of an airway network, with the position of both end points
+struct AirwayNetworkEdge
+{
+  int airway;
+  PositionedID from, to;
+  SGVec3d fromCart, toCart;
+};
+
+typedef std::vector<AirwayNetworkEdge> AirwayNetworkEdgeVec;
+
 namespace Octree {
   class Node;
   class Branch;
@@ -263,9 +283,17 @@ public:
   void defineOctreeNode(Octree::Branch* pr, Octree::Node* nd);
 
   /**
-   * given an octree leaf, return all its child positioned items and their types
+   * given an octree leaf, return all its child positioned items, with their
+   * types and positions
    */
-  TypedPositionedVec getOctreeLeafChildren(int64_t octreeNodeId);
+  SpatialPositionedVec getOctreeLeafChildren(int64_t octreeNodeId);
+
+  /**
+   * Load the whole spatial index into memory at once, including the
+   * position of each item, so that spatial searches never query the
+   * database for octree nodes, and only load the items they return.
+   */
+  void loadOctreeSnapshot();
 
 // airways
   int findAirway(int network, const std::string& aName);
@@ -287,6 +315,12 @@ public:
    */
   AirwayEdgeVec airwayEdgesFrom(int network, PositionedID pos);
 
+  /**
+   * retrieve all the edges of a network at once, so it can be searched
+   * in memory
+   */
+  AirwayNetworkEdgeVec airwayNetworkEdges(int network);
+
     /**
      * Waypoints on the airway
      */
@@ -324,10 +358,14 @@ private:
 
   friend class RebuildThread;
 
-  // A generic function for loading all navigation data files of the
-  // specified type (apt/fix/nav etc.) using the passed type-specific loader.
-  void loadDatFiles(DatFileType type,
-                    std::function<void(const SGPath&, std::size_t, std::size_t)> loader);
+  // A generic function for reading all navigation data files of the
+  // specified group (apt/fix/nav etc.) using the passed type-specific
+  // reader. This doesn't touch the database, hence may run on any thread.
+  static void readDatFiles(const DatFilesGroupInfo& datFilesInfo,
+                           std::function<void(const SGPath&, std::size_t, std::size_t)> reader);
+
+  // Record in the cache the files previously read with readDatFiles()
+  void stampDatFiles(const DatFilesGroupInfo& datFilesInfo);
 
   void doRebuild();
 
@@ -33,8 +33,6 @@
 #include <cstring> // for memset
 #include <iostream>
 
-#include <boost/foreach.hpp>
-
 #include <simgear/debug/logstream.hxx>
 #include <simgear/structure/exception.hxx>
 #include <simgear/timing/timestamp.hxx>
@@ -47,6 +45,21 @@ namespace Octree
   
 Node* global_spatialOctree = NULL;
 
+static bool orderByType(const SpatialPositioned& a, const SpatialPositioned& b)
+{
+  return a.type < b.type;
+}
+
+static bool typeLess(const SpatialPositioned& a, FGPositioned::Type ty)
+{
+  return a.type < ty;
+}
+
+static bool lessType(FGPositioned::Type ty, const SpatialPositioned& a)
+{
+  return ty < a.type;
+}
+
 
 void Node::addPolyLine(const PolyLineRef& aLine)
 {
@@ -84,11 +97,20 @@ void Leaf::visit(const SGVec3d& aPos, double aCutoff,
   
   loadChildren();
   
-  ChildMap::const_iterator it = children.lower_bound(aFilter->minType());
-  ChildMap::const_iterator end = children.upper_bound(aFilter->maxType());
+  SpatialPositionedVec::const_iterator it =
+    std::lower_bound(children.begin(), children.end(),
+                     aFilter->minType(), typeLess);
+  SpatialPositionedVec::const_iterator end =
+    std::upper_bound(it, children.end(), aFilter->maxType(), lessType);
   
   for (; it != end; ++it) {
-    FGPositioned* p = cache->loadById(it->second);
+    if (dist(aPos, it->cart) > aCutoff) {
+      continue; // don't load what is out of range
+    }
+
+    // the item may have moved slightly since it was indexed, see
+    // NavDataCache::updatePosition
+    FGPositioned* p = cache->loadById(it->guid);
     double d = dist(aPos, p->cart());
     if (d > aCutoff) {
       continue;
@@ -115,10 +137,12 @@ void Leaf::visit(const SGVec3d& aPos, double aCutoff,
                      aResults.begin() + previousResultsSize, aResults.end());
 }
 
-void Leaf::insertChild(FGPositioned::Type ty, PositionedID id)
+void Leaf::insertChild(const SpatialPositioned& aChild)
 {
   assert(childrenLoaded);
-  children.insert(children.end(), TypedPositioned(ty, id));
+  children.insert(std::upper_bound(children.begin(), children.end(),
+                                   aChild, orderByType),
+                  aChild);
 }
   
 void Leaf::loadChildren()
@@ -127,13 +151,31 @@ void Leaf::loadChildren()
     return;
   }
   
-  NavDataCache* cache = NavDataCache::instance();
-  BOOST_FOREACH(TypedPositioned tp, cache->getOctreeLeafChildren(guid())) {
-    children.insert(children.end(), tp);
-  } // of leaf members iteration
-  
+  SpatialPositionedVec c(NavDataCache::instance()->getOctreeLeafChildren(guid()));
+  setChildren(c);
+}
+
+void Leaf::setChildren(SpatialPositionedVec& aChildren)
+{
+  children.swap(aChildren);
+  std::stable_sort(children.begin(), children.end(), orderByType);
   childrenLoaded = true;
 }
+
+void Leaf::loadSnapshot(const BranchChildrenMap&, LeafChildrenMap& aLeaves)
+{
+  if (childrenLoaded) {
+    return;
+  }
+
+  LeafChildrenMap::iterator it = aLeaves.find(guid());
+  if (it == aLeaves.end()) {
+    SpatialPositionedVec none;
+    setChildren(none);
+  } else {
+    setChildren(it->second);
+  }
+}
     
 ///////////////////////////////////////////////////////////////////////////////
     
@@ -284,6 +326,28 @@ void Branch::loadChildren() const
   childrenLoaded = true;
 }
   
+void Branch::loadSnapshot(const BranchChildrenMap& aBranches,
+                          LeafChildrenMap& aLeaves)
+{
+  if (!childrenLoaded) {
+    BranchChildrenMap::const_iterator it = aBranches.find(guid());
+    int childrenMask = (it == aBranches.end()) ? 0 : it->second;
+    for (int i=0; i<8; ++i) {
+      if ((1 << i) & childrenMask) {
+        childAtIndex(i);
+      }
+    }
+
+    childrenLoaded = true;
+  }
+
+  for (int i=0; i<8; ++i) {
+    if (children[i]) {
+      children[i]->loadSnapshot(aBranches, aLeaves);
+    }
+  }
+}
+
 int Branch::childMask() const
 {
   int result = 0;
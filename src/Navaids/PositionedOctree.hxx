@@ -30,6 +30,7 @@
 #include <queue>
 #include <cassert>
 #include <map>
+#include <unordered_map>
 #include <functional>
 
 // SimGear
@@ -119,6 +120,11 @@ namespace Octree
 
   extern Node* global_spatialOctree;
 
+  // child masks of all branches, and children of all leaves, keyed by node
+  // ID: the whole index as read by NavDataCache::loadOctreeSnapshot()
+  typedef std::unordered_map<int64_t, int> BranchChildrenMap;
+  typedef std::unordered_map<int64_t, SpatialPositionedVec> LeafChildrenMap;
+
   class Leaf;
 
   /**
@@ -156,6 +162,14 @@ namespace Octree
 
     virtual Node* findNodeForBox(const SGBoxd& box) const;
 
+    /**
+     * Define the children of this node and all its descendants from the
+     * snapshot, instead of loading them lazily from the cache. Leaf children
+     * are moved out of the snapshot.
+     */
+    virtual void loadSnapshot(const BranchChildrenMap& aBranches,
+                              LeafChildrenMap& aLeaves) = 0;
+
     virtual ~Node() {}
 
     void addPolyLine(const PolyLineRef&);
@@ -186,15 +200,20 @@ namespace Octree
       return const_cast<Leaf*>(this);
     }
 
-    void insertChild(FGPositioned::Type ty, PositionedID id);
+    virtual void loadSnapshot(const BranchChildrenMap& aBranches,
+                              LeafChildrenMap& aLeaves);
+
+    void insertChild(const SpatialPositioned& aChild);
 
   private:
     bool childrenLoaded;
 
-    typedef std::multimap<FGPositioned::Type, PositionedID> ChildMap;
-    ChildMap children;
+    // sorted by type, so filters can skip to the types they accept. The
+    // positions are kept here so items out of range are never loaded.
+    SpatialPositionedVec children;
 
     void loadChildren();
+    void setChildren(SpatialPositionedVec& aChildren);
   };
 
   class Branch : public Node
@@ -220,6 +239,9 @@ namespace Octree
 
     virtual Node* findNodeForBox(const SGBoxd& box) const;
 
+    virtual void loadSnapshot(const BranchChildrenMap& aBranches,
+                              LeafChildrenMap& aLeaves);
+
   private:
     Node* childForPos(const SGVec3d& aCart) const;
     Node* childAtIndex(int childIndex) const;
@@ -28,6 +28,7 @@
 #include <simgear/structure/exception.hxx>
 #include <simgear/io/iostreams/sgstream.hxx>
 #include <simgear/misc/sg_path.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include <boost/foreach.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -49,45 +50,11 @@ namespace flightgear
 
 //////////////////////////////////////////////////////////////////////////////
 
-class AStarOpenNode : public SGReferenced
+Airway::Network::Network() :
+  _networkID(0),
+  _graphLoaded(false)
 {
-public:
-  AStarOpenNode(FGPositionedRef aNode, double aLegDist, 
-    int aAirway,
-    FGPositionedRef aDest, AStarOpenNode* aPrev) :
-    node(aNode),
-    airway(aAirway),
-    previous(aPrev)
-  { 
-    distanceFromStart = aLegDist;
-    if (previous) {
-      distanceFromStart +=  previous->distanceFromStart;
-    }
-    
-		directDistanceToDestination = SGGeodesy::distanceM(node->geod(), aDest->geod());
-  }
-  
-  virtual ~AStarOpenNode()
-  {
-  }
-  
-  FGPositionedRef node;
-  int airway;
-  SGSharedPtr<AStarOpenNode> previous;
-  double distanceFromStart; // aka 'g(x)'
-  double directDistanceToDestination; // aka 'h(x)'
-  
-  /**
-	 * aka 'f(x)'
-	 */
-	double totalCost() const {
-		return distanceFromStart + directDistanceToDestination;
-	}
-};
-
-typedef SGSharedPtr<AStarOpenNode> AStarOpenNodeRef;
-
-////////////////////////////////////////////////////////////////////////////
+}
 
 Airway::Network* Airway::lowLevel()
 {
@@ -277,6 +244,7 @@ void Airway::Network::addEdge(int aWay, const SGGeod& aStartPos,
   }
   
   NavDataCache::instance()->insertEdge(_networkID, aWay, start->guid(), end->guid());
+  _graphLoaded = false;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -413,114 +381,244 @@ Airway::Network::findClosestNode(const SGGeod& aGeod)
 
 /////////////////////////////////////////////////////////////////////////////
 
-typedef vector<AStarOpenNodeRef> OpenNodeHeap;
-
-static void buildWaypoints(AStarOpenNodeRef aNode, WayptVec& aRoute)
-{
-// count the route length, and hence pre-size aRoute
-  int count = 0;
-  AStarOpenNodeRef n = aNode;
-  for (; n != NULL; ++count, n = n->previous) {;}
-  aRoute.resize(count);
-  
-// run over the route, creating waypoints
-  for (n = aNode; n; n=n->previous) {
-    aRoute[--count] = new NavaidWaypoint(n->node, NULL);
-  }
-}
-
 /**
- * Inefficent (linear) helper to find an open node in the heap
+ * Binary heap of node indices, ordered by cost, which tracks where each
+ * node is stored so that its cost can be decreased in place.
  */
-static AStarOpenNodeRef
-findInOpen(const OpenNodeHeap& aHeap, FGPositioned* aPos)
+class IndexedNodeHeap
 {
-  for (unsigned int i=0; i<aHeap.size(); ++i) {
-    if (aHeap[i]->node == aPos) {
-      return aHeap[i];
+public:
+  IndexedNodeHeap(size_t aNodeCount) :
+    _position(aNodeCount, -1)
+  {
+  }
+
+  bool empty() const
+  { return _heap.empty(); }
+
+  /**
+   * Insert the node, or lower its cost if it's in the heap already
+   */
+  void update(int aNode, double aCost)
+  {
+    int pos = _position[aNode];
+    if (pos < 0) {
+      pos = _heap.size();
+      _heap.push_back(Entry());
+    } else if (aCost >= _heap[pos].cost) {
+      return;
     }
+
+    siftUp(pos, Entry(aCost, aNode));
   }
-  
-  return NULL;
-}
 
-class HeapOrder
-{
-public:
-  bool operator()(AStarOpenNode* a, AStarOpenNode* b)
+  /**
+   * Remove and return the node with the lowest cost
+   */
+  int pop()
   {
-    return a->totalCost() > b->totalCost();
+    int node = _heap.front().node;
+    _position[node] = -1;
+    Entry last = _heap.back();
+    _heap.pop_back();
+    if (!_heap.empty()) {
+      siftDown(0, last);
+    }
+    return node;
   }
+
+private:
+  struct Entry
+  {
+    Entry(double aCost = 0.0, int aNode = -1) : cost(aCost), node(aNode) {}
+    double cost;
+    int node;
+  };
+
+  void place(size_t aPos, const Entry& aEntry)
+  {
+    _heap[aPos] = aEntry;
+    _position[aEntry.node] = aPos;
+  }
+
+  void siftUp(size_t aPos, const Entry& aEntry)
+  {
+    while (aPos > 0) {
+      size_t parent = (aPos - 1) / 2;
+      if (_heap[parent].cost <= aEntry.cost) {
+        break;
+      }
+      place(aPos, _heap[parent]);
+      aPos = parent;
+    }
+    place(aPos, aEntry);
+  }
+
+  void siftDown(size_t aPos, const Entry& aEntry)
+  {
+    const size_t count = _heap.size();
+    for (;;) {
+      size_t child = 2 * aPos + 1;
+      if (child >= count) {
+        break;
+      }
+      if ((child + 1 < count) && (_heap[child + 1].cost < _heap[child].cost)) {
+        ++child;
+      }
+      if (aEntry.cost <= _heap[child].cost) {
+        break;
+      }
+      place(aPos, _heap[child]);
+      aPos = child;
+    }
+    place(aPos, aEntry);
+  }
+
+  std::vector<Entry> _heap;
+  std::vector<int> _position; // of each node in _heap, or -1
 };
 
+void Airway::Network::loadGraph()
+{
+  SGTimeStamp st;
+  st.stamp();
+
+  AirwayNetworkEdgeVec raw = NavDataCache::instance()->airwayNetworkEdges(_networkID);
+
+  _nodeIds.clear();
+  _nodeCarts.clear();
+  _nodeIndex.clear();
+  std::vector<int> from(raw.size()), to(raw.size());
+  for (size_t i = 0; i < raw.size(); ++i) {
+    std::pair<std::unordered_map<PositionedID, int>::iterator, bool> ins;
+    ins = _nodeIndex.insert(make_pair(raw[i].from, (int) _nodeIds.size()));
+    if (ins.second) {
+      _nodeIds.push_back(raw[i].from);
+      _nodeCarts.push_back(raw[i].fromCart);
+    }
+    from[i] = ins.first->second;
+
+    ins = _nodeIndex.insert(make_pair(raw[i].to, (int) _nodeIds.size()));
+    if (ins.second) {
+      _nodeIds.push_back(raw[i].to);
+      _nodeCarts.push_back(raw[i].toCart);
+    }
+    to[i] = ins.first->second;
+  }
+
+  // the heuristic uses the positions at sea level: the chord between two
+  // points on the ellipsoid is never longer than the geodesic joining
+  // them, while the elevation of navaids could make it longer
+  std::vector<SGGeod> geods(_nodeCarts.size());
+  for (size_t i = 0; i < _nodeCarts.size(); ++i) {
+    geods[i] = SGGeod::fromGeodM(SGGeod::fromCart(_nodeCarts[i]), 0.0);
+    _nodeCarts[i] = SGVec3d::fromGeod(geods[i]);
+  }
+
+  // count the edges of every node, then place them
+  _edgeStart.assign(_nodeIds.size() + 1, 0);
+  for (size_t i = 0; i < raw.size(); ++i) {
+    _edgeStart[from[i] + 1]++;
+  }
+  for (size_t i = 0; i < _nodeIds.size(); ++i) {
+    _edgeStart[i + 1] += _edgeStart[i];
+  }
+
+  _edges.resize(raw.size());
+  std::vector<int> fill(_edgeStart.begin(), _edgeStart.end() - 1);
+  for (size_t i = 0; i < raw.size(); ++i) {
+    Edge& e = _edges[fill[from[i]]++];
+    e.target = to[i];
+    e.airway = raw[i].airway;
+    e.distanceM = SGGeodesy::distanceM(geods[from[i]], geods[to[i]]);
+  }
+
+  _graphLoaded = true;
+  SG_LOG(SG_NAVAID, SG_INFO, "loaded airway network " << _networkID << " ("
+         << _nodeIds.size() << " nodes, " << _edges.size() << " edges) in "
+         << st.elapsedMSec() << "msec");
+}
+
 bool Airway::Network::search2(FGPositionedRef aStart, FGPositionedRef aDest,
   WayptVec& aRoute)
-{  
-  typedef set<PositionedID> ClosedNodeSet;
-  
-  OpenNodeHeap openNodes;
-  ClosedNodeSet closedNodes;
-  HeapOrder ordering;
-  
-  openNodes.push_back(new AStarOpenNode(aStart, 0.0, 0, aDest, NULL));
-  
+{
+  if (aStart == aDest) {
+    aRoute.clear();
+    aRoute.push_back(new NavaidWaypoint(aStart, NULL));
+    return true;
+  }
+
+  if (!_graphLoaded) {
+    loadGraph();
+  }
+
+  std::unordered_map<PositionedID, int>::const_iterator it;
+  it = _nodeIndex.find(aStart->guid());
+  if (it == _nodeIndex.end()) {
+    SG_LOG(SG_NAVAID, SG_INFO, "A* failed to find route");
+    return false;
+  }
+  const int start = it->second;
+  it = _nodeIndex.find(aDest->guid());
+  if (it == _nodeIndex.end()) {
+    SG_LOG(SG_NAVAID, SG_INFO, "A* failed to find route");
+    return false;
+  }
+  const int dest = it->second;
+
+  // the straight line through the earth between sea level positions is
+  // never longer than the geodesic distance along the edges, so h(x) is
+  // admissible (and consistent, being a metric)
+  const SGVec3d& destCart = _nodeCarts[dest];
+  const size_t nodeCount = _nodeIds.size();
+  std::vector<double> distanceFromStart(nodeCount, HUGE_VAL); // aka 'g(x)'
+  std::vector<int> previous(nodeCount, -1);
+  std::vector<bool> closed(nodeCount, false);
+  IndexedNodeHeap openNodes(nodeCount);
+
+  distanceFromStart[start] = 0.0;
+  openNodes.update(start, dist(_nodeCarts[start], destCart));
+
 // A* open node iteration
   while (!openNodes.empty()) {
-    std::pop_heap(openNodes.begin(), openNodes.end(), ordering);
-    AStarOpenNodeRef x = openNodes.back();
-    FGPositioned* xp = x->node;    
-    openNodes.pop_back();
-    closedNodes.insert(xp->guid());
-  
+    int x = openNodes.pop();
+    closed[x] = true;
+
 #ifdef DEBUG_AWY_SEARCH
-    SG_LOG(SG_NAVAID, SG_INFO, "x:" << xp->ident() << ", f(x)=" << x->totalCost());
+    SG_LOG(SG_NAVAID, SG_INFO, "x:" << _nodeIds[x] << ", g(x)=" << distanceFromStart[x]);
 #endif
-    
-  // check if xp is the goal; if so we're done, since there cannot be an open
+
+  // check if x is the goal; if so we're done, since there cannot be an open
   // node with lower f(x) value.
-    if (xp == aDest) {
-      buildWaypoints(x, aRoute);
+    if (x == dest) {
+      std::vector<int> path;
+      for (int n = x; n >= 0; n = previous[n]) {
+        path.push_back(n);
+      }
+
+      NavDataCache* cache = NavDataCache::instance();
+      aRoute.clear();
+      for (std::vector<int>::reverse_iterator p = path.rbegin(); p != path.rend(); ++p) {
+        aRoute.push_back(new NavaidWaypoint(cache->loadById(_nodeIds[*p]), NULL));
+      }
       return true;
     }
-    
+
   // adjacent (neighbour) iteration
-    NavDataCache* cache = NavDataCache::instance();
-    BOOST_FOREACH(AirwayEdge other, cache->airwayEdgesFrom(_networkID, xp->guid())) {
-      if (closedNodes.count(other.second)) {
+    for (int i = _edgeStart[x]; i < _edgeStart[x + 1]; ++i) {
+      const Edge& e = _edges[i];
+      if (closed[e.target]) {
         continue; // closed, ignore
       }
 
-      FGPositioned* yp = cache->loadById(other.second);
-      double edgeDistanceM = SGGeodesy::distanceM(xp->geod(), yp->geod());
-      AStarOpenNodeRef y = findInOpen(openNodes, yp);
-      if (y) { // already open
-        double g = x->distanceFromStart + edgeDistanceM;
-        if (g > y->distanceFromStart) {
-          // worse path, ignore
-#ifdef DEBUG_AWY_SEARCH
-          SG_LOG(SG_NAVAID, SG_INFO, "\tabandoning " << yp->ident() <<
-           " path is worse: g(y)" << y->distanceFromStart << ", g'=" << g);
-#endif
-          continue;
-        }
-        
-      // we need to update y. Unfortunately this means rebuilding the heap,
-      // since y's score can change arbitrarily
-#ifdef DEBUG_AWY_SEARCH
-        SG_LOG(SG_NAVAID, SG_INFO, "\tfixing up previous for new path to " << yp->ident() << ", d =" << g);
-#endif
-        y->previous = x;
-        y->distanceFromStart = g;
-        y->airway = other.first;
-        std::make_heap(openNodes.begin(), openNodes.end(), ordering);
-      } else { // not open, insert a new node for y into the heap
-        y = new AStarOpenNode(yp, edgeDistanceM, other.first, aDest, x);
-#ifdef DEBUG_AWY_SEARCH
-        SG_LOG(SG_NAVAID, SG_INFO, "\ty=" << yp->ident() << ", f(y)=" << y->totalCost());
-#endif
-        openNodes.push_back(y);
-        std::push_heap(openNodes.begin(), openNodes.end(), ordering);
+      double g = distanceFromStart[x] + e.distanceM;
+      if (g >= distanceFromStart[e.target]) {
+        continue; // worse path, ignore
       }
+
+      distanceFromStart[e.target] = g;
+      previous[e.target] = x;
+      openNodes.update(e.target, g + dist(_nodeCarts[e.target], destCart));
     } // of neighbour iteration
   } // of open node iteration
   
@@ -21,6 +21,7 @@
 #define FG_AIRWAYS_HXX
 
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <Navaids/route.hxx>
@@ -69,6 +70,8 @@ public:
   public:
     friend class Airway;
     friend class InAirwayFilter;
+
+    Network();
     
   
     /**
@@ -93,6 +96,27 @@ public:
                             bool exactTo, bool exactFrom);
       
     bool search2(FGPositionedRef aStart, FGPositionedRef aDest, WayptVec& aRoute);
+
+    /**
+     * The network in memory, loaded from the cache on the first search:
+     * the nodes with their position at sea level, and the edges leaving node i at
+     * _edges[_edgeStart[i] .. _edgeStart[i+1]).
+     */
+    struct Edge
+    {
+      int target;
+      int airway;
+      double distanceM;
+    };
+
+    void loadGraph();
+
+    bool _graphLoaded;
+    std::vector<PositionedID> _nodeIds;
+    std::vector<SGVec3d> _nodeCarts;
+    std::vector<int> _edgeStart;
+    std::vector<Edge> _edges;
+    std::unordered_map<PositionedID, int> _nodeIndex;
   
     /**
      * Test if a positioned item is part of this airway network or not.
@@ -67,6 +67,13 @@ FixesLoader::~FixesLoader()
 // Load fixes from the specified fix.dat (or fix.dat.gz) file
 void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
                             std::size_t totalSizeOfAllDatFiles)
+{
+  FixRecordList records;
+  readFixes(path, records);
+  loadFixRecords(path, records, bytesReadSoFar, totalSizeOfAllDatFiles);
+}
+
+void FixesLoader::readFixes(const SGPath& path, FixRecordList& records)
 {
   sg_gzifstream in( path );
   const std::string utf8path = path.utf8Str();
@@ -116,7 +123,6 @@ void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
              "(expected 3 or 5 or 6 fields, but got " << fields.size() << ")");
     }
 
-    std::string ident = fields[2];
     double lat, lon;
     try {
       lat = std::stod(fields[0]);
@@ -127,35 +133,53 @@ void FixesLoader::loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
              " " << fields[1]);
       continue;
     }
-    SGGeod pos(SGGeod::fromDeg(lon, lat));
+
+    FixRecord record;
+    record.lineNumber = lineNumber;
+    record.ident = fields[2];
+    record.pos = SGGeod::fromDeg(lon, lat);
+    records.push_back(record);
+  }
+
+  throwExceptionIfStreamError(in, path);
+}
+
+void FixesLoader::loadFixRecords(const SGPath& path,
+                                 const FixRecordList& records,
+                                 std::size_t bytesReadSoFar,
+                                 std::size_t totalSizeOfAllDatFiles)
+{
+  const std::string utf8path = path.utf8Str();
+  const std::size_t fileSize = path.sizeInBytes();
+
+  for (std::size_t i = 0; i < records.size(); i++) {
+    const FixRecord& record = records[i];
     bool duplicate = false;
-    auto range = _loadedFixes.equal_range(ident);
+    auto range = _loadedFixes.equal_range(record.ident);
     for (auto it = range.first; it != range.second; ++it) {
-      double distNm = dist(SGVec3d::fromGeod(pos),
+      double distNm = dist(SGVec3d::fromGeod(record.pos),
                            SGVec3d::fromGeod(it->second)) * SG_METER_TO_NM;
       if (distNm < DUPLICATE_DETECTION_RADIUS_NM) {
         SG_LOG(SG_NAVAID, SG_INFO,
-               utf8path << ":"  << lineNumber << ": skipping fix " <<
-               ident << " (already defined nearby)");
+               utf8path << ":"  << record.lineNumber << ": skipping fix " <<
+               record.ident << " (already defined nearby)");
         duplicate = true;
         break;
       }
     }
 
     if (!duplicate) {
-      _cache->insertFix(ident, pos);
-      _loadedFixes.insert({ident, pos});
+      _cache->insertFix(record.ident, record.pos);
+      _loadedFixes.insert({record.ident, record.pos});
     }
 
-    if ((lineNumber % 100) == 0) {
-      // every 100 lines
-      unsigned int percent = ((bytesReadSoFar + in.approxOffset()) * 100)
-        / totalSizeOfAllDatFiles;
+    if ((i % 100) == 0) {
+      // every 100 records, assuming they are spread evenly over the file
+      unsigned int percent = ((bytesReadSoFar + fileSize * i / records.size())
+                              * 100) / totalSizeOfAllDatFiles;
       _cache->setRebuildPhaseProgress(NavDataCache::REBUILD_FIXES, percent);
     }
   }
-
-  throwExceptionIfStreamError(in, path);
 }
 
 void FixesLoader::throwExceptionIfStreamError(
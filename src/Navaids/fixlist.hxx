@@ -29,6 +29,7 @@
 #include <simgear/math/SGGeod.hxx>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 class SGPath;
 class sg_gzifstream;
@@ -40,6 +41,16 @@ namespace flightgear
   class FixesLoader
   {
   public:
+    // One fix read from a fix.dat file
+    struct FixRecord
+    {
+      unsigned int lineNumber;
+      std::string ident;
+      SGGeod pos;
+    };
+
+    typedef std::vector<FixRecord> FixRecordList;
+
     FixesLoader();
     ~FixesLoader();
 
@@ -47,9 +58,18 @@ namespace flightgear
     void loadFixes(const SGPath& path, std::size_t bytesReadSoFar,
                    std::size_t totalSizeOfAllDatFiles);
 
+    // Tokenize the specified fix.dat (or fix.dat.gz) file into 'records'.
+    // Does not access the NavDataCache, so it may run on any thread.
+    static void readFixes(const SGPath& path, FixRecordList& records);
+
+    // Load fixes read by readFixes() from 'path' into the NavDataCache
+    void loadFixRecords(const SGPath& path, const FixRecordList& records,
+                        std::size_t bytesReadSoFar,
+                        std::size_t totalSizeOfAllDatFiles);
+
   private:
-    void throwExceptionIfStreamError(const sg_gzifstream& input_stream,
-                                     const SGPath& path);
+    static void throwExceptionIfStreamError(const sg_gzifstream& input_stream,
+                                            const SGPath& path);
 
     NavDataCache* _cache;
     std::unordered_multimap<std::string, SGGeod> _loadedFixes;
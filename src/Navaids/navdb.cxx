@@ -157,17 +157,30 @@ PositionedID NavLoader::processNavLine(
   const string& line, const string& utf8Path, unsigned int lineNum,
   FGPositioned::Type type, unsigned long version)
 {
-  NavDataCache* cache = NavDataCache::instance();
-  int rowCode, elev_ft, freq, range;
-  // 'multiuse': different meanings depending on the record's row code
-  double lat, lon, multiuse;
+  NavRecord record;
+  if (!parseNavLine(line, utf8Path, lineNum, version, record)) {
+    return 0;
+  }
+
+  return processNavRecord(record, utf8Path, type);
+}
+
+// Split a line from a file such as nav.dat or carrier_nav.dat into its
+// fields. This does not access the NavDataCache.
+bool NavLoader::parseNavLine(
+  const string& line, const string& utf8Path, unsigned int lineNum,
+  unsigned long version, NavRecord& record)
+{
+  int& rowCode = record.rowCode;
+  double& multiuse = record.multiuse;
   // Short identifier and longer name for a navaid (e.g., 'OLN' and
   // 'LFPO 02 OM')
-  string ident, name, arpt_code;
+  string& ident = record.ident;
+  string& name = record.name;
 
   if (simgear::strutils::starts_with(line, "#")) {
     // carrier_nav.dat has a comment line using this syntax...
-    return 0;
+    return false;
   }
 
   int num_splits;
@@ -184,7 +197,7 @@ PositionedID NavLoader::processNavLine(
   static const string endOfData = "99"; // special code in the nav.dat spec
 
   if (nbFields == 0) {       // blank line
-    return 0;
+    return false;
   } else if (nbFields == 1) {
     if (fields[0] != endOfData) {
       SG_LOG( SG_NAVAID, SG_WARN,
@@ -192,12 +205,12 @@ PositionedID NavLoader::processNavLine(
               "field, but it is not '99'" );
     }
 
-    return 0;
+    return false;
   } else if (nbFields < 9) {
     SG_LOG( SG_NAVAID, SG_WARN,
             utf8Path << ":"  << lineNum << ": invalid line "
             "(at least 9 fields are required)" );
-    return 0;
+    return false;
   }
 
   // When their string argument can't be properly converted, std::stoi(),
@@ -205,11 +218,11 @@ PositionedID NavLoader::processNavLine(
   // subclass of std::logic_error.
   try {
     rowCode = std::stoi(fields[0]);
-    lat = std::stod(fields[1]);
-    lon = std::stod(fields[2]);
-    elev_ft = std::stoi(fields[3]);
-    freq = std::stoi(fields[4]);
-    range = std::stoi(fields[5]);
+    record.lat = std::stod(fields[1]);
+    record.lon = std::stod(fields[2]);
+    record.elev_ft = std::stoi(fields[3]);
+    record.freq = std::stoi(fields[4]);
+    record.range = std::stoi(fields[5]);
     multiuse = std::stod(fields[6]);
     ident = fields[7];
     if (version >= 1100) {
@@ -238,10 +251,31 @@ PositionedID NavLoader::processNavLine(
             utf8Path << ":"  << lineNum << ": unable to parse (" <<
             exc.what() << "): '" <<
             simgear::strutils::stripTrailingNewlines(line) << "'" );
-    return 0;
+    return false;
   }
 
-  SGGeod pos(SGGeod::fromDegFt(lon, lat, static_cast<double>(elev_ft)));
+  record.lineNumber = lineNum;
+  return true;
+}
+
+// Load a navaid split by parseNavLine() into the NavDataCache. The type
+// can be forced by the caller, otherwise it follows the row code.
+PositionedID NavLoader::processNavRecord(const NavRecord& record,
+                                         const string& utf8Path,
+                                         FGPositioned::Type type)
+{
+  NavDataCache* cache = NavDataCache::instance();
+  const unsigned int lineNum = record.lineNumber;
+  const int rowCode = record.rowCode;
+  const double multiuse = record.multiuse;
+  const string& ident = record.ident;
+  const string& name = record.name;
+  const int elev_ft = record.elev_ft;
+  int freq = record.freq;
+  int range = record.range;
+
+  SGGeod pos(SGGeod::fromDegFt(record.lon, record.lat,
+                               static_cast<double>(elev_ft)));
 
   // The type can be forced by our caller, but normally we use the value
   // supplied in the .dat file.
@@ -426,7 +460,13 @@ PositionedID NavLoader::processNavLine(
 void NavLoader::loadNav(const SGPath& path, std::size_t bytesReadSoFar,
                         std::size_t totalSizeOfAllDatFiles)
 {
-  NavDataCache* cache = NavDataCache::instance();
+  NavRecordList records;
+  readNav(path, records);
+  loadNavRecords(path, records, bytesReadSoFar, totalSizeOfAllDatFiles);
+}
+
+void NavLoader::readNav(const SGPath& path, NavRecordList& records)
+{
   const string utf8Path = path.utf8Str();
   sg_gzifstream in(path);
 
@@ -457,21 +497,37 @@ void NavLoader::loadNav(const SGPath& path, std::size_t bytesReadSoFar,
     throw sg_format_exception(errMsg, strippedLine);
   }
 
+  NavRecord record;
   for (lineNumber = 3; std::getline(in, line); lineNumber++) {
-    processNavLine(line, utf8Path, lineNumber, FGPositioned::INVALID, version);
-
-    if ((lineNumber % 100) == 0) {
-      // every 100 lines
-      unsigned int percent = ((bytesReadSoFar + in.approxOffset()) * 100)
-        / totalSizeOfAllDatFiles;
-      cache->setRebuildPhaseProgress(NavDataCache::REBUILD_NAVAIDS, percent);
+    if (parseNavLine(line, utf8Path, lineNumber, version, record)) {
+      records.push_back(record);
     }
-
   } // of stream data loop
 
   throwExceptionIfStreamError(in, path);
 }
 
+void NavLoader::loadNavRecords(const SGPath& path,
+                               const NavRecordList& records,
+                               std::size_t bytesReadSoFar,
+                               std::size_t totalSizeOfAllDatFiles)
+{
+  NavDataCache* cache = NavDataCache::instance();
+  const string utf8Path = path.utf8Str();
+  const std::size_t fileSize = path.sizeInBytes();
+
+  for (std::size_t i = 0; i < records.size(); i++) {
+    processNavRecord(records[i], utf8Path, FGPositioned::INVALID);
+
+    if ((i % 100) == 0) {
+      // every 100 records, assuming they are spread evenly over the file
+      unsigned int percent = ((bytesReadSoFar + fileSize * i / records.size())
+                              * 100) / totalSizeOfAllDatFiles;
+      cache->setRebuildPhaseProgress(NavDataCache::REBUILD_NAVAIDS, percent);
+    }
+  }
+}
+
 void NavLoader::loadCarrierNav(const SGPath& path)
 {
   SG_LOG( SG_NAVAID, SG_DEBUG, "Opening file: " << path );
@@ -30,6 +30,7 @@
 #include <string>
 #include <map>
 #include <tuple>
+#include <vector>
 #include <Navaids/positioned.hxx>
 
 // forward decls
@@ -41,10 +42,31 @@ namespace flightgear
 
 class NavLoader {
   public:
+    // One navaid line of a nav.dat file, split into its fields
+    struct NavRecord
+    {
+      unsigned int lineNumber;
+      int rowCode, elev_ft, freq, range;
+      // 'multiuse': different meanings depending on the record's row code
+      double lat, lon, multiuse;
+      std::string ident, name;
+    };
+
+    typedef std::vector<NavRecord> NavRecordList;
+
     // load and initialize the navigational databases
     void loadNav(const SGPath& path, std::size_t bytesReadSoFar,
                  std::size_t totalSizeOfAllDatFiles);
 
+    // Tokenize the specified nav.dat file into 'records'. Does not access
+    // the NavDataCache, so it may run on any thread.
+    static void readNav(const SGPath& path, NavRecordList& records);
+
+    // Load navaids read by readNav() from 'path' into the NavDataCache
+    void loadNavRecords(const SGPath& path, const NavRecordList& records,
+                        std::size_t bytesReadSoFar,
+                        std::size_t totalSizeOfAllDatFiles);
+
     void loadCarrierNav(const SGPath& path);
 
     bool loadTacan(const SGPath& path, FGTACANList *channellist);
@@ -59,6 +81,17 @@ class NavLoader {
                                 unsigned int lineNum,
                                 FGPositioned::Type type = FGPositioned::INVALID,
                                 unsigned long version = 810);
+
+    // Split a nav.dat line into 'record', false if there is no navaid on it
+    static bool parseNavLine(const std::string& line,
+                             const std::string& utf8Path,
+                             unsigned int lineNum, unsigned long version,
+                             NavRecord& record);
+
+    // Load a parsed navaid into the NavDataCache
+    PositionedID processNavRecord(const NavRecord& record,
+                                  const std::string& utf8Path,
+                                  FGPositioned::Type type);
 };
 
 } // of namespace flightgear
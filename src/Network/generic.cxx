@@ -221,7 +221,7 @@ int FGSTXETXWrapper::unwrap( size_t n, uint8_t * buf )
   return n;
 }
 
-FGGeneric::FGGeneric(vector<string> tokens) : exitOnError(false), initOk(false), wrapper(NULL)
+FGGeneric::FGGeneric(vector<string> tokens) : exitOnError(false), exitRequested(false), initOk(false), wrapper(NULL)
 {
     size_t configToken;
     if (tokens[1] == "socket") {
@@ -612,6 +612,7 @@ bool FGGeneric::parse_message_ascii(int length) {
 
         default: // SG_STRING
             _in_message[i].prop->setStringValue(p1);
+            _in_message[i].received = true;
             break;
         }
 
@@ -720,6 +721,11 @@ bool FGGeneric::process() {
     return true;
 error_out:
     if (exitOnError) {
+        if (is_threaded()) {
+            // exit from the main thread, in sync_properties()
+            exitRequested = true;
+            return false;
+        }
         fgOSExit(1);
         return true; // should not get there, but please the compiler
     } else
@@ -750,6 +756,93 @@ bool FGGeneric::close() {
 }
 
 
+// copy the value of an output property, in the type of the source, so
+// the output is generated from the value at its full precision
+static void copyValue(SGPropertyNode* dst, const SGPropertyNode* src)
+{
+    switch (src->getType()) {
+    case simgear::props::BOOL:
+        dst->setBoolValue(src->getBoolValue());
+        break;
+    case simgear::props::INT:
+        dst->setIntValue(src->getIntValue());
+        break;
+    case simgear::props::LONG:
+        dst->setLongValue(src->getLongValue());
+        break;
+    case simgear::props::FLOAT:
+        dst->setFloatValue(src->getFloatValue());
+        break;
+    case simgear::props::DOUBLE:
+        dst->setDoubleValue(src->getDoubleValue());
+        break;
+    default:
+        dst->setStringValue(src->getStringValue());
+        break;
+    }
+}
+
+// copy the value of an input property, in the type the chunk declares:
+// the tree node gets the type it would get from updateValue(), also when
+// it has no type yet
+void FGGeneric::copyInputValue(SGPropertyNode* dst, const SGPropertyNode* src,
+                               e_type type)
+{
+    switch (type) {
+    case FG_BOOL:
+        dst->setBoolValue(src->getBoolValue());
+        break;
+    case FG_BYTE:
+    case FG_WORD:
+    case FG_INT:
+        dst->setIntValue(src->getIntValue());
+        break;
+    case FG_FIXED:
+    case FG_FLOAT:
+        dst->setFloatValue(src->getFloatValue());
+        break;
+    case FG_DOUBLE:
+        dst->setDoubleValue(src->getDoubleValue());
+        break;
+    default: // SG_STRING
+        dst->setStringValue(src->getStringValue());
+        break;
+    }
+}
+
+// When the channel runs on the I/O thread, process() works on detached
+// copies of the nodes. The outputs are copied from the tree; the inputs
+// received since the last call are copied to the tree, then all inputs
+// are refreshed from it, so relative inputs apply to the current values.
+void FGGeneric::sync_properties()
+{
+    if (exitRequested) {
+        fgOSExit(1);
+        return;
+    }
+
+    for (unsigned int i = 0; i < _out_message.size(); i++) {
+        _serial_prot& chunk = _out_message[i];
+        if (!chunk.tree)
+            continue;
+        if (chunk.prop == chunk.tree)
+            chunk.prop = new SGPropertyNode();
+        copyValue(chunk.prop, chunk.tree);
+    }
+
+    for (unsigned int i = 0; i < _in_message.size(); i++) {
+        _serial_prot& chunk = _in_message[i];
+        if (!chunk.tree)
+            continue;
+        if (chunk.prop == chunk.tree)
+            chunk.prop = new SGPropertyNode();
+        else if (chunk.received)
+            copyInputValue(chunk.tree, chunk.prop, chunk.type);
+        copyInputValue(chunk.prop, chunk.tree, chunk.type);
+        chunk.received = false;
+    }
+}
+
 void
 FGGeneric::reinit()
 {
@@ -923,13 +1016,15 @@ FGGeneric::read_config(SGPropertyNode *root, vector<_serial_prot> &msg)
         chunk.max = chunks[i]->getDoubleValue("max");
         chunk.wrap = chunks[i]->getBoolValue("wrap");
         chunk.rel = chunks[i]->getBoolValue("relative");
+        chunk.received = false;
 
         if( chunks[i]->hasChild("const") ) {
             chunk.prop = new SGPropertyNode();
             chunk.prop->setStringValue( chunks[i]->getStringValue("const", "" ) );
         } else {
             string node = chunks[i]->getStringValue("node", "/null");
-            chunk.prop = fgGetNode(node.c_str(), true);
+            chunk.tree = fgGetNode(node.c_str(), true);
+            chunk.prop = chunk.tree;
         }
 
         string type = chunks[i]->getStringValue("type");
@@ -1002,4 +1097,5 @@ void FGGeneric::updateValue(FGGeneric::_serial_prot& prot, bool val)
   {
     setValue(prot.prop, val);
   }
+  prot.received = true;
 }
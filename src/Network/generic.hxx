@@ -54,6 +54,9 @@ public:
     // close the channel
     bool close();
 
+    bool supports_io_thread() const { return true; }
+    void sync_properties();
+
     void setExitOnError(bool val) { exitOnError = val; }
     bool getExitOnError() { return exitOnError; }
     bool getInitOk(void) { return initOk; }
@@ -70,7 +73,9 @@ protected:
         double min, max;
         bool wrap;
         bool rel;
-        SGPropertyNode_ptr prop;
+        SGPropertyNode_ptr prop;    // the node process() reads or writes
+        SGPropertyNode_ptr tree;    // in the property tree, unless a const
+        bool received;              // since the last sync_properties()
     } _serial_prot;
 
 private:
@@ -101,7 +106,10 @@ private:
     bool parse_message_ascii(int length);
     bool parse_message_binary(int length);
     bool read_config(SGPropertyNode *root, vector<_serial_prot> &msg);
+    static void copyInputValue(SGPropertyNode* dst, const SGPropertyNode* src,
+                               e_type type);
     bool exitOnError;
+    bool exitRequested;     // by process() on the I/O thread
     bool initOk;
 
     class FGProtocolWrapper * wrapper;
@@ -122,6 +130,7 @@ private:
       }
 
       setValue(prot.prop, new_val);
+      prot.received = true;
     }
     
     // Special handling for bool (relative change = toggle, no min/max, no wrap)
@@ -33,6 +33,7 @@ FGProtocol::FGProtocol() :
     count(0),
     dir(SG_IO_NONE),
     enabled(false),
+    threaded(false),
     io(NULL)
 {
 }
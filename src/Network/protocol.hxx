@@ -53,6 +53,7 @@ private:
     // int length;
 
     bool enabled;
+    bool threaded;
 
     SGIOChannel *io;
 
@@ -90,6 +91,15 @@ public:
     inline bool is_enabled() const { return enabled; }
     inline void set_enabled( const bool b ) { enabled = b; }
 
+    // Protocols which can process() on the I/O thread don't touch the
+    // property tree from process(), but work on a snapshot of their
+    // properties, which sync_properties() exchanges with the tree.
+    // FGIO calls it on the main thread, never during process().
+    virtual bool supports_io_thread() const { return false; }
+    virtual void sync_properties() {}
+    inline bool is_threaded() const { return threaded; }
+    inline void set_threaded( const bool b ) { threaded = b; }
+
     inline SGIOChannel *get_io_channel() const { return io; }
     inline void set_io_channel( SGIOChannel *c ) { io = c; }
 };
@@ -26,6 +26,7 @@
 
 #include <stdlib.h>
 #include <deque>
+#include <vector>
 #include "radio.hxx"
 #include <simgear/scene/material/mat.hxx>
 #include <Scenery/scenery.hxx>
@@ -320,13 +321,23 @@ double FGRadioTransmission::ITM_calculate_attenuation(SGGeod pos, double freq, i
 	
 	unsigned int e_size = (deque<unsigned>::size_type)max_points;
 	
-	while (elevations.size() <= e_size) {
+	// query the whole terrain profile at once
+	std::vector<SGGeod> probes;
+	probes.reserve(e_size + 1);
+	while (probes.size() <= e_size) {
 		probe_distance += point_distance;
-		SGGeod probe = SGGeod::fromGeoc(center.advanceRadM( course, probe_distance ));
-		const simgear::BVHMaterial *material = 0;
-		double elevation_m = 0.0;
+		probes.push_back(SGGeod::fromGeoc(center.advanceRadM( course, probe_distance )));
+	}
+	std::vector<double> probe_elevations;
+	std::vector<bool> probe_valid;
+	std::vector<const simgear::BVHMaterial*> probe_materials;
+	scenery->get_elevations_m( probes, probe_elevations, probe_valid, &probe_materials );
+	
+	for (unsigned int i = 0; i < probes.size(); i++) {
+		const simgear::BVHMaterial *material = probe_materials[i];
+		double elevation_m = probe_elevations[i];
 	
-		if (scenery->get_elevation_m( probe, elevation_m, &material )) {
+		if (probe_valid[i]) {
                         const SGMaterial *mat;
                         mat = dynamic_cast<const SGMaterial*>(material);
 			if((transmission_type == 3) || (transmission_type == 4)) {
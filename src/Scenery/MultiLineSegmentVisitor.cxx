@@ -0,0 +1,328 @@
+// MultiLineSegmentVisitor.cxx -- intersect a set of line segments with a BVH
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cmath>
+
+#include <simgear/math/SGGeometry.hxx>
+#include <simgear/bvh/BVHGroup.hxx>
+#include <simgear/bvh/BVHPageNode.hxx>
+#include <simgear/bvh/BVHTransform.hxx>
+#include <simgear/bvh/BVHMotionTransform.hxx>
+#include <simgear/bvh/BVHLineGeometry.hxx>
+#include <simgear/bvh/BVHStaticGeometry.hxx>
+#include <simgear/bvh/BVHStaticData.hxx>
+#include <simgear/bvh/BVHStaticNode.hxx>
+#include <simgear/bvh/BVHStaticBinary.hxx>
+#include <simgear/bvh/BVHStaticTriangle.hxx>
+
+#include "MultiLineSegmentVisitor.hxx"
+
+using namespace simgear;
+
+// Moeller/Trumbore line segment against triangle test for a whole set of
+// line segments given as structure of arrays. Same semantics as the
+// simgear intersects(point, triangle, lineSegment, eps) function, but the
+// triangle setup is done once and the loop body is free of branches so
+// that the compiler can vectorize it.
+// Returns the number of segments that hit the triangle, the hit flags and
+// the line parameter of the hit are written to hit and tHit.
+static unsigned
+intersectTriangleLanes(const SGTrianglef& triangle, unsigned count,
+                       const float* sx, const float* sy, const float* sz,
+                       const float* dx, const float* dy, const float* dz,
+                       float* tHit, unsigned char* hit)
+{
+    const float eps = 1e-4f;
+    const float minDet = SGLimits<float>::min();
+    SGVec3f v0 = triangle.getBaseVertex();
+    SGVec3f e1 = triangle.getEdge(0);
+    SGVec3f e2 = triangle.getEdge(1);
+
+    unsigned numHits = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        float px = dy[i]*e2[2] - dz[i]*e2[1];
+        float py = dz[i]*e2[0] - dx[i]*e2[2];
+        float pz = dx[i]*e2[1] - dy[i]*e2[0];
+        float a = e1[0]*px + e1[1]*py + e1[2]*pz;
+        float f = 1/a;
+
+        float ox = sx[i] - v0[0];
+        float oy = sy[i] - v0[1];
+        float oz = sz[i] - v0[2];
+        float u = f*(ox*px + oy*py + oz*pz);
+
+        float qx = oy*e1[2] - oz*e1[1];
+        float qy = oz*e1[0] - ox*e1[2];
+        float qz = ox*e1[1] - oy*e1[0];
+        float v = f*(dx[i]*qx + dy[i]*qy + dz[i]*qz);
+        float t = f*(e2[0]*qx + e2[1]*qy + e2[2]*qz);
+
+        bool h = (minDet <= std::fabs(a))
+            & (-eps <= u) & (u <= 1 + eps)
+            & (-eps <= v) & (u + v <= 1 + eps)
+            & (-eps <= t) & (t <= 1 + eps);
+        tHit[i] = t;
+        hit[i] = h;
+        numHits += h;
+    }
+    return numHits;
+}
+
+FGMultiLineSegmentVisitor::FGMultiLineSegmentVisitor(double t) :
+    _time(t),
+    _begin(0),
+    _end(0)
+{
+}
+
+FGMultiLineSegmentVisitor::~FGMultiLineSegmentVisitor()
+{
+}
+
+void
+FGMultiLineSegmentVisitor::addLineSegment(const SGLineSegmentd& lineSegment)
+{
+    Ray ray;
+    ray.lineSegment = lineSegment;
+    ray.normal = SGVec3d::zeros();
+    ray.linearVelocity = SGVec3d::zeros();
+    ray.angularVelocity = SGVec3d::zeros();
+    ray.material = 0;
+    ray.id = 0;
+    ray.haveHit = false;
+    _rays.push_back(ray);
+    _active.push_back(_rays.size() - 1);
+    _end = _active.size();
+}
+
+bool
+FGMultiLineSegmentVisitor::select(const SGSphered& sphere, size_t& begin,
+                                  size_t& end)
+{
+    begin = _active.size();
+    for (size_t i = _begin; i < _end; ++i) {
+        unsigned k = _active[i];
+        if (intersects(_rays[k].lineSegment, sphere))
+            _active.push_back(k);
+    }
+    end = _active.size();
+    return begin != end;
+}
+
+template<typename T>
+void
+FGMultiLineSegmentVisitor::traverse(T& node, size_t begin, size_t end)
+{
+    size_t parentBegin = _begin;
+    size_t parentEnd = _end;
+    _begin = begin;
+    _end = end;
+
+    node.traverse(*this);
+
+    _begin = parentBegin;
+    _end = parentEnd;
+    _active.resize(begin);
+}
+
+void
+FGMultiLineSegmentVisitor::apply(BVHGroup& group)
+{
+    size_t begin, end;
+    if (!select(group.getBoundingSphere(), begin, end))
+        return;
+    traverse(group, begin, end);
+}
+
+void
+FGMultiLineSegmentVisitor::apply(BVHPageNode& pageNode)
+{
+    size_t begin, end;
+    if (!select(pageNode.getBoundingSphere(), begin, end))
+        return;
+    traverse(pageNode, begin, end);
+}
+
+void
+FGMultiLineSegmentVisitor::apply(BVHTransform& transform)
+{
+    size_t begin, end;
+    if (!select(transform.getBoundingSphere(), begin, end))
+        return;
+
+    // Push the line segments
+    std::vector<Ray> parentRays;
+    parentRays.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        Ray& ray = _rays[_active[i]];
+        parentRays.push_back(ray);
+        ray.lineSegment = transform.lineSegmentToLocal(ray.lineSegment);
+        ray.haveHit = false;
+    }
+
+    traverse(transform, begin, end);
+
+    for (size_t i = begin; i < end; ++i) {
+        Ray& ray = _rays[_active[i]];
+        const Ray& parentRay = parentRays[i - begin];
+        if (ray.haveHit) {
+            ray.linearVelocity = transform.vecToWorld(ray.linearVelocity);
+            ray.angularVelocity = transform.vecToWorld(ray.angularVelocity);
+            SGVec3d point(transform.ptToWorld(ray.lineSegment.getEnd()));
+            ray.lineSegment.set(parentRay.lineSegment.getStart(), point);
+            ray.normal = transform.vecToWorld(ray.normal);
+        } else {
+            ray = parentRay;
+        }
+    }
+}
+
+void
+FGMultiLineSegmentVisitor::apply(BVHMotionTransform& transform)
+{
+    size_t begin, end;
+    if (!select(transform.getBoundingSphere(), begin, end))
+        return;
+
+    // Push the line segments
+    SGMatrixd toLocal = transform.getToLocalTransform(_time);
+    std::vector<Ray> parentRays;
+    parentRays.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        Ray& ray = _rays[_active[i]];
+        parentRays.push_back(ray);
+        ray.lineSegment = ray.lineSegment.transform(toLocal);
+        ray.haveHit = false;
+    }
+
+    traverse(transform, begin, end);
+
+    SGMatrixd toWorld = transform.getToWorldTransform(_time);
+    for (size_t i = begin; i < end; ++i) {
+        Ray& ray = _rays[_active[i]];
+        const Ray& parentRay = parentRays[i - begin];
+        if (ray.haveHit) {
+            SGVec3d localStart = ray.lineSegment.getStart();
+            ray.linearVelocity += transform.getLinearVelocityAt(localStart);
+            ray.angularVelocity += transform.getAngularVelocity();
+            ray.linearVelocity = toWorld.xformVec(ray.linearVelocity);
+            ray.angularVelocity = toWorld.xformVec(ray.angularVelocity);
+            SGVec3d localEnd = ray.lineSegment.getEnd();
+            ray.lineSegment.set(parentRay.lineSegment.getStart(),
+                                toWorld.xformPt(localEnd));
+            ray.normal = toWorld.xformVec(ray.normal);
+            if (!ray.id)
+                ray.id = transform.getId();
+        } else {
+            ray = parentRay;
+        }
+    }
+}
+
+void
+FGMultiLineSegmentVisitor::apply(BVHLineGeometry&)
+{ }
+
+void
+FGMultiLineSegmentVisitor::apply(BVHStaticGeometry& node)
+{
+    size_t begin, end;
+    if (!select(node.getBoundingSphere(), begin, end))
+        return;
+
+    // Within a static geometry the coordinate frame does no longer
+    // change. So copy the rays once into the lane arrays that are
+    // used by the triangle kernel.
+    unsigned count = end - begin;
+    _laneRay.resize(count);
+    _sx.resize(count); _sy.resize(count); _sz.resize(count);
+    _dx.resize(count); _dy.resize(count); _dz.resize(count);
+    _tHit.resize(count);
+    _hit.resize(count);
+    for (unsigned i = 0; i < count; ++i) {
+        unsigned k = _active[begin + i];
+        const SGLineSegmentd& lineSegment = _rays[k].lineSegment;
+        SGVec3f start(lineSegment.getStart());
+        SGVec3f direction(lineSegment.getDirection());
+        _laneRay[i] = k;
+        _sx[i] = start[0]; _sy[i] = start[1]; _sz[i] = start[2];
+        _dx[i] = direction[0]; _dy[i] = direction[1]; _dz[i] = direction[2];
+    }
+
+    node.traverse(*this);
+
+    _active.resize(begin);
+}
+
+void
+FGMultiLineSegmentVisitor::apply(const BVHStaticBinary& node,
+                                 const BVHStaticData& data)
+{
+    // Descend if any of the lanes crosses that box
+    unsigned count = _laneRay.size();
+    unsigned i = 0;
+    for (; i < count; ++i) {
+        SGLineSegmentf lineSegment(_rays[_laneRay[i]].lineSegment);
+        if (intersects(lineSegment, node.getBoundingBox()))
+            break;
+    }
+    if (i == count)
+        return;
+
+    // As with the single line segment visitor, enter the box with the
+    // start point first.
+    node.traverse(*this, data, _rays[_laneRay[i]].lineSegment.getStart());
+}
+
+void
+FGMultiLineSegmentVisitor::apply(const BVHStaticTriangle& triangle,
+                                 const BVHStaticData& data)
+{
+    SGTrianglef tri = triangle.getTriangle(data);
+    unsigned count = _laneRay.size();
+    if (!intersectTriangleLanes(tri, count, &_sx[0], &_sy[0], &_sz[0],
+                                &_dx[0], &_dy[0], &_dz[0],
+                                &_tHit[0], &_hit[0]))
+        return;
+
+    SGVec3d normal(tri.getNormal());
+    const BVHMaterial* material;
+    material = data.getMaterial(triangle.getMaterialIndex());
+    for (unsigned i = 0; i < count; ++i) {
+        if (!_hit[i])
+            continue;
+        float t = _tHit[i];
+        SGVec3f point(_sx[i] + t*_dx[i], _sy[i] + t*_dy[i],
+                      _sz[i] + t*_dz[i]);
+
+        // Shorten the ray to the hit, so only nearer triangles
+        // can still intersect.
+        _dx[i] *= t; _dy[i] *= t; _dz[i] *= t;
+
+        Ray& ray = _rays[_laneRay[i]];
+        ray.lineSegment.set(ray.lineSegment.getStart(), SGVec3d(point));
+        ray.normal = normal;
+        ray.linearVelocity = SGVec3d::zeros();
+        ray.angularVelocity = SGVec3d::zeros();
+        ray.material = material;
+        ray.id = 0;
+        ray.haveHit = true;
+    }
+}
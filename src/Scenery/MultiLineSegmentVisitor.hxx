@@ -0,0 +1,100 @@
+// MultiLineSegmentVisitor.hxx -- intersect a set of line segments with a BVH
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _MULTILINESEGMENTVISITOR_HXX
+#define _MULTILINESEGMENTVISITOR_HXX
+
+#include <vector>
+
+#include <simgear/math/SGMath.hxx>
+#include <simgear/math/SGGeometry.hxx>
+#include <simgear/bvh/BVHNode.hxx>
+#include <simgear/bvh/BVHVisitor.hxx>
+
+namespace simgear {
+class BVHMaterial;
+}
+
+/**
+ * Like simgear::BVHLineSegmentVisitor, but for a set of line segments in
+ * a single walk of the tree. Subtrees are culled against the segments
+ * still touching them. Within a static geometry the segments are staged
+ * as structure of arrays, so each triangle is tested against all of them
+ * by a loop the compiler can vectorize.
+ *
+ * Each segment ends at its nearest hit, if there is one.
+ */
+class FGMultiLineSegmentVisitor : public simgear::BVHVisitor {
+public:
+    struct Ray {
+        SGLineSegmentd lineSegment;
+        SGVec3d normal;
+        SGVec3d linearVelocity;
+        SGVec3d angularVelocity;
+        const simgear::BVHMaterial* material;
+        simgear::BVHNode::Id id;
+        bool haveHit;
+    };
+
+    FGMultiLineSegmentVisitor(double t = 0);
+    virtual ~FGMultiLineSegmentVisitor();
+
+    void addLineSegment(const SGLineSegmentd& lineSegment);
+
+    unsigned getNumRays() const
+    { return _rays.size(); }
+    const Ray& getRay(unsigned i) const
+    { return _rays[i]; }
+
+    virtual void apply(simgear::BVHGroup& group);
+    virtual void apply(simgear::BVHPageNode& pageNode);
+    virtual void apply(simgear::BVHTransform& transform);
+    virtual void apply(simgear::BVHMotionTransform& transform);
+    virtual void apply(simgear::BVHLineGeometry&);
+    virtual void apply(simgear::BVHStaticGeometry& node);
+
+    virtual void apply(const simgear::BVHStaticBinary& node,
+                       const simgear::BVHStaticData& data);
+    virtual void apply(const simgear::BVHStaticTriangle& triangle,
+                       const simgear::BVHStaticData& data);
+
+private:
+    // Collect the currently active rays that touch the given sphere on top
+    // of the active stack. Returns false if there is none.
+    bool select(const SGSphered& sphere, size_t& begin, size_t& end);
+    template<typename T>
+    void traverse(T& node, size_t begin, size_t end);
+
+    double _time;
+
+    std::vector<Ray> _rays;
+
+    // Stack of ray indices, the range [_begin, _end) are the rays
+    // intersecting the current node.
+    std::vector<unsigned> _active;
+    size_t _begin;
+    size_t _end;
+
+    // Structure of arrays copy of the rays entering the current
+    // static geometry.
+    std::vector<unsigned> _laneRay;
+    std::vector<float> _sx, _sy, _sz;
+    std::vector<float> _dx, _dy, _dz;
+    std::vector<float> _tHit;
+    std::vector<unsigned char> _hit;
+};
+
+#endif // _MULTILINESEGMENTVISITOR_HXX
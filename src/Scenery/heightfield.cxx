@@ -0,0 +1,116 @@
+// heightfield.cxx -- quantized per-tile terrain elevation grid
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cmath>
+
+#include "heightfield.hxx"
+
+namespace
+{
+    // quantization step of stored heights, covers +-16km
+    const double HEIGHT_STEP_M = 0.5;
+    // markers for grid points not sampled yet / without terrain
+    const short HEIGHT_UNKNOWN = -32768;
+    const short HEIGHT_NONE = -32767;
+    // border grid points are sampled this fraction of a cell inside the
+    // tile, a ray exactly along the tile edge may miss its mesh
+    const double BORDER_INSET = 1e-3;
+}
+
+unsigned long TileHeightField::_hits = 0;
+unsigned long TileHeightField::_misses = 0;
+unsigned long TileHeightField::_samples = 0;
+unsigned TileHeightField::_fields = 0;
+size_t TileHeightField::_memory = 0;
+
+TileHeightField::TileHeightField(const SGBucket& bucket, unsigned resolution) :
+    _resolution(resolution < 1 ? 1 : resolution),
+    _lon0(bucket.get_center_lon() - 0.5*bucket.get_width()),
+    _lat0(bucket.get_center_lat() - 0.5*bucket.get_height()),
+    _dlon(bucket.get_width() / _resolution),
+    _dlat(bucket.get_height() / _resolution)
+{
+    ++_fields;
+}
+
+TileHeightField::~TileHeightField()
+{
+    --_fields;
+    _memory -= _heights.size()*sizeof(short);
+}
+
+bool TileHeightField::get_point(unsigned i, unsigned j, Sampler& sampler,
+                                double& alt)
+{
+    short& h = _heights[j*(_resolution + 1) + i];
+    if (h == HEIGHT_UNKNOWN) {
+        double sampled;
+        double u = SGMiscd::clip(i, BORDER_INSET, _resolution - BORDER_INSET);
+        double v = SGMiscd::clip(j, BORDER_INSET, _resolution - BORDER_INSET);
+        SGGeod geod = SGGeod::fromDeg(_lon0 + u*_dlon, _lat0 + v*_dlat);
+        ++_samples;
+        if (sampler.sample(geod, sampled)) {
+            double q = floor(sampled/HEIGHT_STEP_M + 0.5);
+            h = (short)SGMiscd::clip(q, HEIGHT_NONE + 1, 32767);
+        } else {
+            h = HEIGHT_NONE;
+        }
+    }
+    if (h == HEIGHT_NONE)
+        return false;
+    alt = h*HEIGHT_STEP_M;
+    return true;
+}
+
+bool TileHeightField::get_elevation_m(const SGGeod& geod, Sampler& sampler,
+                                      double& alt)
+{
+    if (_heights.empty()) {
+        _heights.assign((_resolution + 1)*(_resolution + 1), HEIGHT_UNKNOWN);
+        _memory += _heights.size()*sizeof(short);
+    }
+
+    double u = (geod.getLongitudeDeg() - _lon0)/_dlon;
+    double v = (geod.getLatitudeDeg() - _lat0)/_dlat;
+    u = SGMiscd::clip(u, 0, _resolution);
+    v = SGMiscd::clip(v, 0, _resolution);
+    unsigned i = SGMisc<unsigned>::min((unsigned)u, _resolution - 1);
+    unsigned j = SGMisc<unsigned>::min((unsigned)v, _resolution - 1);
+    double fu = u - i;
+    double fv = v - j;
+
+    unsigned long samples = _samples;
+    double h00, h10, h01, h11;
+    bool ok = get_point(i, j, sampler, h00) &&
+              get_point(i + 1, j, sampler, h10) &&
+              get_point(i, j + 1, sampler, h01) &&
+              get_point(i + 1, j + 1, sampler, h11);
+
+    if (_samples == samples)
+        ++_hits;
+    else
+        ++_misses;
+
+    if (!ok)
+        return false;
+
+    alt = (1 - fv)*((1 - fu)*h00 + fu*h10) + fv*((1 - fu)*h01 + fu*h11);
+    return true;
+}
@@ -0,0 +1,85 @@
+// heightfield.hxx -- quantized per-tile terrain elevation grid
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _HEIGHTFIELD_HXX
+#define _HEIGHTFIELD_HXX
+
+#include <cstddef>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/math/SGMath.hxx>
+
+/**
+ * Memoized terrain elevations of one scenery tile.
+ *
+ * The tile is covered by a regular lon/lat grid of resolution x resolution
+ * cells. Grid points are sampled on demand through a Sampler the first
+ * time a lookup needs them and stored quantized to half a meter, so later
+ * lookups in the same cell are a bilinear interpolation of four values.
+ * The field belongs to its TileEntry and goes away with it.
+ */
+class TileHeightField {
+public:
+    /**
+     * Source of exact elevations, usually an intersection test against
+     * the tile's scene graph.
+     */
+    class Sampler {
+    public:
+        virtual ~Sampler() {}
+        // elevation of the terrain at the lon/lat of geod, false if
+        // there is no terrain
+        virtual bool sample(const SGGeod& geod, double& alt) = 0;
+    };
+
+    TileHeightField(const SGBucket& bucket, unsigned resolution);
+    ~TileHeightField();
+
+    /**
+     * Interpolated elevation at the lon/lat of geod, which must lie in
+     * this tile. Returns false if a surrounding grid point has no terrain.
+     */
+    bool get_elevation_m(const SGGeod& geod, Sampler& sampler, double& alt);
+
+    unsigned get_resolution() const { return _resolution; }
+
+    // global statistics over all height fields
+    static unsigned long get_hit_count() { return _hits; }
+    static unsigned long get_miss_count() { return _misses; }
+    static unsigned long get_sample_count() { return _samples; }
+    static unsigned get_field_count() { return _fields; }
+    static size_t get_memory_size() { return _memory; }
+
+private:
+    // height at a grid point, sampling it if needed
+    bool get_point(unsigned i, unsigned j, Sampler& sampler, double& alt);
+
+    unsigned _resolution;
+    double _lon0, _lat0;    // south west corner in degrees
+    double _dlon, _dlat;    // cell size in degrees
+
+    // (resolution + 1)^2 grid points, allocated on first use
+    std::vector<short> _heights;
+
+    static unsigned long _hits;
+    static unsigned long _misses;
+    static unsigned long _samples;
+    static unsigned _fields;
+    static size_t _memory;
+};
+
+#endif // _HEIGHTFIELD_HXX
@@ -420,6 +420,23 @@ FGScenery::get_elevation_m(const SGGeod& geod, double& alt,
                                       butNotFrom );
 }
 
+bool
+FGScenery::get_approx_elevation_m(const SGGeod& geod, double& alt)
+{
+    return _terrain->get_approx_elevation_m( geod, alt );
+}
+
+unsigned
+FGScenery::get_elevations_m(const std::vector<SGGeod>& geods,
+                            std::vector<double>& alt,
+                            std::vector<bool>& valid,
+                            std::vector<const simgear::BVHMaterial*>* materials,
+                            const osg::Node* butNotFrom)
+{
+    return _terrain->get_elevations_m( geods, alt, valid, materials,
+                                       butNotFrom );
+}
+
 bool
 FGScenery::get_cart_ground_intersection(const SGVec3d& pos, const SGVec3d& dir,
                                         SGVec3d& nearestHit,
@@ -29,6 +29,8 @@
 # error This library requires C++
 #endif                                   
 
+#include <vector>
+
 #include <osg/ref_ptr>
 #include <osg/Switch>
 
@@ -91,6 +93,27 @@ public:
                          const simgear::BVHMaterial** material,
                          const osg::Node* butNotFrom = 0);
 
+    /// Compute the elevation of the scenery below each of a set of
+    /// geodetic points, like get_elevation_m does for a single point.
+    /// alt and valid are resized to the number of points; valid[i] tells
+    /// whether scenery was found below geods[i]. If materials is given,
+    /// it receives the material of each hit the same way.
+    /// Nearby points share the scene graph traversal, so prefer this
+    /// over repeated get_elevation_m calls for profiles and probe sets.
+    /// Returns the number of points scenery was found for.
+    unsigned get_elevations_m(const std::vector<SGGeod>& geods,
+                              std::vector<double>& alt,
+                              std::vector<bool>& valid,
+                              std::vector<const simgear::BVHMaterial*>* materials = 0,
+                              const osg::Node* butNotFrom = 0);
+
+    /// Approximate elevation of the scenery at the lon/lat of geod; the
+    /// elevation of geod is ignored. Meant for consumers which do not
+    /// need exact ground contact (probes, samplers, AI ground vehicles):
+    /// the result may be interpolated from memoized per-tile heights.
+    /// Returns false if there is no scenery at that position.
+    bool get_approx_elevation_m(const SGGeod& geod, double& alt);
+
     /// Compute the elevation of the scenery below the cartesian point pos.
     /// you the returned scenery altitude is not higher than the position
     /// pos plus an offset given with max_altoff.
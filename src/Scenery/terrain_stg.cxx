@@ -28,6 +28,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include <osg/Camera>
 #include <osg/Transform>
 #include <osg/MatrixTransform>
@@ -57,6 +61,8 @@
 #include <Main/fg_props.hxx>
 #include <GUI/MouseCursor.hxx>
 
+#include "heightfield.hxx"
+#include "MultiLineSegmentVisitor.hxx"
 #include "terrain_stg.hxx"
 
 using namespace flightgear;
@@ -221,6 +227,249 @@ private:
     bool _haveHit;
 };
 
+/**
+ * Like FGSceneryIntersect, but for a set of line segments at once.
+ * The scene graph is walked once for all active segments; each node is
+ * first tested against a sphere around all of them and only the segments
+ * hitting its bound are carried further down.
+ */
+class FGSceneryMultiIntersect : public osg::NodeVisitor {
+public:
+    FGSceneryMultiIntersect(const std::vector<SGLineSegmentd>& lineSegments,
+                            const osg::Node* skipNode) :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _lineSegments(lineSegments),
+        _materials(lineSegments.size(), 0),
+        _haveHit(lineSegments.size(), false),
+        _skipNode(skipNode)
+    { }
+
+    // restrict the next traversal to the given segments
+    void setActive(const std::vector<unsigned>& active)
+    {
+        _active = active;
+        updateBound();
+    }
+
+    bool getHaveHit(unsigned i) const
+    { return _haveHit[i]; }
+    const SGLineSegmentd& getLineSegment(unsigned i) const
+    { return _lineSegments[i]; }
+    const simgear::BVHMaterial* getMaterial(unsigned i) const
+    { return _materials[i]; }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (&node == _skipNode)
+            return;
+        std::vector<unsigned> active;
+        if (!selectActive(node.getBound(), active))
+            return;
+
+        SGSphered bound = _bound;
+        enter(active);
+        addBoundingVolume(node);
+        leave(active, bound);
+    }
+
+    virtual void apply(osg::Group& group)
+    {
+        if (&group == _skipNode)
+            return;
+        std::vector<unsigned> active;
+        if (!selectActive(group.getBound(), active))
+            return;
+
+        SGSphered bound = _bound;
+        enter(active);
+        traverse(group);
+        addBoundingVolume(group);
+        leave(active, bound);
+    }
+
+    virtual void apply(osg::Transform& transform)
+    { handleTransform(transform); }
+    virtual void apply(osg::Camera& camera)
+    {
+        if (camera.getRenderOrder() != osg::Camera::NESTED_RENDER)
+            return;
+        handleTransform(camera);
+    }
+    virtual void apply(osg::CameraView& transform)
+    { handleTransform(transform); }
+    virtual void apply(osg::MatrixTransform& transform)
+    { handleTransform(transform); }
+    virtual void apply(osg::PositionAttitudeTransform& transform)
+    { handleTransform(transform); }
+
+private:
+    void handleTransform(osg::Transform& transform)
+    {
+        if (&transform == _skipNode)
+            return;
+        // Hmm, may be this needs to be refined somehow ...
+        if (transform.getReferenceFrame() != osg::Transform::RELATIVE_RF)
+            return;
+
+        std::vector<unsigned> active;
+        if (!selectActive(transform.getBound(), active))
+            return;
+
+        osg::Matrix inverseMatrix;
+        if (!transform.computeWorldToLocalMatrix(inverseMatrix, this))
+            return;
+        osg::Matrix matrix;
+        if (!transform.computeLocalToWorldMatrix(matrix, this))
+            return;
+
+        // save the state of the segments entering the transform
+        std::vector<SGLineSegmentd> lineSegments;
+        std::vector<const simgear::BVHMaterial*> materials;
+        std::vector<bool> haveHit;
+        lineSegments.reserve(active.size());
+        materials.reserve(active.size());
+        haveHit.reserve(active.size());
+
+        SGMatrixd toLocal(inverseMatrix.ptr());
+        for (size_t k = 0; k < active.size(); ++k) {
+            unsigned i = active[k];
+            lineSegments.push_back(_lineSegments[i]);
+            materials.push_back(_materials[i]);
+            haveHit.push_back(_haveHit[i]);
+
+            _haveHit[i] = false;
+            _lineSegments[i] = _lineSegments[i].transform(toLocal);
+        }
+
+        SGSphered bound = _bound;
+        enter(active);
+        addBoundingVolume(transform);
+        traverse(transform);
+        leave(active, bound);
+
+        SGMatrixd toWorld(matrix.ptr());
+        for (size_t k = 0; k < active.size(); ++k) {
+            unsigned i = active[k];
+            if (_haveHit[i]) {
+                _lineSegments[i] = _lineSegments[i].transform(toWorld);
+            } else {
+                _lineSegments[i] = lineSegments[k];
+                _materials[i] = materials[k];
+                _haveHit[i] = haveHit[k];
+            }
+        }
+    }
+
+    // make the given segments the active set, the previous set is
+    // swapped into active
+    void enter(std::vector<unsigned>& active)
+    {
+        _active.swap(active);
+        updateBound();
+    }
+    void leave(std::vector<unsigned>& active, const SGSphered& bound)
+    {
+        _active.swap(active);
+        _bound = bound;
+    }
+
+    void updateBound()
+    {
+        _bound = SGSphered();
+        for (size_t k = 0; k < _active.size(); ++k) {
+            const SGLineSegmentd& lineSegment = _lineSegments[_active[k]];
+            _bound.expandBy(lineSegment.getStart());
+            _bound.expandBy(lineSegment.getEnd());
+        }
+    }
+
+    // collect the active segments intersecting the bound
+    bool selectActive(const osg::BoundingSphere& bound,
+                      std::vector<unsigned>& active) const
+    {
+        if (!bound.valid())
+            return false;
+
+        SGSphered sphere(toVec3d(toSG(bound._center)), bound._radius);
+        if (!intersects(_bound, sphere))
+            return false;
+
+        for (size_t k = 0; k < _active.size(); ++k) {
+            if (intersects(_lineSegments[_active[k]], sphere))
+                active.push_back(_active[k]);
+        }
+        return !active.empty();
+    }
+
+    simgear::BVHNode* getNodeBoundingVolume(osg::Node& node)
+    {
+        SGSceneUserData* userData = SGSceneUserData::getSceneUserData(&node);
+        if (!userData)
+            return 0;
+        return userData->getBVHNode();
+    }
+    void addBoundingVolume(osg::Node& node)
+    {
+        simgear::BVHNode* bvNode = getNodeBoundingVolume(node);
+        if (!bvNode)
+            return;
+
+        // Find ground intersection on the bvh nodes, all active segments
+        // in one walk of the tree
+        FGMultiLineSegmentVisitor lineSegmentVisitor(0/*startTime*/);
+        for (size_t k = 0; k < _active.size(); ++k)
+            lineSegmentVisitor.addLineSegment(_lineSegments[_active[k]]);
+        bvNode->accept(lineSegmentVisitor);
+
+        for (size_t k = 0; k < _active.size(); ++k) {
+            const FGMultiLineSegmentVisitor::Ray& ray = lineSegmentVisitor.getRay(k);
+            if (!ray.haveHit)
+                continue;
+            unsigned i = _active[k];
+            _lineSegments[i] = ray.lineSegment;
+            _materials[i] = ray.material;
+            _haveHit[i] = true;
+        }
+    }
+
+    std::vector<SGLineSegmentd> _lineSegments;
+    std::vector<const simgear::BVHMaterial*> _materials;
+    std::vector<bool> _haveHit;
+    const osg::Node* _skipNode;
+
+    // segments taking part in the current subtree and a sphere around them
+    std::vector<unsigned> _active;
+    SGSphered _bound;
+};
+
+/**
+ * Samples height fields by intersecting against a single tile's subgraph.
+ */
+class FGTileHeightSampler : public TileHeightField::Sampler {
+public:
+    FGTileHeightSampler(osg::Node* tileNode) :
+        _tileNode(tileNode)
+    { }
+
+    virtual bool sample(const SGGeod& geod, double& alt)
+    {
+        SGVec3d start = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, SG_MAX_ELEVATION_M));
+        SGVec3d end = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, -10000));
+
+        FGSceneryIntersect intersectVisitor(SGLineSegmentd(start, end), 0);
+        intersectVisitor.setTraversalMask(SG_NODEMASK_TERRAIN_BIT);
+        _tileNode->accept(intersectVisitor);
+        if (!intersectVisitor.getHaveHit())
+            return false;
+
+        alt = SGGeod::fromCart(intersectVisitor.getLineSegment().getEnd()).getElevationM();
+        return true;
+    }
+
+private:
+    osg::Node* _tileNode;
+};
+
 ////////////////////////////////////////////////////////////////////////////
 
 // Terrain Management system
@@ -249,6 +498,19 @@ void FGStgTerrain::init( osg::Group* terrain ) {
     // initialize the tile manager
     _tilemgr.init();
 
+    SGPropertyNode* heightField = fgGetNode("/sim/tile-cache/height-field", true);
+    _heightFieldEnabled = heightField->getNode("enabled", true);
+    if (_heightFieldEnabled->getType() == simgear::props::NONE)
+        _heightFieldEnabled->setBoolValue(true);
+    _heightFieldResolution = heightField->getNode("resolution", true);
+    if (_heightFieldResolution->getType() == simgear::props::NONE)
+        _heightFieldResolution->setIntValue(64);
+    _heightFieldHits = heightField->getNode("hits", true);
+    _heightFieldMisses = heightField->getNode("misses", true);
+    _heightFieldSamples = heightField->getNode("samples", true);
+    _heightFieldTiles = heightField->getNode("tiles", true);
+    _heightFieldMemory = heightField->getNode("memory-kb", true);
+
     // Toggle the setup flag.
     _inited = true;
 }
@@ -276,6 +538,12 @@ void FGStgTerrain::shutdown()
 void FGStgTerrain::update(double dt)
 {
     _tilemgr.update(dt);
+
+    _heightFieldHits->setLongValue(TileHeightField::get_hit_count());
+    _heightFieldMisses->setLongValue(TileHeightField::get_miss_count());
+    _heightFieldSamples->setLongValue(TileHeightField::get_sample_count());
+    _heightFieldTiles->setIntValue(TileHeightField::get_field_count());
+    _heightFieldMemory->setDoubleValue(TileHeightField::get_memory_size()/1024.0);
 }
 
 void FGStgTerrain::bind() 
@@ -334,6 +602,81 @@ FGStgTerrain::get_elevation_m(const SGGeod& geod, double& alt,
   return true;
 }
 
+bool
+FGStgTerrain::get_approx_elevation_m(const SGGeod& geod, double& alt)
+{
+  if (_heightFieldEnabled && _heightFieldEnabled->getBoolValue()) {
+      TileEntry* tile = _tilemgr.get_tile(SGBucket(geod));
+      if (tile && tile->is_loaded()) {
+          unsigned resolution = SGMisc<int>::clip(_heightFieldResolution->getIntValue(), 1, 1024);
+          FGTileHeightSampler sampler(tile->getNode());
+          if (tile->get_height_field(resolution)->get_elevation_m(geod, sampler, alt))
+              return true;
+          // holes in the field are answered by an exact query
+      }
+  }
+
+  return get_elevation_m(SGGeod::fromGeodM(geod, SG_MAX_ELEVATION_M), alt, 0);
+}
+
+unsigned
+FGStgTerrain::get_elevations_m(const std::vector<SGGeod>& geods,
+                               std::vector<double>& alt,
+                               std::vector<bool>& valid,
+                               std::vector<const simgear::BVHMaterial*>* materials,
+                               const osg::Node* butNotFrom)
+{
+  alt.assign(geods.size(), 0.0);
+  valid.assign(geods.size(), false);
+  if (materials)
+      materials->assign(geods.size(), 0);
+
+  // same downward segments as get_elevation_m, sorted by tile
+  std::vector<SGLineSegmentd> lineSegments;
+  std::vector<std::pair<long, unsigned> > tileOrder;
+  lineSegments.reserve(geods.size());
+  tileOrder.reserve(geods.size());
+  for (unsigned i = 0; i < geods.size(); ++i) {
+      SGGeod geodEnd = geods[i];
+      geodEnd.setElevationM(SGMiscd::min(geods[i].getElevationM() - 10, -10000));
+      lineSegments.push_back(SGLineSegmentd(SGVec3d::fromGeod(geods[i]),
+                                            SGVec3d::fromGeod(geodEnd)));
+      tileOrder.push_back(std::make_pair(SGBucket(geods[i]).gen_index(), i));
+  }
+  std::sort(tileOrder.begin(), tileOrder.end());
+
+  FGSceneryMultiIntersect intersectVisitor(lineSegments, butNotFrom);
+  intersectVisitor.setTraversalMask(SG_NODEMASK_TERRAIN_BIT);
+
+  // one traversal per tile, its probes are rejected together by all
+  // other tiles
+  std::vector<unsigned> group;
+  for (size_t j = 0; j < tileOrder.size(); ) {
+      long tile = tileOrder[j].first;
+      group.clear();
+      for (; (j < tileOrder.size()) && (tileOrder[j].first == tile); ++j)
+          group.push_back(tileOrder[j].second);
+
+      intersectVisitor.setActive(group);
+      terrain_branch->accept(intersectVisitor);
+  }
+
+  unsigned found = 0;
+  for (unsigned i = 0; i < geods.size(); ++i) {
+      if (!intersectVisitor.getHaveHit(i))
+          continue;
+      alt[i] = SGGeod::fromCart(intersectVisitor.getLineSegment(i).getEnd()).getElevationM();
+      valid[i] = true;
+      if (materials)
+          (*materials)[i] = intersectVisitor.getMaterial(i);
+      ++found;
+  }
+
+  SG_LOG(SG_TERRAIN, SG_DEBUG, "FGStgTerrain::get_elevations_m: " << found
+         << " of " << geods.size() << " points");
+  return found;
+}
+
 bool
 FGStgTerrain::get_cart_ground_intersection(const SGVec3d& pos, const SGVec3d& dir,
                                            SGVec3d& nearestHit,
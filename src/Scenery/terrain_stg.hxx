@@ -75,6 +75,19 @@ public:
                          const simgear::BVHMaterial** material,
                          const osg::Node* butNotFrom = 0);
 
+    /// Compute the elevations below a set of points, probes are grouped
+    /// by tile so each group is tested against one tile's subgraph.
+    unsigned get_elevations_m(const std::vector<SGGeod>& geods,
+                              std::vector<double>& alt,
+                              std::vector<bool>& valid,
+                              std::vector<const simgear::BVHMaterial*>* materials = 0,
+                              const osg::Node* butNotFrom = 0);
+
+    /// Approximate elevation interpolated from the height field of the
+    /// tile at geod, falls back to get_elevation_m when the tile is not
+    /// loaded or the height field cache is disabled.
+    bool get_approx_elevation_m(const SGGeod& geod, double& alt);
+
     /// Compute the elevation of the scenery below the cartesian point pos.
     /// you the returned scenery altitude is not higher than the position
     /// pos plus an offset given with max_altoff.
@@ -117,6 +130,12 @@ private:
     
     // terrain branch of scene graph
     osg::ref_ptr<osg::Group> terrain_branch;
+
+    // height field cache configuration and statistics
+    SGPropertyNode_ptr _heightFieldEnabled, _heightFieldResolution;
+    SGPropertyNode_ptr _heightFieldHits, _heightFieldMisses,
+                       _heightFieldSamples, _heightFieldTiles,
+                       _heightFieldMemory;
     
     bool _inited;
 };
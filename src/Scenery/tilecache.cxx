@@ -24,6 +24,8 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+
 #include <simgear/bucket/newbucket.hxx>
 #include <simgear/debug/logstream.hxx>
 #include <simgear/misc/sg_path.hxx>
@@ -31,30 +33,227 @@
 #include "tileentry.hxx"
 #include "tilecache.hxx"
 
+namespace
+{
+    // initial hash table size, must be a power of two
+    const size_t MIN_SLOTS = 64;
+}
+
 TileCache::TileCache( void ) :
-    max_cache_size(100), current_time(0.0)
+    _slot_mask(0), max_cache_size(100), current(0), current_time(0.0)
 {
-    tile_cache.clear();
+    rehash( MIN_SLOTS );
 }
 
 
 TileCache::~TileCache( void )
 {
-    tile_map_iterator it = tile_cache.begin();
-    for (; it != tile_cache.end(); ++it) {
-        TileEntry* tile = it->second;
+    for (size_t i = 0; i < _records.size(); ++i) {
+        TileEntry* tile = _records[i].tile;
         tile->removeFromSceneGraph();
         delete tile;
     }
 }
 
 
+// Hash slot for a bucket index.  Bucket indices of neighbouring tiles
+// differ mostly in their low bits, so spread them with a Fibonacci hash.
+unsigned TileCache::slot_of( long tile_index ) const {
+    unsigned long long h = static_cast<unsigned long long>(tile_index)
+                         * 0x9E3779B97F4A7C15ULL;
+    return static_cast<unsigned>(h >> 32) & _slot_mask;
+}
+
+
+int TileCache::find_record( long tile_index ) const {
+    for (unsigned s = slot_of( tile_index ); ; s = (s + 1) & _slot_mask) {
+        int record = _slots[s];
+        if (record < 0)
+            return -1;
+        if (_records[record].index == tile_index)
+            return record;
+    }
+}
+
+
+void TileCache::slot_insert( long tile_index, int record ) {
+    unsigned s = slot_of( tile_index );
+    while (_slots[s] >= 0)
+        s = (s + 1) & _slot_mask;
+    _slots[s] = record;
+}
+
+
+// Remove a bucket index from the hash table.  Uses backward shift
+// deletion, so lookups never need to skip over tombstones.
+void TileCache::slot_erase( long tile_index ) {
+    unsigned i = slot_of( tile_index );
+    while (_slots[i] >= 0 && _records[_slots[i]].index != tile_index)
+        i = (i + 1) & _slot_mask;
+    if (_slots[i] < 0)
+        return;
+
+    for (unsigned j = (i + 1) & _slot_mask; _slots[j] >= 0;
+         j = (j + 1) & _slot_mask) {
+        unsigned k = slot_of( _records[_slots[j]].index );
+        // move entry j into the hole at i unless its home slot k lies
+        // cyclically within (i, j]
+        bool stays = (i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j));
+        if (!stays) {
+            _slots[i] = _slots[j];
+            i = j;
+        }
+    }
+    _slots[i] = -1;
+}
+
+
+void TileCache::slot_update( long tile_index, int record ) {
+    unsigned s = slot_of( tile_index );
+    while (_records[_slots[s]].index != tile_index)
+        s = (s + 1) & _slot_mask;
+    _slots[s] = record;
+}
+
+
+void TileCache::rehash( size_t slot_count ) {
+    _slots.assign( slot_count, -1 );
+    _slot_mask = static_cast<unsigned>(slot_count - 1);
+    for (size_t i = 0; i < _records.size(); ++i)
+        slot_insert( _records[i].index, static_cast<int>(i) );
+}
+
+
+// Remove a record from all indices.  The last record is moved into the
+// gap, so the dense storage stays contiguous.
+void TileCache::erase_record( int record ) {
+    unqueue_expiry( record );
+    slot_erase( _records[record].index );
+
+    int last = static_cast<int>(_records.size()) - 1;
+    if (record != last) {
+        _records[record] = _records[last];
+        slot_update( _records[record].index, record );
+        for (int h = 0; h < NUM_HEAPS; ++h) {
+            int pos = _records[record].heap_pos[h];
+            if (pos >= 0)
+                _heap[h][pos] = record;
+        }
+    }
+    _records.pop_back();
+}
+
+
+// drop oldest tile with lowest priority first
+bool TileCache::heap_less( int a, int b ) const {
+    const TileEntry* ta = _records[a].tile;
+    const TileEntry* tb = _records[b].tile;
+    if (ta->get_time_expired() != tb->get_time_expired())
+        return ta->get_time_expired() < tb->get_time_expired();
+    return ta->get_priority() < tb->get_priority();
+}
+
+
+void TileCache::heap_swap( int heap, int i, int j ) {
+    std::vector<int>& h = _heap[heap];
+    std::swap( h[i], h[j] );
+    _records[h[i]].heap_pos[heap] = i;
+    _records[h[j]].heap_pos[heap] = j;
+}
+
+
+void TileCache::heap_sift_up( int heap, int i ) {
+    const std::vector<int>& h = _heap[heap];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!heap_less( h[i], h[parent] ))
+            break;
+        heap_swap( heap, i, parent );
+        i = parent;
+    }
+}
+
+
+void TileCache::heap_sift_down( int heap, int i ) {
+    const std::vector<int>& h = _heap[heap];
+    int n = static_cast<int>(h.size());
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < n && heap_less( h[left], h[smallest] ))
+            smallest = left;
+        if (right < n && heap_less( h[right], h[smallest] ))
+            smallest = right;
+        if (smallest == i)
+            break;
+        heap_swap( heap, i, smallest );
+        i = smallest;
+    }
+}
+
+
+void TileCache::heap_push( int heap, int record ) {
+    if (_records[record].heap_pos[heap] >= 0) {
+        heap_update( heap, record );
+        return;
+    }
+    std::vector<int>& h = _heap[heap];
+    h.push_back( record );
+    _records[record].heap_pos[heap] = static_cast<int>(h.size()) - 1;
+    heap_sift_up( heap, static_cast<int>(h.size()) - 1 );
+}
+
+
+void TileCache::heap_remove( int heap, int record ) {
+    int pos = _records[record].heap_pos[heap];
+    if (pos < 0)
+        return;
+    std::vector<int>& h = _heap[heap];
+    int last = static_cast<int>(h.size()) - 1;
+    if (pos != last)
+        heap_swap( heap, pos, last );
+    h.pop_back();
+    _records[record].heap_pos[heap] = -1;
+    if (pos < last) {
+        // restore the heap property for the element moved into the gap
+        int moved = h[pos];
+        heap_sift_up( heap, pos );
+        heap_sift_down( heap, _records[moved].heap_pos[heap] );
+    }
+}
+
+
+void TileCache::heap_update( int heap, int record ) {
+    if (_records[record].heap_pos[heap] < 0)
+        return;
+    heap_sift_up( heap, _records[record].heap_pos[heap] );
+    heap_sift_down( heap, _records[record].heap_pos[heap] );
+}
+
+
+void TileCache::queue_expiry( int record ) {
+    heap_push( EXPIRY_HEAP, record );
+    if (!_records[record].tile->is_loaded())
+        heap_push( EMPTY_HEAP, record );
+}
+
+
+void TileCache::unqueue_expiry( int record ) {
+    heap_remove( EXPIRY_HEAP, record );
+    heap_remove( EMPTY_HEAP, record );
+}
+
+
 // Free a tile cache entry
 void TileCache::entry_free( long tile_index ) {
     SG_LOG( SG_TERRAIN, SG_DEBUG, "FREEING CACHE ENTRY = " << tile_index );
-    TileEntry *tile = tile_cache[tile_index];
+    int record = find_record( tile_index );
+    if (record < 0)
+        return;
+    TileEntry *tile = _records[record].tile;
     tile->removeFromSceneGraph();
-    tile_cache.erase( tile_index );
+    erase_record( record );
     delete tile;
 }
 
@@ -66,7 +265,7 @@ void TileCache::init( void ) {
     SG_LOG( SG_TERRAIN, SG_INFO, "  max cache size = "
             << max_cache_size );
     SG_LOG( SG_TERRAIN, SG_INFO, "  current cache size = "
-            << tile_cache.size() );
+            << _records.size() );
 
     clear_cache();
 
@@ -76,70 +275,48 @@ void TileCache::init( void ) {
 
 // Search for the specified "bucket" in the cache
 bool TileCache::exists( const SGBucket& b ) const {
-    long tile_index = b.gen_index();
-    const_tile_map_iterator it = tile_cache.find( tile_index );
-
-    return ( it != tile_cache.end() );
+    return find_record( b.gen_index() ) >= 0;
 }
 
 
 // Return the index of a tile to be dropped from the cache, return -1 if
 // nothing available to be removed.
 long TileCache::get_drop_tile() {
-    long min_index = -1;
-    double min_time = DBL_MAX;
-    float priority = FLT_MAX;
-
-    tile_map_iterator current = tile_cache.begin();
-    tile_map_iterator end = tile_cache.end();
-
-    for ( ; current != end; ++current ) {
-        long index = current->first;
-        TileEntry *e = current->second;
-        if (( !e->is_current_view() )&&
-            ( e->is_expired(current_time) ))
-        {
-            if (e->is_expired(current_time - 1.0)&&
-                !e->is_loaded())
-            {
-                /* Immediately drop "empty" tiles which are no longer used/requested, and were last requested > 1 second ago...
-                 * Allow a 1 second timeout since an empty tiles may just be loaded...
-                 */
-                SG_LOG( SG_TERRAIN, SG_DEBUG, "    dropping an unused and empty tile");
-                min_index = index;
-                break;
-            }
-            if (( e->get_time_expired() < min_time )||
-                (( e->get_time_expired() == min_time)&&
-                 ( priority > e->get_priority())))
-            {
-                // drop oldest tile with lowest priority
-                min_time = e->get_time_expired();
-                priority = e->get_priority();
-                min_index = index;
-            }
-        }
+    // Tiles leave the "empty" heap lazily once they have been loaded,
+    // since a tile never returns to the unloaded state.
+    std::vector<int>& empty = _heap[EMPTY_HEAP];
+    while (!empty.empty() && _records[empty[0]].tile->is_loaded())
+        heap_remove( EMPTY_HEAP, empty[0] );
+
+    if (!empty.empty() &&
+        _records[empty[0]].tile->is_expired(current_time - 1.0))
+    {
+        /* Immediately drop "empty" tiles which are no longer used/requested, and were last requested > 1 second ago...
+         * Allow a 1 second timeout since an empty tiles may just be loaded...
+         */
+        SG_LOG( SG_TERRAIN, SG_DEBUG, "    dropping an unused and empty tile");
+        return _records[empty[0]].index;
     }
 
-    SG_LOG( SG_TERRAIN, SG_DEBUG, "    index = " << min_index );
-    SG_LOG( SG_TERRAIN, SG_DEBUG, "    min_time = " << min_time );
+    const std::vector<int>& expiry = _heap[EXPIRY_HEAP];
+    if (expiry.empty() ||
+        !_records[expiry[0]].tile->is_expired(current_time))
+        return -1;
+
+    const Record& oldest = _records[expiry[0]];
+    SG_LOG( SG_TERRAIN, SG_DEBUG, "    index = " << oldest.index );
+    SG_LOG( SG_TERRAIN, SG_DEBUG, "    min_time = "
+            << oldest.tile->get_time_expired() );
 
-    return min_index;
+    return oldest.index;
 }
 
 long TileCache::get_first_expired_tile() const
 {
-  const_tile_map_iterator current = tile_cache.begin();
-  const_tile_map_iterator end = tile_cache.end();
-  
-  for ( ; current != end; ++current ) {
-    TileEntry *e = current->second;
-    if (!e->is_current_view() && e->is_expired(current_time))
-    {
-      return current->first;
-    }
-  }
-  
+  const std::vector<int>& expiry = _heap[EXPIRY_HEAP];
+  if (!expiry.empty() && _records[expiry[0]].tile->is_expired(current_time))
+    return _records[expiry[0]].index;
+
   return -1; // no expired tile found
 }
 
@@ -147,40 +324,41 @@ long TileCache::get_first_expired_tile() const
 // Clear all flags indicating tiles belonging to the current view
 void TileCache::clear_current_view()
 {
-    tile_map_iterator current = tile_cache.begin();
-    tile_map_iterator end = tile_cache.end();
-
-    for ( ; current != end; ++current ) {
-        TileEntry *e = current->second;
+    for (size_t i = 0; i < _current_view.size(); ++i) {
+        int record = find_record( _current_view[i] );
+        if (record < 0)
+            continue;
+        TileEntry *e = _records[record].tile;
         if (e->is_current_view())
         {
             // update expiry time for tiles belonging to most recent position
             e->update_time_expired( current_time );
             e->set_current_view( false );
+            queue_expiry( record );
         }
     }
+    _current_view.clear();
 }
 
 // Clear a cache entry, note that the cache only holds pointers
 // and this does not free the object which is pointed to.
 void TileCache::clear_entry( long tile_index ) {
-    tile_cache.erase( tile_index );
+    int record = find_record( tile_index );
+    if (record >= 0)
+        erase_record( record );
 }
 
 
 // Clear all completely loaded tiles (ignores partially loaded tiles)
 void TileCache::clear_cache() {
     std::vector<long> indexList;
-    tile_map_iterator current = tile_cache.begin();
-    tile_map_iterator end = tile_cache.end();
 
-    for ( ; current != end; ++current ) {
-        long index = current->first;
-        TileEntry *e = current->second;
+    for (size_t i = 0; i < _records.size(); ++i) {
+        TileEntry *e = _records[i].tile;
         if ( e->is_loaded() ) {
             e->tile_bucket.make_bad();
-            // entry_free modifies tile_cache, so store index and call entry_free() later;
-            indexList.push_back( index);
+            // entry_free modifies the cache, so store index and call entry_free() later;
+            indexList.push_back( _records[i].index );
         }
     }
     for (unsigned int it = 0; it < indexList.size(); it++) {
@@ -194,9 +372,31 @@ void TileCache::clear_cache() {
 bool TileCache::insert_tile( TileEntry *e ) {
     // register tile in the cache
     long tile_index = e->get_tile_bucket().gen_index();
-    tile_cache[tile_index] = e;
+    int record = find_record( tile_index );
+    if (record >= 0) {
+        unqueue_expiry( record );
+        _records[record].tile = e;
+    } else {
+        Record r;
+        r.index = tile_index;
+        r.tile = e;
+        r.heap_pos[EXPIRY_HEAP] = r.heap_pos[EMPTY_HEAP] = -1;
+        _records.push_back( r );
+        record = static_cast<int>(_records.size()) - 1;
+
+        // keep the load factor at or below 1/2
+        if (_records.size() * 2 > _slots.size())
+            rehash( _slots.size() * 2 );
+        else
+            slot_insert( tile_index, record );
+    }
     e->update_time_expired(current_time);
 
+    if (e->is_current_view())
+        _current_view.push_back( tile_index );
+    else
+        queue_expiry( record );
+
     return true;
 }
 
@@ -206,6 +406,9 @@ void TileCache::request_tile(TileEntry* t,float priority,bool current_view,doubl
     if ((!current_view)&&(request_time<=0.0))
         return;
 
+    long tile_index = t->get_tile_bucket().gen_index();
+    int record = find_record( tile_index );
+
     // update priority when higher - or old request has expired
     if ((t->is_expired(current_time))||
          (priority > t->get_priority()))
@@ -216,10 +419,19 @@ void TileCache::request_tile(TileEntry* t,float priority,bool current_view,doubl
     if (current_view)
     {
         t->update_time_expired( current_time );
-        t->set_current_view( true );
+        if (!t->is_current_view()) {
+            t->set_current_view( true );
+            if (record >= 0) {
+                // current view tiles are never dropped
+                unqueue_expiry( record );
+                _current_view.push_back( tile_index );
+            }
+        }
     }
     else
     {
         t->update_time_expired( current_time+request_time );
+        if ((record >= 0)&&(!t->is_current_view()))
+            queue_expiry( record );
     }
 }
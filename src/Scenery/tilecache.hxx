@@ -25,6 +25,7 @@
 #define _TILECACHE_HXX
 
 #include <map>
+#include <vector>
 
 #include <simgear/bucket/newbucket.hxx>
 #include "tileentry.hxx"
@@ -32,32 +33,77 @@
 using std::map;
 
 // A class to store and manage a pile of tiles
+//
+// Tiles are kept in a dense array (iterated by the external traversal)
+// which is indexed by an open-addressing hash table keyed on the bucket
+// index.  Tiles not belonging to the current view are additionally kept
+// in indexed min-heaps ordered by (expiry time, priority), so finding
+// the next tile to drop does not require a scan of the whole cache.
 class TileCache {
-public:
-    typedef map < long, TileEntry * > tile_map;
-    typedef tile_map::iterator tile_map_iterator;
-    typedef tile_map::const_iterator const_tile_map_iterator;
 private:
+    // one cache entry in the dense storage array
+    struct Record {
+        long index;
+        TileEntry* tile;
+        int heap_pos[2];  // position in _heap[], -1 if not contained
+    };
+
+    enum {
+        EXPIRY_HEAP = 0,  // all tiles not belonging to the current view
+        EMPTY_HEAP,       // the subset which was not loaded when queued
+        NUM_HEAPS
+    };
+
     // cache storage space
-    tile_map tile_cache;
+    std::vector<Record> _records;
+
+    // open-addressing hash table (linear probing), holding positions
+    // in _records or -1 for an empty slot
+    std::vector<int> _slots;
+    unsigned _slot_mask;
+
+    // min-heaps of positions in _records
+    std::vector<int> _heap[NUM_HEAPS];
+
+    // bucket indices of tiles flagged as belonging to the current view
+    std::vector<long> _current_view;
 
     // maximum cache size
     int max_cache_size;
 
-    // pointers to allow an external linear traversal of cache entries
-    tile_map_iterator current;
+    // position to allow an external linear traversal of cache entries
+    size_t current;
 
     double current_time;
 
     // Free a tile cache entry
     void entry_free( long cache_index );
 
-public:
-    tile_map_iterator begin() { return tile_cache.begin(); }
-    tile_map_iterator end() { return tile_cache.end(); }
-    const_tile_map_iterator begin() const { return tile_cache.begin(); }
-    const_tile_map_iterator end() const { return tile_cache.end(); }
+    // hash table maintenance
+    unsigned slot_of( long tile_index ) const;
+    int find_record( long tile_index ) const;
+    void slot_insert( long tile_index, int record );
+    void slot_erase( long tile_index );
+    void slot_update( long tile_index, int record );
+    void rehash( size_t slot_count );
+
+    // remove a record from all indices and the dense storage
+    void erase_record( int record );
+
+    // heap maintenance
+    bool heap_less( int a, int b ) const;
+    void heap_swap( int heap, int i, int j );
+    void heap_sift_up( int heap, int i );
+    void heap_sift_down( int heap, int i );
+    void heap_push( int heap, int record );
+    void heap_remove( int heap, int record );
+    void heap_update( int heap, int record );
+
+    // (re)queue a record not belonging to the current view for expiry
+    void queue_expiry( int record );
+    void unqueue_expiry( int record );
 
+public:
     // Constructor
     TileCache();
 
@@ -88,12 +134,8 @@ public:
 
     // Return a pointer to the specified tile cache entry
     inline TileEntry *get_tile( const long tile_index ) const {
-	const_tile_map_iterator it = tile_cache.find( tile_index );
-	if ( it != tile_cache.end() ) {
-	    return it->second;
-	} else {
-	    return NULL;
-	}
+        int record = find_record( tile_index );
+        return ( record >= 0 ) ? _records[record].tile : NULL;
     }
 
     // Return a pointer to the specified tile cache entry
@@ -102,14 +144,14 @@ public:
     }
 
     // Return the cache size
-    inline size_t get_size() const { return tile_cache.size(); }
+    inline size_t get_size() const { return _records.size(); }
 
     // External linear traversal of cache
-    inline void reset_traversal() { current = tile_cache.begin(); }
-    inline bool at_end() { return current == tile_cache.end(); }
+    inline void reset_traversal() { current = 0; }
+    inline bool at_end() { return current >= _records.size(); }
     inline TileEntry *get_current() const {
-	// cout << "index = " << current->first << endl;
-	return current->second;
+	// cout << "index = " << _records[current].index << endl;
+	return _records[current].tile;
     }
     inline void next() { ++current; }
 
@@ -33,6 +33,7 @@
 #include <simgear/bucket/newbucket.hxx>
 #include <simgear/debug/logstream.hxx>
 
+#include "heightfield.hxx"
 #include "tileentry.hxx"
 
 using std::string;
@@ -44,7 +45,10 @@ TileEntry::TileEntry ( const SGBucket& b )
       _node( new osg::LOD ),
       _priority(-FLT_MAX),
       _current_view(false),
-      _time_expired(-1.0)
+      _time_expired(-1.0),
+      _time_requested(-1.0),
+      _load_reported(false),
+      _height_field(0)
 {
     tileFileName += ".stg";
     _node->setName(tileFileName);
@@ -60,7 +64,10 @@ TileEntry::TileEntry( const TileEntry& t )
   _node( new osg::LOD ),
   _priority(t._priority),
   _current_view(t._current_view),
-  _time_expired(t._time_expired)
+  _time_expired(t._time_expired),
+  _time_requested(t._time_requested),
+  _load_reported(t._load_reported),
+  _height_field(0)
 {
     _node->setName(tileFileName);
     // Give a default LOD range so that traversals that traverse
@@ -72,6 +79,18 @@ TileEntry::TileEntry( const TileEntry& t )
 // Destructor
 TileEntry::~TileEntry ()
 {
+    delete _height_field;
+}
+
+TileHeightField* TileEntry::get_height_field(unsigned resolution)
+{
+    if (_height_field && (_height_field->get_resolution() != resolution)) {
+        delete _height_field;
+        _height_field = 0;
+    }
+    if (!_height_field)
+        _height_field = new TileHeightField(tile_bucket, resolution);
+    return _height_field;
 }
 
 // Update the ssg transform node for this tile so it can be
@@ -42,6 +42,8 @@
 #include <osg/Group>
 #include <osg/LOD>
 
+class TileHeightField;
+
 /**
  * A class to encapsulate everything we need to know about a scenery tile.
  */
@@ -71,6 +73,12 @@ private:
     bool _current_view;
     /** Time when tile expires. */ 
     double _time_expired;
+    /** Time when tile was first requested, -1 when unknown. */
+    double _time_requested;
+    /** Flag indicating the load latency of this tile was recorded. */
+    bool _load_reported;
+    /** Memoized terrain elevations, created on first use. */
+    TileHeightField* _height_field;
 
 public:
 
@@ -120,6 +128,12 @@ public:
      */
     osg::LOD *getNode() const { return _node.get(); }
 
+    /**
+     * Return the height field of this tile with the given grid
+     * resolution, (re)creating it when needed.
+     */
+    TileHeightField* get_height_field(unsigned resolution);
+
     inline double get_time_expired() const { return _time_expired; }
     inline void update_time_expired( double time_expired ) { if (_time_expired<time_expired) _time_expired = time_expired; }
 
@@ -128,6 +142,11 @@ public:
     inline void set_current_view(bool current_view) { _current_view = current_view; }
     inline bool is_current_view() const { return _current_view; }
 
+    inline void set_time_requested(double time_requested) { _time_requested = time_requested; }
+    inline double get_time_requested() const { return _time_requested; }
+    inline void set_load_reported() { _load_reported = true; }
+    inline bool is_load_reported() const { return _load_reported; }
+
     /**
      * Return true if the tile entry is still needed, otherwise return false
      * indicating that the tile is no longer in active use.
@@ -48,6 +48,8 @@
 #include <Viewer/splash.hxx>
 #include <Scripting/NasalSys.hxx>
 #include <Scripting/NasalModelData.hxx>
+#include <Autopilot/route_mgr.hxx>
+#include <Navaids/route.hxx>
 
 #include "scenery.hxx"
 #include "SceneryPager.hxx"
@@ -55,6 +57,35 @@
 
 using flightgear::SceneryPager;
 
+namespace
+{
+    // view movements faster than this are jumps (view changes, resets)
+    const double MAX_VIEW_SPEED_MPS = 2000.0;
+    // time constant of the view velocity low-pass filter
+    const double VELOCITY_FILTER_SEC = 1.0;
+    // below this speed tiles are scheduled purely by distance
+    const double MIN_LOOKAHEAD_SPEED_MPS = 30.0;
+    // re-project the flight path at least this often
+    const double LOOKAHEAD_INTERVAL_SEC = 5.0;
+    // distance weights for tiles ahead of / behind the aircraft
+    const double AHEAD_WEIGHT = 0.5;
+    const double BEHIND_WEIGHT = 2.0;
+
+    /**
+     * Loading priority of a tile at (x, y) tiles from the view position,
+     * for a flight direction (dirX, dirY) given as unit vector in tile
+     * units. Tiles ahead are treated as closer than they are, tiles
+     * behind as farther away.
+     */
+    float directionalPriority(double x, double y, double dirX, double dirY)
+    {
+        double along = x*dirX + y*dirY;
+        double cross = x*dirY - y*dirX;
+        along *= (along > 0.0) ? AHEAD_WEIGHT : BEHIND_WEIGHT;
+        return (float)(-(along*along + cross*cross));
+    }
+}
+
 class FGTileMgr::TileManagerListener : public SGPropertyChangeListener
 {
 public:
@@ -121,7 +152,18 @@ FGTileMgr::FGTileMgr():
     _scenery_loaded(fgGetNode("/sim/sceneryloaded", true)),
     _scenery_override(fgGetNode("/sim/sceneryloaded-override", true)),
     _pager(FGScenery::getPagerSingleton()),
-    _enableCache(true)
+    _enableCache(true),
+    _lastViewPos(SGVec3d::zeros()),
+    _lastViewTime(-1.0),
+    _viewVelocity(SGVec3d::zeros()),
+    _lastLookaheadTime(-1.0),
+    _lookaheadEnabled(fgGetNode("/sim/tile-cache/lookahead/enabled", true)),
+    _lookaheadTime(fgGetNode("/sim/tile-cache/lookahead/time-sec", true)),
+    _latencyCount(fgGetNode("/sim/tile-cache/latency/count", true)),
+    _latencyLast(fgGetNode("/sim/tile-cache/latency/last-sec", true)),
+    _latencyMean(fgGetNode("/sim/tile-cache/latency/mean-sec", true)),
+    _latencyMax(fgGetNode("/sim/tile-cache/latency/max-sec", true)),
+    _latencySum(0.0)
 {
 }
 
@@ -229,6 +271,22 @@ void FGTileMgr::reinit()
     current_bucket.make_bad();
     scheduled_visibility = 100.0;
 
+    if (_lookaheadEnabled->getType() == simgear::props::NONE) {
+        _lookaheadEnabled->setBoolValue(true);
+    }
+    if (_lookaheadTime->getType() == simgear::props::NONE) {
+        _lookaheadTime->setDoubleValue(60.0);
+    }
+    _lastViewTime = -1.0;
+    _viewVelocity = SGVec3d::zeros();
+    _lastLookaheadTime = -1.0;
+
+    _latencySum = 0.0;
+    _latencyCount->setIntValue(0);
+    _latencyLast->setDoubleValue(0.0);
+    _latencyMean->setDoubleValue(0.0);
+    _latencyMax->setDoubleValue(0.0);
+
     // force an update now
     update(0.0);
 }
@@ -248,6 +306,7 @@ bool FGTileMgr::sched_tile( const SGBucket& b, double priority, bool current_vie
     {
         // create a new entry
         t = new TileEntry( b );
+        t->set_time_requested( tile_cache.get_current_time() );
         SG_LOG( SG_TERRAIN, SG_INFO, "sched_tile: new tile entry for:" << b );
 
 
@@ -317,6 +376,10 @@ void FGTileMgr::schedule_needed(const SGBucket& curr_bucket, double vis)
             = globals->get_renderer()->getViewer()->getFrameStamp();
     tile_cache.set_current_time(framestamp->getReferenceTime());
 
+    // when moving fast, prefer tiles ahead over tiles behind
+    double dirX = 0.0, dirY = 0.0;
+    bool directional = get_flight_direction(curr_bucket, dirX, dirY);
+
     SGBucket b;
 
     int x, y;
@@ -332,7 +395,8 @@ void FGTileMgr::schedule_needed(const SGBucket& curr_bucket, double vis)
                 continue;
             }
             
-            float priority = (-1.0) * (x*x+y*y);
+            float priority = directional ?
+                directionalPriority(x, y, dirX, dirY) : (-1.0) * (x*x+y*y);
             sched_tile( b, priority, true, 0.0 );
             
             if (_terra_sync) {
@@ -384,6 +448,9 @@ void FGTileMgr::update_queues(bool& isDownloadingScenery)
                     loading++;
                 }
             } // of tile not loaded case
+            else if (!e->is_load_reported()) {
+                record_load_latency(e, current_time);
+            }
         } else {
             SG_LOG(SG_TERRAIN, SG_ALERT, "Warning: empty tile in cache!");
         }
@@ -481,6 +548,11 @@ void FGTileMgr::schedule_tiles_at(const SGGeod& location, double range_m)
 
     current_bucket = SGBucket( location );
 
+    osg::FrameStamp* framestamp
+            = globals->get_renderer()->getViewer()->getFrameStamp();
+    double current_time = framestamp->getReferenceTime();
+    update_view_velocity(location, current_time);
+
     // schedule more tiles when visibility increased considerably
     // TODO Calculate tile size - instead of using fixed value (5000m)
     if (range_m - scheduled_visibility > 5000.0)
@@ -504,6 +576,9 @@ void FGTileMgr::schedule_tiles_at(const SGGeod& location, double range_m)
                    << ", visibility=" << range_m);
             scheduled_visibility = range_m;
             schedule_needed(current_bucket, range_m);
+            schedule_lookahead(location, current_time);
+        } else if (current_time - _lastLookaheadTime > LOOKAHEAD_INTERVAL_SEC) {
+            schedule_lookahead(location, current_time);
         }
         
         // save bucket
@@ -517,6 +592,135 @@ void FGTileMgr::schedule_tiles_at(const SGGeod& location, double range_m)
     last_state = state;
 }
 
+// Estimate the velocity of the view position from its movement between
+// frames. Low-pass filtered, since frame time jitter makes the raw
+// difference noisy.
+void FGTileMgr::update_view_velocity(const SGGeod& location, double current_time)
+{
+    SGVec3d pos = SGVec3d::fromGeod(location);
+    double dt = current_time - _lastViewTime;
+    if ((_lastViewTime < 0.0)||(dt > 1.0)) {
+        // no usable history (startup, reinit or a long stall)
+        _viewVelocity = SGVec3d::zeros();
+    } else if (dt > 0.0) {
+        SGVec3d velocity = (pos - _lastViewPos)/dt;
+        if (norm(velocity) > MAX_VIEW_SPEED_MPS) {
+            // view switched or position was reset, not actual movement
+            _viewVelocity = SGVec3d::zeros();
+        } else {
+            _viewVelocity += (velocity - _viewVelocity)*std::min(1.0, dt/VELOCITY_FILTER_SEC);
+        }
+    }
+    _lastViewPos = pos;
+    _lastViewTime = current_time;
+}
+
+bool FGTileMgr::get_flight_direction(const SGBucket& b, double& dirX, double& dirY) const
+{
+    if (!_lookaheadEnabled->getBoolValue())
+        return false;
+
+    // bucket x offsets run east, y offsets north
+    SGVec3d ned = SGQuatd::fromLonLat(b.get_center()).transform(_viewVelocity);
+    double speed = sqrt(ned[0]*ned[0] + ned[1]*ned[1]);
+    if (speed < MIN_LOOKAHEAD_SPEED_MPS)
+        return false;
+
+    double vx = ned[1] / b.get_width_m();
+    double vy = ned[0] / b.get_height_m();
+    double len = sqrt(vx*vx + vy*vy);
+    dirX = vx / len;
+    dirY = vy / len;
+    return true;
+}
+
+/* Schedule the buckets along the projected flight path, so tiles the
+ * aircraft is about to reach are loaded before they enter the visible
+ * range. The path follows the active route when there is one, otherwise
+ * it is projected along the current velocity. Requests are kept for the
+ * look-ahead time and expire normally afterwards. */
+void FGTileMgr::schedule_lookahead(const SGGeod& location, double current_time)
+{
+    _lastLookaheadTime = current_time;
+
+    double lookahead_time = _lookaheadTime->getDoubleValue();
+    double speed = norm(_viewVelocity);
+    if (!_lookaheadEnabled->getBoolValue() || (lookahead_time <= 0.0) ||
+        (speed < MIN_LOOKAHEAD_SPEED_MPS))
+        return;
+
+    double max_dist = speed*lookahead_time;
+    std::vector<SGVec3d> path;
+    path.push_back(SGVec3d::fromGeod(location));
+
+    FGRouteMgr* routeMgr = static_cast<FGRouteMgr*>(globals->get_subsystem("route-manager"));
+    if (routeMgr && routeMgr->isRouteActive()) {
+        double route_dist = 0.0;
+        for (int i = std::max(0, routeMgr->currentIndex());
+             (i < routeMgr->numLegs()) && (route_dist < max_dist); ++i) {
+            flightgear::Waypt* wpt = routeMgr->wayptAtIndex(i);
+            // dynamic waypoints have no fixed position to project to
+            if (!wpt || wpt->flag(flightgear::WPT_DYNAMIC))
+                continue;
+            SGVec3d pos = SGVec3d::fromGeod(wpt->position());
+            route_dist += dist(path.back(), pos);
+            path.push_back(pos);
+        }
+    }
+
+    if (path.size() < 2) {
+        path.push_back(path.front() + _viewVelocity*lookahead_time);
+    }
+
+    SGBucket bucket(location);
+    double tile_size = sqrt(bucket.get_width_m()*bucket.get_height_m());
+    double step = 0.5*std::min(bucket.get_width_m(), bucket.get_height_m());
+
+    // walk the path, scheduling each bucket once
+    SGBucket previous;
+    double along = 0.0;
+    for (unsigned int i = 1; (i < path.size()) && (along < max_dist); ++i) {
+        SGVec3d start = path[i-1];
+        double length = dist(start, path[i]);
+        SGVec3d dir = (length > 0.0) ? (path[i] - start)/length : SGVec3d::zeros();
+        for (double d = 0.0; (d < length) && (along + d < max_dist); d += step) {
+            SGBucket b(SGGeod::fromCart(start + dir*d));
+            if (!b.isValid() || (b == previous))
+                continue;
+            previous = b;
+
+            double tiles = (along + d) / tile_size;
+            float priority = directionalPriority(tiles, 0.0, 1.0, 0.0);
+            sched_tile( b, priority, false, lookahead_time );
+
+            if (_terra_sync) {
+                _terra_sync->scheduleTile(b);
+            }
+        }
+        along += length;
+    }
+}
+
+// Record how long a tile took from its first request until it was loaded
+void FGTileMgr::record_load_latency(TileEntry* e, double current_time)
+{
+    e->set_load_reported();
+    if (e->get_time_requested() < 0.0)
+        return;
+
+    double latency = current_time - e->get_time_requested();
+    int count = _latencyCount->getIntValue() + 1;
+    _latencySum += latency;
+    _latencyCount->setIntValue(count);
+    _latencyLast->setDoubleValue(latency);
+    _latencyMean->setDoubleValue(_latencySum / count);
+    if (latency > _latencyMax->getDoubleValue())
+        _latencyMax->setDoubleValue(latency);
+
+    SG_LOG( SG_TERRAIN, SG_DEBUG, "Tile " << e->get_tile_bucket()
+            << " loaded " << latency << "s after request" );
+}
+
 /** Schedules scenery for given position. Load request remains valid for given duration
  * (duration=0.0 => nothing is loaded).
  * Used for FDM/AI/groundcache/... requests. Viewer uses "schedule_tiles_at" instead.
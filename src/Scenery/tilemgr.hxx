@@ -27,6 +27,7 @@
 #include <simgear/compiler.h>
 
 #include <simgear/bucket/newbucket.hxx>
+#include <simgear/math/SGMath.hxx>
 #include "SceneryPager.hxx"
 #include "tilecache.hxx"
 
@@ -85,6 +86,19 @@ private:
     // schedule tiles for the viewer bucket
     void schedule_tiles_at(const SGGeod& location, double rangeM);
 
+    // update the estimated velocity of the view position
+    void update_view_velocity(const SGGeod& location, double current_time);
+
+    // direction of flight in tile units of the given bucket, returns
+    // false when not moving fast enough to prefer any direction
+    bool get_flight_direction(const SGBucket& b, double& dirX, double& dirY) const;
+
+    // schedule buckets along the projected flight path
+    void schedule_lookahead(const SGGeod& location, double current_time);
+
+    // record the request-to-load latency of a newly loaded tile
+    void record_load_latency(TileEntry* e, double current_time);
+
     SGPropertyNode_ptr _visibilityMeters;
     SGPropertyNode_ptr _maxTileRangeM, _disableNasalHooks;
     SGPropertyNode_ptr _scenery_loaded, _scenery_override;
@@ -93,6 +107,18 @@ private:
 
     /// is caching of expired tiles enabled or not?
     bool _enableCache;    
+
+    // view position tracking for the look-ahead scheduler
+    SGVec3d _lastViewPos;
+    double _lastViewTime;
+    SGVec3d _viewVelocity;
+    double _lastLookaheadTime;
+
+    SGPropertyNode_ptr _lookaheadEnabled, _lookaheadTime;
+
+    // tile load latency statistics
+    SGPropertyNode_ptr _latencyCount, _latencyLast, _latencyMean, _latencyMax;
+    double _latencySum;
 public:
     FGTileMgr();
     ~FGTileMgr();
@@ -105,6 +131,9 @@ public:
 
     const SGBucket& get_current_bucket () const { return current_bucket; }
 
+    // Return the cached tile for the given bucket, NULL if not cached
+    TileEntry* get_tile( const SGBucket& b ) const { return tile_cache.get_tile( b ); }
+
     // Returns true if scenery is available for the given lat, lon position
     // within a range of range_m.
     // lat and lon are expected to be in degrees.
@@ -23,6 +23,7 @@
 #endif
 
 #include <string.h>
+#include <vector>
 
 #include "NasalPositioned.hxx"
 
@@ -1093,23 +1094,12 @@ static naRef f_aircraftToCart(naContext c, naRef me, int argc, naRef* args)
     return pos_h;
 }
 
-// For given geodetic point return array with elevation, and a material data
-// hash, or nil if there's no information available (tile not loaded). If
-// information about the material isn't available, then nil is returned instead
-// of the hash.
-static naRef f_geodinfo(naContext c, naRef me, int argc, naRef* args)
+// Build the geodinfo() result vector: elevation and material data hash,
+// or nil instead of the hash if there's no material information.
+static naRef geodinfoToNasal(naContext c, double elev,
+                             const simgear::BVHMaterial* material)
 {
 #define HASHSET(s,l,n) naHash_set(matdata, naStr_fromdata(naNewString(c),s,l),n)
-  if(argc < 2 || argc > 3)
-    naRuntimeError(c, "geodinfo() expects 2 or 3 arguments: lat, lon [, maxalt]");
-  double lat = naNumValue(args[0]).num;
-  double lon = naNumValue(args[1]).num;
-  double elev = argc == 3 ? naNumValue(args[2]).num : 10000;
-  const simgear::BVHMaterial *material;
-  SGGeod geod = SGGeod::fromDegM(lon, lat, elev);
-  if(!globals->get_scenery()->get_elevation_m(geod, elev, &material))
-    return naNil();
-
   naRef vec = naNewVector(c);
   naVec_append(vec, naNum(elev));
 
@@ -1137,6 +1127,61 @@ static naRef f_geodinfo(naContext c, naRef me, int argc, naRef* args)
 #undef HASHSET
 }
 
+// For given geodetic point return array with elevation, and a material data
+// hash, or nil if there's no information available (tile not loaded). If
+// information about the material isn't available, then nil is returned instead
+// of the hash.
+static naRef f_geodinfo(naContext c, naRef me, int argc, naRef* args)
+{
+  if(argc < 2 || argc > 3)
+    naRuntimeError(c, "geodinfo() expects 2 or 3 arguments: lat, lon [, maxalt]");
+  double lat = naNumValue(args[0]).num;
+  double lon = naNumValue(args[1]).num;
+  double elev = argc == 3 ? naNumValue(args[2]).num : 10000;
+  const simgear::BVHMaterial *material;
+  SGGeod geod = SGGeod::fromDegM(lon, lat, elev);
+  if(!globals->get_scenery()->get_elevation_m(geod, elev, &material))
+    return naNil();
+
+  return geodinfoToNasal(c, elev, material);
+}
+
+// Vector version of geodinfo(): for a vector of [lat, lon] pairs return a
+// vector holding the geodinfo() result for each point (nil where there's no
+// scenery). All points are queried in one pass over the scenery.
+//
+// geodinfos([[lat, lon], ...] [, maxalt]);
+static naRef f_geodinfos(naContext c, naRef me, int argc, naRef* args)
+{
+  if(argc < 1 || argc > 2 || !naIsVector(args[0]))
+    naRuntimeError(c, "geodinfos() expects 1 or 2 arguments: [[lat, lon], ...] [, maxalt]");
+  double maxalt = argc == 2 ? naNumValue(args[1]).num : 10000;
+
+  int count = naVec_size(args[0]);
+  std::vector<SGGeod> geods;
+  geods.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    naRef point = naVec_get(args[0], i);
+    if (!naIsVector(point) || naVec_size(point) < 2)
+      naRuntimeError(c, "geodinfos() expects each point to be a vector [lat, lon]");
+    double lat = naNumValue(naVec_get(point, 0)).num;
+    double lon = naNumValue(naVec_get(point, 1)).num;
+    geods.push_back(SGGeod::fromDegM(lon, lat, maxalt));
+  }
+
+  std::vector<double> elevs;
+  std::vector<bool> valid;
+  std::vector<const simgear::BVHMaterial*> materials;
+  globals->get_scenery()->get_elevations_m(geods, elevs, valid, &materials);
+
+  naRef result = naNewVector(c);
+  for (int i = 0; i < count; ++i) {
+    naVec_append(result, valid[i] ? geodinfoToNasal(c, elevs[i], materials[i])
+                                  : naNil());
+  }
+  return result;
+}
+
 
 // Returns data hash for particular or nearest airport of a <type>, or nil
 // on error.
@@ -2627,6 +2672,7 @@ static struct { const char* name; naCFunction func; } funcs[] = {
   { "carttogeod", f_carttogeod },
   { "geodtocart", f_geodtocart },
   { "geodinfo", f_geodinfo },
+  { "geodinfos", f_geodinfos },
   { "get_cart_ground_intersection", f_get_cart_ground_intersection },
   { "aircraftToCart", f_aircraftToCart },
   { "airportinfo", f_airportinfo },
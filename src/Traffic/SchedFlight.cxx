@@ -46,6 +46,8 @@
 #include <fstream>
 
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -295,3 +297,84 @@ bool compareScheduledFlights(FGScheduledFlight *a, FGScheduledFlight *b)
 { 
   return (*a) < (*b); 
 };
+
+/// orders the heap of flights by indexed arrival time, earliest on top
+struct ArrivesLater
+{
+  template <class Entry>
+  bool operator()(const Entry& a, const Entry& b) const
+  {
+    return a.arrival > b.arrival;
+  }
+};
+
+const FGScheduledFlightIndex::DepartureMap&
+FGScheduledFlightIndex::departures(const std::string& req, const std::string& depId, time_t now)
+{
+  std::map<std::string, Requirement>::iterator r = requirements.find(req);
+  if (r == requirements.end()) {
+    r = requirements.insert(std::make_pair(req, Requirement())).first;
+    build(r->second, allFlights[req], now);
+  } else if (now < r->second.lastUpdate) {
+    // time went backwards, flights may need to move back a repetition
+    build(r->second, allFlights[req], now);
+  } else {
+    advance(r->second, now);
+  }
+
+  static const DepartureMap noFlights;
+  std::map<std::string, DepartureMap>::const_iterator d = r->second.byAirport.find(depId);
+  return (d == r->second.byAirport.end()) ? noFlights : d->second;
+}
+
+void FGScheduledFlightIndex::build(Requirement& r, FGScheduledFlightVec& flights, time_t now)
+{
+  r.byAirport.clear();
+  r.byArrival.clear();
+  r.byArrival.reserve(flights.size());
+  for (FGScheduledFlightVecIterator i = flights.begin(); i != flights.end(); i++) {
+    (*i)->adjustTime(now);
+    r.byArrival.push_back(Entry(*i));
+    insert(r, r.byArrival.back());
+  }
+  std::make_heap(r.byArrival.begin(), r.byArrival.end(), ArrivesLater());
+  r.lastUpdate = now;
+}
+
+void FGScheduledFlightIndex::advance(Requirement& r, time_t now)
+{
+  // flights which arrived already move on to their next repetition. A
+  // flight a schedule moved on by itself still arrived by its indexed
+  // time, and is found by that.
+  while (!r.byArrival.empty() && (r.byArrival.front().arrival < now)) {
+    std::pop_heap(r.byArrival.begin(), r.byArrival.end(), ArrivesLater());
+    Entry& e = r.byArrival.back();
+    erase(r, e);
+    e.flight->adjustTime(now);
+    e = Entry(e.flight);
+    insert(r, e);
+    std::push_heap(r.byArrival.begin(), r.byArrival.end(), ArrivesLater());
+  }
+  r.lastUpdate = now;
+}
+
+void FGScheduledFlightIndex::insert(Requirement& r, const Entry& e)
+{
+  r.byAirport[std::string()].insert(std::make_pair(e.departure, e.flight));
+  r.byAirport[e.flight->getDepartureId()].insert(std::make_pair(e.departure, e.flight));
+}
+
+void FGScheduledFlightIndex::erase(Requirement& r, const Entry& e)
+{
+  const std::string keys[2] = { std::string(), e.flight->getDepartureId() };
+  for (int k = 0; k < 2; k++) {
+    DepartureMap& departures = r.byAirport[keys[k]];
+    std::pair<DepartureMap::iterator, DepartureMap::iterator> range = departures.equal_range(e.departure);
+    for (DepartureMap::iterator i = range.first; i != range.second; ++i) {
+      if (i->second == e.flight) {
+        departures.erase(i);
+        break;
+      }
+    }
+  }
+}
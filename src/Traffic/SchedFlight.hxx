@@ -90,6 +90,7 @@ public:
   void setArrivalAirport  (const std::string& port) { arrId = port; };
   FGAirport *getDepartureAirport();
   FGAirport *getArrivalAirport  ();
+  const std::string& getDepartureId() { return depId; };
 
   int getCruiseAlt() { return cruiseAltitude; };
 
@@ -119,5 +120,65 @@ typedef std::map < std::string, FGScheduledFlightVec > FGScheduledFlightMap;
 
 bool compareScheduledFlights(FGScheduledFlight *a, FGScheduledFlight *b);
 
+/**
+ * Index of the scheduled flights of each aircraft requirement, by
+ * departure airport and departure time. Flights are kept adjusted to
+ * the current time: as time passes, only the flights which arrived
+ * are moved on to their next repetition, instead of adjusting and
+ * sorting all of them for each lookup.
+ */
+class FGScheduledFlightIndex
+{
+public:
+  typedef std::multimap<time_t, FGScheduledFlight*> DepartureMap;
+
+  FGScheduledFlightIndex(FGScheduledFlightMap& flights) : allFlights(flights) {};
+
+  /**
+   * Drop the index, i.e. when flights were added or removed.
+   */
+  void clear() { requirements.clear(); };
+
+  /**
+   * Flights for the given requirement departing from the given airport
+   * (or from anywhere, when empty), keyed by departure time, and
+   * adjusted to now.
+   */
+  const DepartureMap& departures(const std::string& req, const std::string& depId, time_t now);
+
+private:
+  /**
+   * A flight with the times it is indexed by. Schedules move flights on
+   * to their next repetition themselves (FGScheduledFlight::update()),
+   * so these may be outdated until the flight's entry is popped.
+   */
+  struct Entry
+  {
+    Entry(FGScheduledFlight* f) :
+      arrival(f->getArrivalTime()), departure(f->getDepartureTime()), flight(f) {};
+    time_t arrival;
+    time_t departure;
+    FGScheduledFlight* flight;
+  };
+
+  struct Requirement
+  {
+    Requirement() : lastUpdate(0) {};
+    time_t lastUpdate;
+    /// heap of the flights, earliest indexed arrival on top
+    std::vector<Entry> byArrival;
+    /// flights by indexed departure time and airport, "" maps all of them
+    std::map<std::string, DepartureMap> byAirport;
+  };
+
+  void build(Requirement& r, FGScheduledFlightVec& flights, time_t now);
+  void advance(Requirement& r, time_t now);
+  void insert(Requirement& r, const Entry& e);
+  void erase(Requirement& r, const Entry& e);
+
+  FGScheduledFlightMap& allFlights;
+  std::map<std::string, Requirement> requirements;
+};
+
 
 #endif
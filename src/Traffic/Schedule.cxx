@@ -36,6 +36,7 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <boost/foreach.hpp>
 
 #include <simgear/compiler.h>
@@ -75,7 +76,9 @@ FGAISchedule::FGAISchedule()
     courseToDest(0),
     initialized(false),
     valid(false),
-    scheduleComplete(false)
+    scheduleComplete(false),
+    nextEvent(0),
+    outOfRange(false)
 {
 }
 
@@ -104,7 +107,9 @@ FGAISchedule::FGAISchedule(const string& model,
       courseToDest(0),
       initialized(false),
       valid(true),
-      scheduleComplete(false)
+      scheduleComplete(false),
+      nextEvent(0),
+      outOfRange(false)
 {
   modelPath        = model; 
   livery           = lvry; 
@@ -149,6 +154,8 @@ FGAISchedule::FGAISchedule(const FGAISchedule &other)
   initialized        = other.initialized;
   valid              = other.valid;
   scheduleComplete   = other.scheduleComplete;
+  nextEvent          = other.nextEvent;
+  outOfRange         = other.outOfRange;
 }
 
 
@@ -207,6 +214,8 @@ bool FGAISchedule::update(time_t now, const SGVec3d& userCart)
          //remainingTimeEnroute,
          deptime = 0;
 
+  nextEvent = 0;
+  outOfRange = false;
   if (!valid) {
     return true; // processing complete
   }
@@ -216,6 +225,7 @@ bool FGAISchedule::update(time_t now, const SGVec3d& userCart)
   }
 
   if (!scheduleComplete) {
+      nextEvent = now;
       return false; // not ready yet, continue processing in next iteration
   }
 
@@ -248,6 +258,7 @@ bool FGAISchedule::update(time_t now, const SGVec3d& userCart)
     if (aiAircraft->getDie()) {
       aiAircraft = NULL;
     } else {
+      nextEvent = now + AIPOLLINTERVAL;
       return true; // in visual range, let the AIManager handle it
     }
   }
@@ -261,9 +272,18 @@ bool FGAISchedule::update(time_t now, const SGVec3d& userCart)
     // and detach it from the current list of aircraft. 
     flight->update();
     flights.erase(flights.begin()); // pop_front(), effectively
+    nextEvent = now; // continue with the next flight
     return true; // processing complete
   }
   
+  // nothing changes before the flight departs or has arrived, unless
+  // the user comes closer
+  if (flight->getDepartureTime() > now) {
+    nextEvent = flight->getDepartureTime();
+  } else {
+    nextEvent = flight->getArrivalTime() + 1;
+  }
+
   FGAirport* dep = flight->getDepartureAirport();
   FGAirport* arr = flight->getArrivalAirport();
   if (!dep || !arr) {
@@ -317,11 +337,15 @@ bool FGAISchedule::update(time_t now, const SGVec3d& userCart)
 	     << dep->getId() << " to " << arr->getId() << ". Current distance to user: " 
              << distanceToUser);
   if (distanceToUser >= TRAFFICTOAIDISTTOSTART) {
+    outOfRange = true;
     return true; // out of visual range, for the moment.
   }
 
   if (!createAIAircraft(flight, speed, deptime)) {
       valid = false;
+      nextEvent = 0;
+  } else {
+      nextEvent = now + AIPOLLINTERVAL;
   }
 
 
@@ -560,70 +584,39 @@ FGScheduledFlight* FGAISchedule::findAvailableFlight (const string &currentDesti
     time_t now = globals->get_time_params()->get_cur_time();
 
     FGTrafficManager *tmgr = (FGTrafficManager *) globals->get_subsystem("traffic-manager");
-    FGScheduledFlightVecIterator fltBegin, fltEnd;
-    fltBegin = tmgr->getFirstFlight(req);
-    fltEnd   = tmgr->getLastFlight(req);
+    // flights for this requirement, departing from our current destination
+    // (or from anywhere), ordered by departure time
+    const FGScheduledFlightIndex::DepartureMap& departures =
+        tmgr->getFlightIndex().departures(req, currentDestination, now);
+
+    // is departure time later than planned arrival?
+    time_t earliest = std::numeric_limits<time_t>::min();
+    if (! flights.empty()) {
+        earliest = flights.back()->getArrivalTime() + groundTimeFromRadius();
+    }
+    if (min != 0) {
+        earliest = std::max(earliest, min);
+    }
 
+    for (FGScheduledFlightIndex::DepartureMap::const_iterator i = departures.lower_bound(earliest);
+         i != departures.end(); ++i) {
+        FGScheduledFlight* flight = i->second;
+        if ((min != 0) && (i->first > max)) {
+            break;
+        }
+        if (!flight->isAvailable()) {
+            continue;
+        }
+        // are departure and arrival ports valid?
+        if (!(flight->getArrivalAirport() && flight->getDepartureAirport())) {
+            continue;
+        }
 
-     //cerr << "Finding available flight " << endl;
-     // For Now:
-     // Traverse every registered flight
-     if (fltBegin == fltEnd) {
-          //cerr << "No Flights Scheduled for " << req << endl;
-     }
-     int counter = 0;
-     for (FGScheduledFlightVecIterator i = fltBegin; i != fltEnd; i++) {
-          (*i)->adjustTime(now);
-           //sort(fltBegin, fltEnd, compareScheduledFlights);
-           //cerr << counter++ << endl;
-     }
-     std::sort(fltBegin, fltEnd, compareScheduledFlights);
-     for (FGScheduledFlightVecIterator i = fltBegin; i != fltEnd; i++) {
-          //bool valid = true;
-          counter++;
-          if (!(*i)->isAvailable()) {
-               //cerr << (*i)->getCallSign() << "is no longer available" << endl;
-               continue;
-          }
-          if (!((*i)->getRequirement() == req)) {
-               continue;
-          }
-          if (!(((*i)->getArrivalAirport()) && ((*i)->getDepartureAirport()))) {
-              continue;
-          }
-          if (!(currentDestination.empty())) {
-              if (currentDestination != (*i)->getDepartureAirport()->getId()) {
-                   //cerr << (*i)->getCallSign() << "Doesn't match destination" << endl;
-                   //cerr << "Current Destination " << currentDestination << "Doesnt match flight's " <<
-                   //          (*i)->getArrivalAirport()->getId() << endl;
-                   continue;
-              }
-          }
-          if (! flights.empty()) {
-            time_t arrival = flights.back()->getArrivalTime();
-            int groundTime = groundTimeFromRadius();
-            if ((*i)->getDepartureTime() < (arrival+(groundTime)))
-                continue;
-          }
-          if (min != 0) {
-              time_t dep = (*i)->getDepartureTime();
-              if ((dep < min) || (dep > max))
-                  continue;
-          }
-
-          // So, if we actually get here, we have a winner
-          //cerr << "found flight: " << req << " : " << currentDestination << " : " <<       
-          //         (*i)->getArrivalAirport()->getId() << endl;
-          (*i)->lock();
-          return (*i);
-     }
-     // matches req?
-     // if currentDestination has a value, does it match departure of next flight?
-     // is departure time later than planned arrival?
-     // is departure port valid?
-     // is arrival port valid?
-     //cerr << "Ack no flight found: " << endl;
-     return NULL;
+        // So, if we actually get here, we have a winner
+        flight->lock();
+        return flight;
+    }
+    return NULL;
 }
 
 int FGAISchedule::groundTimeFromRadius()
@@ -29,8 +29,12 @@
 #ifndef _FGSCHEDULE_HXX_
 #define _FGSCHEDULE_HXX_
 
+#include <vector>
+
 #define TRAFFICTOAIDISTTOSTART 150.0
 #define TRAFFICTOAIDISTTODIE   200.0
+// seconds between checks whether an AI aircraft of a schedule still exists
+#define AIPOLLINTERVAL         10
 
 // forward decls
 class FGAIAircraft;
@@ -66,6 +70,8 @@ class FGAISchedule
   bool initialized;
   bool valid;
   bool scheduleComplete;
+  time_t nextEvent;
+  bool outOfRange;
 
   bool scheduleFlights(time_t now);
   int groundTimeFromRadius();
@@ -102,6 +108,19 @@ class FGAISchedule
     static SGPath resolveModelPath(const std::string& model);
     
   bool update(time_t now, const SGVec3d& userCart);
+
+  /**
+   * Sim time when update() needs to be called again at the latest, i.e.
+   * the next departure or arrival. Only valid after an update(); 0 when
+   * the schedule has nothing left to do.
+   */
+  time_t getNextEvent() const { return nextEvent; }
+  /**
+   * True when the last update() found the aircraft too far from the user
+   * for AI traffic, in which case getDistanceToUser() is valid.
+   */
+  bool isOutOfRange() const { return outOfRange; }
+  double getDistanceToUser() const { return distanceToUser; }
   bool init();
 
   double getSpeed         ();
@@ -0,0 +1,167 @@
+// ScheduleWheel.hxx -- Ordering traffic schedules by their next update
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _FGSCHEDULEWHEEL_HXX_
+#define _FGSCHEDULEWHEEL_HXX_
+
+#include <algorithm>
+#include <ctime>
+#include <queue>
+#include <vector>
+
+/**
+ * Schedules waiting for their next update, as a time wheel with a slot
+ * per second of sim time. Schedules due further ahead than the wheel
+ * spans are simply updated early. Due schedules are handed out nearest
+ * to the user first.
+ *
+ * The schedules are only held, never looked at: the traffic manager
+ * queues FGAISchedule, with the distance each had to the user at its
+ * last update.
+ */
+template <class Schedule>
+class FGScheduleWheel
+{
+public:
+  enum { Slots = 4096 };
+
+  FGScheduleWheel() :
+    slots(Slots),
+    current(0),
+    started(false),
+    waiting(0),
+    sequence(0)
+  {
+  }
+
+  void clear()
+  {
+    for (size_t i = 0; i < slots.size(); ++i) {
+      slots[i].clear();
+    }
+    ready = std::priority_queue<ReadyEntry>();
+    started = false;
+    waiting = 0;
+  }
+
+  /**
+   * Queue the schedule for an update at sim time due. distance orders
+   * the schedules due at the same time, 0 for the ones in range.
+   */
+  void insert(Schedule* schedule, time_t due, double distance)
+  {
+    if (!started || (due <= current)) {
+      makeReady(schedule, distance);
+      return;
+    }
+
+    due = std::min<time_t>(due, current + Slots - 1);
+    Entry e = { schedule, due, distance };
+    slots[due % Slots].push_back(e);
+    waiting++;
+  }
+
+  /**
+   * Make the schedules due by now ready. Returns false, without doing
+   * anything, when time went backwards.
+   */
+  bool advance(time_t now)
+  {
+    if (!started) {
+      current = now;
+      started = true;
+      return true;
+    }
+    if (now < current) {
+      return false;
+    }
+
+    // after large jumps, every slot is processed once
+    time_t last = std::min<time_t>(now, current + Slots);
+    for (time_t t = current + 1; t <= last; ++t) {
+      std::vector<Entry>& slot = slots[t % Slots];
+      size_t kept = 0;
+      for (size_t i = 0; i < slot.size(); ++i) {
+        if (slot[i].due <= now) {
+          makeReady(slot[i].schedule, slot[i].distance);
+          waiting--;
+        } else {
+          slot[kept++] = slot[i];
+        }
+      }
+      slot.resize(kept);
+    }
+    current = now;
+    return true;
+  }
+
+  /** Take the next ready schedule. */
+  Schedule* popReady()
+  {
+    if (ready.empty()) {
+      return NULL;
+    }
+    Schedule* schedule = ready.top().schedule;
+    ready.pop();
+    return schedule;
+  }
+
+  size_t readyCount() const { return ready.size(); }
+  /** All queued schedules, ready or not. */
+  size_t size() const { return ready.size() + waiting; }
+
+private:
+  struct Entry
+  {
+    Schedule* schedule;
+    time_t due;
+    double distance;
+  };
+
+  struct ReadyEntry
+  {
+    Schedule* schedule;
+    double distance;
+    unsigned long sequence;
+
+    // priority_queue puts the greatest first: the nearest, then the
+    // longest waiting
+    bool operator<(const ReadyEntry& other) const
+    {
+      if (distance != other.distance)
+        return distance > other.distance;
+      return sequence > other.sequence;
+    }
+  };
+
+  void makeReady(Schedule* schedule, double distance)
+  {
+    ReadyEntry e;
+    e.schedule = schedule;
+    e.distance = distance;
+    e.sequence = sequence++;
+    ready.push(e);
+  }
+
+  std::vector<std::vector<Entry> > slots;
+  std::priority_queue<ReadyEntry> ready;
+  time_t current;          // slots up to this time have been processed
+  bool started;
+  size_t waiting;
+  unsigned long sequence;
+};
+
+#endif
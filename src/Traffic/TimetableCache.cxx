@@ -0,0 +1,285 @@
+// TimetableCache.cxx - binary cache of the parsed traffic schedules
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string.h>
+#include <algorithm>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
+
+#include "TimetableCache.hxx"
+
+/*
+ * Layout of the cache file. Numbers are stored in host byte order, the
+ * file is only ever read on the machine that wrote it.
+ *
+ *   magic, version
+ *   traffic files and included files: count, then path and mtime each
+ *   aircraft: count, then the fields of FGTimetableAircraft each
+ *   flights: count, then the fields of FGTimetableFlight each
+ */
+static const char TimetableMagic[] = "FGTimetableCache";
+static const uint32_t TimetableVersion = 1;
+
+/* sanity limit for strings read from the file */
+static const uint32_t MaxSize = 64*1024*1024;
+
+/* the least number of bytes each kind of record takes in the file */
+static const size_t SourceMinSize = sizeof(uint32_t) + sizeof(int64_t);
+static const size_t AircraftMinSize = 9*sizeof(uint32_t) + 2*sizeof(double) + 1;
+static const size_t FlightMinSize = 8*sizeof(uint32_t) + sizeof(int32_t);
+
+template <class T>
+static void
+writeValue(std::ostream& output, T value)
+{
+    output.write((const char*) &value, sizeof(T));
+}
+
+template <class T>
+static bool
+readValue(std::istream& input, T& value)
+{
+    input.read((char*) &value, sizeof(T));
+    return !input.fail();
+}
+
+static void
+writeString(std::ostream& output, const std::string& s)
+{
+    writeValue<uint32_t>(output, s.size());
+    output.write(s.data(), s.size());
+}
+
+static bool
+readString(std::istream& input, std::string& s)
+{
+    uint32_t size = 0;
+    if (!readValue(input, size) || (size > MaxSize))
+        return false;
+    s.resize(size);
+    if (size)
+        input.read(&s[0], size);
+    return !input.fail();
+}
+
+/* the number of records of recordSize bytes the rest of the file can
+   hold, to check counts read from it before allocating for them */
+static uint32_t
+recordsLeft(std::istream& input, uint64_t fileSize, size_t recordSize)
+{
+    std::streamoff pos = input.tellg();
+    if ((pos < 0) || (uint64_t(pos) > fileSize))
+        return 0;
+    return std::min<uint64_t>((fileSize - pos)/recordSize, MaxSize);
+}
+
+static void
+writeSources(std::ostream& output, const FGTimetable::SourceList& sources)
+{
+    writeValue<uint32_t>(output, sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        writeString(output, sources[i].path);
+        writeValue<int64_t>(output, sources[i].modTime);
+    }
+}
+
+static bool
+readSources(std::istream& input, uint64_t fileSize,
+            FGTimetable::SourceList& sources)
+{
+    uint32_t count = 0;
+    if (!readValue(input, count) ||
+        (count > recordsLeft(input, fileSize, SourceMinSize)))
+        return false;
+    sources.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!readString(input, sources[i].path) ||
+            !readValue(input, sources[i].modTime))
+            return false;
+    }
+    return true;
+}
+
+FGTimetable::Source FGTimetable::source(const SGPath& path)
+{
+    Source s;
+    s.path = path.utf8Str();
+    s.modTime = path.modTime();
+    return s;
+}
+
+void FGTimetable::clear()
+{
+    files.clear();
+    includes.clear();
+    aircraft.clear();
+    flights.clear();
+}
+
+void FGTimetable::append(const FGTimetable& other)
+{
+    files.insert(files.end(), other.files.begin(), other.files.end());
+    includes.insert(includes.end(), other.includes.begin(), other.includes.end());
+    aircraft.insert(aircraft.end(), other.aircraft.begin(), other.aircraft.end());
+    flights.insert(flights.end(), other.flights.begin(), other.flights.end());
+}
+
+bool FGTimetable::save(const SGPath& path) const
+{
+    SGPath p(path);
+    // create the directories of the file (not the file itself)
+    if (!p.exists())
+        p.create_dir(0755);
+
+    sg_ofstream output(p, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (output.fail()) {
+        SG_LOG(SG_AI, SG_WARN, "Traffic Manager: cannot write timetable cache " << path);
+        return false;
+    }
+
+    output.write(TimetableMagic, sizeof(TimetableMagic));
+    writeValue<uint32_t>(output, TimetableVersion);
+    writeSources(output, files);
+    writeSources(output, includes);
+
+    writeValue<uint32_t>(output, aircraft.size());
+    for (size_t i = 0; i < aircraft.size(); ++i) {
+        const FGTimetableAircraft& a = aircraft[i];
+        writeString(output, a.model);
+        writeString(output, a.livery);
+        writeString(output, a.homePort);
+        writeString(output, a.registration);
+        writeString(output, a.flightId);
+        writeString(output, a.acType);
+        writeString(output, a.airline);
+        writeString(output, a.perfClass);
+        writeString(output, a.flightType);
+        writeValue<double>(output, a.radius);
+        writeValue<double>(output, a.offset);
+        writeValue<uint8_t>(output, a.heavy);
+    }
+
+    writeValue<uint32_t>(output, flights.size());
+    for (size_t i = 0; i < flights.size(); ++i) {
+        const FGTimetableFlight& f = flights[i];
+        writeString(output, f.callsign);
+        writeString(output, f.fltRules);
+        writeString(output, f.departurePort);
+        writeString(output, f.arrivalPort);
+        writeString(output, f.departureTime);
+        writeString(output, f.arrivalTime);
+        writeString(output, f.repeat);
+        writeString(output, f.requiredAircraft);
+        writeValue<int32_t>(output, f.cruiseAlt);
+    }
+
+    output.close();
+    if (output.fail()) {
+        SG_LOG(SG_AI, SG_WARN, "Traffic Manager: error writing timetable cache " << path);
+        p.remove();
+        return false;
+    }
+    return true;
+}
+
+bool FGTimetable::load(const SGPath& path, const SourceList& currentFiles)
+{
+    clear();
+    if (!path.exists())
+        return false;
+
+    sg_ifstream input(path, std::ios::binary | std::ios::in);
+    uint64_t fileSize = path.sizeInBytes();
+    char magic[sizeof(TimetableMagic)];
+    uint32_t version = 0;
+    input.read(magic, sizeof(magic));
+    if (input.fail() || memcmp(magic, TimetableMagic, sizeof(magic)) ||
+        !readValue(input, version) || (version != TimetableVersion)) {
+        SG_LOG(SG_AI, SG_INFO, "Traffic Manager: discarding outdated timetable cache " << path);
+        return false;
+    }
+
+    if (!readSources(input, fileSize, files) ||
+        !readSources(input, fileSize, includes)) {
+        clear();
+        return false;
+    }
+
+    // outdated when files were added, removed or modified
+    bool upToDate = (files == currentFiles);
+    for (size_t i = 0; upToDate && (i < includes.size()); ++i) {
+        upToDate = (source(SGPath::fromUtf8(includes[i].path)) == includes[i]);
+    }
+    if (!upToDate) {
+        SG_LOG(SG_AI, SG_INFO, "Traffic Manager: traffic files changed, not using timetable cache");
+        clear();
+        return false;
+    }
+
+    uint32_t count = 0;
+    bool ok = readValue(input, count) &&
+              (count <= recordsLeft(input, fileSize, AircraftMinSize));
+    if (ok)
+        aircraft.resize(count);
+    for (size_t i = 0; ok && (i < aircraft.size()); ++i) {
+        FGTimetableAircraft& a = aircraft[i];
+        uint8_t heavy = 0;
+        ok = readString(input, a.model) &&
+             readString(input, a.livery) &&
+             readString(input, a.homePort) &&
+             readString(input, a.registration) &&
+             readString(input, a.flightId) &&
+             readString(input, a.acType) &&
+             readString(input, a.airline) &&
+             readString(input, a.perfClass) &&
+             readString(input, a.flightType) &&
+             readValue(input, a.radius) &&
+             readValue(input, a.offset) &&
+             readValue(input, heavy);
+        a.heavy = (heavy != 0);
+    }
+
+    ok = ok && readValue(input, count) &&
+         (count <= recordsLeft(input, fileSize, FlightMinSize));
+    if (ok)
+        flights.resize(count);
+    for (size_t i = 0; ok && (i < flights.size()); ++i) {
+        FGTimetableFlight& f = flights[i];
+        int32_t cruiseAlt = 0;
+        ok = readString(input, f.callsign) &&
+             readString(input, f.fltRules) &&
+             readString(input, f.departurePort) &&
+             readString(input, f.arrivalPort) &&
+             readString(input, f.departureTime) &&
+             readString(input, f.arrivalTime) &&
+             readString(input, f.repeat) &&
+             readString(input, f.requiredAircraft) &&
+             readValue(input, cruiseAlt);
+        f.cruiseAlt = cruiseAlt;
+    }
+
+    if (!ok) {
+        SG_LOG(SG_AI, SG_WARN, "Traffic Manager: corrupt timetable cache " << path);
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+// TimetableCache.hxx - binary cache of the parsed traffic schedules
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef _FG_TIMETABLECACHE_HXX
+#define _FG_TIMETABLECACHE_HXX
+
+#include <string>
+#include <vector>
+
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/misc/stdint.hxx>
+
+/**
+ * An aircraft of the traffic schedules, as read from the XML files.
+ */
+struct FGTimetableAircraft
+{
+    std::string model, livery, homePort, registration, flightId,
+        acType, airline, perfClass, flightType;
+    double radius, offset;
+    bool heavy;
+};
+
+/**
+ * A flight of the traffic schedules, as read from the XML files.
+ */
+struct FGTimetableFlight
+{
+    std::string callsign, fltRules, departurePort, arrivalPort,
+        departureTime, arrivalTime, repeat, requiredAircraft;
+    int cruiseAlt;
+};
+
+/**
+ * The traffic schedules, together with the files they were read from.
+ * Saved to and loaded from a binary file, so the XML files only need
+ * parsing again when one of them was added, removed or modified.
+ */
+class FGTimetable
+{
+public:
+    struct Source
+    {
+        std::string path;
+        int64_t modTime;
+
+        bool operator==(const Source& other) const
+        { return (modTime == other.modTime) && (path == other.path); }
+    };
+    typedef std::vector<Source> SourceList;
+
+    /** Describe the file by its current modification time. */
+    static Source source(const SGPath& path);
+
+    void clear();
+    /** Append the contents of another timetable. */
+    void append(const FGTimetable& other);
+
+    bool save(const SGPath& path) const;
+
+    /**
+     * Load the timetable, if it was read from the given files and
+     * the files it included haven't changed since.
+     */
+    bool load(const SGPath& path, const SourceList& files);
+
+    SourceList files;     // the traffic files, in parsing order
+    SourceList includes;  // files included by the traffic files
+    std::vector<FGTimetableAircraft> aircraft;
+    std::vector<FGTimetableFlight> flights;
+};
+
+#endif // _FG_TIMETABLECACHE_HXX
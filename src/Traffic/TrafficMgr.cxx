@@ -50,6 +50,8 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <thread>
 #include <boost/foreach.hpp>
 
 #include <simgear/compiler.h>
@@ -77,6 +79,7 @@
 #include <Main/fg_props.hxx>
 
 #include "TrafficMgr.hxx"
+#include "TimetableCache.hxx"
 
 using std::sort;
 using std::strcmp;
@@ -84,61 +87,74 @@ using std::endl;
 using std::string;
 using std::vector;
 
+// upper limit of the speed of scheduled traffic
+static const double MAXTRAFFICSPEEDKTS = 600.0;
+// moving further within one frame is taken as a relocation of the user
+static const double USERJUMPDISTANCEM = 20000.0;
+
+// schedules in range go first, the others by how far away they were
+static double wheelDistance(const FGAISchedule* schedule)
+{
+    return schedule->isOutOfRange() ? schedule->getDistanceToUser() : 0.0;
+}
+
 /**
- * Thread encapsulating parsing the traffic schedules.
+ * Reads traffic schedule files into a timetable. Every parsing thread
+ * uses its own parser, so they don't share any parser state.
  */
-class ScheduleParseThread : public SGThread, public XMLVisitor
+class ScheduleFileParser : public XMLVisitor
 {
 public:
-  ScheduleParseThread(FGTrafficManager* traffic) :
-    _trafficManager(traffic),
-    _isFinished(false),
-    _cancelThread(false),
+  ScheduleFileParser() :
     cruiseAlt(0),
-    score(0),
     acCounter(0),
     radius(0),
     offset(0),
     heavy(false)
   {
-
   }
 
-  // if we're destroyed while running, ensure the thread exits cleanly
-  ~ScheduleParseThread()
+  void parse(const SGPath& path)
   {
-    _lock.lock();
-    if (!_isFinished) {
-      _cancelThread = true; // request cancellation so we don't wait ages
-      _lock.unlock();
-      join();
-    } else {
-      _lock.unlock();
+    try {
+      readXML(path, *this);
+    } catch (const sg_exception& e) {
+      SG_LOG(SG_AI, SG_ALERT, "Traffic Manager: error reading " << path
+             << ": " << e.getFormattedMessage());
     }
   }
 
-  void setTrafficDirs(const PathList& dirs)
+  const FGTimetable& timetable() const
   {
-    _trafficDirPaths = dirs;
+    return _timetable;
   }
 
-  bool isFinished() const
+  /**
+   * Number of aircraft ids generated for aircraft without
+   * required-aircraft element. They count up from 0 for every parser.
+   */
+  int generatedIds() const
   {
-    SGGuard<SGMutex> g(_lock);
-    return _isFinished;
+    return acCounter;
   }
 
-  virtual void run()
+  /**
+   * Shift the generated aircraft ids by first, to keep them unique when
+   * merging the timetables of several parsers.
+   */
+  void renumberIds(int first)
   {
-      BOOST_FOREACH(SGPath p, _trafficDirPaths) {
-          parseTrafficDir(p);
-          if (_cancelThread) {
-              return;
-          }
-      }
-
-    SGGuard<SGMutex> g(_lock);
-    _isFinished = true;
+    if (first == 0) {
+      return;
+    }
+    BOOST_FOREACH(size_t i, _generatedAircraft) {
+      FGTimetableAircraft& a = _timetable.aircraft[i];
+      a.flightId = idString(first + atoi(a.flightId.c_str()));
+    }
+    BOOST_FOREACH(size_t i, _generatedFlights) {
+      FGTimetableFlight& f = _timetable.flights[i];
+      f.requiredAircraft = idString(first + atoi(f.requiredAircraft.c_str()));
+    }
   }
 
     void startXML()
@@ -167,6 +183,7 @@ public:
             SGPath path = globals->get_fg_root();
             path.append("/Traffic/");
             path.append(attval);
+            _timetable.includes.push_back(FGTimetable::source(path));
             readXML(path, *this);
         }
         elementValueStack.push_back("");
@@ -226,55 +243,21 @@ public:
         else if (!strcmp(name, "flight")) {
             // We have loaded and parsed all the information belonging to this flight
             // so we temporarily store it.
-            //cerr << "Pusing back flight " << callsign << endl;
-            //cerr << callsign  <<  " " << fltrules     << " "<< departurePort << " " <<  arrivalPort << " "
-            //   << cruiseAlt <<  " " << departureTime<< " "<< arrivalTime   << " " << repeat << endl;
-
-            //Prioritize aircraft
-            string apt = fgGetString("/sim/presets/airport-id");
-            //cerr << "Airport information: " << apt << " " << departurePort << " " << arrivalPort << endl;
-            //if (departurePort == apt) score++;
-            //flights.push_back(new FGScheduledFlight(callsign,
-            //                                fltrules,
-            //                                departurePort,
-            //                                arrivalPort,
-            //                                cruiseAlt,
-            //                                departureTime,
-            //                                arrivalTime,
-            //                                repeat));
             if (requiredAircraft == "") {
-                char buffer[16];
-                snprintf(buffer, 16, "%d", acCounter);
-                requiredAircraft = buffer;
-            }
-            SG_LOG(SG_AI, SG_DEBUG, "Adding flight: " << callsign << " "
-                   << fltrules << " "
-                   << departurePort << " "
-                   << arrivalPort << " "
-                   << cruiseAlt << " "
-                   << departureTime << " "
-                   << arrivalTime << " " << repeat << " " << requiredAircraft);
-            // For database maintainance purposes, it may be convenient to
-            //
-            if (fgGetBool("/sim/traffic-manager/dumpdata") == true) {
-                SG_LOG(SG_AI, SG_ALERT, "Traffic Dump FLIGHT," << callsign << ","
-                       << fltrules << ","
-                       << departurePort << ","
-                       << arrivalPort << ","
-                       << cruiseAlt << ","
-                       << departureTime << ","
-                       << arrivalTime << "," << repeat << "," << requiredAircraft);
+                requiredAircraft = idString(acCounter);
+                _generatedFlights.push_back(_timetable.flights.size());
             }
-
-            _trafficManager->flights[requiredAircraft].push_back(new FGScheduledFlight(callsign,
-                                                                      fltrules,
-                                                                      departurePort,
-                                                                      arrivalPort,
-                                                                      cruiseAlt,
-                                                                      departureTime,
-                                                                      arrivalTime,
-                                                                      repeat,
-                                                                      requiredAircraft));
+            FGTimetableFlight flight;
+            flight.callsign = callsign;
+            flight.fltRules = fltrules;
+            flight.departurePort = departurePort;
+            flight.arrivalPort = arrivalPort;
+            flight.departureTime = departureTime;
+            flight.arrivalTime = arrivalTime;
+            flight.repeat = repeat;
+            flight.requiredAircraft = requiredAircraft;
+            flight.cruiseAlt = cruiseAlt;
+            _timetable.flights.push_back(flight);
             requiredAircraft = "";
         } else if (!strcmp(name, "aircraft")) {
             endAircraft();
@@ -309,111 +292,366 @@ public:
     }
 
 private:
-    void endAircraft()
+    static string idString(int id)
     {
-        string isHeavy = heavy ? "true" : "false";
-
-        if (missingModels.find(mdl) != missingModels.end()) {
-            // don't stat() or warn again
-            requiredAircraft = homePort = "";
-            return;
-        }
-
-        if (!FGAISchedule::validModelPath(mdl)) {
-            missingModels.insert(mdl);
-            SG_LOG(SG_AI, SG_DEV_WARN, "TrafficMgr: Missing model path:" << mdl);
-            requiredAircraft = homePort = "";
-            return;
-        }
-
-        int proportion =
-        (int) (fgGetDouble("/sim/traffic-manager/proportion") * 100);
-        int randval = rand() & 100;
-        if (randval > proportion) {
-            requiredAircraft = homePort = "";
-            return;
-        }
-
-        if (fgGetBool("/sim/traffic-manager/dumpdata") == true) {
-            SG_LOG(SG_AI, SG_ALERT, "Traffic Dump AC," << homePort << "," << registration << "," << requiredAircraft
-                   << "," << acType << "," << livery << ","
-                   << airline << ","  << m_class << "," << offset << "," << radius << "," << flighttype << "," << isHeavy << "," << mdl);
-        }
+        char buffer[16];
+        snprintf(buffer, 16, "%d", id);
+        return buffer;
+    }
 
+    // Aircraft are checked for missing models and thinned out by
+    // ScheduleParseThread, so that they can be cached unfiltered.
+    void endAircraft()
+    {
         if (requiredAircraft == "") {
-            char buffer[16];
-            snprintf(buffer, 16, "%d", acCounter);
-            requiredAircraft = buffer;
+            requiredAircraft = idString(acCounter);
+            _generatedAircraft.push_back(_timetable.aircraft.size());
         }
         if (homePort == "") {
             homePort = departurePort;
         }
 
-        // caution, modifying the scheduled aircraft strucutre from the
-        // 'wrong' thread. This is safe becuase FGTrafficManager won't touch
-        // the structure while we exist.
-        _trafficManager->scheduledAircraft.push_back(new FGAISchedule(mdl,
-                                                     livery,
-                                                     homePort,
-                                                     registration,
-                                                     requiredAircraft,
-                                                     heavy,
-                                                     acType,
-                                                     airline,
-                                                     m_class,
-                                                     flighttype,
-                                                     radius, offset));
+        FGTimetableAircraft aircraft;
+        aircraft.model = mdl;
+        aircraft.livery = livery;
+        aircraft.homePort = homePort;
+        aircraft.registration = registration;
+        aircraft.flightId = requiredAircraft;
+        aircraft.acType = acType;
+        aircraft.airline = airline;
+        aircraft.perfClass = m_class;
+        aircraft.flightType = flighttype;
+        aircraft.radius = radius;
+        aircraft.offset = offset;
+        aircraft.heavy = heavy;
+        _timetable.aircraft.push_back(aircraft);
 
         acCounter++;
         requiredAircraft = "";
         homePort = "";
-        score = 0;
     }
 
-    void parseTrafficDir(const SGPath& path)
-    {
-        SGTimeStamp st;
-        st.stamp();
-
-        simgear::Dir trafficDir(path);
-        simgear::PathList d = trafficDir.children(simgear::Dir::TYPE_DIR | simgear::Dir::NO_DOT_OR_DOTDOT);
-
-        BOOST_FOREACH(SGPath p, d) {
-            simgear::Dir d2(p);
-            SG_LOG(SG_AI, SG_INFO, "parsing traffic in:" << p);
-            simgear::PathList trafficFiles = d2.children(simgear::Dir::TYPE_FILE, ".xml");
-            BOOST_FOREACH(SGPath xml, trafficFiles) {
-                readXML(xml, *this);
-                if (_cancelThread) {
-                    return;
-                }
-            }
-        } // of sub-directories iteration
-
-        SG_LOG(SG_AI, SG_INFO, "parsing traffic schedules took:" << st.elapsedMSec() << "msec");
-    }
-
-  FGTrafficManager* _trafficManager;
-  mutable SGMutex _lock;
-  bool _isFinished;
-  bool _cancelThread;
-  simgear::PathList _trafficDirPaths;
+    FGTimetable _timetable;
+    // entries with a generated aircraft id
+    std::vector<size_t> _generatedAircraft, _generatedFlights;
 
 // parser state
 
     string_list elementValueStack;
-    // record model paths which are missing, to avoid duplicate
-    // warnings when parsing traffic schedules.
-    std::set<std::string> missingModels;
 
     std::string mdl, livery, registration, callsign, fltrules,
     port, timeString, departurePort, departureTime, arrivalPort, arrivalTime,
     repeat, acType, airline, m_class, flighttype, requiredAircraft, homePort;
     int cruiseAlt;
-    int score, acCounter;
+    int acCounter;
     double radius, offset;
     bool heavy;
+};
+
+/**
+ * Thread encapsulating parsing the traffic schedules. The traffic files
+ * are read by a pool of threads, or taken from the timetable cache when
+ * none of them changed.
+ */
+class ScheduleParseThread : public SGThread
+{
+public:
+  ScheduleParseThread(FGTrafficManager* traffic) :
+    _trafficManager(traffic),
+    _isFinished(false),
+    _cancelThread(false),
+    _fromCache(false),
+    _nextFile(0)
+  {
+    // properties are read here, on the main thread
+    _proportion = (int) (fgGetDouble("/sim/traffic-manager/proportion") * 100);
+    _dumpData = fgGetBool("/sim/traffic-manager/dumpdata");
+    _heuristics = fgGetBool("/sim/traffic-manager/heuristics");
+    _airport = fgGetString("/sim/presets/airport-id");
+
+    SGPropertyNode* tm = fgGetNode("/sim/traffic-manager", true);
+    _threadCount = tm->getIntValue("parse-threads", 0);
+    if (_threadCount <= 0) {
+      _threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    _useCache = !tm->hasValue("timetable-cache") ||
+                tm->getBoolValue("timetable-cache");
+    _cachePath = globals->get_fg_home();
+    _cachePath.append("ai");
+    _cachePath.append("timetable-cache.bin");
+  }
+
+  // if we're destroyed while running, ensure the thread exits cleanly
+  ~ScheduleParseThread()
+  {
+    _lock.lock();
+    if (!_isFinished) {
+      _cancelThread = true; // request cancellation so we don't wait ages
+      _lock.unlock();
+      join();
+    } else {
+      _lock.unlock();
+    }
+  }
+
+  void setTrafficDirs(const PathList& dirs)
+  {
+    _trafficDirPaths = dirs;
+  }
+
+  bool isFinished() const
+  {
+    SGGuard<SGMutex> g(_lock);
+    return _isFinished;
+  }
+
+  /** True when the schedules came from the timetable cache. */
+  bool isFromCache() const
+  {
+    SGGuard<SGMutex> g(_lock);
+    return _fromCache;
+  }
+
+  virtual void run()
+  {
+    SGTimeStamp st;
+    st.stamp();
+
+    FGTimetable::SourceList sources;
+    BOOST_FOREACH(SGPath p, _trafficDirPaths) {
+      findTrafficFiles(p);
+    }
+    BOOST_FOREACH(const SGPath& p, _trafficFiles) {
+      sources.push_back(FGTimetable::source(p));
+    }
+
+    FGTimetable timetable;
+    bool fromCache = _useCache && timetable.load(_cachePath, sources);
+    if (!fromCache) {
+      parseTrafficFiles();
+      if (isCancelled()) {
+        return;
+      }
+
+      int ids = 0;
+      for (size_t i = 0; i < _parsers.size(); ++i) {
+        _parsers[i]->renumberIds(ids);
+        ids += _parsers[i]->generatedIds();
+        timetable.append(_parsers[i]->timetable());
+      }
+      _parsers.clear();
+      timetable.files = sources;
+
+      if (_useCache) {
+        timetable.save(_cachePath);
+      }
+    }
+
+    // caution, modifying the scheduled aircraft strucutre from the
+    // 'wrong' thread. This is safe becuase FGTrafficManager won't touch
+    // the structure while we exist.
+    addToTrafficManager(timetable);
+    if (_heuristics) {
+      _trafficManager->loadHeuristics(_airport);
+    }
+
+    SG_LOG(SG_AI, SG_INFO, "parsing traffic schedules took:" << st.elapsedMSec() << "msec"
+           << (fromCache ? " (from timetable cache)" : ""));
+
+    SGGuard<SGMutex> g(_lock);
+    _fromCache = fromCache;
+    _isFinished = true;
+  }
+
+  /**
+   * Parse a single traffic file on the calling thread, without using
+   * the timetable cache.
+   */
+  void parseFile(const SGPath& path)
+  {
+    ScheduleFileParser parser;
+    parser.parse(path);
+    addToTrafficManager(parser.timetable());
+
+    SGGuard<SGMutex> g(_lock);
+    _isFinished = true;
+  }
+
+private:
+  class Worker : public SGThread
+  {
+  public:
+    Worker(ScheduleParseThread* owner) :
+      _owner(owner)
+    {
+    }
+
+    virtual void run()
+    {
+      _owner->parseNextFiles();
+    }
+
+  private:
+    ScheduleParseThread* _owner;
+  };
+
+  bool isCancelled() const
+  {
+    SGGuard<SGMutex> g(_lock);
+    return _cancelThread;
+  }
+
+  void findTrafficFiles(const SGPath& path)
+  {
+    simgear::Dir trafficDir(path);
+    simgear::PathList d = trafficDir.children(simgear::Dir::TYPE_DIR | simgear::Dir::NO_DOT_OR_DOTDOT);
+
+    BOOST_FOREACH(SGPath p, d) {
+      simgear::Dir d2(p);
+      simgear::PathList trafficFiles = d2.children(simgear::Dir::TYPE_FILE, ".xml");
+      _trafficFiles.insert(_trafficFiles.end(), trafficFiles.begin(), trafficFiles.end());
+    } // of sub-directories iteration
+  }
+
+  /** Parse all traffic files, with this and the worker threads. */
+  void parseTrafficFiles()
+  {
+    _parsers.clear();
+    _parsers.resize(_trafficFiles.size());
+    _nextFile = 0;
+
+    size_t workerCount = std::min<size_t>(_threadCount, _trafficFiles.size());
+    std::vector<std::unique_ptr<Worker> > workers;
+    for (size_t i = 1; i < workerCount; ++i) {
+      workers.push_back(std::unique_ptr<Worker>(new Worker(this)));
+      workers.back()->start();
+    }
+
+    parseNextFiles();
+
+    BOOST_FOREACH(std::unique_ptr<Worker>& w, workers) {
+      w->join();
+    }
+  }
+
+  /**
+   * Parse files until none are left. Every file gets its own parser,
+   * so the results can be merged in the order of the files.
+   */
+  void parseNextFiles()
+  {
+    for (;;) {
+      size_t index;
+      {
+        SGGuard<SGMutex> g(_lock);
+        if (_cancelThread || (_nextFile >= _trafficFiles.size())) {
+          return;
+        }
+        index = _nextFile++;
+      }
+
+      SG_LOG(SG_AI, SG_DEBUG, "parsing traffic in:" << _trafficFiles[index]);
+      ScheduleFileParser* parser = new ScheduleFileParser;
+      parser->parse(_trafficFiles[index]);
+      // every slot is written by one thread only
+      _parsers[index].reset(parser);
+    }
+  }
+
+  void addToTrafficManager(const FGTimetable& timetable)
+  {
+    BOOST_FOREACH(const FGTimetableFlight& f, timetable.flights) {
+      SG_LOG(SG_AI, SG_DEBUG, "Adding flight: " << f.callsign << " "
+             << f.fltRules << " "
+             << f.departurePort << " "
+             << f.arrivalPort << " "
+             << f.cruiseAlt << " "
+             << f.departureTime << " "
+             << f.arrivalTime << " " << f.repeat << " " << f.requiredAircraft);
+      // For database maintainance purposes, it may be convenient to
+      //
+      if (_dumpData) {
+        SG_LOG(SG_AI, SG_ALERT, "Traffic Dump FLIGHT," << f.callsign << ","
+               << f.fltRules << ","
+               << f.departurePort << ","
+               << f.arrivalPort << ","
+               << f.cruiseAlt << ","
+               << f.departureTime << ","
+               << f.arrivalTime << "," << f.repeat << "," << f.requiredAircraft);
+      }
+
+      _trafficManager->flights[f.requiredAircraft].push_back(new FGScheduledFlight(f.callsign,
+                                                                  f.fltRules,
+                                                                  f.departurePort,
+                                                                  f.arrivalPort,
+                                                                  f.cruiseAlt,
+                                                                  f.departureTime,
+                                                                  f.arrivalTime,
+                                                                  f.repeat,
+                                                                  f.requiredAircraft));
+    }
+
+    BOOST_FOREACH(const FGTimetableAircraft& a, timetable.aircraft) {
+      if (missingModels.find(a.model) != missingModels.end()) {
+        // don't stat() or warn again
+        continue;
+      }
+
+      if (!FGAISchedule::validModelPath(a.model)) {
+        missingModels.insert(a.model);
+        SG_LOG(SG_AI, SG_DEV_WARN, "TrafficMgr: Missing model path:" << a.model);
+        continue;
+      }
+
+      int randval = rand() & 100;
+      if (randval > _proportion) {
+        continue;
+      }
+
+      if (_dumpData) {
+        SG_LOG(SG_AI, SG_ALERT, "Traffic Dump AC," << a.homePort << "," << a.registration << "," << a.flightId
+               << "," << a.acType << "," << a.livery << ","
+               << a.airline << ","  << a.perfClass << "," << a.offset << "," << a.radius << "," << a.flightType << ","
+               << (a.heavy ? "true" : "false") << "," << a.model);
+      }
+
+      _trafficManager->scheduledAircraft.push_back(new FGAISchedule(a.model,
+                                                   a.livery,
+                                                   a.homePort,
+                                                   a.registration,
+                                                   a.flightId,
+                                                   a.heavy,
+                                                   a.acType,
+                                                   a.airline,
+                                                   a.perfClass,
+                                                   a.flightType,
+                                                   a.radius, a.offset));
+    }
+  }
+
+  FGTrafficManager* _trafficManager;
+  mutable SGMutex _lock;
+  bool _isFinished;
+  bool _cancelThread;
+  bool _fromCache;
+  simgear::PathList _trafficDirPaths;
 
+  // settings, read on the main thread
+  int _proportion;
+  bool _dumpData;
+  bool _heuristics;
+  std::string _airport;
+  int _threadCount;
+  bool _useCache;
+  SGPath _cachePath;
+
+  simgear::PathList _trafficFiles;
+  size_t _nextFile;       // next file to parse, guarded by _lock
+  std::vector<std::unique_ptr<ScheduleFileParser> > _parsers;
+
+  // record model paths which are missing, to avoid duplicate
+  // warnings when parsing traffic schedules.
+  std::set<std::string> missingModels;
 };
 
 /******************************************************************************
@@ -424,11 +662,21 @@ FGTrafficManager::FGTrafficManager() :
   doingInit(false),
   trafficSyncRequested(false),
   waitingMetarTime(0.0),
+  flightIndex(flights),
   enabled("/sim/traffic-manager/enabled"),
   aiEnabled("/sim/ai/enabled"),
   realWxEnabled("/environment/realwx/enabled"),
   metarValid("/environment/metar/valid")
 {
+    SGPropertyNode* scheduler = fgGetNode("/sim/traffic-manager/scheduler", true);
+    schedulerBudget = scheduler->getNode("budget-ms", true);
+    if (!schedulerBudget->hasValue()) {
+        schedulerBudget->setDoubleValue(1.0);
+    }
+    schedulerUpdates = scheduler->getNode("updates", true);
+    schedulerBacklog = scheduler->getNode("backlog", true);
+    schedulerQueued = scheduler->getNode("queued", true);
+    schedulerTime = scheduler->getNode("update-time-us", true);
 }
 
 FGTrafficManager::~FGTrafficManager()
@@ -491,6 +739,8 @@ void FGTrafficManager::shutdown()
         cachefile.close();
     }
     scheduledAircraft.clear();
+    scheduleWheel.clear();
+    flightIndex.clear();
     flights.clear();
 
     currAircraft = scheduledAircraft.begin();
@@ -550,6 +800,7 @@ void FGTrafficManager::init()
             return;
         }
 
+        initStamp.stamp();
         scheduleParser.reset(new ScheduleParseThread(this));
         scheduleParser->setTrafficDirs(dirs);
         scheduleParser->start();
@@ -562,7 +813,7 @@ void FGTrafficManager::init()
                 // use a SchedulerParser to parse, but run it in this thread,
                 // i.e don't start it
                 ScheduleParseThread parser(this);
-                readXML(path, parser);
+                parser.parseFile(path);
             }
         } else if (path.extension() == "conf") {
             if (path.exists()) {
@@ -583,7 +834,6 @@ void FGTrafficManager::finishInit()
 {
     assert(doingInit);
     SG_LOG(SG_AI, SG_INFO, "finishing AI-Traffic init");
-    loadHeuristics();
     PerformanceDB* perfDB = globals->get_subsystem<PerformanceDB>();
     // Do sorting and scoring separately, to take advantage of the "homeport" variable
     BOOST_FOREACH(FGAISchedule* schedule, scheduledAircraft) {
@@ -597,23 +847,34 @@ void FGTrafficManager::finishInit()
          compareSchedules);
     currAircraft = scheduledAircraft.begin();
     currAircraftClosest = scheduledAircraft.begin();
+    // flights are indexed when first looked up
+    flightIndex.clear();
+
+    // all schedules are due for a first update, in the order of their score
+    lastUserCart = globals->get_aircraft_position_cart();
+    rescheduleAll(globals->get_time_params()->get_cur_time());
+
+    if (scheduleParser) {
+        bool fromCache = scheduleParser->isFromCache();
+        int initMSec = initStamp.elapsedMSec();
+        SG_LOG(SG_AI, SG_INFO, "AI-Traffic init took " << initMSec << "msec ("
+               << (fromCache ? "warm, from timetable cache" : "cold") << ")");
+        fgSetInt("/sim/traffic-manager/init-time-ms", initMSec);
+        fgSetBool("/sim/traffic-manager/timetable-cached", fromCache);
+        scheduleParser.reset();
+    }
 
     doingInit = false;
     inited = true;
 }
 
-void FGTrafficManager::loadHeuristics()
+void FGTrafficManager::loadHeuristics(const string& airport)
 {
-    if (!fgGetBool("/sim/traffic-manager/heuristics")) {
-        return;
-    }
-
     HeuristicMap heurMap;
     //cerr << "Processing Heuristics" << endl;
     // Load the heuristics data
     SGPath cacheData(globals->get_fg_home());
     cacheData.append("ai");
-    string airport = fgGetString("/sim/presets/airport-id");
     if ((airport) != "") {
       char buffer[128];
       ::snprintf(buffer, 128, "%c/%c/%c/",
@@ -721,18 +982,66 @@ void FGTrafficManager::update(double dt)
     }
 
     SGVec3d userCart = globals->get_aircraft_position_cart();
+    time_t now = globals->get_time_params()->get_cur_time();
+
+    if (!scheduleWheel.advance(now) ||
+        (dist(userCart, lastUserCart) > USERJUMPDISTANCEM)) {
+        // time went backwards or the user was relocated: the next
+        // updates of all schedules are out of date
+        rescheduleAll(now);
+    }
+    lastUserCart = userCart;
+
+    // how fast the user and an aircraft can approach each other, to
+    // know when distant aircraft might come into range
+    double closingSpeedKts = MAXTRAFFICSPEEDKTS +
+        std::max(0.0, fgGetDouble("/velocities/groundspeed-kt"));
+    double budgetUSec = schedulerBudget->getDoubleValue() * 1000.0;
+
+    SGTimeStamp st;
+    st.stamp();
+    int updates = 0;
+    ScheduleVector deferred;
+    // update at least one schedule per frame, even when over budget
+    while (scheduleWheel.readyCount() &&
+           ((updates == 0) || (st.elapsedUSec() < budgetUSec))) {
+        FGAISchedule* schedule = scheduleWheel.popReady();
+        schedule->update(now, userCart);
+        updates++;
+
+        time_t due = schedule->getNextEvent();
+        if (!due) {
+            continue; // nothing left to do
+        }
+        if (schedule->isOutOfRange()) {
+            double rangeNm = schedule->getDistanceToUser() - TRAFFICTOAIDISTTOSTART;
+            due = std::min(due, now + (time_t) (rangeNm / closingSpeedKts * 3600.0));
+        }
+        if (due <= now) {
+            // continue with it in the next frame
+            deferred.push_back(schedule);
+        } else {
+            scheduleWheel.insert(schedule, due, wheelDistance(schedule));
+        }
+    }
 
-    if (currAircraft == scheduledAircraft.end()) {
-        currAircraft = scheduledAircraft.begin();
+    BOOST_FOREACH(FGAISchedule* schedule, deferred) {
+        scheduleWheel.insert(schedule, now, wheelDistance(schedule));
     }
 
-    time_t now = globals->get_time_params()->get_cur_time();
+    schedulerUpdates->setIntValue(updates);
+    schedulerBacklog->setIntValue(scheduleWheel.readyCount());
+    schedulerQueued->setIntValue(scheduleWheel.size());
+    schedulerTime->setIntValue(st.elapsedUSec());
+}
 
-    //cerr << "Processing << " << (*currAircraft)->getRegistration() << " with score " << (*currAircraft)->getScore() << endl;
-    if ((*currAircraft)->update(now, userCart)) {
-        // schedule is done - process another aircraft in next iteration
-        currAircraft++;
+void FGTrafficManager::rescheduleAll(time_t now)
+{
+    scheduleWheel.clear();
+    BOOST_FOREACH(FGAISchedule* schedule, scheduledAircraft) {
+        scheduleWheel.insert(schedule, now, wheelDistance(schedule));
     }
+    scheduleWheel.advance(now);
 }
 
 void FGTrafficManager::readTimeTableFromFile(SGPath infileName)
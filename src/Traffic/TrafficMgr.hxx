@@ -50,11 +50,14 @@
 #include <memory>
 
 #include <simgear/structure/subsystem_mgr.hxx>
+#include <simgear/props/props.hxx>
 #include <simgear/props/propertyObject.hxx>
 #include <simgear/misc/sg_path.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include "SchedFlight.hxx"
 #include "Schedule.hxx"
+#include "ScheduleWheel.hxx"
 
 class Heuristic
 {
@@ -89,13 +92,24 @@ private:
   ScheduleVectorIterator currAircraft, currAircraftClosest;
     
   FGScheduledFlightMap flights;
+  FGScheduledFlightIndex flightIndex;
+
+  // schedules by the time of their next update
+  FGScheduleWheel<FGAISchedule> scheduleWheel;
+  SGVec3d lastUserCart;
+  SGPropertyNode_ptr schedulerBudget, schedulerUpdates, schedulerBacklog,
+      schedulerQueued, schedulerTime;
+  void rescheduleAll(time_t now);
 
   void readTimeTableFromFile(SGPath infilename);
     void Tokenize(const std::string& str, std::vector<std::string>& tokens, const std::string& delimiters = " ");
 
   simgear::PropertyObject<bool> enabled, aiEnabled, realWxEnabled, metarValid;
   
-  void loadHeuristics();
+  SGTimeStamp initStamp;
+
+  // called from the schedule parser thread, after parsing
+  void loadHeuristics(const std::string& airport);
   
   void finishInit();
   void shutdown();
@@ -118,6 +132,7 @@ public:
 
     FGScheduledFlightVecIterator getFirstFlight(const std::string &ref) { return flights[ref].begin(); }
     FGScheduledFlightVecIterator getLastFlight(const std::string &ref) { return flights[ref].end(); }
+    FGScheduledFlightIndex& getFlightIndex() { return flightIndex; }
 
 };
 
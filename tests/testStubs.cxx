@@ -104,6 +104,30 @@ bool FGScenery::get_elevation_m(const SGGeod& geod, double& alt,
     return false;
 }
 
+bool FGScenery::get_approx_elevation_m(const SGGeod& geod, double& alt)
+{
+    return false;
+}
+
+unsigned FGScenery::get_elevations_m(const std::vector<SGGeod>& geods,
+                     std::vector<double>& alt,
+                     std::vector<bool>& valid,
+                     std::vector<const simgear::BVHMaterial*>* materials,
+                     const osg::Node* butNotFrom)
+{
+    alt.assign(geods.size(), 0.0);
+    valid.assign(geods.size(), false);
+    if (materials)
+        materials->assign(geods.size(), 0);
+    return 0;
+}
+
+bool FGScenery::schedule_scenery(const SGGeod& position, double range_m,
+                                 double duration)
+{
+    return false;
+}
+
 bool FGScenery::get_cart_ground_intersection(const SGVec3d& start, const SGVec3d& dir,
                      SGVec3d& nearestHit,
                      const osg::Node* butNotFrom)
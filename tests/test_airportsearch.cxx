@@ -0,0 +1,272 @@
+#include "config.h"
+
+#include "unitTestHelpers.hxx"
+
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <set>
+
+#ifdef SYSTEM_SQLITE
+  #include "sqlite3.h"
+#else
+  #define SQLITE_INT64_TYPE int64_t
+  #define SQLITE_UINT64_TYPE uint64_t
+  #include "fg_sqlite3.h"
+#endif
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/misc/strutils.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <Navaids/NavDataCache.hxx>
+#include <Navaids/positioned.hxx>
+
+using namespace flightgear;
+
+struct SearchResult
+{
+    std::string name;
+    std::string ident;
+    int rank;
+};
+
+typedef std::vector<SearchResult> SearchResultVec;
+
+// lower case runs of letters and digits, as the search index splits text
+static string_list words(const std::string& text)
+{
+    string_list result;
+    std::string word;
+    for (std::size_t i = 0; i <= text.size(); ++i) {
+        unsigned char c = (i < text.size()) ? text[i] : ' ';
+        if ((c >= 0x80) || isalnum(c)) {
+            word.push_back(tolower(c));
+        } else if (!word.empty()) {
+            result.push_back(word);
+            word.clear();
+        }
+    }
+    return result;
+}
+
+static bool hasWordStartingWith(const string_list& list, const std::string& prefix)
+{
+    for (const std::string& w : list) {
+        if (simgear::strutils::starts_with(w, prefix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 0: exact ident, 1: ident prefix, 2: exact name word, 3: name prefix
+static int expectedRank(const std::string& term, const std::string& ident,
+                        const std::string& name)
+{
+    const std::string first = words(term).front();
+    const string_list identWords = words(ident), nameWords = words(name);
+    if (std::find(identWords.begin(), identWords.end(), first) != identWords.end()) {
+        return 0;
+    } else if (hasWordStartingWith(identWords, first)) {
+        return 1;
+    } else if (std::find(nameWords.begin(), nameWords.end(), first) != nameWords.end()) {
+        return 2;
+    }
+    return 3;
+}
+
+static SearchResultVec search(const std::string& term)
+{
+    SearchResultVec result;
+    char** entries = NavDataCache::instance()->searchAirportNamesAndIdents(term);
+    for (char** e = entries; *e; ++e) {
+        // ' name   (ident)'
+        std::string entry(*e);
+        std::size_t sep = entry.rfind("   (");
+        SG_VERIFY(sep != std::string::npos);
+        SG_VERIFY(entry[entry.size() - 1] == ')');
+
+        SearchResult r;
+        r.name = entry.substr(1, sep - 1);
+        r.ident = entry.substr(sep + 4, entry.size() - sep - 5);
+        r.rank = words(term).empty() ? 0 : expectedRank(term, r.ident, r.name);
+        result.push_back(r);
+        free(*e);
+    }
+    free(entries);
+    return result;
+}
+
+static bool contains(const SearchResultVec& results, const std::string& ident)
+{
+    for (const SearchResult& r : results) {
+        if (r.ident == ident) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// every result has a word starting with each term word, ordered by rank
+// and then by name
+static void checkRanking(const std::string& term, const SearchResultVec& results)
+{
+    const string_list termWords = words(term);
+    for (size_t i = 0; i < results.size(); ++i) {
+        string_list itemWords = words(results[i].ident + " " + results[i].name);
+        for (const std::string& w : termWords) {
+            SG_VERIFY(hasWordStartingWith(itemWords, w));
+        }
+
+        if (i > 0) {
+            const SearchResult& prev = results[i - 1];
+            SG_VERIFY(prev.rank <= results[i].rank);
+            if (prev.rank == results[i].rank) {
+                SG_VERIFY(prev.name <= results[i].name);
+            }
+        }
+    }
+}
+
+void testExactIdent()
+{
+    SearchResultVec results = search("EDDM");
+    SG_VERIFY(!results.empty());
+    SG_CHECK_EQUAL(results.front().ident, "EDDM");
+    SG_CHECK_EQUAL(results.front().rank, 0);
+    checkRanking("EDDM", results);
+
+    // case doesn't matter
+    results = search("eddm");
+    SG_CHECK_EQUAL(results.front().ident, "EDDM");
+}
+
+void testIdentPrefix()
+{
+    SearchResultVec results = search("EDD");
+    SG_VERIFY(results.size() > 10);
+    checkRanking("EDD", results);
+    SG_VERIFY(contains(results, "EDDF"));
+    SG_VERIFY(contains(results, "EDDM"));
+
+    // the German international airports come before any name match
+    SG_VERIFY(results.front().rank <= 1);
+    SG_VERIFY(simgear::strutils::starts_with(results.front().ident, "EDD"));
+}
+
+void testNameWords()
+{
+    SearchResultVec results = search("san francisco");
+    SG_VERIFY(contains(results, "KSFO"));
+    checkRanking("san francisco", results);
+
+    // word order and separators don't matter, prefixes of words match
+    results = search("Francisco, San");
+    SG_VERIFY(contains(results, "KSFO"));
+    checkRanking("Francisco, San", results);
+
+    results = search("frank main");
+    SG_VERIFY(contains(results, "EDDF"));
+    checkRanking("frank main", results);
+
+    // an exact name word ranks above a name prefix
+    results = search("munich");
+    SG_VERIFY(contains(results, "EDDM"));
+    checkRanking("munich", results);
+    SG_CHECK_EQUAL(results.front().rank, 2);
+
+    SG_VERIFY(search("qqqqzzzz").empty());
+}
+
+void testFallbackScan()
+{
+    // no letters or digits: nothing to look up in the index, so the term
+    // is matched anywhere in the ident or name
+    SearchResultVec results = search("-");
+    SG_VERIFY(!results.empty());
+    for (const SearchResult& r : results) {
+        SG_VERIFY((r.name.find('-') != std::string::npos) ||
+                  (r.ident.find('-') != std::string::npos));
+    }
+
+    SG_VERIFY(search("~~~").empty());
+}
+
+// The search as it was before the index: a LIKE scan of all airports, on
+// a connection of its own to the cache
+static std::set<std::string> scanAirports(sqlite3* db, const std::string& term)
+{
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(db, "SELECT ident FROM positioned WHERE "
+                                "(name LIKE ?1 OR ident LIKE ?1) AND type>=?2 AND type<=?3",
+                                -1, &stmt, NULL);
+    SG_CHECK_EQUAL(rc, SQLITE_OK);
+    std::string like = "%" + term + "%";
+    sqlite3_bind_text(stmt, 1, like.c_str(), like.size(), SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, FGPositioned::AIRPORT);
+    sqlite3_bind_int(stmt, 3, FGPositioned::SEAPORT);
+
+    std::set<std::string> idents;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        idents.insert(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+    }
+    sqlite3_finalize(stmt);
+    return idents;
+}
+
+// Latency of the index against the scan, for terms as typed into the
+// airport list. Single word terms find a subset of what the scan finds:
+// the index matches word prefixes only.
+void testTiming()
+{
+    sqlite3* db = NULL;
+    std::string path = NavDataCache::instance()->path().utf8Str();
+    SG_CHECK_EQUAL(sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, NULL),
+                   SQLITE_OK);
+
+    const char* terms[] = { "E", "ED", "EDD", "EDDM", "mun", "munich", "int", "san fran" };
+    const int rounds = 10;
+    for (const char* term : terms) {
+        SGTimeStamp t0 = SGTimeStamp::now();
+        SearchResultVec results;
+        for (int i = 0; i < rounds; ++i) {
+            results = search(term);
+        }
+        double indexUs = (SGTimeStamp::now() - t0).toUSecs() / double(rounds);
+
+        t0 = SGTimeStamp::now();
+        std::set<std::string> scanned;
+        for (int i = 0; i < rounds; ++i) {
+            scanned = scanAirports(db, term);
+        }
+        double scanUs = (SGTimeStamp::now() - t0).toUSecs() / double(rounds);
+
+        if (words(term).size() == 1) {
+            for (const SearchResult& r : results) {
+                SG_VERIFY(scanned.count(r.ident) == 1);
+            }
+        }
+
+        std::cout << "'" << term << "': index " << results.size() << " matches in "
+                  << indexUs << " us, LIKE scan " << scanned.size() << " matches in "
+                  << scanUs << " us" << std::endl;
+    }
+
+    sqlite3_close(db);
+}
+
+int main(int argc, char* argv[])
+{
+    fgtest::initTestGlobals("airportsearch");
+
+    testExactIdent();
+    testIdentPrefix();
+    testNameWords();
+    testFallbackScan();
+    testTiming();
+
+    fgtest::shutdownTestGlobals();
+}
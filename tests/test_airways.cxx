@@ -0,0 +1,165 @@
+#include "config.h"
+
+#include "unitTestHelpers.hxx"
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+
+#include <simgear/misc/test_macros.hxx>
+
+#include <Navaids/airways.hxx>
+#include <Navaids/NavDataCache.hxx>
+#include <Navaids/waypoint.hxx>
+
+#include <Airports/airport.hxx>
+
+using namespace flightgear;
+
+class NetworkFilter : public FGPositioned::Filter
+{
+public:
+    NetworkFilter(int network) :
+        _network(network)
+    { }
+
+    virtual bool pass(FGPositioned* aPos) const
+    {
+        return NavDataCache::instance()->isInAirwayNetwork(_network, aPos->guid());
+    }
+
+    virtual FGPositioned::Type minType() const
+    { return FGPositioned::WAYPOINT; }
+
+    virtual FGPositioned::Type maxType() const
+    { return FGPositioned::NDB; }
+
+private:
+    int _network;
+};
+
+static FGPositionedRef networkNodeNear(int network, const std::string& icao)
+{
+    NetworkFilter filter(network);
+    FGAirportRef apt = FGAirport::getByIdent(icao);
+    return FGPositioned::findClosest(apt->geod(), 200.0, &filter);
+}
+
+static bool isEdge(int network, FGPositioned* from, FGPositioned* to)
+{
+    for (const AirwayEdge& e : NavDataCache::instance()->airwayEdgesFrom(network, from->guid())) {
+        if (e.second == to->guid()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Dijkstra over the edges queried from the cache node by node, the way the
+// airway search used to run, returning the length of the shortest route
+static double referenceDistanceM(int network, FGPositioned* start, FGPositioned* dest)
+{
+    NavDataCache* cache = NavDataCache::instance();
+    typedef std::pair<double, PositionedID> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+    std::map<PositionedID, double> distance;
+    std::map<PositionedID, SGGeod> geods;
+    std::set<PositionedID> closed;
+
+    geods[start->guid()] = start->geod();
+    distance[start->guid()] = 0.0;
+    open.push(Entry(0.0, start->guid()));
+
+    while (!open.empty()) {
+        Entry best = open.top();
+        open.pop();
+        if (!closed.insert(best.second).second) {
+            continue;
+        }
+
+        if (best.second == dest->guid()) {
+            return best.first;
+        }
+
+        for (const AirwayEdge& e : cache->airwayEdgesFrom(network, best.second)) {
+            if (closed.count(e.second)) {
+                continue;
+            }
+
+            if (geods.find(e.second) == geods.end()) {
+                geods[e.second] = cache->loadById(e.second)->geod();
+            }
+
+            double d = best.first + SGGeodesy::distanceM(geods[best.second], geods[e.second]);
+            std::map<PositionedID, double>::iterator it = distance.find(e.second);
+            if ((it == distance.end()) || (d < it->second)) {
+                distance[e.second] = d;
+                open.push(Entry(d, e.second));
+            }
+        }
+    }
+
+    return HUGE_VAL;
+}
+
+static void checkRoute(Airway::Network* net, int network,
+                       const std::string& depICAO, const std::string& destICAO)
+{
+    FGPositionedRef from = networkNodeNear(network, depICAO);
+    FGPositionedRef to = networkNodeNear(network, destICAO);
+    SG_VERIFY(from.valid());
+    SG_VERIFY(to.valid());
+
+    double expected = referenceDistanceM(network, from, to);
+    SG_VERIFY(expected < HUGE_VAL);
+
+    // both ends are on the network, so the route leaves them out
+    WayptVec path;
+    SG_VERIFY(net->route(new NavaidWaypoint(from, NULL),
+                         new NavaidWaypoint(to, NULL), path));
+
+    std::vector<FGPositionedRef> nodes;
+    nodes.push_back(from);
+    for (const WayptRef& w : path) {
+        nodes.push_back(w->source());
+    }
+    nodes.push_back(to);
+
+    double distance = 0.0;
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        SG_VERIFY(isEdge(network, nodes[i - 1], nodes[i]));
+        distance += SGGeodesy::distanceM(nodes[i - 1]->geod(), nodes[i]->geod());
+    }
+
+    SG_CHECK_EQUAL_EP2(distance, expected, 1.0);
+}
+
+void testHighLevelRoutes()
+{
+    Airway::Network* net = Airway::highLevel();
+    checkRoute(net, 2, "EGLL", "LFPG");
+    checkRoute(net, 2, "EHAM", "EDDM");
+    checkRoute(net, 2, "LEMD", "LIRF");
+    checkRoute(net, 2, "KSFO", "KLAX");
+    checkRoute(net, 2, "KJFK", "KORD");
+}
+
+void testLowLevelRoutes()
+{
+    Airway::Network* net = Airway::lowLevel();
+    checkRoute(net, 1, "EGPH", "EGCC");
+    checkRoute(net, 1, "EDDF", "EDDS");
+    checkRoute(net, 1, "KBOS", "KPHL");
+}
+
+int main(int argc, char* argv[])
+{
+    fgtest::initTestGlobals("airways");
+
+    testHighLevelRoutes();
+    testLowLevelRoutes();
+
+    fgtest::shutdownTestGlobals();
+}
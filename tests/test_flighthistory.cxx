@@ -0,0 +1,98 @@
+#include "config.h"
+
+#include <cmath>
+
+#include <simgear/misc/test_macros.hxx>
+
+#include <Main/globals.hxx>
+#include <Main/fg_props.hxx>
+#include <Aircraft/FlightHistory.hxx>
+
+static const int MemoryUseBytes = 200000;
+
+// a wavy track, so thinning out keeps some of the samples
+static void flyTo(unsigned int sample)
+{
+    const double t = sample * 0.01;
+    fgSetDouble("/position/latitude-deg", 47.0 + 0.05 * t + 0.01 * std::sin(7.0 * t));
+    fgSetDouble("/position/longitude-deg", 8.0 + 0.02 * std::cos(3.0 * t));
+    fgSetDouble("/position/altitude-ft", 5000.0 + 1000.0 * std::sin(t));
+    globals->set_sim_time_sec(sample * 1.5);
+}
+
+static void record(FGFlightHistory& history, unsigned int& sample, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i, ++sample) {
+        flyTo(sample);
+        history.update(1.5);
+    }
+}
+
+static void checkSamePath(const SGGeodVec& a, const SGGeodVec& b)
+{
+    SG_CHECK_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        SG_CHECK_EQUAL(a[i].getLongitudeDeg(), b[i].getLongitudeDeg());
+        SG_CHECK_EQUAL(a[i].getLatitudeDeg(), b[i].getLatitudeDeg());
+        SG_CHECK_EQUAL(a[i].getElevationM(), b[i].getElevationM());
+    }
+}
+
+// The paths kept up to date while recording must be the ones built from
+// scratch, also once buckets have been thinned out.
+void testFilteredPathsFollowDecimation()
+{
+    fgSetBool("/sim/history/enabled", true);
+    fgSetBool("/sim/history/clear-on-takeoff", false);
+    fgSetDouble("/sim/history/sample-interval-sec", 1.0);
+    fgSetInt("/sim/history/max-memory-use-bytes", MemoryUseBytes);
+
+    FGFlightHistory history;
+    history.init();
+
+    unsigned int sample = 0;
+    record(history, sample, 100);
+    const double edgeLengths[2] = { 50.0, 500.0 };
+    for (int i = 0; i < 2; ++i) {
+        SG_VERIFY(history.pathForHistory(edgeLengths[i]).size() > 1);
+    }
+
+    // several buckets get thinned out, and levels move on to coarser ones
+    for (int round = 0; round < 12; ++round) {
+        record(history, sample, 1500);
+
+        SGGeodVec cached[2];
+        for (int i = 0; i < 2; ++i) {
+            cached[i] = history.pathForHistory(edgeLengths[i]);
+        }
+
+        // evict the cached paths, so they are built again
+        for (int j = 1; j <= 4; ++j) {
+            history.pathForHistory(1000.0 * j);
+        }
+
+        // the paths start with the oldest sample left
+        PagedPathForHistory_ptr oldest = history.pagedPathForHistory(1);
+        SG_CHECK_EQUAL(oldest->path.size(), 1);
+
+        for (int i = 0; i < 2; ++i) {
+            SGGeodVec built = history.pathForHistory(edgeLengths[i]);
+            checkSamePath(cached[i], built);
+            checkSamePath(SGGeodVec(1, built.front()), oldest->path);
+        }
+    }
+
+    // samples were thinned out
+    SG_VERIFY(history.pagedPathForHistory(sample).path.size() < sample);
+
+    history.shutdown();
+}
+
+int main(int argc, char* argv[])
+{
+    globals = new FGGlobals;
+
+    testFilteredPathsFollowDecimation();
+
+    delete globals;
+}
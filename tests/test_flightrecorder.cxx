@@ -0,0 +1,156 @@
+#include "config.h"
+
+#include <cstring>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+
+#include <Main/globals.hxx>
+#include <Main/fg_props.hxx>
+#include <Aircraft/flightrecorder.hxx>
+
+static void addSignal(SGPropertyNode* config, const char* type, const char* property)
+{
+    SGPropertyNode* signal = config->addChild("signal");
+    signal->setStringValue("type", type);
+    signal->setStringValue("property", property);
+}
+
+// one signal of every type, and more bools than fit into a byte
+static void configure(FGFlightRecorder& recorder)
+{
+    SGPropertyNode_ptr config = new SGPropertyNode;
+    addSignal(config, "double", "/test/rec/latitude-deg");
+    addSignal(config, "double", "/test/rec/fuel-lbs");
+    addSignal(config, "float",  "/test/rec/pitch-deg");
+    addSignal(config, "float",  "/test/rec/flaps");
+    addSignal(config, "int",    "/test/rec/frame");
+    addSignal(config, "int16",  "/test/rec/rpm");
+    addSignal(config, "int8",   "/test/rec/trim");
+    for (int i = 0; i < 11; ++i) {
+        std::string property = "/test/rec/switch[" + std::to_string(i) + "]";
+        addSignal(config, "bool", property.c_str());
+    }
+    recorder.reinit(config);
+}
+
+static void setSignals(unsigned i)
+{
+    fgSetDouble("/test/rec/latitude-deg", 37.6 + 1e-6 * i * i);
+    fgSetDouble("/test/rec/fuel-lbs", 250.0);                       // constant
+    fgSetFloat("/test/rec/pitch-deg", (i % 7) - 3.5f);
+    fgSetFloat("/test/rec/flaps", (i < 20) ? 0.0f : 0.5f);           // one step
+    fgSetInt("/test/rec/frame", 100000 - 3000 * int(i));             // negative deltas
+    fgSetInt("/test/rec/rpm", (i % 2) ? 32767 : -32768);             // full range jumps
+    fgSetInt("/test/rec/trim", -int(i % 5));
+    for (int s = 0; s < 11; ++s) {
+        fgGetNode("/test/rec/switch", s, true)->setBoolValue(((i >> (s % 4)) & 1) != 0);
+    }
+}
+
+static std::vector<unsigned char> capture(FGFlightRecorder& recorder, unsigned count)
+{
+    const size_t recordSize = recorder.getRecordSize();
+    std::vector<unsigned char> frames(count * recordSize);
+    for (unsigned i = 0; i < count; ++i) {
+        setSignals(i);
+        recorder.capture(0.05 * i, (FGReplayData*) &frames[i * recordSize]);
+    }
+    return frames;
+}
+
+// encode count frames starting at first, decode them and compare bytes
+static void checkRoundTrip(FGFlightRecorder& recorder, const std::vector<unsigned char>& frames,
+                           unsigned first, unsigned count)
+{
+    const size_t recordSize = recorder.getRecordSize();
+    std::vector<unsigned char> block;
+    recorder.encodeBlock(&frames[first * recordSize], count, recordSize, block);
+
+    std::vector<unsigned char> decoded(count * recordSize, 0xcd);
+    SG_VERIFY(recorder.decodeBlock(block, count, recordSize, &decoded[0]));
+    SG_VERIFY(memcmp(&decoded[0], &frames[first * recordSize], decoded.size()) == 0);
+
+    // a truncated block is rejected
+    block.pop_back();
+    SG_VERIFY(!recorder.decodeBlock(block, count, recordSize, &decoded[0]));
+}
+
+void testRoundTrip()
+{
+    FGFlightRecorder recorder("test-recorder");
+    configure(recorder);
+    const unsigned count = 3 * FGReplayBlockList::BLOCK_FRAMES;
+    const std::vector<unsigned char> frames = capture(recorder, count);
+
+    // full blocks, starting with the first frame of the recording
+    for (unsigned first = 0; first < count; first += FGReplayBlockList::BLOCK_FRAMES) {
+        checkRoundTrip(recorder, frames, first, FGReplayBlockList::BLOCK_FRAMES);
+    }
+
+    // a single frame: every column is constant
+    checkRoundTrip(recorder, frames, 0, 1);
+    checkRoundTrip(recorder, frames, 17, 1);
+
+    // partial blocks, across the step of the flaps
+    checkRoundTrip(recorder, frames, 15, 10);
+    checkRoundTrip(recorder, frames, 1, 2);
+}
+
+void testStride()
+{
+    FGFlightRecorder recorder("test-recorder");
+    configure(recorder);
+    const size_t recordSize = recorder.getRecordSize();
+    const unsigned count = FGReplayBlockList::BLOCK_FRAMES;
+    const std::vector<unsigned char> frames = capture(recorder, count);
+
+    // records within larger slots, as the replay buffers keep them
+    const size_t stride = recordSize + 5;
+    std::vector<unsigned char> padded(count * stride, 0x55);
+    for (unsigned i = 0; i < count; ++i) {
+        memcpy(&padded[i * stride], &frames[i * recordSize], recordSize);
+    }
+
+    std::vector<unsigned char> block, packed;
+    recorder.encodeBlock(&padded[0], count, stride, block);
+    recorder.encodeBlock(&frames[0], count, recordSize, packed);
+    SG_VERIFY(block == packed);
+
+    std::vector<unsigned char> decoded(count * stride, 0x55);
+    SG_VERIFY(recorder.decodeBlock(block, count, stride, &decoded[0]));
+    SG_VERIFY(decoded == padded);
+}
+
+void testCompression()
+{
+    FGFlightRecorder recorder("test-recorder");
+    configure(recorder);
+    const size_t recordSize = recorder.getRecordSize();
+    const unsigned count = FGReplayBlockList::BLOCK_FRAMES;
+
+    // nothing changes: one value per column
+    std::vector<unsigned char> frames(count * recordSize);
+    setSignals(0);
+    for (unsigned i = 0; i < count; ++i) {
+        recorder.capture(0.0, (FGReplayData*) &frames[i * recordSize]);
+    }
+    std::vector<unsigned char> block;
+    recorder.encodeBlock(&frames[0], count, recordSize, block);
+    SG_VERIFY(block.size() < 2 * recordSize);
+
+    std::vector<unsigned char> decoded(frames.size());
+    SG_VERIFY(recorder.decodeBlock(block, count, recordSize, &decoded[0]));
+    SG_VERIFY(decoded == frames);
+}
+
+int main(int argc, char* argv[])
+{
+    globals = new FGGlobals;
+
+    testRoundTrip();
+    testStride();
+    testCompression();
+
+    delete globals;
+}
@@ -0,0 +1,183 @@
+#include "config.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/io/sg_file.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <Main/globals.hxx>
+#include <Main/fg_props.hxx>
+#include <Network/generic.hxx>
+
+static const int RecordCount = 10;
+
+static void writeProtocol(const SGPath& path)
+{
+    std::ofstream f(path.utf8Str().c_str());
+    f << "<?xml version=\"1.0\"?>\n<PropertyList>\n<generic>\n";
+    const char* directions[2] = { "output", "input" };
+    for (int d = 0; d < 2; ++d) {
+        const std::string prefix = (d == 0) ? "/test/out/" : "/test/in/";
+        f << "<" << directions[d] << ">\n"
+          << "<line_separator>newline</line_separator>\n"
+          << "<var_separator>,</var_separator>\n"
+          << "<chunk><type>bool</type><format>%d</format><node>" << prefix << "flag</node></chunk>\n"
+          << "<chunk><type>int</type><format>%d</format><node>" << prefix << "count</node></chunk>\n"
+          << "<chunk><type>float</type><format>%f</format><node>" << prefix << "ratio</node></chunk>\n"
+          << "<chunk><type>double</type><format>%.3f</format><node>" << prefix << "altitude</node></chunk>\n"
+          << "<chunk><type>string</type><format>%s</format><node>" << prefix << "name</node></chunk>\n"
+          << "<chunk><type>int</type><format>%d</format><relative>true</relative>"
+          << "<node>" << prefix << "steps</node></chunk>\n"
+          << "</" << directions[d] << ">\n";
+    }
+    f << "</generic>\n</PropertyList>\n";
+}
+
+static FGGeneric* createChannel(const std::string& direction, const SGPath& file)
+{
+    // --generic=file,<direction>,50,<file>,roundtrip
+    std::vector<std::string> tokens;
+    tokens.push_back("generic");
+    tokens.push_back("file");
+    tokens.push_back(direction);
+    tokens.push_back("50");
+    tokens.push_back(file.utf8Str());
+    tokens.push_back("roundtrip");
+
+    FGGeneric* channel = new FGGeneric(tokens);
+    SG_VERIFY(channel->getInitOk());
+    channel->set_direction(direction);
+    channel->set_hz(50);
+    channel->set_io_channel(new SGFile(file));
+    return channel;
+}
+
+/**
+ * Runs a channel the way FGIO does with /sim/io/thread set: process() on
+ * its own thread at the channel rate, holding the lock the main thread
+ * takes to exchange the property snapshot.
+ */
+class ChannelThread : public SGThread
+{
+public:
+    ChannelThread(FGProtocol* channel, int count) :
+        _channel(channel),
+        _count(count),
+        _done(false)
+    {
+        _channel->set_threaded(true);
+        _channel->sync_properties();
+    }
+
+    virtual void run()
+    {
+        for (int i = 0; i < _count; ++i) {
+            {
+                SGGuard<SGMutex> g(_lock);
+                SG_VERIFY(_channel->process());
+            }
+            SGTimeStamp::sleepForMSec(1000 / _channel->get_hz());
+        }
+
+        SGGuard<SGMutex> g(_lock);
+        _done = true;
+    }
+
+    // what FGIO::update() does every frame, until the thread is done
+    void syncUntilDone()
+    {
+        for (;;) {
+            {
+                SGGuard<SGMutex> g(_lock);
+                _channel->sync_properties();
+                if (_done) {
+                    break;
+                }
+            }
+            SGTimeStamp::sleepForMSec(5);
+        }
+
+        join();
+        _channel->set_threaded(false);
+    }
+
+private:
+    FGProtocol* _channel;
+    int _count;
+    SGMutex _lock;
+    bool _done;
+};
+
+void testThreadedRoundTrip(const SGPath& dataFile)
+{
+    fgSetBool("/test/out/flag", true);
+    fgSetInt("/test/out/count", 42);
+    fgSetFloat("/test/out/ratio", 0.25f);
+    fgSetDouble("/test/out/altitude", 1234.5);
+    fgSetString("/test/out/name", "roundtrip");
+    fgSetInt("/test/out/steps", 3);
+
+    FGGeneric* out = createChannel("out", dataFile);
+    SG_VERIFY(out->open());
+    ChannelThread writer(out, RecordCount);
+    writer.start();
+    writer.syncUntilDone();
+    SG_VERIFY(out->close());
+    delete out;
+
+    // the inputs have no type yet: they must get the type of their
+    // chunk, as they would without the I/O thread
+    SGPropertyNode* in = fgGetNode("/test/in", true);
+    SG_CHECK_EQUAL(fgGetNode("/test/in/flag", true)->getType(), simgear::props::NONE);
+
+    FGGeneric* reader = createChannel("in", dataFile);
+    SG_VERIFY(reader->open());
+    ChannelThread readerThread(reader, RecordCount);
+    readerThread.start();
+    readerThread.syncUntilDone();
+    SG_VERIFY(reader->close());
+    delete reader;
+
+    SG_CHECK_EQUAL(in->getNode("flag")->getType(), simgear::props::BOOL);
+    SG_CHECK_EQUAL(in->getBoolValue("flag"), true);
+
+    SG_CHECK_EQUAL(in->getNode("count")->getType(), simgear::props::INT);
+    SG_CHECK_EQUAL(in->getIntValue("count"), 42);
+
+    SG_CHECK_EQUAL(in->getNode("ratio")->getType(), simgear::props::FLOAT);
+    SG_CHECK_EQUAL_EP(in->getFloatValue("ratio"), 0.25f);
+
+    SG_CHECK_EQUAL(in->getNode("altitude")->getType(), simgear::props::DOUBLE);
+    SG_CHECK_EQUAL_EP(in->getDoubleValue("altitude"), 1234.5);
+
+    SG_CHECK_EQUAL(in->getNode("name")->getType(), simgear::props::STRING);
+    SG_CHECK_EQUAL(std::string(in->getStringValue("name")), "roundtrip");
+
+    // a relative input adds up every record, across the exchanges
+    SG_CHECK_EQUAL(in->getNode("steps")->getType(), simgear::props::INT);
+    SG_CHECK_EQUAL(in->getIntValue("steps"), 3 * RecordCount);
+}
+
+int main(int argc, char* argv[])
+{
+    simgear::Dir tmp = simgear::Dir::tempDir("fgtest-generic");
+    tmp.setRemoveOnDestroy();
+
+    // the generic protocol reads its configuration from $FG_ROOT/Protocol
+    SGPath protocolDir = tmp.path() / "Protocol";
+    simgear::Dir(protocolDir).create(0755);
+    writeProtocol(protocolDir / "roundtrip.xml");
+
+    globals = new FGGlobals;
+    globals->set_fg_root(tmp.path());
+
+    testThreadedRoundTrip(tmp.path() / "roundtrip.dat");
+
+    delete globals;
+}
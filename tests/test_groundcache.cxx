@@ -0,0 +1,378 @@
+#include "config.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/MatrixTransform>
+
+#include <simgear/constants.h>
+#include <simgear/math/SGMath.hxx>
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/bvh/BVHMaterial.hxx>
+#include <simgear/bvh/BVHLineSegmentVisitor.hxx>
+#include <simgear/bvh/BVHStaticGeometryBuilder.hxx>
+#include <simgear/scene/util/SGSceneUserData.hxx>
+#include <simgear/scene/util/OsgMath.hxx>
+#include <simgear/structure/SGSharedPtr.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <FDM/groundcache.hxx>
+#include <Scenery/MultiLineSegmentVisitor.hxx>
+
+// A synthetic terrain of rolling hills, cut into square tiles the way the
+// scenery is: each tile is a transform to its center with the triangles
+// and their bounding volume tree in local coordinates below.
+
+static const SGGeod terrainCenter = SGGeod::fromDeg(11.35, 47.26);
+static const int tilesPerSide = 10;
+static const double tileSize = 4000;
+static const double gridSpacing = 100;
+
+static double terrainHeight(double north, double east)
+{
+    return 600 + 40*sin(north/700)*cos(east/900);
+}
+
+// The cartesian position of the terrain point north/east meters from the
+// center, height meters above the tangent plane there.
+static SGVec3d terrainCart(double north, double east, double height)
+{
+    SGVec3d center = SGVec3d::fromGeod(terrainCenter);
+    SGQuatd hlToEc = SGQuatd::fromLonLat(terrainCenter);
+    return center + hlToEc.rotate(SGVec3d(north, east, -height));
+}
+
+static osg::Node* createTile(double north0, double east0,
+                             const simgear::BVHMaterial* material)
+{
+    SGVec3d tileCenter = terrainCart(north0 + 0.5*tileSize,
+                                     east0 + 0.5*tileSize, 0);
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    SGSharedPtr<simgear::BVHStaticGeometryBuilder> builder;
+    builder = new simgear::BVHStaticGeometryBuilder;
+    builder->setCurrentMaterial(material);
+
+    int n = int(tileSize/gridSpacing);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            SGVec3f v[4];
+            for (int k = 0; k < 4; ++k) {
+                double north = north0 + (i + (k & 1))*gridSpacing;
+                double east = east0 + (j + (k >> 1))*gridSpacing;
+                SGVec3d p = terrainCart(north, east, terrainHeight(north, east));
+                v[k] = toVec3f(p - tileCenter);
+            }
+            builder->addTriangle(v[0], v[1], v[3]);
+            builder->addTriangle(v[0], v[3], v[2]);
+            const int order[6] = { 0, 1, 3, 0, 3, 2 };
+            for (int k = 0; k < 6; ++k)
+                vertices->push_back(toOsg(v[order[k]]));
+        }
+    }
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES,
+                                                  0, vertices->size()));
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(geometry);
+    SGSceneUserData* userData;
+    userData = SGSceneUserData::getOrCreateSceneUserData(geode);
+    userData->setBVHNode(builder->buildTree());
+
+    osg::MatrixTransform* transform = new osg::MatrixTransform;
+    transform->setMatrix(osg::Matrix::translate(toOsg(tileCenter)));
+    transform->addChild(geode);
+    return transform;
+}
+
+static osg::Node* createTerrain(const simgear::BVHMaterial* material)
+{
+    osg::Group* terrain = new osg::Group;
+    double start = -0.5*tilesPerSide*tileSize;
+    for (int i = 0; i < tilesPerSide; ++i)
+        for (int j = 0; j < tilesPerSide; ++j)
+            terrain->addChild(createTile(start + i*tileSize,
+                                         start + j*tileSize, material));
+    return terrain;
+}
+
+// The ground contacts of a large aircraft, relative to its reference point
+static std::vector<SGVec3d> gearContacts(double north, double east,
+                                         double agl)
+{
+    std::vector<SGVec3d> contacts;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            double n = north + 20*i - 30;
+            double e = east + 12*j - 18;
+            contacts.push_back(terrainCart(n, e, terrainHeight(n, e) + agl));
+        }
+    }
+    return contacts;
+}
+
+void testBatchedAgl()
+{
+    SGSharedPtr<simgear::BVHMaterial> material = new simgear::BVHMaterial;
+    osg::ref_ptr<osg::Node> terrain = createTerrain(material.get());
+
+    FGGroundCache cache;
+    cache.set_scene(terrain.get());
+
+    std::vector<SGVec3d> contacts = gearContacts(250, -130, 2);
+    SGVec3d reference = terrainCart(250, -130, terrainHeight(250, -130) + 5);
+    SG_VERIFY(cache.prepare_ground_cache(0, 0.1, reference, 80));
+
+    unsigned count = contacts.size();
+    std::vector<FGGroundCache::AglResult> results(count);
+    SG_CHECK_EQUAL(cache.get_agl_multi(0, count, contacts.data(),
+                                       results.data()), count);
+
+    // The batched walk finds the same triangles as one query per point
+    for (unsigned i = 0; i < count; ++i) {
+        SGVec3d contact, normal, linearVel, angularVel;
+        simgear::BVHNode::Id id;
+        const simgear::BVHMaterial* mat;
+        SG_VERIFY(cache.get_agl(0, contacts[i], contact, normal, linearVel,
+                                angularVel, id, mat));
+        SG_VERIFY(results[i].valid);
+        SG_CHECK_EQUAL_EP2(dist(contact, results[i].contact), 0.0, 1e-6);
+        SG_CHECK_EQUAL_EP2(dot(normal, results[i].normal), 1.0, 1e-9);
+        SG_CHECK_EQUAL(mat, results[i].material);
+        SG_CHECK_EQUAL(results[i].material, material.get());
+        // 2m above the interpolated terrain
+        SG_CHECK_EQUAL_EP2(dist(contact, contacts[i]), 2.0, 0.5);
+    }
+
+    // Time both ways of asking for a frame's worth of gear contacts
+    const int frames = 20000;
+    SGTimeStamp t0 = SGTimeStamp::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        for (unsigned i = 0; i < count; ++i) {
+            SGVec3d contact, normal, linearVel, angularVel;
+            simgear::BVHNode::Id id;
+            const simgear::BVHMaterial* mat;
+            cache.get_agl(0, contacts[i], contact, normal, linearVel,
+                          angularVel, id, mat);
+        }
+    }
+    SGTimeStamp perPoint = SGTimeStamp::now() - t0;
+
+    t0 = SGTimeStamp::now();
+    for (int frame = 0; frame < frames; ++frame)
+        cache.get_agl_multi(0, count, contacts.data(), results.data());
+    SGTimeStamp batched = SGTimeStamp::now() - t0;
+
+    std::cout << count << " gear contacts, " << frames << " frames: "
+              << "per point " << perPoint.toUSecs()/double(frames)
+              << " us/frame, batched " << batched.toUSecs()/double(frames)
+              << " us/frame" << std::endl;
+}
+
+void testPredictionVelocity()
+{
+    SGSharedPtr<simgear::BVHMaterial> material = new simgear::BVHMaterial;
+    osg::ref_ptr<osg::Node> terrain = createTerrain(material.get());
+
+    FGGroundCache cache;
+    cache.set_scene(terrain.get());
+    cache.set_incremental(true);
+    cache.set_prediction_time(2);
+
+    SGVec3d pt = terrainCart(0, 0, terrainHeight(0, 0) + 30);
+    SGVec3d north = terrainCart(1, 0, 0) - terrainCart(0, 0, 0);
+    SGVec3d cachePt;
+    double refTime, rad;
+
+    // At 100m/s the volume is stretched over the next 200m
+    SG_VERIFY(cache.prepare_ground_cache(10, 10.1, pt, 50, 100*north));
+    SG_VERIFY(cache.is_valid(refTime, cachePt, rad));
+    SG_CHECK_EQUAL_EP2(rad, 150.0, 1e-6);
+    SG_CHECK_EQUAL_EP2(dist(cachePt, pt + 100*north), 0.0, 1e-6);
+
+    // Nothing an FDM reset can produce blows up the volume
+    FGGroundCache reset;
+    reset.set_scene(terrain.get());
+    reset.set_incremental(true);
+    SG_VERIFY(reset.prepare_ground_cache(10, 10.1, pt, 50, 1e9*north));
+    SG_VERIFY(reset.is_valid(refTime, cachePt, rad));
+    SG_CHECK_EQUAL_EP2(rad, 50.0, 1e-6);
+
+    FGGroundCache broken;
+    broken.set_scene(terrain.get());
+    broken.set_incremental(true);
+    SG_VERIFY(broken.prepare_ground_cache(10, 10.1, pt, 50,
+                                          SGVec3d(NAN, 0, 0)));
+    SG_VERIFY(broken.is_valid(refTime, cachePt, rad));
+    SG_CHECK_EQUAL_EP2(rad, 50.0, 1e-6);
+}
+
+// A low level route at 250m/s, 30m above the hills, flying a circle of
+// 8km radius. The FDM position is taken timeOffset seconds along it.
+static const double routeSpeed = 250;
+static const double routeRadius = 8000;
+static const double routeAgl = 30;
+
+static SGVec3d routePoint(double t)
+{
+    double angle = routeSpeed*t/routeRadius;
+    double north = routeRadius*sin(angle) - 6000;
+    double east = routeRadius*(1 - cos(angle)) - 6000;
+    return terrainCart(north, east, terrainHeight(north, east) + routeAgl);
+}
+
+void testFastLowLevelRoute()
+{
+    SGSharedPtr<simgear::BVHMaterial> material = new simgear::BVHMaterial;
+    osg::ref_ptr<osg::Node> terrain = createTerrain(material.get());
+
+    FGGroundCache cache;
+    cache.set_scene(terrain.get());
+    cache.set_async(true);
+    cache.set_prediction_time(1);
+
+    const double dt = 1.0/120;
+    const double duration = 60;
+    // Halfway through, jump 2km ahead like a reposition would, so the
+    // prefetched volume can not cover the next request.
+    const double jumpTime = 30;
+    const double jump = 8;
+
+    int steps = 0, invalid = 0, invalidAfterJump = 0;
+    double lastInvalidTime = 0;
+    SGTimeStamp maxPrepare = SGTimeStamp::fromSec(0);
+    for (double t = 0; t < duration; t += dt, ++steps) {
+        double routeTime = t < jumpTime ? t : t + jump;
+        SGVec3d pt = routePoint(routeTime);
+        SGVec3d velocity = (routePoint(routeTime + dt) - pt)/dt;
+
+        SGTimeStamp t0 = SGTimeStamp::now();
+        SG_VERIFY(cache.prepare_ground_cache(t, t + dt, pt, 30, velocity));
+        SGTimeStamp prepare = SGTimeStamp::now() - t0;
+        // The first cache is the only one built on this thread
+        if (0 < steps && maxPrepare < prepare)
+            maxPrepare = prepare;
+
+        SGVec3d contact, normal, linearVel, angularVel;
+        simgear::BVHNode::Id id;
+        const simgear::BVHMaterial* mat;
+        if (cache.get_agl(t, pt, contact, normal, linearVel, angularVel,
+                          id, mat)) {
+            SG_CHECK_EQUAL_EP2(dist(contact, pt), routeAgl, 1.0);
+        } else {
+            ++invalid;
+            lastInvalidTime = t;
+            if (jumpTime <= t)
+                ++invalidAfterJump;
+        }
+    }
+
+    std::cout << steps << " steps: " << cache.get_build_count()
+              << " builds, " << cache.get_prefetch_count() << " prefetches, "
+              << cache.get_prefetch_swap_count() << " swaps, "
+              << cache.get_miss_count() << " misses, "
+              << invalid << " lookups outside the cache, max prepare "
+              << maxPrepare.toUSecs() << " us" << std::endl;
+
+    // Everything but the first volume came from the prefetch thread
+    SG_CHECK_EQUAL(cache.get_build_count(), 1);
+    SG_VERIFY(10 < cache.get_prefetch_swap_count());
+    // Only a miss can leave a lookup outside the cache
+    SG_VERIFY(invalid <= cache.get_miss_count());
+    // The jump is a miss, and the cache catches up within a second
+    SG_VERIFY(0 < cache.get_miss_count());
+    SG_VERIFY(invalidAfterJump == 0 || lastInvalidTime < jumpTime + 1);
+    cache.set_async(false);
+}
+
+// The terrain probes of the scenery trace all of their rays through a
+// tile in one walk. That must find the same points as one walk per ray.
+void testMultiLineSegments()
+{
+    SGSharedPtr<simgear::BVHMaterial> material = new simgear::BVHMaterial;
+    osg::ref_ptr<osg::Node> terrain = createTerrain(material.get());
+    osg::Group* tiles = terrain->asGroup();
+
+    // A grid of vertical probes across the corner of four tiles, some of
+    // them too short to reach the ground.
+    std::vector<SGLineSegmentd> probes;
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 16; ++j) {
+            double north = 37*i - 300;
+            double east = 41*j - 300;
+            double height = terrainHeight(north, east);
+            double below = (i + j) % 7 ? -200 : 20;
+            probes.push_back(SGLineSegmentd(terrainCart(north, east, height + 200),
+                                            terrainCart(north, east, height + below)));
+        }
+    }
+    unsigned count = probes.size();
+
+    unsigned hits = 0;
+    double multiUs = 0, singleUs = 0;
+    const int rounds = 20;
+    for (unsigned n = 0; n < tiles->getNumChildren(); ++n) {
+        osg::MatrixTransform* transform;
+        transform = tiles->getChild(n)->asTransform()->asMatrixTransform();
+        osg::Node* geode = transform->getChild(0);
+        simgear::BVHNode* bvNode;
+        bvNode = SGSceneUserData::getSceneUserData(geode)->getBVHNode();
+        SGVec3d tileCenter = toVec3d(toSG(transform->getMatrix().getTrans()));
+
+        std::vector<SGLineSegmentd> local;
+        for (unsigned k = 0; k < count; ++k)
+            local.push_back(SGLineSegmentd(probes[k].getStart() - tileCenter,
+                                           probes[k].getEnd() - tileCenter));
+
+        for (int round = 0; round < rounds; ++round) {
+            SGTimeStamp t0 = SGTimeStamp::now();
+            FGMultiLineSegmentVisitor multi(0);
+            for (unsigned k = 0; k < count; ++k)
+                multi.addLineSegment(local[k]);
+            bvNode->accept(multi);
+            multiUs += (SGTimeStamp::now() - t0).toUSecs();
+
+            for (unsigned k = 0; k < count; ++k) {
+                t0 = SGTimeStamp::now();
+                simgear::BVHLineSegmentVisitor single(local[k], 0);
+                bvNode->accept(single);
+                singleUs += (SGTimeStamp::now() - t0).toUSecs();
+
+                if (round != 0)
+                    continue;
+                const FGMultiLineSegmentVisitor::Ray& ray = multi.getRay(k);
+                SG_CHECK_EQUAL(ray.haveHit, !single.empty());
+                if (single.empty())
+                    continue;
+                ++hits;
+                SG_CHECK_EQUAL_EP2(dist(ray.lineSegment.getEnd(),
+                                        single.getLineSegment().getEnd()),
+                                   0.0, 1e-3);
+                SG_CHECK_EQUAL(ray.material, single.getMaterial());
+            }
+        }
+    }
+
+    // Every probe reaching the ground hits one tile, the ones at a
+    // common edge may hit two.
+    SG_VERIFY(200 < hits);
+
+    std::cout << count << " probe rays, " << tiles->getNumChildren()
+              << " tiles: one walk " << multiUs/rounds
+              << " us, one walk per ray " << singleUs/rounds
+              << " us" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    testBatchedAgl();
+    testPredictionVelocity();
+    testFastLowLevelRoute();
+    testMultiLineSegments();
+}
@@ -0,0 +1,359 @@
+#include "config.h"
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/math/SGMath.hxx>
+#include <simgear/xml/easyxml.hxx>
+
+#include <Airports/airport.hxx>
+#include <Airports/groundnetwork.hxx>
+#include <Airports/dynamicloader.hxx>
+#include <Airports/gnnode.hxx>
+#include <Airports/parking.hxx>
+
+static const SGGeod airportCenter = SGGeod::fromDeg(11.35, 47.26);
+
+// deterministic pseudo random numbers in [0, 1)
+static unsigned int randomState = 12345;
+static double nextRandom()
+{
+    randomState = randomState * 1103515245u + 12345u;
+    return ((randomState >> 8) & 0xffff) / 65536.0;
+}
+
+// format an angle the way groundnet.xml files do, e.g. "N47 15.6000"
+static std::string groundnetAngle(double deg, char positive, char negative)
+{
+    char prefix = (deg < 0) ? negative : positive;
+    deg = fabs(deg);
+    int whole = static_cast<int>(deg);
+    char buf[32];
+    ::snprintf(buf, sizeof(buf), "%c%d %.6f", prefix, whole, (deg - whole) * 60.0);
+    return buf;
+}
+
+static std::string groundnetPos(double northM, double eastM)
+{
+    double course = SGMiscd::rad2deg(atan2(eastM, northM));
+    SGGeod pos = SGGeodesy::direct(airportCenter, course,
+                                   sqrt(northM * northM + eastM * eastM));
+    return "lat=\"" + groundnetAngle(pos.getLatitudeDeg(), 'N', 'S') +
+        "\" lon=\"" + groundnetAngle(pos.getLongitudeDeg(), 'E', 'W') + "\"";
+}
+
+static void loadGroundNet(FGGroundNetwork* net, const std::string& xml)
+{
+    FGGroundNetXMLLoader loader(net);
+    std::istringstream input(xml);
+    readXML(input, loader);
+    net->init();
+}
+
+class TestNetwork
+{
+public:
+    TestNetwork(FGGroundNetwork* net) :
+        _net(net)
+    {
+        for (unsigned int idx = 1; _net->findSegment(idx); ++idx) {
+            FGTaxiSegment* seg = _net->findSegment(idx);
+            addNode(seg->getStart());
+            addNode(seg->getEnd());
+        }
+
+        for (const FGParkingRef& park : _net->allParkings()) {
+            addNode(park);
+        }
+    }
+
+    const FGTaxiNodeVector& nodes() const
+    { return _nodes; }
+
+    FGTaxiNodeRef nodeByIndex(int index) const
+    {
+        for (const FGTaxiNodeRef& node : _nodes) {
+            if (node->getIndex() == index) {
+                return node;
+            }
+        }
+        return FGTaxiNodeRef();
+    }
+
+    static double edgeCost(FGTaxiNode* from, FGTaxiNode* to)
+    {
+        return dist(from->cart(), to->cart()) +
+            (to->type() == FGPositioned::PARKING ? 10000 : 0) +
+            (to->getIsOnRunway() ? 1000 : 0);
+    }
+
+    // the plain O(V^2) Dijkstra the ground network used to run
+    double dijkstraCost(FGTaxiNode* start, FGTaxiNode* end) const
+    {
+        const size_t count = _nodes.size();
+        std::vector<double> score(count, HUGE_VAL);
+        std::vector<bool> visited(count, false);
+
+        size_t startIndex = indexOf(start);
+        if (startIndex == count) {
+            return HUGE_VAL;
+        }
+        score[startIndex] = 0.0;
+
+        for (;;) {
+            size_t best = count;
+            for (size_t i = 0; i < count; ++i) {
+                if (!visited[i] && ((best == count) || (score[i] < score[best]))) {
+                    best = i;
+                }
+            }
+
+            if ((best == count) || (score[best] == HUGE_VAL)) {
+                break;
+            }
+            visited[best] = true;
+            if (_nodes[best].ptr() == end) {
+                break;
+            }
+
+            for (unsigned int idx = 1; _net->findSegment(idx); ++idx) {
+                FGTaxiSegment* seg = _net->findSegment(idx);
+                if (seg->getStart().ptr() != _nodes[best].ptr()) {
+                    continue;
+                }
+
+                size_t target = indexOf(seg->getEnd());
+                double alt = score[best] + edgeCost(_nodes[best], seg->getEnd());
+                if (alt < score[target]) {
+                    score[target] = alt;
+                }
+            }
+        }
+
+        size_t endIndex = indexOf(end);
+        return (endIndex == count) ? HUGE_VAL : score[endIndex];
+    }
+
+    // walk a found route, checking that each step follows its segment,
+    // and return its cost
+    double routeCost(FGTaxiRoute route, FGTaxiNode* start, FGTaxiNode* end) const
+    {
+        FGTaxiNodeRef node, previous;
+        int segIndex;
+        double cost = 0.0;
+
+        route.first();
+        while (route.next(node, &segIndex)) {
+            if (!previous.valid()) {
+                SG_VERIFY(node.ptr() == start);
+            } else {
+                FGTaxiSegment* seg = _net->findSegment(segIndex);
+                SG_VERIFY(seg != NULL);
+                SG_VERIFY(seg->getStart().ptr() == previous.ptr());
+                SG_VERIFY(seg->getEnd().ptr() == node.ptr());
+                cost += edgeCost(previous, node);
+            }
+            previous = node;
+        }
+
+        SG_VERIFY(previous.ptr() == end);
+        return cost;
+    }
+
+private:
+    void addNode(const FGTaxiNodeRef& node)
+    {
+        if (indexOf(node.ptr()) == _nodes.size()) {
+            _nodes.push_back(node);
+        }
+    }
+
+    size_t indexOf(const FGTaxiNode* node) const
+    {
+        for (size_t i = 0; i < _nodes.size(); ++i) {
+            if (_nodes[i].ptr() == node) {
+                return i;
+            }
+        }
+        return _nodes.size();
+    }
+
+    FGGroundNetwork* _net;
+    FGTaxiNodeVector _nodes;
+};
+
+// a jittered grid of taxiways with a runway along one column, some one
+// way arcs, gates off the edges and one parking without any taxiway
+static std::string createGridNetwork(int size, double spacingM)
+{
+    std::ostringstream xml;
+    xml << "<?xml version=\"1.0\"?>\n<groundnet>\n<version>1</version>\n";
+
+    const int gateCount = size;
+    xml << "<parkingList>\n";
+    for (int g = 0; g <= gateCount; ++g) {
+        xml << "<Parking index=\"" << (1000 + g) << "\" type=\"gate\" name=\"A\""
+            << " number=\"" << g << "\" "
+            << groundnetPos(-spacingM, g * spacingM) << " heading=\"0\" radius=\"20\"/>\n";
+    }
+    xml << "</parkingList>\n";
+
+    xml << "<TaxiNodes>\n";
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            double north = row * spacingM + (nextRandom() - 0.5) * spacingM * 0.5;
+            double east = col * spacingM + (nextRandom() - 0.5) * spacingM * 0.5;
+            xml << "<node index=\"" << (row * size + col) << "\" "
+                << groundnetPos(north, east)
+                << " isOnRunway=\"" << (col == size / 2 ? 1 : 0) << "\""
+                << " holdPointType=\"none\"/>\n";
+        }
+    }
+    xml << "</TaxiNodes>\n";
+
+    xml << "<TaxiWaySegments>\n";
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            const int node = row * size + col;
+            const int neighbours[3] = {
+                (col + 1 < size) ? node + 1 : -1,
+                (row + 1 < size) ? node + size : -1,
+                ((col + 1 < size) && (row + 1 < size) && (nextRandom() < 0.2)) ? node + size + 1 : -1
+            };
+
+            for (int n = 0; n < 3; ++n) {
+                if ((neighbours[n] < 0) || (nextRandom() < 0.15)) {
+                    continue; // missing taxiway
+                }
+
+                double r = nextRandom();
+                if (r < 0.9) {
+                    xml << "<arc begin=\"" << node << "\" end=\"" << neighbours[n] << "\"/>\n";
+                }
+                if (r > 0.1) {
+                    xml << "<arc begin=\"" << neighbours[n] << "\" end=\"" << node << "\"/>\n";
+                }
+            }
+        }
+    }
+
+    // the last gate stays unconnected
+    for (int g = 0; g < gateCount; ++g) {
+        xml << "<arc begin=\"" << (1000 + g) << "\" end=\"" << g << "\"/>\n"
+            << "<arc begin=\"" << g << "\" end=\"" << (1000 + g) << "\"/>\n";
+    }
+    xml << "</TaxiWaySegments>\n</groundnet>\n";
+    return xml.str();
+}
+
+void testRoutesMatchDijkstra()
+{
+    FGAirportRef apt = new FGAirport(FGPositioned::TRANSIENT_ID, "XTST",
+                                     airportCenter, "Test", false,
+                                     FGPositioned::AIRPORT);
+    FGGroundNetwork net(apt);
+    loadGroundNet(&net, createGridNetwork(12, 150.0));
+
+    TestNetwork test(&net);
+    const FGTaxiNodeVector& nodes = test.nodes();
+    SG_VERIFY(nodes.size() > 12 * 12);
+
+    int reachable = 0;
+    for (size_t s = 0; s < nodes.size(); s += 3) {
+        for (size_t e = 0; e < nodes.size(); e += 5) {
+            FGTaxiNode* start = nodes[s];
+            FGTaxiNode* end = nodes[e];
+            double expected = test.dijkstraCost(start, end);
+
+            FGTaxiRoute route = net.findShortestRoute(start, end, false);
+            if (expected == HUGE_VAL) {
+                SG_VERIFY(route.empty());
+                continue;
+            }
+
+            SG_VERIFY(!route.empty());
+            SG_CHECK_EQUAL_EP2(test.routeCost(route, start, end), expected, 1e-6);
+
+            // served from the route cache the second time
+            FGTaxiRoute again = net.findShortestRoute(start, end, false);
+            SG_CHECK_EQUAL(again.size(), route.size());
+            SG_CHECK_EQUAL_EP2(test.routeCost(again, start, end), expected, 1e-6);
+            ++reachable;
+        }
+    }
+
+    SG_VERIFY(reachable > 100);
+    SG_VERIFY(unreachable > 0);
+
+    // routes to the gate without taxiways, or to a node outside the network
+    FGTaxiNodeRef isolated = test.nodeByIndex(1000 + 12);
+    SG_VERIFY(isolated.valid());
+    SG_VERIFY(net.findShortestRoute(nodes.front(), isolated, false).empty());
+
+    FGTaxiNodeRef stranger(new FGTaxiNode(5000, airportCenter, false, 0));
+    SG_VERIFY(net.findShortestRoute(nodes.front(), stranger, false).empty());
+    SG_VERIFY(net.findShortestRoute(stranger, nodes.front(), false).empty());
+}
+
+void testPenalties()
+{
+    FGAirportRef apt = new FGAirport(FGPositioned::TRANSIENT_ID, "XTST",
+                                     airportCenter, "Test", false,
+                                     FGPositioned::AIRPORT);
+    FGGroundNetwork net(apt);
+
+    // 1 -> 2 -> 5 crosses the runway at 2, 1 -> 3 -> 5 is a longer
+    // detour on the taxiway and 1 -> 4 -> 6 -> 5 a shorter one that
+    // enters one more node. 7 -> 8 is one way.
+    std::ostringstream xml;
+    xml << "<?xml version=\"1.0\"?>\n<groundnet>\n<TaxiNodes>\n"
+        << "<node index=\"1\" " << groundnetPos(0, 0) << "/>\n"
+        << "<node index=\"2\" " << groundnetPos(0, 300) << " isOnRunway=\"1\"/>\n"
+        << "<node index=\"3\" " << groundnetPos(400, 300) << "/>\n"
+        << "<node index=\"4\" " << groundnetPos(-100, 200) << "/>\n"
+        << "<node index=\"5\" " << groundnetPos(0, 600) << "/>\n"
+        << "<node index=\"6\" " << groundnetPos(-100, 400) << "/>\n"
+        << "<node index=\"7\" " << groundnetPos(200, 0) << "/>\n"
+        << "<node index=\"8\" " << groundnetPos(200, 100) << "/>\n"
+        << "</TaxiNodes>\n<TaxiWaySegments>\n"
+        << "<arc begin=\"1\" end=\"2\"/><arc begin=\"2\" end=\"5\"/>\n"
+        << "<arc begin=\"1\" end=\"3\"/><arc begin=\"3\" end=\"5\"/>\n"
+        << "<arc begin=\"1\" end=\"4\"/><arc begin=\"4\" end=\"6\"/><arc begin=\"6\" end=\"5\"/>\n"
+        << "<arc begin=\"7\" end=\"8\"/>\n"
+        << "</TaxiWaySegments>\n</groundnet>\n";
+    loadGroundNet(&net, xml.str());
+
+    TestNetwork test(&net);
+    FGTaxiNodeRef n1 = test.nodeByIndex(1), n3 = test.nodeByIndex(3),
+        n5 = test.nodeByIndex(5), n7 = test.nodeByIndex(7),
+        n8 = test.nodeByIndex(8);
+
+    // every node entered costs the 10000 node penalty, so the three node
+    // detour loses against both two node routes, and the runway penalty
+    // outweighs the 400 m longer way round on the taxiway
+    FGTaxiRoute route = net.findShortestRoute(n1, n5, false);
+    SG_CHECK_EQUAL(route.size(), 3);
+
+    FGTaxiNodeRef node;
+    int segIndex;
+    route.first();
+    route.next(node, &segIndex);
+    route.next(node, &segIndex);
+    SG_VERIFY(node.ptr() == n3.ptr());
+
+    SG_CHECK_EQUAL_EP2(test.routeCost(route, n1, n5), test.dijkstraCost(n1, n5), 1e-6);
+
+    // one way arc
+    SG_VERIFY(!net.findShortestRoute(n7, n8, false).empty());
+    SG_VERIFY(net.findShortestRoute(n8, n7, false).empty());
+    SG_VERIFY(net.findShortestRoute(n1, n7, false).empty());
+}
+
+int main(int argc, char* argv[])
+{
+    testRoutesMatchDijkstra();
+    testPenalties();
+}
@@ -0,0 +1,197 @@
+#include "config.h"
+
+#include <cmath>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+
+#include <Scenery/heightfield.hxx>
+
+/**
+ * Terrain sloping linearly in lon and lat, which bilinear interpolation
+ * reproduces up to the quantization of the stored heights. Optionally
+ * without terrain west of a longitude.
+ */
+class PlaneSampler : public TileHeightField::Sampler
+{
+public:
+    PlaneSampler(const SGBucket& bucket) :
+        _bucket(bucket),
+        _holeWestOfLon(-1000.0),
+        _count(0)
+    { }
+
+    double height(const SGGeod& geod) const
+    {
+        return 300.0 + 2000.0 * (geod.getLongitudeDeg() - _bucket.get_center_lon()) -
+            1500.0 * (geod.getLatitudeDeg() - _bucket.get_center_lat());
+    }
+
+    virtual bool sample(const SGGeod& geod, double& alt)
+    {
+        ++_count;
+        // only ever asked for points of its tile
+        SG_VERIFY(std::fabs(geod.getLongitudeDeg() - _bucket.get_center_lon()) <=
+                  0.5 * _bucket.get_width());
+        SG_VERIFY(std::fabs(geod.getLatitudeDeg() - _bucket.get_center_lat()) <=
+                  0.5 * _bucket.get_height());
+
+        if (geod.getLongitudeDeg() < _holeWestOfLon)
+            return false;
+        alt = height(geod);
+        return true;
+    }
+
+    SGBucket _bucket;
+    double _holeWestOfLon;
+    unsigned _count;
+};
+
+static const unsigned Resolution = 8;
+// stored heights are rounded to half a meter
+static const double QuantizationM = 0.25 + 1e-6;
+
+static SGGeod tilePoint(const SGBucket& bucket, double u, double v)
+{
+    return SGGeod::fromDeg(bucket.get_center_lon() + (u - 0.5) * bucket.get_width(),
+                           bucket.get_center_lat() + (v - 0.5) * bucket.get_height());
+}
+
+void testInterpolation()
+{
+    SGBucket bucket(SGGeod::fromDeg(8.3, 47.3));
+    TileHeightField field(bucket, Resolution);
+    PlaneSampler sampler(bucket);
+
+    // grid points are sampled a little inside the tile at its border,
+    // so allow for the slope over that distance
+    const double borderM = (2000.0 * bucket.get_width() + 1500.0 * bucket.get_height()) *
+        1e-3 / Resolution;
+
+    for (unsigned j = 0; j <= 4 * Resolution; ++j) {
+        for (unsigned i = 0; i <= 4 * Resolution; ++i) {
+            // cell corners, edges and centers
+            SGGeod geod = tilePoint(bucket, double(i) / (4 * Resolution),
+                                    double(j) / (4 * Resolution));
+            double alt;
+            SG_VERIFY(field.get_elevation_m(geod, sampler, alt));
+            SG_CHECK_EQUAL_EP2(alt, sampler.height(geod), QuantizationM + borderM);
+        }
+    }
+
+    // every grid point was sampled exactly once
+    SG_CHECK_EQUAL(sampler._count, (Resolution + 1) * (Resolution + 1));
+}
+
+void testCellEdges()
+{
+    SGBucket bucket(SGGeod::fromDeg(-122.4, 37.6));
+    TileHeightField field(bucket, Resolution);
+    PlaneSampler sampler(bucket);
+
+    // both sides of an inner cell edge agree with the value on it
+    for (unsigned k = 1; k < Resolution; ++k) {
+        const double edge = double(k) / Resolution;
+        const double eps = 1e-9;
+        double on, west, east, south, north;
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, edge, 0.3), sampler, on));
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, edge - eps, 0.3), sampler, west));
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, edge + eps, 0.3), sampler, east));
+        SG_CHECK_EQUAL_EP2(west, on, 1e-3);
+        SG_CHECK_EQUAL_EP2(east, on, 1e-3);
+
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 0.3, edge), sampler, on));
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 0.3, edge - eps), sampler, south));
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 0.3, edge + eps), sampler, north));
+        SG_CHECK_EQUAL_EP2(south, on, 1e-3);
+        SG_CHECK_EQUAL_EP2(north, on, 1e-3);
+    }
+
+    // a grid point is the stored height itself
+    double alt;
+    SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 3.0 / Resolution, 5.0 / Resolution),
+                                    sampler, alt));
+    SG_CHECK_EQUAL_EP2(alt, 0.5 * std::floor(2.0 * sampler.height(
+        tilePoint(bucket, 3.0 / Resolution, 5.0 / Resolution)) + 0.5), 1e-6);
+}
+
+void testOutsideTile()
+{
+    SGBucket bucket(SGGeod::fromDeg(8.3, 47.3));
+    TileHeightField field(bucket, Resolution);
+    PlaneSampler sampler(bucket);
+
+    // queries beyond the tile are clamped to its border, and never
+    // sample outside of it
+    const double outside[4][2] = { { -0.2, 0.5 }, { 1.3, 0.5 }, { 0.5, -0.01 }, { 0.5, 1.5 } };
+    const double border[4][2]  = { {  0.0, 0.5 }, { 1.0, 0.5 }, { 0.5,  0.0  }, { 0.5, 1.0 } };
+    for (int k = 0; k < 4; ++k) {
+        double altOutside, altBorder;
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, outside[k][0], outside[k][1]),
+                                        sampler, altOutside));
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, border[k][0], border[k][1]),
+                                        sampler, altBorder));
+        SG_CHECK_EQUAL_EP2(altOutside, altBorder, 1e-6);
+    }
+
+    // the corner beyond both borders
+    double altOutside, altBorder;
+    SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 1.5, 1.5), sampler, altOutside));
+    SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 1.0, 1.0), sampler, altBorder));
+    SG_CHECK_EQUAL_EP2(altOutside, altBorder, 1e-6);
+}
+
+void testMissingTerrain()
+{
+    SGBucket bucket(SGGeod::fromDeg(8.3, 47.3));
+    TileHeightField field(bucket, Resolution);
+    PlaneSampler sampler(bucket);
+    // no terrain at the western two columns of grid points
+    sampler._holeWestOfLon = tilePoint(bucket, 1.5 / Resolution, 0.0).getLongitudeDeg();
+
+    double alt;
+    SG_VERIFY(!field.get_elevation_m(tilePoint(bucket, 0.5 / Resolution, 0.5), sampler, alt));
+    SG_VERIFY(!field.get_elevation_m(tilePoint(bucket, 1.5 / Resolution, 0.5), sampler, alt));
+    SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 2.5 / Resolution, 0.5), sampler, alt));
+
+    // points without terrain are remembered, too
+    unsigned count = sampler._count;
+    SG_VERIFY(!field.get_elevation_m(tilePoint(bucket, 0.6 / Resolution, 0.55), sampler, alt));
+    SG_CHECK_EQUAL(sampler._count, count);
+}
+
+void testStatistics()
+{
+    const unsigned fields = TileHeightField::get_field_count();
+    const size_t memory = TileHeightField::get_memory_size();
+    {
+        SGBucket bucket(SGGeod::fromDeg(8.3, 47.3));
+        TileHeightField field(bucket, Resolution);
+        PlaneSampler sampler(bucket);
+        SG_CHECK_EQUAL(TileHeightField::get_field_count(), fields + 1);
+        // the grid is allocated on first use
+        SG_CHECK_EQUAL(TileHeightField::get_memory_size(), memory);
+
+        const unsigned long hits = TileHeightField::get_hit_count();
+        const unsigned long misses = TileHeightField::get_miss_count();
+        double alt;
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 0.51, 0.51), sampler, alt));
+        SG_VERIFY(field.get_elevation_m(tilePoint(bucket, 0.52, 0.53), sampler, alt));
+        SG_CHECK_EQUAL(TileHeightField::get_miss_count(), misses + 1);
+        SG_CHECK_EQUAL(TileHeightField::get_hit_count(), hits + 1);
+        SG_CHECK_EQUAL(sampler._count, 4);
+        SG_CHECK_EQUAL(TileHeightField::get_memory_size(),
+                       memory + (Resolution + 1) * (Resolution + 1) * sizeof(short));
+    }
+    SG_CHECK_EQUAL(TileHeightField::get_field_count(), fields);
+    SG_CHECK_EQUAL(TileHeightField::get_memory_size(), memory);
+}
+
+int main(int argc, char* argv[])
+{
+    testInterpolation();
+    testCellEdges();
+    testOutsideTile();
+    testMissingTerrain();
+    testStatistics();
+}
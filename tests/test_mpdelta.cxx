@@ -0,0 +1,270 @@
+#include "config.h"
+
+#include <iostream>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <MultiPlayer/mpmessages.hxx>
+#include <MultiPlayer/mpdelta.hxx>
+#include <MultiPlayer/tiny_xdr.hxx>
+
+// The properties of an aircraft: the first ones change with every
+// message, like the surface positions, some now and then, like the
+// engine settings, and most never, like the livery.
+static const unsigned PropertyCount = 60;
+static const unsigned FirstId = 100;
+static const unsigned BoolBlocks = 3;
+static const unsigned BoolStartId = 11000;
+
+struct Aircraft {
+  std::vector<float> values;
+  int bools[BoolBlocks];
+
+  Aircraft() : values(PropertyCount, 0.0f)
+  {
+    for (unsigned i = 0; i < BoolBlocks; ++i)
+      bools[i] = 0;
+  }
+
+  void fly(unsigned frame)
+  {
+    for (unsigned i = 0; i < PropertyCount; ++i) {
+      if (i < 8)
+        values[i] = 0.01f * ((frame * (i + 1)) % 100);
+      else if (i < 16 && frame % (5 * i) == 0)
+        values[i] += 1.0f;
+      else if (frame == 0)
+        values[i] = 0.5f * i;
+    }
+    bools[0] = (frame / 7) & 0x5;
+    bools[1] = (frame % 40 < 20) ? 0x100 : 0;
+    bools[2] = 0;
+  }
+};
+
+struct Packet {
+  bool keyframe;
+  uint32_t number;
+  std::vector<xdr_data_t> data;
+};
+
+// Encode the properties as V2 messages do, an id and a value each, the
+// bool blocks last.
+static Packet encode(const Aircraft& aircraft, FGMPDeltaEncoder& encoder,
+                     bool useDelta)
+{
+  Packet packet;
+  packet.keyframe = false;
+  packet.number = 0;
+  packet.data.resize(2 * (PropertyCount + BoolBlocks));
+  xdr_data_t* data = &packet.data[0];
+  xdr_data_t* ptr = data;
+
+  if (useDelta) {
+    packet.keyframe = encoder.begin(PropertyCount, 20);
+    packet.number = encoder.getKeyframe();
+  }
+  for (unsigned i = 0; i < PropertyCount; ++i) {
+    xdr_data_t* propStart = ptr;
+    *ptr++ = XDR_encode_uint32(FirstId + i);
+    *ptr++ = XDR_encode_float(aircraft.values[i]);
+    if (useDelta)
+      ptr = (xdr_data_t*)encoder.filter((char*)data, (char*)propStart, (char*)ptr);
+  }
+  if (packet.keyframe) {
+    encoder.end((char*)data, (char*)ptr);
+    for (unsigned i = 0; i < BoolBlocks; ++i)
+      encoder.setKeyframeBools(i, aircraft.bools[i]);
+  }
+  for (unsigned i = 0; i < BoolBlocks; ++i) {
+    if (useDelta && !packet.keyframe && !encoder.boolsChanged(i, aircraft.bools[i]))
+      continue;
+    *ptr++ = XDR_encode_uint32(BoolStartId + i);
+    *ptr++ = XDR_encode_uint32(aircraft.bools[i]);
+  }
+  packet.data.resize(ptr - data);
+  return packet;
+}
+
+static std::vector<FGPropertyData*> decode(const Packet& packet)
+{
+  std::vector<FGPropertyData*> properties;
+  for (size_t i = 0; i + 1 < packet.data.size(); i += 2) {
+    FGPropertyData* property = new FGPropertyData;
+    property->id = XDR_decode_uint32(packet.data[i]);
+    if (property->id >= BoolStartId) {
+      property->type = simgear::props::INT;
+      property->int_value = XDR_decode_uint32(packet.data[i + 1]);
+    } else {
+      property->type = simgear::props::FLOAT;
+      property->float_value = XDR_decode_float(packet.data[i + 1]);
+    }
+    properties.push_back(property);
+  }
+  return properties;
+}
+
+static void clear(std::vector<FGPropertyData*>& properties)
+{
+  for (size_t i = 0; i < properties.size(); ++i)
+    delete properties[i];
+  properties.clear();
+}
+
+// every property that was received is the one sent
+static void checkValues(const std::vector<FGPropertyData*>& properties,
+                        const Aircraft& aircraft)
+{
+  for (size_t i = 0; i < properties.size(); ++i) {
+    unsigned id = properties[i]->id;
+    if (id >= BoolStartId) {
+      SG_CHECK_EQUAL(properties[i]->int_value, aircraft.bools[id - BoolStartId]);
+    } else {
+      SG_CHECK_EQUAL(properties[i]->float_value, aircraft.values[id - FirstId]);
+    }
+  }
+}
+
+// all properties, in the order of the keyframe
+static void checkComplete(const std::vector<FGPropertyData*>& properties,
+                          const Aircraft& aircraft)
+{
+  SG_CHECK_EQUAL(properties.size(), PropertyCount + BoolBlocks);
+  for (unsigned i = 0; i < PropertyCount; ++i)
+    SG_CHECK_EQUAL(properties[i]->id, FirstId + i);
+  for (unsigned i = 0; i < BoolBlocks; ++i)
+    SG_CHECK_EQUAL(properties[PropertyCount + i]->id, BoolStartId + i);
+  checkValues(properties, aircraft);
+}
+
+void testRoundTrip()
+{
+  Aircraft aircraft;
+  FGMPDeltaEncoder encoder;
+  FGMPDeltaDecoder decoder;
+
+  unsigned keyframes = 0, deltas = 0, incomplete = 0;
+  uint32_t lastKeyframe = MP_DELTA_PROBE;
+  for (unsigned frame = 0; frame < 200; ++frame) {
+    aircraft.fly(frame);
+    Packet packet = encode(aircraft, encoder, true);
+    SG_VERIFY(packet.number != MP_DELTA_PROBE);
+
+    // a delta gets lost, and the keyframe after it
+    if (frame == 30 || frame == 40)
+      continue;
+
+    std::vector<FGPropertyData*> properties = decode(packet);
+    if (packet.keyframe) {
+      ++keyframes;
+      SG_VERIFY(packet.number != lastKeyframe);
+      lastKeyframe = packet.number;
+      decoder.setKeyframe(properties, packet.number);
+      checkComplete(properties, aircraft);
+    } else if (decoder.complete(properties, packet.number)) {
+      ++deltas;
+      checkComplete(properties, aircraft);
+    } else {
+      // until the next keyframe, only what changed is known
+      ++incomplete;
+      SG_VERIFY(frame > 40 && frame < 60);
+      SG_VERIFY(properties.size() < PropertyCount);
+      checkValues(properties, aircraft);
+    }
+    clear(properties);
+  }
+
+  // a keyframe every 20 messages, one of them lost
+  SG_CHECK_EQUAL(keyframes, 9);
+  SG_CHECK_EQUAL(incomplete, 19);
+  SG_CHECK_EQUAL(deltas, 200 - 2 - keyframes - incomplete);
+}
+
+void testPropertiesChange()
+{
+  FGMPDeltaEncoder encoder;
+  SG_VERIFY(encoder.begin(PropertyCount, 20));
+  encoder.end(0, 0);
+  SG_VERIFY(!encoder.begin(PropertyCount, 20));
+  uint32_t keyframe = encoder.getKeyframe();
+
+  // another property list always starts a keyframe
+  SG_VERIFY(encoder.begin(PropertyCount + 1, 20));
+  SG_VERIFY(encoder.getKeyframe() != keyframe);
+
+  // as does going back to delta messages
+  encoder.reset();
+  SG_VERIFY(encoder.begin(PropertyCount + 1, 20));
+}
+
+void testMissingKeyframeProperty()
+{
+  FGMPDeltaDecoder decoder;
+  std::vector<FGPropertyData*> keyframe;
+  for (unsigned i = 0; i < 3; ++i) {
+    FGPropertyData* property = new FGPropertyData;
+    property->id = FirstId + i;
+    property->type = simgear::props::INT;
+    property->int_value = i;
+    keyframe.push_back(property);
+  }
+  decoder.setKeyframe(keyframe, 7);
+  clear(keyframe);
+
+  // a property the keyframe lacks is dropped, the list keeps its length
+  std::vector<FGPropertyData*> delta;
+  FGPropertyData* changed = new FGPropertyData;
+  changed->id = FirstId + 1;
+  changed->type = simgear::props::INT;
+  changed->int_value = 42;
+  delta.push_back(changed);
+  FGPropertyData* unknown = new FGPropertyData;
+  unknown->id = BoolStartId;
+  unknown->type = simgear::props::INT;
+  unknown->int_value = 1;
+  delta.push_back(unknown);
+
+  SG_VERIFY(!decoder.complete(delta, 6));
+  SG_CHECK_EQUAL(delta.size(), 2);
+  SG_VERIFY(decoder.complete(delta, 7));
+  SG_CHECK_EQUAL(delta.size(), 3);
+  SG_CHECK_EQUAL(delta[0]->int_value, 0);
+  SG_CHECK_EQUAL(delta[1]->int_value, 42);
+  SG_CHECK_EQUAL(delta[2]->int_value, 2);
+  clear(delta);
+}
+
+// Bytes on the wire and encode time of plain and delta messages
+void testTiming()
+{
+  const unsigned frames = 20000;
+  size_t bytes[2] = { 0, 0 };
+  double usecs[2] = { 0, 0 };
+  for (int useDelta = 0; useDelta < 2; ++useDelta) {
+    Aircraft aircraft;
+    FGMPDeltaEncoder encoder;
+    for (unsigned frame = 0; frame < frames; ++frame) {
+      aircraft.fly(frame);
+      SGTimeStamp t0 = SGTimeStamp::now();
+      Packet packet = encode(aircraft, encoder, useDelta != 0);
+      usecs[useDelta] += (SGTimeStamp::now() - t0).toUSecs();
+      bytes[useDelta] += packet.data.size() * sizeof(xdr_data_t);
+    }
+  }
+  SG_VERIFY(bytes[1] < bytes[0] / 2);
+
+  std::cout << PropertyCount << " properties: plain " << bytes[0] / frames
+            << " bytes, " << usecs[0] / frames << " us/message, delta "
+            << bytes[1] / frames << " bytes, " << usecs[1] / frames
+            << " us/message" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  testRoundTrip();
+  testPropertiesChange();
+  testMissingKeyframeProperty();
+  testTiming();
+}
@@ -1,10 +1,18 @@
 #include "unitTestHelpers.hxx"
 
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
 #include <simgear/misc/test_macros.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include <Navaids/NavDataCache.hxx>
 #include <Navaids/navrecord.hxx>
 #include <Navaids/navlist.hxx>
+#include <Navaids/PositionedOctree.hxx>
+
+using flightgear::NavDataCache;
 
 void testBasic()
 {
@@ -19,11 +27,75 @@ void testBasic()
     
 }
 
+// an octree as the cache starts with, loading nodes as searches reach them
+static void resetOctree()
+{
+    double RADIUS_EARTH_M = 7000 * 1000.0;
+    SGVec3d earthExtent(RADIUS_EARTH_M, RADIUS_EARTH_M, RADIUS_EARTH_M);
+    flightgear::Octree::global_spatialOctree =
+        new flightgear::Octree::Branch(SGBox<double>(-earthExtent, earthExtent), 1);
+}
+
+// range and nearest searches over Europe, returning the ids found; the
+// order of items in a leaf is up to the database
+static std::vector<PositionedID> searchSweep()
+{
+    std::vector<PositionedID> ids;
+    for (double lat = 40.0; lat <= 60.0; lat += 2.0) {
+        for (double lon = -10.0; lon <= 30.0; lon += 4.0) {
+            SGGeod pos = SGGeod::fromDeg(lon, lat);
+            FGPositionedList inRange = FGPositioned::findWithinRange(pos, 30.0, NULL);
+            FGPositionedList closest = FGPositioned::findClosestN(pos, 10, 100.0, NULL);
+            for (FGPositionedRef p : inRange)
+                ids.push_back(p->guid());
+            for (FGPositionedRef p : closest)
+                ids.push_back(p->guid());
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// Searches on the snapshot find what the lazily loaded octree finds, and
+// the time of both.
+void testOctreeSnapshot()
+{
+    flightgear::Octree::Node* octree = flightgear::Octree::global_spatialOctree;
+
+    // load the items found, so both timed sweeps only differ in reading
+    // the octree structure
+    resetOctree();
+    std::vector<PositionedID> expected = searchSweep();
+    SG_VERIFY(!expected.empty());
+
+    resetOctree();
+    SGTimeStamp t0 = SGTimeStamp::now();
+    std::vector<PositionedID> lazy = searchSweep();
+    SGTimeStamp lazyTime = SGTimeStamp::now() - t0;
+    SG_VERIFY(lazy == expected);
+
+    resetOctree();
+    t0 = SGTimeStamp::now();
+    NavDataCache::instance()->loadOctreeSnapshot();
+    SGTimeStamp loadTime = SGTimeStamp::now() - t0;
+    t0 = SGTimeStamp::now();
+    std::vector<PositionedID> snapshot = searchSweep();
+    SGTimeStamp snapshotTime = SGTimeStamp::now() - t0;
+    SG_VERIFY(snapshot == expected);
+
+    std::cout << "octree search sweep: lazy " << lazyTime.toMSecs()
+              << " ms, snapshot load " << loadTime.toMSecs()
+              << " ms and sweep " << snapshotTime.toMSecs() << " ms" << std::endl;
+
+    flightgear::Octree::global_spatialOctree = octree;
+}
+
 int main(int argc, char* argv[])
 {
   fgtest::initTestGlobals("navaids2");
 
   testBasic();
+  testOctreeSnapshot();
 
   fgtest::shutdownTestGlobals();
 }
@@ -0,0 +1,177 @@
+#include "config.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/misc/sg_dir.hxx>
+
+#include <Main/globals.hxx>
+#include <Main/fg_props.hxx>
+#include <Aircraft/flightrecorder.hxx>
+#include <Aircraft/replaytape.hxx>
+
+static const unsigned FrameCount = 2 * FGReplayBlockList::BLOCK_FRAMES + 22;
+
+static void addSignal(SGPropertyNode* config, const char* type, const char* property)
+{
+    SGPropertyNode* signal = config->addChild("signal");
+    signal->setStringValue("type", type);
+    signal->setStringValue("property", property);
+}
+
+static void configure(FGFlightRecorder& recorder)
+{
+    SGPropertyNode_ptr config = new SGPropertyNode;
+    config->setStringValue("name", "tape test");
+    addSignal(config, "double", "/test/tape/altitude-ft");
+    addSignal(config, "float",  "/test/tape/heading-deg");
+    addSignal(config, "int",    "/test/tape/frame");
+    addSignal(config, "bool",   "/test/tape/gear-down");
+    recorder.reinit(config);
+}
+
+// record FrameCount frames of a climbing turn, one byte string each
+static std::vector<unsigned char> recordFrames(FGFlightRecorder& recorder)
+{
+    const size_t recordSize = recorder.getRecordSize();
+    std::vector<unsigned char> frames(FrameCount * recordSize);
+    for (unsigned i = 0; i < FrameCount; ++i) {
+        fgSetDouble("/test/tape/altitude-ft", 1000.0 + 7.5 * i);
+        fgSetFloat("/test/tape/heading-deg", fmod(3.0f * i, 360.0f));
+        fgSetInt("/test/tape/frame", i);
+        fgSetBool("/test/tape/gear-down", i < 40);
+        recorder.capture(0.1 * i, (FGReplayData*) &frames[i * recordSize]);
+    }
+    return frames;
+}
+
+// read and decode every chunk, comparing it to the recorded frames
+static void checkChunks(FGFlightRecorder& recorder, FGReplayTapeReader& reader,
+                        const std::vector<unsigned char>& frames)
+{
+    const size_t recordSize = recorder.getRecordSize();
+    const std::vector<FGReplayTapeReader::Chunk>& chunks = reader.chunks();
+    SG_CHECK_EQUAL(chunks.size(), 3);
+    SG_CHECK_EQUAL(chunks[0].Frames, FGReplayBlockList::BLOCK_FRAMES);
+    SG_CHECK_EQUAL(chunks[1].Frames, FGReplayBlockList::BLOCK_FRAMES);
+    SG_CHECK_EQUAL(chunks[2].Frames, 22);
+
+    SG_CHECK_EQUAL(reader.times().size(), FrameCount);
+    for (unsigned i = 0; i < FrameCount; ++i) {
+        SG_CHECK_EQUAL(reader.times()[i], 0.1 * i);
+    }
+
+    size_t first = 0;
+    std::vector<unsigned char> data, decoded;
+    for (const FGReplayTapeReader::Chunk& c : chunks) {
+        SG_VERIFY(reader.readChunk(c.Offset, c.Size, data));
+        decoded.resize(c.Frames * recordSize);
+        SG_VERIFY(recorder.decodeBlock(data, c.Frames, recordSize, &decoded[0]));
+        SG_VERIFY(memcmp(&decoded[0], &frames[first * recordSize], decoded.size()) == 0);
+        first += c.Frames;
+    }
+}
+
+void testSaveAndLoad(const SGPath& path)
+{
+    FGFlightRecorder recorder("test-tape");
+    configure(recorder);
+    const std::vector<unsigned char> frames = recordFrames(recorder);
+    const size_t recordSize = recorder.getRecordSize();
+
+    SGPropertyNode_ptr config = new SGPropertyNode;
+    recorder.getConfig(config);
+    SGPropertyNode_ptr meta = new SGPropertyNode;
+    meta->setStringValue("aircraft-type", "c172p");
+
+    FGReplayTapeWriter writer(&recorder);
+    SG_VERIFY(writer.open(path, config));
+    SG_VERIFY(writer.isOpen());
+    for (unsigned i = 0; i < FrameCount; ++i) {
+        writer.append((const FGReplayData*) &frames[i * recordSize]);
+    }
+    SG_CHECK_EQUAL(writer.startTime(), 0.0);
+    SG_CHECK_EQUAL(writer.endTime(), 0.1 * (FrameCount - 1));
+    SG_VERIFY(writer.close(meta));
+    SG_VERIFY(!writer.isOpen());
+
+    SG_VERIFY(FGReplayTapeReader::isChunkedTape(path));
+    FGReplayTapeReader reader(&recorder);
+    SG_VERIFY(reader.open(path));
+
+    SGPropertyNode_ptr readConfig = new SGPropertyNode;
+    SG_VERIFY(reader.readConfig(readConfig));
+    SG_CHECK_EQUAL(std::string(readConfig->getStringValue("name")), "tape test");
+    SG_CHECK_EQUAL(readConfig->getIntValue("double"), 1);
+    SG_CHECK_EQUAL(readConfig->getNode("signals")->getChildren("signal").size(), 4);
+
+    SGPropertyNode_ptr readMeta = new SGPropertyNode;
+    SG_VERIFY(reader.readMetaData(readMeta));
+    SG_CHECK_EQUAL(std::string(readMeta->getStringValue("aircraft-type")), "c172p");
+
+    SG_VERIFY(reader.readIndex());
+    checkChunks(recorder, reader, frames);
+}
+
+// a tape which wasn't closed, i.e. after a crash, has chunks but no
+// footer: its index is rebuilt from the chunks
+void testRecoverUnclosedTape(const SGPath& path, const SGPath& truncatedPath)
+{
+    FGFlightRecorder recorder("test-tape");
+    configure(recorder);
+    const std::vector<unsigned char> frames = recordFrames(recorder);
+
+    uint64_t footerOffset;
+    {
+        FGReplayTapeReader reader(&recorder);
+        SG_VERIFY(reader.open(path));
+        SG_VERIFY(reader.readIndex());
+        const FGReplayTapeReader::Chunk& last = reader.chunks().back();
+        footerOffset = last.Offset + last.Size;
+    }
+
+    std::ifstream in(path.utf8Str().c_str(), std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    SG_VERIFY(bytes.size() > footerOffset);
+    std::ofstream out(truncatedPath.utf8Str().c_str(), std::ios::binary);
+    out.write(&bytes[0], footerOffset);
+    out.close();
+
+    FGReplayTapeReader reader(&recorder);
+    SG_VERIFY(reader.open(truncatedPath));
+    SGPropertyNode_ptr meta = new SGPropertyNode;
+    SG_VERIFY(!reader.readMetaData(meta));
+    SG_VERIFY(reader.readIndex());
+    checkChunks(recorder, reader, frames);
+}
+
+void testRejectsOtherFiles(const SGPath& path)
+{
+    std::ofstream out(path.utf8Str().c_str(), std::ios::binary);
+    out << "\x1f\x8b not a chunked tape";
+    out.close();
+
+    SG_VERIFY(!FGReplayTapeReader::isChunkedTape(path));
+    FGFlightRecorder recorder("test-tape");
+    FGReplayTapeReader reader(&recorder);
+    SG_VERIFY(!reader.open(path));
+}
+
+int main(int argc, char* argv[])
+{
+    simgear::Dir tmp = simgear::Dir::tempDir("fgtest-replaytape");
+    tmp.setRemoveOnDestroy();
+
+    globals = new FGGlobals;
+
+    testSaveAndLoad(tmp.path() / "test.fgtape");
+    testRecoverUnclosedTape(tmp.path() / "test.fgtape", tmp.path() / "unclosed.fgtape");
+    testRejectsOtherFiles(tmp.path() / "legacy.fgtape");
+
+    delete globals;
+}
@@ -0,0 +1,219 @@
+#include "config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <set>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/timing/sg_time.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <Main/globals.hxx>
+#include <Traffic/SchedFlight.hxx>
+
+static const time_t Day = 24 * 60 * 60;
+// 2017-06-05 12:00 UTC
+static const time_t StartTime = 1496664000;
+
+// deterministic pseudo random numbers
+static unsigned int randomState = 42;
+static unsigned int nextRandom(unsigned int range)
+{
+    randomState = randomState * 1103515245u + 12345u;
+    return ((randomState >> 8) & 0xffffff) % range;
+}
+
+// a daily flight every hour, alternating between two departure airports
+static FGScheduledFlightVec createFlights()
+{
+    FGScheduledFlightVec flights;
+    for (int h = 0; h < 24; ++h) {
+        char callsign[16], dep[16], arr[16];
+        snprintf(callsign, sizeof(callsign), "TST%02d", h);
+        snprintf(dep, sizeof(dep), "%02d:15:00", h);
+        snprintf(arr, sizeof(arr), "%02d:05:00", (h + 2) % 24);
+        flights.push_back(new FGScheduledFlight(callsign, "IFR",
+                                                (h % 2) ? "EDDM" : "EDDF",
+                                                (h % 2) ? "EDDF" : "EDDM",
+                                                300, dep, arr, "24Hr", "B737"));
+    }
+    return flights;
+}
+
+// every flight of the airport is listed once, by its current departure
+// time, and adjusted to the next arrival
+static void checkDepartures(FGScheduledFlightIndex& index, const FGScheduledFlightVec& flights,
+                            const std::string& depId, time_t now)
+{
+    const FGScheduledFlightIndex::DepartureMap& departures = index.departures("B737", depId, now);
+
+    std::set<FGScheduledFlight*> listed;
+    for (FGScheduledFlightIndex::DepartureMap::const_iterator i = departures.begin();
+         i != departures.end(); ++i) {
+        FGScheduledFlight* flight = i->second;
+        SG_VERIFY(listed.insert(flight).second);
+        SG_CHECK_EQUAL(i->first, flight->getDepartureTime());
+        SG_VERIFY(flight->getArrivalTime() >= now);
+        SG_VERIFY(flight->getArrivalTime() <= now + Day);
+        SG_VERIFY(depId.empty() || (flight->getDepartureId() == depId));
+    }
+
+    size_t expected = 0;
+    for (FGScheduledFlight* flight : flights) {
+        if (depId.empty() || (flight->getDepartureId() == depId)) {
+            ++expected;
+        }
+    }
+    SG_CHECK_EQUAL(listed.size(), expected);
+}
+
+// what FGAISchedule::update() does with a flight in the past
+static void flyPastFlights(const FGScheduledFlightVec& flights, time_t now)
+{
+    for (FGScheduledFlight* flight : flights) {
+        while ((flight->getArrivalTime() < now) && (nextRandom(3) != 0)) {
+            flight->update();
+        }
+    }
+}
+
+void testRepeatedFlight()
+{
+    FGScheduledFlightMap allFlights;
+    FGScheduledFlightVec& flights = allFlights["B737"] = createFlights();
+    FGScheduledFlightIndex index(allFlights);
+    checkDepartures(index, flights, "", StartTime);
+
+    // a schedule moves its arrived flight on by itself
+    FGScheduledFlight* flight = flights[13];
+    time_t now = flight->getArrivalTime() + 60;
+    flight->update();
+    SG_VERIFY(flight->getArrivalTime() > now);
+
+    checkDepartures(index, flights, "", now);
+    checkDepartures(index, flights, "EDDM", now);
+    checkDepartures(index, flights, "EDDF", now);
+
+    // ... also when it is more than one repetition late
+    now += 3 * Day;
+    flight->update();
+    flight->update();
+    checkDepartures(index, flights, "EDDM", now);
+    checkDepartures(index, flights, "", now);
+
+    for (FGScheduledFlight* f : flights) {
+        delete f;
+    }
+}
+
+void testRandomized()
+{
+    FGScheduledFlightMap allFlights;
+    FGScheduledFlightVec& flights = allFlights["B737"] = createFlights();
+    FGScheduledFlightIndex index(allFlights);
+
+    time_t now = StartTime;
+    for (int step = 0; step < 2000; ++step) {
+        now += nextRandom(4 * 60 * 60);
+        flyPastFlights(flights, now);
+
+        const char* airports[3] = { "", "EDDF", "EDDM" };
+        checkDepartures(index, flights, airports[nextRandom(3)], now);
+    }
+
+    for (FGScheduledFlight* f : flights) {
+        delete f;
+    }
+}
+
+// The lookup as it was before the index: adjust all flights of the
+// requirement to now, sort them by departure, and scan for the first one
+// departing from the airport in time.
+static FGScheduledFlight* scanFlights(FGScheduledFlightVec& flights, const std::string& depId,
+                                      time_t now, time_t earliest)
+{
+    for (FGScheduledFlight* flight : flights) {
+        flight->adjustTime(now);
+    }
+    std::sort(flights.begin(), flights.end(), compareScheduledFlights);
+    for (FGScheduledFlight* flight : flights) {
+        if ((flight->getDepartureId() == depId) && (flight->getDepartureTime() >= earliest)) {
+            return flight;
+        }
+    }
+    return NULL;
+}
+
+static FGScheduledFlight* lookupFlight(FGScheduledFlightIndex& index, const std::string& depId,
+                                       time_t now, time_t earliest)
+{
+    const FGScheduledFlightIndex::DepartureMap& departures = index.departures("B737", depId, now);
+    FGScheduledFlightIndex::DepartureMap::const_iterator i = departures.lower_bound(earliest);
+    return (i == departures.end()) ? NULL : i->second;
+}
+
+// Time the lookups of a traffic manager with many aircraft of one type,
+// as the flights they pick move on.
+void testTiming()
+{
+    const int airportCount = 100, lookups = 2000;
+    FGScheduledFlightMap allFlights;
+    FGScheduledFlightVec& flights = allFlights["B737"];
+    for (int a = 0; a < airportCount; ++a) {
+        char dep[16];
+        snprintf(dep, sizeof(dep), "AP%02d", a);
+        FGScheduledFlightVec daily = createFlights();
+        for (FGScheduledFlight* flight : daily) {
+            flight->setDepartureAirport(dep);
+            flights.push_back(flight);
+        }
+    }
+    FGScheduledFlightIndex index(allFlights);
+
+    randomState = 7;
+    time_t now = StartTime;
+    double scanned = 0.0, indexed = 0.0;
+    for (int i = 0; i < lookups; ++i) {
+        now += nextRandom(120);
+        char dep[16];
+        snprintf(dep, sizeof(dep), "AP%02d", nextRandom(airportCount));
+        const time_t earliest = now + nextRandom(6 * 60 * 60);
+
+        SGTimeStamp t0 = SGTimeStamp::now();
+        FGScheduledFlight* byIndex = lookupFlight(index, dep, now, earliest);
+        indexed += (SGTimeStamp::now() - t0).toUSecs();
+
+        t0 = SGTimeStamp::now();
+        FGScheduledFlight* byScan = scanFlights(flights, dep, now, earliest);
+        scanned += (SGTimeStamp::now() - t0).toUSecs();
+
+        // there is a flight from every airport every hour
+        SG_VERIFY(byIndex != NULL);
+        SG_VERIFY(byScan != NULL);
+        SG_CHECK_EQUAL(byIndex->getDepartureTime(), byScan->getDepartureTime());
+    }
+
+    std::cout << flights.size() << " flights, " << airportCount
+              << " airports: index " << indexed / lookups << " us/lookup, "
+              << "adjust, sort and scan " << scanned / lookups << " us/lookup" << std::endl;
+
+    for (FGScheduledFlight* f : flights) {
+        delete f;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    globals = new FGGlobals;
+    // flights are scheduled relative to the current day
+    SGTime* time = new SGTime(SGGeod(), SGPath(), StartTime);
+    time->update(SGGeod(), StartTime, 0);
+    globals->set_time_params(time);
+
+    testRepeatedFlight();
+    testRandomized();
+    testTiming();
+
+    delete globals;
+}
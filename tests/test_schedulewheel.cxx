@@ -0,0 +1,164 @@
+#include "config.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <Traffic/ScheduleWheel.hxx>
+
+// 2017-06-05 12:00 UTC
+static const time_t StartTime = 1496664000;
+
+// what the traffic manager knows of a schedule after its update
+struct Schedule {
+    time_t due;
+    time_t interval;
+    double distance;
+};
+
+typedef FGScheduleWheel<Schedule> Wheel;
+
+// deterministic pseudo random numbers
+static unsigned int randomState = 42;
+static unsigned int nextRandom(unsigned int range)
+{
+    randomState = randomState * 1103515245u + 12345u;
+    return ((randomState >> 8) & 0xffffff) % range;
+}
+
+void testDueTimes()
+{
+    Wheel wheel;
+    Schedule a = { 0, 0, 0.0 }, b = { 0, 0, 0.0 }, c = { 0, 0, 0.0 };
+    SG_VERIFY(wheel.advance(StartTime));
+    wheel.insert(&a, StartTime + 10, 0.0);
+    wheel.insert(&b, StartTime + 5, 0.0);
+    wheel.insert(&c, StartTime, 0.0);
+    SG_CHECK_EQUAL(wheel.size(), 3);
+
+    // due already
+    SG_CHECK_EQUAL(wheel.readyCount(), 1);
+    SG_CHECK_EQUAL(wheel.popReady(), &c);
+    SG_VERIFY(wheel.popReady() == NULL);
+
+    SG_VERIFY(wheel.advance(StartTime + 4));
+    SG_CHECK_EQUAL(wheel.readyCount(), 0);
+    SG_VERIFY(wheel.advance(StartTime + 7));
+    SG_CHECK_EQUAL(wheel.readyCount(), 1);
+    SG_CHECK_EQUAL(wheel.popReady(), &b);
+    SG_CHECK_EQUAL(wheel.size(), 1);
+
+    // time going backwards is left to the caller
+    SG_VERIFY(!wheel.advance(StartTime + 6));
+    SG_CHECK_EQUAL(wheel.size(), 1);
+
+    SG_VERIFY(wheel.advance(StartTime + 10));
+    SG_CHECK_EQUAL(wheel.popReady(), &a);
+    SG_CHECK_EQUAL(wheel.size(), 0);
+
+    // beyond the span of the wheel, it comes early
+    wheel.insert(&a, StartTime + 10 + 100000, 0.0);
+    SG_VERIFY(wheel.advance(StartTime + 10 + Wheel::Slots - 2));
+    SG_CHECK_EQUAL(wheel.readyCount(), 0);
+    SG_VERIFY(wheel.advance(StartTime + 10 + Wheel::Slots - 1));
+    SG_CHECK_EQUAL(wheel.popReady(), &a);
+
+    // a jump over the whole wheel readies everything
+    wheel.insert(&a, StartTime + 20000, 0.0);
+    wheel.insert(&b, StartTime + 20100, 0.0);
+    SG_VERIFY(wheel.advance(StartTime + 50000));
+    SG_CHECK_EQUAL(wheel.readyCount(), 2);
+    SG_CHECK_EQUAL(wheel.size(), 2);
+
+    wheel.clear();
+    SG_CHECK_EQUAL(wheel.size(), 0);
+    SG_VERIFY(wheel.popReady() == NULL);
+}
+
+void testNearestFirst()
+{
+    Wheel wheel;
+    Schedule s[5];
+    const double distances[] = { 300.0, 0.0, 180.0, 0.0, 160.0 };
+    SG_VERIFY(wheel.advance(StartTime));
+    for (int i = 0; i < 5; ++i) {
+        wheel.insert(&s[i], StartTime + 1, distances[i]);
+    }
+    SG_VERIFY(wheel.advance(StartTime + 1));
+
+    // in range first, in the order they were queued, then by distance
+    SG_CHECK_EQUAL(wheel.popReady(), &s[1]);
+    SG_CHECK_EQUAL(wheel.popReady(), &s[3]);
+    SG_CHECK_EQUAL(wheel.popReady(), &s[4]);
+    SG_CHECK_EQUAL(wheel.popReady(), &s[2]);
+    SG_CHECK_EQUAL(wheel.popReady(), &s[0]);
+}
+
+// Cost of the wheel per frame, and how late schedules get their update
+// with the wheel and with the former round robin of one per frame
+void testTiming()
+{
+    const int count = 20000;
+    const int fps = 30;
+    const int seconds = 600;
+
+    std::vector<Schedule> schedules(count);
+    for (int i = 0; i < count; ++i) {
+        schedules[i].interval = 10 + nextRandom(600);
+        schedules[i].due = StartTime + 1 + nextRandom(schedules[i].interval);
+        schedules[i].distance = nextRandom(2) ? 0.0 : 150.0 + nextRandom(1000);
+    }
+
+    Wheel wheel;
+    wheel.advance(StartTime);
+    for (int i = 0; i < count; ++i) {
+        wheel.insert(&schedules[i], schedules[i].due, schedules[i].distance);
+    }
+
+    unsigned long updates = 0;
+    time_t maxWheelDelay = 0;
+    SGTimeStamp t0 = SGTimeStamp::now();
+    for (int frame = 0; frame < fps * seconds; ++frame) {
+        time_t now = StartTime + frame / fps;
+        SG_VERIFY(wheel.advance(now));
+        while (Schedule* schedule = wheel.popReady()) {
+            maxWheelDelay = std::max(maxWheelDelay, now - schedule->due);
+            schedule->due = now + schedule->interval;
+            wheel.insert(schedule, schedule->due, schedule->distance);
+            updates++;
+        }
+    }
+    double wheelUSec = (SGTimeStamp::now() - t0).toUSecs();
+    SG_CHECK_EQUAL(wheel.size(), count);
+    SG_VERIFY(maxWheelDelay <= 1);
+
+    // the same schedules, one per frame
+    for (int i = 0; i < count; ++i) {
+        schedules[i].due = StartTime + 1 + nextRandom(schedules[i].interval);
+    }
+    time_t maxRoundRobinDelay = 0;
+    for (int frame = 0; frame < fps * seconds; ++frame) {
+        time_t now = StartTime + frame / fps;
+        Schedule& schedule = schedules[frame % count];
+        if (schedule.due <= now) {
+            maxRoundRobinDelay = std::max(maxRoundRobinDelay, now - schedule.due);
+            schedule.due = now + schedule.interval;
+        }
+    }
+
+    std::cout << count << " schedules, " << seconds << " s at " << fps << " fps: wheel "
+              << wheelUSec / (fps * seconds) << " us and "
+              << double(updates) / (fps * seconds) << " updates per frame, "
+              << maxWheelDelay << " s late at most; round robin "
+              << maxRoundRobinDelay << " s late at most" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    testDueTimes();
+    testNearestFirst();
+    testTiming();
+}
@@ -0,0 +1,314 @@
+#include "config.h"
+
+#include <cfloat>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <osg/Group>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <Scenery/tilecache.hxx>
+#include <Scenery/tileentry.hxx>
+
+// The tile cache as it was before it got its hash table and expiry heaps:
+// a map from bucket index to tile, scanned linearly for the tiles to drop.
+class ReferenceTileCache
+{
+public:
+    ReferenceTileCache() :
+        current_time(0.0)
+    {}
+
+    ~ReferenceTileCache()
+    {
+        for (TileMap::iterator it = tiles.begin(); it != tiles.end(); ++it)
+            delete it->second;
+    }
+
+    void insert_tile(TileEntry* e)
+    {
+        tiles[e->get_tile_bucket().gen_index()] = e;
+        e->update_time_expired(current_time);
+    }
+
+    void clear_entry(long tile_index)
+    { tiles.erase(tile_index); }
+
+    TileEntry* get_tile(long tile_index) const
+    {
+        TileMap::const_iterator it = tiles.find(tile_index);
+        return (it == tiles.end()) ? NULL : it->second;
+    }
+
+    void clear_current_view()
+    {
+        for (TileMap::iterator it = tiles.begin(); it != tiles.end(); ++it) {
+            TileEntry* e = it->second;
+            if (e->is_current_view()) {
+                e->update_time_expired(current_time);
+                e->set_current_view(false);
+            }
+        }
+    }
+
+    void request_tile(TileEntry* t, float priority, bool current_view, double request_time)
+    {
+        if ((!current_view) && (request_time <= 0.0))
+            return;
+
+        if (t->is_expired(current_time) || (priority > t->get_priority()))
+            t->set_priority(priority);
+
+        if (current_view) {
+            t->update_time_expired(current_time);
+            t->set_current_view(true);
+        } else {
+            t->update_time_expired(current_time + request_time);
+        }
+    }
+
+    // the tiles get_drop_tile() may return: any unused empty tile, or
+    // else the expired tiles of the lowest (expiry time, priority)
+    std::set<long> drop_candidates() const
+    {
+        std::set<long> empty, oldest;
+        double min_time = DBL_MAX;
+        float min_priority = FLT_MAX;
+        for (TileMap::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+            TileEntry* e = it->second;
+            if (e->is_current_view() || !e->is_expired(current_time))
+                continue;
+
+            if (e->is_expired(current_time - 1.0) && !e->is_loaded())
+                empty.insert(it->first);
+
+            if ((e->get_time_expired() < min_time) ||
+                ((e->get_time_expired() == min_time) && (e->get_priority() < min_priority))) {
+                min_time = e->get_time_expired();
+                min_priority = e->get_priority();
+                oldest.clear();
+            }
+            if ((e->get_time_expired() == min_time) && (e->get_priority() == min_priority))
+                oldest.insert(it->first);
+        }
+        return empty.empty() ? oldest : empty;
+    }
+
+    bool has_expired_tile() const
+    {
+        for (TileMap::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+            if (it->second->is_expired(current_time))
+                return true;
+        }
+        return false;
+    }
+
+    typedef std::map<long, TileEntry*> TileMap;
+    TileMap tiles;
+    double current_time;
+};
+
+// deterministic pseudo random numbers
+static unsigned int randomState = 4711;
+static unsigned int nextRandom(unsigned int range)
+{
+    randomState = randomState * 1103515245u + 12345u;
+    return ((randomState >> 8) & 0xffffff) % range;
+}
+
+static std::vector<SGBucket> createBuckets(int count)
+{
+    std::vector<SGBucket> buckets;
+    for (int i = 0; i < count; ++i) {
+        // neighbouring tiles, as the tile manager requests them
+        buckets.push_back(SGBucket(SGGeod::fromDeg(5.0 + (i % 64) * 0.125,
+                                                   45.0 + (i / 64) * 0.125)));
+    }
+    return buckets;
+}
+
+static void markLoaded(TileEntry* e)
+{
+    e->getNode()->addChild(new osg::Group);
+}
+
+static void checkSameTiles(TileCache& cache, const ReferenceTileCache& reference)
+{
+    SG_CHECK_EQUAL(cache.get_size(), reference.tiles.size());
+
+    std::set<long> traversed;
+    for (cache.reset_traversal(); !cache.at_end(); cache.next()) {
+        TileEntry* e = cache.get_current();
+        long index = e->get_tile_bucket().gen_index();
+        SG_VERIFY(traversed.insert(index).second);
+        SG_VERIFY(reference.get_tile(index) != NULL);
+        SG_VERIFY(cache.get_tile(index) == e);
+    }
+    SG_CHECK_EQUAL(traversed.size(), reference.tiles.size());
+}
+
+// Random inserts, requests, loads, view changes and drops, applied to the
+// cache and to the reference with their own copies of every tile, checking
+// the tiles the cache offers to drop.
+void testRandomized()
+{
+    const std::vector<SGBucket> buckets = createBuckets(1024);
+    TileCache cache;
+    ReferenceTileCache reference;
+    int drops = 0, emptyDrops = 0;
+
+    for (int step = 0; step < 200000; ++step) {
+        const SGBucket& b = buckets[nextRandom(buckets.size())];
+        const long index = b.gen_index();
+        TileEntry* tile = cache.get_tile(index);
+        TileEntry* refTile = reference.get_tile(index);
+        SG_VERIFY((tile == NULL) == (refTile == NULL));
+
+        switch (nextRandom(8)) {
+        case 0: // time passes
+            reference.current_time += 0.25 * nextRandom(8);
+            cache.set_current_time(reference.current_time);
+            break;
+
+        case 1: // new tile, or a request for a known one
+        case 2: {
+            if (!tile) {
+                tile = new TileEntry(b);
+                refTile = new TileEntry(b);
+                cache.insert_tile(tile);
+                reference.insert_tile(refTile);
+            }
+
+            // few distinct priorities and times, so there are ties
+            float priority = -float(nextRandom(4));
+            bool currentView = (nextRandom(3) == 0);
+            double requestTime = 0.5 * nextRandom(6);
+            cache.request_tile(tile, priority, currentView, requestTime);
+            reference.request_tile(refTile, priority, currentView, requestTime);
+            break;
+        }
+
+        case 3: // loaded by the pager
+            if (tile && !tile->is_loaded()) {
+                markLoaded(tile);
+                markLoaded(refTile);
+            }
+            break;
+
+        case 4: // next update of the tile manager
+            cache.clear_current_view();
+            reference.clear_current_view();
+            break;
+
+        default: { // drop a tile
+            std::set<long> candidates = reference.drop_candidates();
+            long drop = cache.get_drop_tile();
+            if (candidates.empty()) {
+                SG_CHECK_EQUAL(drop, -1);
+                break;
+            }
+
+            SG_VERIFY(candidates.count(drop) == 1);
+            if (!reference.get_tile(drop)->is_loaded())
+                ++emptyDrops;
+            ++drops;
+
+            TileEntry* dropped = cache.get_tile(drop);
+            TileEntry* refDropped = reference.get_tile(drop);
+            cache.clear_entry(drop);
+            reference.clear_entry(drop);
+            delete dropped;
+            delete refDropped;
+            break;
+        }
+        }
+
+        long expired = cache.get_first_expired_tile();
+        if (expired < 0) {
+            SG_VERIFY(!reference.has_expired_tile());
+        } else {
+            SG_VERIFY(reference.get_tile(expired)->is_expired(reference.current_time));
+        }
+
+        if ((step % 1000) == 0)
+            checkSameTiles(cache, reference);
+    }
+
+    checkSameTiles(cache, reference);
+    SG_VERIFY(drops > 1000);
+    SG_VERIFY(emptyDrops > 0);
+}
+
+// Time a tile manager like workload of a full cache: every update requests
+// the tiles around the view, then drops the expired ones.
+template<class Cache>
+static double timeUpdates(Cache& cache, const std::vector<SGBucket>& buckets,
+                          int updates, int tilesPerUpdate)
+{
+    randomState = 1;
+    SGTimeStamp t0 = SGTimeStamp::now();
+    for (int update = 0; update < updates; ++update) {
+        double now = update * 0.1;
+        cache.set_current_time(now);
+        cache.clear_current_view();
+
+        int first = nextRandom(buckets.size() - tilesPerUpdate);
+        for (int i = first; i < first + tilesPerUpdate; ++i) {
+            long index = buckets[i].gen_index();
+            TileEntry* tile = cache.get_tile(index);
+            if (!tile) {
+                tile = new TileEntry(buckets[i]);
+                markLoaded(tile);
+                cache.insert_tile(tile);
+            }
+            cache.request_tile(tile, -float(i - first), (i - first) < 9, 30.0);
+        }
+
+        for (long drop = cache.get_drop_tile(); drop >= 0; drop = cache.get_drop_tile()) {
+            TileEntry* tile = cache.get_tile(drop);
+            cache.clear_entry(drop);
+            delete tile;
+        }
+    }
+    return (SGTimeStamp::now() - t0).toUSecs() / double(updates);
+}
+
+// the same interface over the reference, for timeUpdates()
+class TimedReference : public ReferenceTileCache
+{
+public:
+    void set_current_time(double t)
+    { current_time = t; }
+
+    long get_drop_tile() const
+    {
+        std::set<long> candidates = drop_candidates();
+        return candidates.empty() ? -1 : *candidates.begin();
+    }
+};
+
+void testTiming()
+{
+    const std::vector<SGBucket> buckets = createBuckets(4096);
+    const int updates = 2000, tilesPerUpdate = 300;
+
+    TileCache cache;
+    double hashed = timeUpdates(cache, buckets, updates, tilesPerUpdate);
+    TimedReference reference;
+    double scanned = timeUpdates(reference, buckets, updates, tilesPerUpdate);
+
+    std::cout << cache.get_size() << " cached tiles, " << tilesPerUpdate
+              << " requests per update: hash and heaps " << hashed
+              << " us/update, map and scans " << scanned << " us/update"
+              << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    testRandomized();
+    testTiming();
+}
@@ -0,0 +1,269 @@
+#include "config.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+#include <simgear/xml/easyxml.hxx>
+
+#include <Traffic/TimetableCache.hxx>
+
+static const int AircraftCount = 2000;
+static const int FlightsPerAircraft = 10;
+
+static std::string number(const char* format, int n)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), format, n);
+    return buffer;
+}
+
+// a timetable of the size of the traffic shipped with large traffic packs
+static FGTimetable createTimetable()
+{
+    FGTimetable timetable;
+    for (int a = 0; a < AircraftCount; ++a) {
+        FGTimetableAircraft aircraft;
+        aircraft.model = "Aircraft/A320/Models/A320-" + number("%d", a % 7) + ".xml";
+        aircraft.livery = number("LIV%d", a % 40);
+        aircraft.homePort = number("E%03d", a % 300);
+        aircraft.registration = number("D-A%04d", a);
+        aircraft.flightId = number("TST%d", a);
+        aircraft.acType = "A320";
+        aircraft.airline = number("AL%d", a % 40);
+        aircraft.perfClass = "jet_transport";
+        aircraft.flightType = "gate";
+        aircraft.radius = 18.0;
+        aircraft.offset = 2.0;
+        aircraft.heavy = (a % 5) == 0;
+        timetable.aircraft.push_back(aircraft);
+
+        for (int f = 0; f < FlightsPerAircraft; ++f) {
+            FGTimetableFlight flight;
+            flight.callsign = number("TST%05d", a * FlightsPerAircraft + f);
+            flight.fltRules = "IFR";
+            flight.departurePort = number("E%03d", (a + f) % 300);
+            flight.arrivalPort = number("E%03d", (a + f + 1) % 300);
+            flight.departureTime = number("%d/07:00:00", f % 7);
+            flight.arrivalTime = number("%d/09:00:00", f % 7);
+            flight.repeat = "WEEK";
+            flight.requiredAircraft = aircraft.flightId;
+            flight.cruiseAlt = 300 + 10 * f;
+            timetable.flights.push_back(flight);
+        }
+    }
+    return timetable;
+}
+
+// the same timetable as a traffic file
+static void writeTrafficFile(const FGTimetable& timetable, const SGPath& path)
+{
+    sg_ofstream out(path);
+    out << "<?xml version=\"1.0\"?>\n<trafficlist>\n";
+    for (const FGTimetableAircraft& a : timetable.aircraft) {
+        out << " <aircraft>\n"
+            << "  <model>" << a.model << "</model>\n"
+            << "  <livery>" << a.livery << "</livery>\n"
+            << "  <airline>" << a.airline << "</airline>\n"
+            << "  <home-port>" << a.homePort << "</home-port>\n"
+            << "  <required-aircraft>" << a.flightId << "</required-aircraft>\n"
+            << "  <actype>" << a.acType << "</actype>\n"
+            << "  <offset>" << a.offset << "</offset>\n"
+            << "  <radius>" << a.radius << "</radius>\n"
+            << "  <flighttype>" << a.flightType << "</flighttype>\n"
+            << "  <performance-class>" << a.perfClass << "</performance-class>\n"
+            << "  <registration>" << a.registration << "</registration>\n"
+            << "  <heavy>" << (a.heavy ? "true" : "false") << "</heavy>\n"
+            << " </aircraft>\n";
+    }
+    for (const FGTimetableFlight& f : timetable.flights) {
+        out << " <flight>\n"
+            << "  <callsign>" << f.callsign << "</callsign>\n"
+            << "  <required-aircraft>" << f.requiredAircraft << "</required-aircraft>\n"
+            << "  <fltrules>" << f.fltRules << "</fltrules>\n"
+            << "  <departure><port>" << f.departurePort << "</port><time>"
+            << f.departureTime << "</time></departure>\n"
+            << "  <cruise-alt>" << f.cruiseAlt << "</cruise-alt>\n"
+            << "  <arrival><port>" << f.arrivalPort << "</port><time>"
+            << f.arrivalTime << "</time></arrival>\n"
+            << "  <repeat>" << f.repeat << "</repeat>\n"
+            << " </flight>\n";
+    }
+    out << "</trafficlist>\n";
+}
+
+/**
+ * Collects the element values as the schedule parser of the traffic
+ * manager does, without building its timetable: what parsing the XML
+ * costs at least.
+ */
+class ElementCollector : public XMLVisitor
+{
+public:
+    ElementCollector() : elements(0) { }
+
+    virtual void startElement(const char*, const XMLAttributes&)
+    {
+        values.push_back(std::string());
+    }
+    virtual void endElement(const char*)
+    {
+        values.pop_back();
+        ++elements;
+    }
+    virtual void data(const char* s, int len)
+    {
+        values.back() += std::string(s, len);
+    }
+
+    std::vector<std::string> values;
+    unsigned elements;
+};
+
+static void checkEqual(const FGTimetable& a, const FGTimetable& b)
+{
+    SG_CHECK_EQUAL(a.aircraft.size(), b.aircraft.size());
+    for (size_t i = 0; i < a.aircraft.size(); ++i) {
+        const FGTimetableAircraft& x = a.aircraft[i];
+        const FGTimetableAircraft& y = b.aircraft[i];
+        SG_CHECK_EQUAL(x.model, y.model);
+        SG_CHECK_EQUAL(x.livery, y.livery);
+        SG_CHECK_EQUAL(x.homePort, y.homePort);
+        SG_CHECK_EQUAL(x.registration, y.registration);
+        SG_CHECK_EQUAL(x.flightId, y.flightId);
+        SG_CHECK_EQUAL(x.acType, y.acType);
+        SG_CHECK_EQUAL(x.airline, y.airline);
+        SG_CHECK_EQUAL(x.perfClass, y.perfClass);
+        SG_CHECK_EQUAL(x.flightType, y.flightType);
+        SG_CHECK_EQUAL(x.radius, y.radius);
+        SG_CHECK_EQUAL(x.offset, y.offset);
+        SG_CHECK_EQUAL(x.heavy, y.heavy);
+    }
+
+    SG_CHECK_EQUAL(a.flights.size(), b.flights.size());
+    for (size_t i = 0; i < a.flights.size(); ++i) {
+        const FGTimetableFlight& x = a.flights[i];
+        const FGTimetableFlight& y = b.flights[i];
+        SG_CHECK_EQUAL(x.callsign, y.callsign);
+        SG_CHECK_EQUAL(x.fltRules, y.fltRules);
+        SG_CHECK_EQUAL(x.departurePort, y.departurePort);
+        SG_CHECK_EQUAL(x.arrivalPort, y.arrivalPort);
+        SG_CHECK_EQUAL(x.departureTime, y.departureTime);
+        SG_CHECK_EQUAL(x.arrivalTime, y.arrivalTime);
+        SG_CHECK_EQUAL(x.repeat, y.repeat);
+        SG_CHECK_EQUAL(x.requiredAircraft, y.requiredAircraft);
+        SG_CHECK_EQUAL(x.cruiseAlt, y.cruiseAlt);
+    }
+}
+
+void testSaveAndLoad(const SGPath& dir)
+{
+    FGTimetable timetable = createTimetable();
+    SGPath trafficPath = dir / "traffic.xml";
+    SGPath includePath = dir / "include.xml";
+    writeTrafficFile(timetable, trafficPath);
+    writeTrafficFile(FGTimetable(), includePath);
+    timetable.files.push_back(FGTimetable::source(trafficPath));
+    timetable.includes.push_back(FGTimetable::source(includePath));
+
+    SGPath cachePath = dir / "timetable-cache.bin";
+    SG_VERIFY(timetable.save(cachePath));
+
+    FGTimetable loaded;
+    SG_VERIFY(loaded.load(cachePath, timetable.files));
+    checkEqual(timetable, loaded);
+    SG_VERIFY(loaded.files == timetable.files);
+    SG_VERIFY(loaded.includes == timetable.includes);
+
+    // a modified, added or removed traffic file makes it outdated
+    FGTimetable::SourceList files = timetable.files;
+    files[0].modTime += 1;
+    SG_VERIFY(!loaded.load(cachePath, files));
+    SG_VERIFY(loaded.aircraft.empty());
+    SG_VERIFY(loaded.flights.empty());
+
+    files = timetable.files;
+    files.push_back(FGTimetable::source(includePath));
+    SG_VERIFY(!loaded.load(cachePath, files));
+    SG_VERIFY(!loaded.load(cachePath, FGTimetable::SourceList()));
+
+    // as does a missing include
+    includePath.remove();
+    SG_VERIFY(!loaded.load(cachePath, timetable.files));
+}
+
+void testCorruptCache(const SGPath& dir)
+{
+    FGTimetable timetable = createTimetable();
+    SGPath cachePath = dir / "timetable-cache.bin";
+    SG_VERIFY(timetable.save(cachePath));
+
+    std::string contents;
+    {
+        sg_ifstream in(cachePath, std::ios::binary | std::ios::in);
+        contents.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>());
+    }
+
+    // truncated anywhere, it is rejected and leaves nothing behind
+    const size_t cuts[] = { 3, 20, contents.size() / 2, contents.size() - 1 };
+    for (size_t cut : cuts) {
+        SGPath truncated = dir / "truncated.bin";
+        {
+            sg_ofstream out(truncated, std::ios::binary | std::ios::out);
+            out.write(contents.data(), cut);
+        }
+        FGTimetable loaded;
+        SG_VERIFY(!loaded.load(truncated, timetable.files));
+        SG_VERIFY(loaded.aircraft.empty());
+        SG_VERIFY(loaded.flights.empty());
+    }
+
+    FGTimetable loaded;
+    SG_VERIFY(!loaded.load(dir / "missing.bin", timetable.files));
+}
+
+// Loading the cache against reading the same schedules as XML
+void testTiming(const SGPath& dir)
+{
+    FGTimetable timetable = createTimetable();
+    SGPath trafficPath = dir / "traffic.xml";
+    writeTrafficFile(timetable, trafficPath);
+    timetable.files.push_back(FGTimetable::source(trafficPath));
+    SGPath cachePath = dir / "timetable-cache.bin";
+    SG_VERIFY(timetable.save(cachePath));
+
+    SGTimeStamp t0 = SGTimeStamp::now();
+    ElementCollector collector;
+    readXML(trafficPath, collector);
+    SGTimeStamp parseTime = SGTimeStamp::now() - t0;
+    SG_VERIFY(collector.elements > unsigned(AircraftCount * FlightsPerAircraft));
+
+    t0 = SGTimeStamp::now();
+    FGTimetable loaded;
+    SG_VERIFY(loaded.load(cachePath, timetable.files));
+    SGTimeStamp loadTime = SGTimeStamp::now() - t0;
+    SG_CHECK_EQUAL(loaded.flights.size(), timetable.flights.size());
+
+    std::cout << AircraftCount << " aircraft, " << timetable.flights.size()
+              << " flights: XML " << trafficPath.sizeInBytes() / 1024 << " kB read in "
+              << parseTime.toMSecs() << " ms, cache " << cachePath.sizeInBytes() / 1024
+              << " kB loaded in " << loadTime.toMSecs() << " ms" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    simgear::Dir tmp = simgear::Dir::tempDir("fgtest-timetablecache");
+    tmp.setRemoveOnDestroy();
+
+    testSaveAndLoad(tmp.path());
+    testCorruptCache(tmp.path());
+    testTiming(tmp.path());
+}